@@ -752,7 +752,7 @@ TDNFOpenHandle(
 
     if(!pArgs->nAllDeps)
     {
-        dwError = SolvReadInstalledRpms(pSack->pPool->installed, pszCacheDir);
+        dwError = SolvReadInstalledRpms(pSack, pTdnf->pConf->pszCacheDir);
         BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
     }
 
@@ -767,9 +767,6 @@ TDNFOpenHandle(
     dwError = TDNFInitCmdLineRepo(pTdnf, pSack);
     BAIL_ON_TDNF_ERROR(dwError);
 
-    pool_addfileprovides(pSack->pPool);
-    pool_createwhatprovides(pSack->pPool);
-
     pTdnf->pSack = pSack;
     *ppTdnf = pTdnf;
 
@@ -911,9 +908,8 @@ TDNFAddCmdLinePackages(
         queue_push(pQueueGoal, id);
     }
 
-    pool_addfileprovides(pSack->pPool);
-    pool_createwhatprovides(pSack->pPool);
     repo_internalize(pTdnf->pSolvCmdLineRepo);
+    pSack->nProvidesDirty = 1;
 
 cleanup:
     TDNF_SAFE_FREE_MEMORY(pszRPMPath);
@@ -958,7 +954,8 @@ TDNFProvides(
     dwError = SolvGetQueryResult(pQuery, &pPkgList);
     BAIL_ON_TDNF_ERROR(dwError);
 
-    dwError = TDNFPopulatePkgInfos(pTdnf->pSack, pPkgList, &pPkgInfo);
+    dwError = TDNFPopulatePkgInfos(pTdnf->pSack, pPkgList,
+                                   PKGINFO_FIELD_SUMMARY, &pPkgInfo);
     BAIL_ON_TDNF_ERROR(dwError);
 
     *ppPkgInfo = pPkgInfo;
@@ -1060,60 +1057,6 @@ error:
     goto cleanup;
 }
 
-static int
-_rm_rpms(
-    const char *pszFilePath,
-    const struct stat *sbuf,
-    int type,
-    struct FTW *ftwb
-    )
-{
-    uint32_t dwError = 0;
-    char *pszKeepFile = NULL;
-    struct stat statKeep = {0};
-
-    UNUSED(sbuf);
-    UNUSED(type);
-    UNUSED(ftwb);
-
-    if (strcmp(&pszFilePath[strlen(pszFilePath)-4], ".rpm") == 0)
-    {
-        dwError = TDNFAllocateStringPrintf(&pszKeepFile, "%s.reposync-keep", pszFilePath);
-        BAIL_ON_TDNF_ERROR(dwError);
-
-        if (stat(pszKeepFile, &statKeep))
-        {
-            if (errno == ENOENT)
-            {
-                pr_info("deleting %s\n", pszFilePath);
-                if(remove(pszFilePath) < 0)
-                {
-                    pr_crit("unable to remove %s: %s\n", pszFilePath, strerror(errno));
-                }
-            }
-            else
-            {
-                dwError = errno;
-                BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
-            }
-        }
-        else
-        {
-            /* marker file can be removed now */
-            /* coverity[toctou] */
-            if(remove(pszKeepFile) < 0)
-            {
-                pr_crit("unable to remove %s: %s\n", pszKeepFile, strerror(errno));
-            }
-        }
-    }
-cleanup:
-    TDNF_SAFE_FREE_MEMORY(pszKeepFile);
-    return (int)dwError;
-error:
-    goto cleanup;
-}
-
 uint32_t
 TDNFRepoSync(
     PTDNF pTdnf,
@@ -1121,7 +1064,6 @@ TDNFRepoSync(
     )
 {
     uint32_t dwError = 0;
-    int ret;
     PTDNF_PKG_INFO pPkgInfos = NULL;
     PTDNF_PKG_INFO pPkgInfo = NULL;
     PTDNF_REPO_DATA pRepo = NULL;
@@ -1130,12 +1072,9 @@ TDNFRepoSync(
     PSolvPackageList pPkgList = NULL;
     char *pszRootPath = NULL;
     char *pszUrl = NULL;
-    char *pszDir = NULL;
-    char *pszFilePath = NULL;
-    char *pszKeepFile = NULL;
     uint32_t dwCount = 0;
     uint32_t dwRepoCount = 0;
-    TDNFRPMTS ts = {0};
+    PTDNF_REPOSYNC_CTX pSync = NULL;
 
     if(!pTdnf || !pTdnf->pSack || !pReposyncArgs)
     {
@@ -1196,16 +1135,6 @@ TDNFRepoSync(
     dwError = TDNFPopulatePkgInfoForRepoSync(pTdnf->pSack, pPkgList, &pPkgInfos);
     BAIL_ON_TDNF_ERROR(dwError);
 
-    if (pReposyncArgs->nGPGCheck)
-    {
-        ts.pTS = rpmtsCreate();
-        if(!ts.pTS)
-        {
-            dwError = ERROR_TDNF_RPMTS_CREATE_FAILED;
-            BAIL_ON_TDNF_ERROR(dwError);
-        }
-    }
-
     if (pReposyncArgs->pszDownloadPath == NULL)
     {
         pszRootPath = getcwd(NULL, 0);
@@ -1225,6 +1154,12 @@ TDNFRepoSync(
         TDNFPkgInfoFilterNewest(pTdnf->pSack, pPkgInfos);
     }
 
+    if (!pReposyncArgs->nPrintUrlsOnly)
+    {
+        dwError = TDNFRepoMirrorCreate(pTdnf, pReposyncArgs, pszRootPath, &pSync);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
     /* iterate through all packages */
     for (pPkgInfo = pPkgInfos; pPkgInfo; pPkgInfo = pPkgInfo->pNext)
     {
@@ -1252,70 +1187,8 @@ TDNFRepoSync(
 
         if (!pReposyncArgs->nPrintUrlsOnly)
         {
-            PTDNF_REPO_DATA pPkgRepo = NULL;
-
-            if (!pReposyncArgs->nNoRepoPath)
-            {
-                dwError = TDNFJoinPath(&pszDir,
-                                       pszRootPath && strcmp(pszRootPath, "/") ? pszRootPath : "",
-                                       pPkgInfo->pszRepoName,
-                                       NULL);
-                BAIL_ON_TDNF_ERROR(dwError);
-            }
-            else
-            {
-                dwError = TDNFAllocateString(pszRootPath, &pszDir);
-                BAIL_ON_TDNF_ERROR(dwError);
-            }
-
-            dwError = TDNFUtilsMakeDir(pszDir);
-            BAIL_ON_TDNF_ERROR(dwError);
-
-            dwError = TDNFFindRepoById(pTdnf, pPkgInfo->pszRepoName, &pPkgRepo);
-            BAIL_ON_TDNF_ERROR(dwError);
-
-            dwError = TDNFDownloadPackageToTree(pTdnf,
-                            pPkgInfo->pszLocation, pPkgInfo->pszName,
-                            pPkgRepo, pszDir,
-                            &pszFilePath);
+            dwError = TDNFRepoMirrorAdd(pSync, pPkgInfo);
             BAIL_ON_TDNF_ERROR(dwError);
-
-            /* if gpgcheck option is given, check for a valid signature. If that fails,
-               delete the package */
-            if (pReposyncArgs->nGPGCheck)
-            {
-                dwError = TDNFGPGCheckPackage(&ts, pTdnf, pPkgRepo, pszFilePath, NULL);
-                if (dwError != RPMRC_NOTTRUSTED && dwError != RPMRC_NOKEY)
-                {
-                    BAIL_ON_TDNF_ERROR(dwError);
-                }
-                else if (dwError)
-                {
-                    pr_crit("checking package %s failed: %d, deleting\n", pszFilePath, dwError);
-                    if(remove(pszFilePath) < 0)
-                    {
-                        pr_crit("unable to remove %s: %s\n", pszFilePath, strerror(errno));
-                    }
-                }
-            }
-
-            /* dwError==0 means TDNFGPGCheckPackage() succeeded or wasn't called */
-            if (pReposyncArgs->nDelete && dwError == 0)
-            {
-                /* if "delete" option is given, create a marker file to protect
-                   what we just downloaded. Later all *.rpm files that do not
-                   have a marker file will be deleted */
-                dwError = TDNFAllocateStringPrintf(&pszKeepFile, "%s.reposync-keep", pszFilePath);
-                BAIL_ON_TDNF_ERROR(dwError);
-
-                dwError = TDNFTouchFile(pszKeepFile);
-                BAIL_ON_TDNF_ERROR(dwError);
-                TDNF_SAFE_FREE_MEMORY(pszKeepFile);
-            }
-            dwError = 0;
-
-            TDNF_SAFE_FREE_MEMORY(pszDir);
-            TDNF_SAFE_FREE_MEMORY(pszFilePath);
         }
         else
         {
@@ -1332,38 +1205,11 @@ TDNFRepoSync(
         }
     }
 
-    if (pReposyncArgs->nDelete)
+    /* download, verify, and with delete remove what was not synced */
+    if (pSync)
     {
-        /* go through all packages in the destination directory,
-           delete those that were not just downloaded as indicated by the
-           marker file */
-        for (pRepo = pTdnf->pRepos; pRepo; pRepo = pRepo->pNext)
-        {
-            if ((strcmp(pRepo->pszName, CMDLINE_REPO_NAME) == 0) ||
-                (!pRepo->nEnabled))
-            {
-                continue;
-            }
-
-            /* no need to check nNoRepoPath since we wouldn't get here */
-            dwError = TDNFJoinPath(&pszRepoDir,
-                                   pszRootPath && strcmp(pszRootPath, "/") ? pszRootPath : "",
-                                   pRepo->pszId,
-                                   NULL);
-            BAIL_ON_TDNF_ERROR(dwError);
-
-            ret = nftw(pszRepoDir, _rm_rpms, 10, FTW_DEPTH|FTW_PHYS);
-            if (ret < 0)
-            {
-                dwError = errno;
-                BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
-            }
-            else
-            {
-                dwError = ret;
-                BAIL_ON_TDNF_ERROR(dwError);
-            }
-        }
+        dwError = TDNFRepoMirrorRun(pSync);
+        BAIL_ON_TDNF_ERROR(dwError);
     }
 
     if (pReposyncArgs->nDownloadMetadata)
@@ -1416,16 +1262,9 @@ cleanup:
     {
         SolvFreePackageList(pPkgList);
     }
-    if(ts.pTS)
-    {
-        rpmtsCloseDB(ts.pTS);
-        rpmtsFree(ts.pTS);
-    }
-    TDNF_SAFE_FREE_MEMORY(pszDir);
+    TDNFFreeRepoMirror(pSync);
     TDNF_SAFE_FREE_MEMORY(pszRepoDir);
     TDNF_SAFE_FREE_MEMORY(pszRootPath);
-    TDNF_SAFE_FREE_MEMORY(pszKeepFile);
-    TDNF_SAFE_FREE_MEMORY(pszFilePath);
     TDNFFreePackageInfoArray(pPkgInfos, dwCount);
     return dwError;
 error:
@@ -1861,10 +1700,7 @@ TDNFSearchCommand(
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
-    dwError = TDNFAllocateMemory(
-                  unCount,
-                  sizeof(TDNF_PKG_INFO),
-                  (void**)&pPkgInfo);
+    dwError = TDNFAllocatePkgInfoArray(unCount, &pPkgInfo);
     BAIL_ON_TDNF_ERROR(dwError);
 
     for(nIndex = 0; (uint32_t)nIndex < unCount; nIndex++)
@@ -1874,12 +1710,19 @@ TDNFSearchCommand(
         dwError = SolvGetPackageId(pPkgList, nIndex, &dwPkgId);
         BAIL_ON_TDNF_ERROR(dwError);
 
-        dwError = SolvGetPkgNameFromId(pTdnf->pSack, dwPkgId, &pPkg->pszName);
+        dwError = TDNFPkgInfoLookupString(
+                      pTdnf->pSack,
+                      dwPkgId,
+                      pPkg,
+                      SOLVABLE_NAME,
+                      &pPkg->pszName);
         BAIL_ON_TDNF_ERROR(dwError);
 
-        dwError = SolvGetPkgSummaryFromId(
+        dwError = TDNFPkgInfoLookupString(
                       pTdnf->pSack,
                       dwPkgId,
+                      pPkg,
+                      SOLVABLE_SUMMARY,
                       &pPkg->pszSummary);
         BAIL_ON_TDNF_ERROR(dwError);
     }
@@ -2107,14 +1950,24 @@ TDNFHistoryResolve(
             BAIL_ON_TDNF_ERROR(dwError);
         }
     }
+    else if (pHistoryArgs->nCommand == HISTORY_CMD_COMPACT)
+    {
+        /* nTo == 0 compacts up to the latest transaction */
+        if (pHistoryArgs->nTo < 0)
+        {
+            dwError = ERROR_TDNF_INVALID_PARAMETER;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+    }
     else if (pHistoryArgs->nCommand != HISTORY_CMD_INIT)
     {
         dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
-    /* no need to refresh cache when initializing db */
-    if (pHistoryArgs->nCommand != HISTORY_CMD_INIT) {
+    /* no need to refresh cache when only changing the db */
+    if (pHistoryArgs->nCommand != HISTORY_CMD_INIT &&
+        pHistoryArgs->nCommand != HISTORY_CMD_COMPACT) {
         dwError = TDNFRefresh(pTdnf);
         BAIL_ON_TDNF_ERROR(dwError);
     }
@@ -2153,6 +2006,14 @@ TDNFHistoryResolve(
     {
         case HISTORY_CMD_INIT:
             goto cleanup;
+        case HISTORY_CMD_COMPACT:
+            rc = history_compact(ctx, pHistoryArgs->nTo ? pHistoryArgs->nTo : ctx->trans_id);
+            if (rc != 0)
+            {
+                dwError = ERROR_TDNF_HISTORY_ERROR;
+                BAIL_ON_TDNF_ERROR(dwError);
+            }
+            goto cleanup;
         case HISTORY_CMD_ROLLBACK:
             hd = history_get_delta(ctx, pHistoryArgs->nTo);
             hfd = history_get_flags_delta(ctx, ctx->trans_id, pHistoryArgs->nTo);
@@ -2460,7 +2321,10 @@ TDNFMark(
     PSolvPackageList pPkgList = NULL;
     struct history_ctx *ctx = NULL;
     char *pszCmdLine = NULL;
-    char *pszName = NULL;
+    char **ppszNames = NULL;
+    int *pnValues = NULL;
+    int nCount = 0;
+    int rc;
 
     if(!pTdnf || !pTdnf->pSack || !ppszPackageNameSpecs)
     {
@@ -2497,24 +2361,30 @@ TDNFMark(
         history_add_transaction(ctx, pszCmdLine);
         BAIL_ON_TDNF_ERROR(dwError);
 
-        for (int i = 0; i < pPkgList->queuePackages.count; i++)
-        {
-            int rc;
+        nCount = pPkgList->queuePackages.count;
+        dwError = TDNFAllocateMemory(nCount + 1, sizeof(char *),
+                                     (void **)&ppszNames);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        dwError = TDNFAllocateMemory(nCount, sizeof(int), (void **)&pnValues);
+        BAIL_ON_TDNF_ERROR(dwError);
 
+        for (int i = 0; i < nCount; i++)
+        {
             dwError = SolvGetPkgNameFromId(pTdnf->pSack,
                                            pPkgList->queuePackages.elements[i],
-                                           &pszName);
+                                           &ppszNames[i]);
             BAIL_ON_TDNF_ERROR(dwError);
 
-            pr_info("marking %s as %sinstalled\n", pszName, dwValue ? "auto" : "user");
+            pr_info("marking %s as %sinstalled\n", ppszNames[i], dwValue ? "auto" : "user");
+            pnValues[i] = dwValue;
+        }
 
-            rc = history_set_auto_flag(ctx, pszName, dwValue);
-            if (rc != 0)
-            {
-                dwError = ERROR_TDNF_HISTORY_ERROR;
-                BAIL_ON_TDNF_ERROR(dwError);
-            }
-            TDNF_SAFE_FREE_MEMORY(pszName);
+        rc = history_set_auto_flags(ctx, (const char **)ppszNames, pnValues, nCount);
+        if (rc != 0)
+        {
+            dwError = ERROR_TDNF_HISTORY_ERROR;
+            BAIL_ON_TDNF_ERROR(dwError);
         }
     }
     else
@@ -2525,7 +2395,8 @@ TDNFMark(
 
 cleanup:
     TDNF_SAFE_FREE_MEMORY(pszCmdLine);
-    TDNF_SAFE_FREE_MEMORY(pszName);
+    TDNFFreeStringArray(ppszNames);
+    TDNF_SAFE_FREE_MEMORY(pnValues);
     destroy_history_ctx(ctx);
     if(pQuery)
     {
@@ -2548,6 +2419,11 @@ TDNFCloseHandle(
 {
     if(pTdnf)
     {
+        if(pTdnf->pCurlPool)
+        {
+            TDNFCurlPoolShowStats(pTdnf);
+            TDNFFreeCurlPool(pTdnf->pCurlPool);
+        }
         if(pTdnf->pRepos)
         {
             TDNFFreeReposInternal(pTdnf->pRepos);
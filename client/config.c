@@ -151,6 +151,18 @@ TDNFConfigFromCnfTree(PTDNF_CONF pConf, struct cnfnode *cn_top)
         {
             pConf->nOpenMax = strtoi(cn->value);
         }
+        else if (strcmp(cn->name, TDNF_CONF_KEY_MAX_PARALLEL_DOWNLOADS) == 0)
+        {
+            pConf->nMaxParallelDownloads = strtoi(cn->value);
+        }
+        else if (strcmp(cn->name, TDNF_CONF_KEY_MAX_HOST_CONNECTIONS) == 0)
+        {
+            pConf->nMaxHostConnections = strtoi(cn->value);
+        }
+        else if (strcmp(cn->name, TDNF_CONF_KEY_HISTORY_SNAPSHOT_INTERVAL) == 0)
+        {
+            pConf->nHistorySnapshotInterval = strtoi(cn->value);
+        }
         else if (strcmp(cn->name, TDNF_CONF_KEY_CHECK_UPDATE_COMPAT) == 0)
         {
             pConf->nCheckUpdateCompat = isTrue(cn->value);
@@ -255,6 +267,9 @@ TDNFReadConfig(
     pConf->nOpenMax = TDNF_CONF_DEFAULT_OPENMAX;
     pConf->nInstallOnlyLimit = TDNF_CONF_DEFAULT_INSTALLONLY_LIMIT;
     pConf->nSSLVerify = TDNF_CONF_DEFAULT_SSLVERIFY;
+    pConf->nMaxParallelDownloads = TDNF_CONF_DEFAULT_MAX_PARALLEL_DOWNLOADS;
+    pConf->nMaxHostConnections = TDNF_CONF_DEFAULT_MAX_HOST_CONNECTIONS;
+    pConf->nHistorySnapshotInterval = TDNF_CONF_DEFAULT_HISTORY_SNAPSHOT_INTERVAL;
 
     register_ini(NULL);
     mod_ini = find_cnfmodule("ini");
@@ -19,6 +19,53 @@ typedef enum
     DETAIL_SOURCEPKG
 }TDNF_PKG_DETAIL;
 
+/*
+ * Columns filled in by TDNFPopulatePkgInfos(). Name, arch, evr and
+ * repo are always filled in, callers ask for the rest.
+ */
+typedef enum
+{
+    PKGINFO_FIELD_SUMMARY  = 1 << 0,
+    PKGINFO_FIELD_LOCATION = 1 << 1,
+    PKGINFO_FIELD_CHECKSUM = 1 << 2,
+    PKGINFO_FIELD_SIZES    = 1 << 3
+}TDNF_PKG_INFO_FIELD;
+
+/* what a package to be downloaded and installed needs */
+#define PKGINFO_FIELDS_INSTALL \
+    (PKGINFO_FIELD_LOCATION | PKGINFO_FIELD_CHECKSUM | PKGINFO_FIELD_SIZES)
+/* packages to be removed only have their sizes printed */
+#define PKGINFO_FIELDS_ERASE PKGINFO_FIELD_SIZES
+
+typedef enum
+{
+    DOWNLOAD_PENDING,
+    DOWNLOAD_ACTIVE,
+    DOWNLOAD_DONE
+}TDNF_DOWNLOAD_STATE;
+
+/* delay before the first retry of a download, doubled for each
+   further retry up to the max */
+#define DOWNLOAD_RETRY_DELAY_MS     500
+#define DOWNLOAD_RETRY_DELAY_MAX_MS 8000
+
+typedef enum
+{
+    REPOSYNC_FILE_CHECK,
+    REPOSYNC_FILE_DOWNLOAD,
+    REPOSYNC_FILE_DONE,
+    REPOSYNC_FILE_REMOVED
+}TDNF_REPOSYNC_FILE_STATE;
+
+/* what is known to be good about a synced file */
+#define REPOSYNC_VERIFIED_DIGEST    0x1
+#define REPOSYNC_VERIFIED_SIGNATURE 0x2
+
+/* followed by the repo id, repos may share a directory */
+#define REPOSYNC_JOURNAL_PREFIX ".reposync-state-"
+/* downloads between two journal updates */
+#define REPOSYNC_DOWNLOAD_BATCH 256
+
 #define BAIL_ON_TDNF_RPM_ERROR(dwError) \
     do {                                                           \
         if (dwError)                                               \
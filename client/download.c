@@ -0,0 +1,1282 @@
+/*
+ * Copyright (C) 2023 VMware, Inc. All Rights Reserved.
+ *
+ * Licensed under the GNU Lesser General Public License v2.1 (the "License");
+ * you may not use this file except in compliance with the License. The terms
+ * of the License are located in the COPYING file of this distribution.
+ */
+
+/*
+ * Download queue. Callers collect the files they need with
+ * TDNFDownloadQueueAdd() and fetch them in one go with
+ * TDNFDownloadQueueRun(), which drives up to max_parallel_downloads
+ * transfers at a time through a curl multi handle, with at most
+ * max_host_connections to one host. Failed transfers are retried
+ * after a delay that doubles with each retry.
+ *
+ * Items can carry the expected checksum and size of the file
+ * (TDNFDownloadQueueSetVerify()). Those are checked as the data is
+ * written, so a wrong file is caught without reading it again.
+ *
+ * Curl handle pool. All transfers of a tdnf handle take their curl
+ * easy handle from a per repo pool instead of creating a new one.
+ * The handles share DNS, TLS sessions and connections through a curl
+ * share handle, so keep-alive and session resumption work across
+ * repomd, metadata, keys and packages.
+ */
+
+#include "includes.h"
+
+static
+uint32_t
+_TDNFDownloadItemStart(
+    PTDNF pTdnf,
+    CURLM *pMulti,
+    PTDNF_DOWNLOAD_ITEM pItem
+    );
+
+static
+uint32_t
+_TDNFDownloadItemDone(
+    PTDNF pTdnf,
+    PTDNF_DOWNLOAD_ITEM pItem,
+    CURLcode nResult
+    );
+
+static
+int
+_TDNFDownloadRepoLimit(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepo
+    );
+
+static
+uint64_t
+_TDNFDownloadNow(
+    void
+    );
+
+static
+size_t
+_TDNFDownloadWrite(
+    char *pData,
+    size_t nSize,
+    size_t nMemb,
+    void *pUserData
+    );
+
+static
+uint32_t
+_TDNFDownloadItemVerify(
+    PTDNF_DOWNLOAD_ITEM pItem
+    );
+
+static
+uint32_t
+_TDNFDownloadFileVerify(
+    PTDNF_DOWNLOAD_ITEM pItem
+    );
+
+static
+PTDNF_DOWNLOAD_ITEM
+_TDNFDownloadQueueFind(
+    PTDNF_DOWNLOAD_QUEUE pQueue,
+    const char *pszFile
+    );
+
+static
+void
+_TDNFFreeDownloadItem(
+    PTDNF_DOWNLOAD_ITEM pItem
+    );
+
+static
+uint32_t
+_TDNFCreateCurlPool(
+    PTDNF_CURL_POOL *ppPool
+    );
+
+static
+void
+_TDNFFreeCurlHandle(
+    PTDNF_CURL_HANDLE pHandle
+    );
+
+uint32_t
+TDNFDownloadQueueCreate(
+    PTDNF_DOWNLOAD_QUEUE *ppQueue
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_DOWNLOAD_QUEUE pQueue = NULL;
+
+    if(!ppQueue)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFAllocateMemory(1, sizeof(TDNF_DOWNLOAD_QUEUE),
+                                 (void **)&pQueue);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    stringpool_init_empty(&pQueue->files);
+
+    *ppQueue = pQueue;
+cleanup:
+    return dwError;
+error:
+    goto cleanup;
+}
+
+uint32_t
+TDNFDownloadQueueAdd(
+    PTDNF_DOWNLOAD_QUEUE pQueue,
+    PTDNF_REPO_DATA pRepo,
+    const char *pszLocation,
+    const char *pszFile,
+    const char *pszProgressData
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_DOWNLOAD_ITEM pItem = NULL;
+    PTDNF_DOWNLOAD_ITEM *ppItemsById = NULL;
+    Id idFile = 0;
+    int nItemsById = 0;
+
+    if(!pQueue || !pRepo ||
+       IsNullOrEmptyString(pszLocation) ||
+       IsNullOrEmptyString(pszFile))
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    /* the same file may be requested more than once */
+    idFile = stringpool_str2id(&pQueue->files, pszFile, 1);
+    if (idFile < pQueue->nItemsById && pQueue->ppItemsById[idFile])
+    {
+        goto cleanup;
+    }
+
+    if (idFile >= pQueue->nItemsById)
+    {
+        nItemsById = pQueue->nItemsById ? pQueue->nItemsById * 2 : 64;
+        while (nItemsById <= idFile)
+        {
+            nItemsById *= 2;
+        }
+        ppItemsById = pQueue->ppItemsById;
+        dwError = TDNFReAllocateMemory(nItemsById * sizeof(PTDNF_DOWNLOAD_ITEM),
+                                       (void **)&ppItemsById);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        memset(ppItemsById + pQueue->nItemsById, 0,
+               (nItemsById - pQueue->nItemsById) * sizeof(PTDNF_DOWNLOAD_ITEM));
+        pQueue->ppItemsById = ppItemsById;
+        pQueue->nItemsById = nItemsById;
+    }
+
+    dwError = TDNFAllocateMemory(1, sizeof(TDNF_DOWNLOAD_ITEM),
+                                 (void **)&pItem);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    pItem->pRepo = pRepo;
+    pItem->nState = DOWNLOAD_PENDING;
+
+    dwError = TDNFAllocateString(pszLocation, &pItem->pszLocation);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFAllocateString(pszFile, &pItem->pszFile);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFSafeAllocateString(pszProgressData, &pItem->pszProgressData);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFAllocateStringPrintf(&pItem->pszFileTmp, "%s.tmp", pszFile);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (pQueue->pTail)
+    {
+        pQueue->pTail->pNext = pItem;
+    }
+    else
+    {
+        pQueue->pHead = pItem;
+    }
+    pQueue->pTail = pItem;
+    pQueue->ppItemsById[idFile] = pItem;
+    pQueue->nCount++;
+
+cleanup:
+    return dwError;
+error:
+    _TDNFFreeDownloadItem(pItem);
+    goto cleanup;
+}
+
+uint32_t
+TDNFDownloadQueueRun(
+    PTDNF pTdnf,
+    PTDNF_DOWNLOAD_QUEUE pQueue
+    )
+{
+    uint32_t dwError = 0;
+    CURLM *pMulti = NULL;
+    CURLMsg *pMsg = NULL;
+    PTDNF_DOWNLOAD_ITEM pItem = NULL;
+    PTDNF_DOWNLOAD_ITEM pFirstPending = NULL;
+    PTDNF_DOWNLOAD_ITEM *ppActive = NULL;
+    int nMax = 0;
+    int nMaxHost = 0;
+    int nActive = 0;
+    int nRunning = 0;
+    int nMsgs = 0;
+    int nSchedule = 1;
+    uint64_t qwNow = 0;
+    uint64_t qwNextRetry = 0;
+    long lTimeout = 0;
+    int i, j;
+
+    if(!pTdnf || !pTdnf->pConf || !pTdnf->pArgs || !pQueue)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if (!pQueue->pHead)
+    {
+        goto cleanup;
+    }
+
+    nMax = pTdnf->pConf->nMaxParallelDownloads;
+    if (nMax > pQueue->nCount)
+    {
+        nMax = pQueue->nCount;
+    }
+
+    /* nothing to parallelize, keep the usual progress output */
+    if (nMax <= 1)
+    {
+        for (pItem = pQueue->pHead; pItem; pItem = pItem->pNext)
+        {
+            dwError = TDNFDownloadFileFromRepo(pTdnf,
+                                               pItem->pRepo,
+                                               pItem->pszLocation,
+                                               pItem->pszFile,
+                                               pItem->pszProgressData);
+            if (!dwError)
+            {
+                dwError = _TDNFDownloadFileVerify(pItem);
+            }
+            pItem->nState = DOWNLOAD_DONE;
+            if (dwError && pQueue->nContinueOnError)
+            {
+                pItem->dwError = dwError;
+                dwError = 0;
+            }
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+        goto cleanup;
+    }
+
+    pMulti = curl_multi_init();
+    if (!pMulti)
+    {
+        dwError = ERROR_TDNF_CURL_INIT;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    /* repos often share a mirror host, don't open all connections
+       to one of them */
+    nMaxHost = pTdnf->pConf->nMaxHostConnections;
+    if (nMaxHost <= 0 || nMaxHost > nMax)
+    {
+        nMaxHost = nMax;
+    }
+    if (curl_multi_setopt(pMulti, CURLMOPT_MAX_TOTAL_CONNECTIONS,
+                          (long)nMax) != CURLM_OK ||
+        curl_multi_setopt(pMulti, CURLMOPT_MAX_HOST_CONNECTIONS,
+                          (long)nMaxHost) != CURLM_OK)
+    {
+        dwError = ERROR_TDNF_CURL_INIT;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFAllocateMemory(nMax, sizeof(PTDNF_DOWNLOAD_ITEM),
+                                 (void **)&ppActive);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    pFirstPending = pQueue->pHead;
+    while (pFirstPending || nActive > 0)
+    {
+        /* fill free slots in queue order, skipping items whose
+           repo is already at its own limit */
+        if (nSchedule)
+        {
+            qwNow = _TDNFDownloadNow();
+            qwNextRetry = 0;
+            while (pFirstPending && pFirstPending->nState != DOWNLOAD_PENDING)
+            {
+                pFirstPending = pFirstPending->pNext;
+            }
+            for (pItem = pFirstPending;
+                 pItem && nActive < nMax;
+                 pItem = pItem->pNext)
+            {
+                int nRepoActive = 0;
+
+                if (pItem->nState != DOWNLOAD_PENDING)
+                {
+                    continue;
+                }
+                /* retries back off, remember the first one due */
+                if (pItem->qwRetryAt > qwNow)
+                {
+                    if (!qwNextRetry || pItem->qwRetryAt < qwNextRetry)
+                    {
+                        qwNextRetry = pItem->qwRetryAt;
+                    }
+                    continue;
+                }
+                for (i = 0; i < nActive; i++)
+                {
+                    if (ppActive[i]->pRepo == pItem->pRepo)
+                    {
+                        nRepoActive++;
+                    }
+                }
+                if (nRepoActive >= _TDNFDownloadRepoLimit(pTdnf, pItem->pRepo))
+                {
+                    continue;
+                }
+
+                dwError = _TDNFDownloadItemStart(pTdnf, pMulti, pItem);
+                if (dwError && pQueue->nContinueOnError)
+                {
+                    pItem->dwError = dwError;
+                    pItem->nState = DOWNLOAD_DONE;
+                    dwError = 0;
+                    continue;
+                }
+                BAIL_ON_TDNF_ERROR(dwError);
+                ppActive[nActive++] = pItem;
+            }
+            nSchedule = 0;
+        }
+
+        if (nActive == 0)
+        {
+            /* only retries are left, wait for the first one */
+            qwNow = _TDNFDownloadNow();
+            if (qwNextRetry > qwNow)
+            {
+                usleep((qwNextRetry - qwNow) * 1000);
+            }
+            nSchedule = 1;
+            continue;
+        }
+
+        if (curl_multi_perform(pMulti, &nRunning) != CURLM_OK)
+        {
+            dwError = ERROR_TDNF_CURL_INIT;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+
+        while ((pMsg = curl_multi_info_read(pMulti, &nMsgs)) != NULL)
+        {
+            CURLcode nResult;
+
+            if (pMsg->msg != CURLMSG_DONE)
+            {
+                continue;
+            }
+            nResult = pMsg->data.result;
+            pItem = NULL;
+            curl_easy_getinfo(pMsg->easy_handle, CURLINFO_PRIVATE, (char **)&pItem);
+            curl_multi_remove_handle(pMulti, pMsg->easy_handle);
+
+            for (i = 0, j = 0; i < nActive; i++)
+            {
+                if (ppActive[i] != pItem)
+                {
+                    ppActive[j++] = ppActive[i];
+                }
+            }
+            nActive = j;
+            nSchedule = 1;
+
+            dwError = _TDNFDownloadItemDone(pTdnf, pItem, nResult);
+            if (dwError && pQueue->nContinueOnError)
+            {
+                pItem->dwError = dwError;
+                dwError = 0;
+            }
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+
+        if (nRunning > 0 && !nSchedule)
+        {
+            lTimeout = 1000;
+            if (qwNextRetry)
+            {
+                qwNow = _TDNFDownloadNow();
+                lTimeout = qwNextRetry <= qwNow ? 0 :
+                           qwNextRetry - qwNow < 1000 ? qwNextRetry - qwNow :
+                           1000;
+            }
+            if (curl_multi_wait(pMulti, NULL, 0, lTimeout, NULL) != CURLM_OK)
+            {
+                dwError = ERROR_TDNF_CURL_INIT;
+                BAIL_ON_TDNF_ERROR(dwError);
+            }
+        }
+        if (qwNextRetry && _TDNFDownloadNow() >= qwNextRetry)
+        {
+            nSchedule = 1;
+        }
+    }
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(ppActive);
+    if (pQueue)
+    {
+        for (pItem = pQueue->pHead; pItem; pItem = pItem->pNext)
+        {
+            if (pItem->pCurl)
+            {
+                TDNFCurlPoolReleaseHandle(pTdnf, pItem->pCurl);
+                pItem->pCurl = NULL;
+            }
+        }
+    }
+    if (pMulti)
+    {
+        curl_multi_cleanup(pMulti);
+    }
+    return dwError;
+
+error:
+    /* abort transfers still in flight */
+    for (i = 0; i < nActive; i++)
+    {
+        pItem = ppActive[i];
+        curl_multi_remove_handle(pMulti, pItem->pCurl);
+        if (pItem->fp)
+        {
+            fclose(pItem->fp);
+            pItem->fp = NULL;
+        }
+        unlink(pItem->pszFileTmp);
+    }
+    goto cleanup;
+}
+
+/*
+ * Verify the download of pszFile against the given digest and size.
+ * Does nothing if pszFile is not in the queue, e.g. because it
+ * was already downloaded. nSize 0 means the size is unknown.
+ */
+uint32_t
+TDNFDownloadQueueSetVerify(
+    PTDNF_DOWNLOAD_QUEUE pQueue,
+    const char *pszFile,
+    int nChecksumType,
+    const unsigned char *pbChecksum,
+    uint64_t qwSize
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_DOWNLOAD_ITEM pItem = NULL;
+
+    if(!pQueue || IsNullOrEmptyString(pszFile) ||
+       (pbChecksum && (nChecksumType < TDNF_HASH_MD5 ||
+                       nChecksumType >= TDNF_HASH_SENTINEL)))
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    pItem = _TDNFDownloadQueueFind(pQueue, pszFile);
+    if (!pItem || pItem->nState != DOWNLOAD_PENDING)
+    {
+        goto cleanup;
+    }
+
+    TDNF_SAFE_FREE_MEMORY(pItem->pbChecksum);
+    if (pbChecksum)
+    {
+        dwError = TDNFAllocateMemory(1, hash_ops[nChecksumType].length,
+                                     (void **)&pItem->pbChecksum);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        memcpy(pItem->pbChecksum, pbChecksum, hash_ops[nChecksumType].length);
+        pItem->nChecksumType = nChecksumType;
+    }
+    pItem->qwExpectedSize = qwSize;
+
+cleanup:
+    return dwError;
+error:
+    goto cleanup;
+}
+
+/* nonzero if pszFile was downloaded and its digest checked on the way */
+int
+TDNFDownloadQueueIsVerified(
+    PTDNF_DOWNLOAD_QUEUE pQueue,
+    const char *pszFile
+    )
+{
+    PTDNF_DOWNLOAD_ITEM pItem = NULL;
+
+    if (!pQueue || IsNullOrEmptyString(pszFile))
+    {
+        return 0;
+    }
+    pItem = _TDNFDownloadQueueFind(pQueue, pszFile);
+    return pItem ? pItem->nVerified : 0;
+}
+
+/*
+ * Returns the error of the first failed item of pRepo, or 0 if all
+ * its downloads succeeded. Only meaningful with nContinueOnError.
+ */
+uint32_t
+TDNFDownloadQueueRepoError(
+    PTDNF_DOWNLOAD_QUEUE pQueue,
+    PTDNF_REPO_DATA pRepo
+    )
+{
+    PTDNF_DOWNLOAD_ITEM pItem = NULL;
+
+    if (!pQueue || !pRepo)
+    {
+        return ERROR_TDNF_INVALID_PARAMETER;
+    }
+    for (pItem = pQueue->pHead; pItem; pItem = pItem->pNext)
+    {
+        if (pItem->pRepo == pRepo && pItem->dwError)
+        {
+            return pItem->dwError;
+        }
+    }
+    return 0;
+}
+
+void
+TDNFFreeDownloadQueue(
+    PTDNF_DOWNLOAD_QUEUE pQueue
+    )
+{
+    PTDNF_DOWNLOAD_ITEM pItem = NULL;
+
+    if (!pQueue)
+    {
+        return;
+    }
+    while (pQueue->pHead)
+    {
+        pItem = pQueue->pHead;
+        pQueue->pHead = pItem->pNext;
+        _TDNFFreeDownloadItem(pItem);
+    }
+    stringpool_free(&pQueue->files);
+    TDNF_SAFE_FREE_MEMORY(pQueue->ppItemsById);
+    TDNFFreeMemory(pQueue);
+}
+
+uint32_t
+TDNFCurlPoolGetHandle(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepo,
+    CURL **ppCurl
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_CURL_POOL pPool = NULL;
+    PTDNF_CURL_HANDLE pHandle = NULL;
+    PTDNF_CURL_HANDLE pNewHandle = NULL;
+
+    if(!pTdnf || !pRepo || IsNullOrEmptyString(pRepo->pszId) || !ppCurl)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if (!pTdnf->pCurlPool)
+    {
+        dwError = _TDNFCreateCurlPool(&pTdnf->pCurlPool);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    pPool = pTdnf->pCurlPool;
+
+    for (pHandle = pPool->pHandles; pHandle; pHandle = pHandle->pNext)
+    {
+        if (!pHandle->nInUse && !strcmp(pHandle->pszRepoId, pRepo->pszId))
+        {
+            break;
+        }
+    }
+
+    if (pHandle)
+    {
+        /* repo settings are still in place, only undo what the
+           previous transfer may have set */
+        if (curl_easy_setopt(pHandle->pCurl, CURLOPT_NOPROGRESS, 1L) != CURLE_OK ||
+            curl_easy_setopt(pHandle->pCurl, CURLOPT_PRIVATE, NULL) != CURLE_OK ||
+            curl_easy_setopt(pHandle->pCurl, CURLOPT_WRITEFUNCTION, NULL) != CURLE_OK)
+        {
+            dwError = ERROR_TDNF_CURL_INIT;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+        pPool->dwHandlesReused++;
+    }
+    else
+    {
+        dwError = TDNFAllocateMemory(1, sizeof(TDNF_CURL_HANDLE),
+                                     (void **)&pNewHandle);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        dwError = TDNFAllocateString(pRepo->pszId, &pNewHandle->pszRepoId);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        pNewHandle->pCurl = curl_easy_init();
+        if (!pNewHandle->pCurl)
+        {
+            dwError = ERROR_TDNF_CURL_INIT;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+
+        dwError = curl_easy_setopt(pNewHandle->pCurl, CURLOPT_SHARE, pPool->pShare);
+        BAIL_ON_TDNF_CURL_ERROR(dwError);
+
+        dwError = TDNFCurlApplyRepoSettings(pTdnf, pRepo, pNewHandle->pCurl);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        pNewHandle->pNext = pPool->pHandles;
+        pPool->pHandles = pNewHandle;
+        pPool->dwHandlesCreated++;
+
+        pHandle = pNewHandle;
+        pNewHandle = NULL;
+    }
+
+    pHandle->nInUse = 1;
+    *ppCurl = pHandle->pCurl;
+
+cleanup:
+    return dwError;
+
+error:
+    _TDNFFreeCurlHandle(pNewHandle);
+    goto cleanup;
+}
+
+void
+TDNFCurlPoolReleaseHandle(
+    PTDNF pTdnf,
+    CURL *pCurl
+    )
+{
+    PTDNF_CURL_HANDLE pHandle = NULL;
+
+    if (!pTdnf || !pTdnf->pCurlPool || !pCurl)
+    {
+        return;
+    }
+    for (pHandle = pTdnf->pCurlPool->pHandles; pHandle; pHandle = pHandle->pNext)
+    {
+        if (pHandle->pCurl == pCurl)
+        {
+            pHandle->nInUse = 0;
+            break;
+        }
+    }
+}
+
+/*
+ * Account a finished transfer. CURLINFO_NUM_CONNECTS is the number of
+ * connections the last transfer had to open, 0 means it reused one.
+ */
+void
+TDNFCurlPoolCountTransfer(
+    PTDNF pTdnf,
+    CURL *pCurl
+    )
+{
+    PTDNF_CURL_POOL pPool = NULL;
+    long lConnects = 0;
+
+    if (!pTdnf || !pTdnf->pCurlPool || !pCurl)
+    {
+        return;
+    }
+    pPool = pTdnf->pCurlPool;
+
+    if (curl_easy_getinfo(pCurl, CURLINFO_NUM_CONNECTS, &lConnects) != CURLE_OK)
+    {
+        return;
+    }
+    pPool->dwTransfers++;
+    if (lConnects > 0)
+    {
+        pPool->dwConnectionsNew += lConnects;
+    }
+    else
+    {
+        pPool->dwConnectionsReused++;
+    }
+}
+
+void
+TDNFCurlPoolShowStats(
+    PTDNF pTdnf
+    )
+{
+    PTDNF_CURL_POOL pPool = NULL;
+
+    if (!pTdnf || !pTdnf->pArgs || !pTdnf->pCurlPool)
+    {
+        return;
+    }
+    pPool = pTdnf->pCurlPool;
+
+    if (pTdnf->pArgs->nVerbose && pPool->dwTransfers > 0)
+    {
+        pr_info("Downloads: %u transfers, %u new connections, "
+                "%u reused connections, %u curl handles created, "
+                "%u reused\n",
+                pPool->dwTransfers,
+                pPool->dwConnectionsNew,
+                pPool->dwConnectionsReused,
+                pPool->dwHandlesCreated,
+                pPool->dwHandlesReused);
+    }
+}
+
+void
+TDNFFreeCurlPool(
+    PTDNF_CURL_POOL pPool
+    )
+{
+    PTDNF_CURL_HANDLE pHandle = NULL;
+
+    if (!pPool)
+    {
+        return;
+    }
+    while (pPool->pHandles)
+    {
+        pHandle = pPool->pHandles;
+        pPool->pHandles = pHandle->pNext;
+        _TDNFFreeCurlHandle(pHandle);
+    }
+    /* the share can only go once no easy handle uses it */
+    if (pPool->pShare)
+    {
+        curl_share_cleanup(pPool->pShare);
+    }
+    TDNFFreeMemory(pPool);
+}
+
+static
+uint32_t
+_TDNFDownloadItemStart(
+    PTDNF pTdnf,
+    CURLM *pMulti,
+    PTDNF_DOWNLOAD_ITEM pItem
+    )
+{
+    uint32_t dwError = 0;
+    char *pszUrl = NULL;
+    PTDNF_REPO_DATA pRepo = pItem->pRepo;
+
+    if (!pItem->pCurl)
+    {
+        dwError = TDNFCurlPoolGetHandle(pTdnf, pRepo, &pItem->pCurl);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        dwError = curl_easy_setopt(pItem->pCurl, CURLOPT_PRIVATE, pItem);
+        BAIL_ON_TDNF_CURL_ERROR(dwError);
+    }
+
+    /* If there is no base url, pszLocation should contain the whole URL.
+       This is the case for packages from the command line. */
+    if (pRepo->ppszBaseUrls && pRepo->ppszBaseUrls[0])
+    {
+        dwError = TDNFJoinPath(&pszUrl,
+                               pRepo->ppszBaseUrls[pItem->nUrlIndex],
+                               pItem->pszLocation,
+                               NULL);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    else
+    {
+        dwError = TDNFAllocateString(pItem->pszLocation, &pszUrl);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    /* curl keeps its own copy of the url */
+    dwError = curl_easy_setopt(pItem->pCurl, CURLOPT_URL, pszUrl);
+    BAIL_ON_TDNF_CURL_ERROR(dwError);
+
+    /* every attempt starts from scratch */
+    pItem->qwReceived = 0;
+    pItem->dwWriteError = 0;
+    pItem->nVerified = 0;
+    if (pItem->pDigestCtx)
+    {
+        EVP_MD_CTX_destroy(pItem->pDigestCtx);
+        pItem->pDigestCtx = NULL;
+    }
+    if (pItem->pbChecksum)
+    {
+        dwError = TDNFDigestCreate(hash_ops + pItem->nChecksumType,
+                                   &pItem->pDigestCtx);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    pItem->fp = fopen(pItem->pszFileTmp, "wb");
+    if (!pItem->fp)
+    {
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
+    }
+
+    dwError = curl_easy_setopt(pItem->pCurl, CURLOPT_WRITEFUNCTION,
+                               _TDNFDownloadWrite);
+    BAIL_ON_TDNF_CURL_ERROR(dwError);
+
+    dwError = curl_easy_setopt(pItem->pCurl, CURLOPT_WRITEDATA, pItem);
+    BAIL_ON_TDNF_CURL_ERROR(dwError);
+
+    if (pItem->nRetry > 0)
+    {
+        pr_info("%s: retrying %d/%d\n", pItem->pszProgressData ?
+                pItem->pszProgressData : pItem->pszLocation,
+                pItem->nRetry, pRepo->nRetries);
+    }
+
+    if (curl_multi_add_handle(pMulti, pItem->pCurl) != CURLM_OK)
+    {
+        dwError = ERROR_TDNF_CURL_INIT;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    pItem->nState = DOWNLOAD_ACTIVE;
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszUrl);
+    return dwError;
+
+error:
+    if (pItem->fp)
+    {
+        fclose(pItem->fp);
+        pItem->fp = NULL;
+        unlink(pItem->pszFileTmp);
+    }
+    goto cleanup;
+}
+
+/*
+ * Called when the transfer for pItem finished. Either completes the
+ * item, or puts it back to pending for a retry or the next base url,
+ * following the same rules as TDNFDownloadFileFromRepo().
+ */
+static
+uint32_t
+_TDNFDownloadItemDone(
+    PTDNF pTdnf,
+    PTDNF_DOWNLOAD_ITEM pItem,
+    CURLcode nResult
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_REPO_DATA pRepo = NULL;
+    /* lStatus reads CURLINFO_RESPONSE_CODE. Must be long */
+    long lStatus = 0;
+    curl_off_t nSize = 0;
+    int nDelay = 0;
+    int i;
+
+    if (!pItem)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    pRepo = pItem->pRepo;
+
+    /* a failed close (ENOSPC) can leave a truncated file behind */
+    if (fclose(pItem->fp) != 0)
+    {
+        pItem->fp = NULL;
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
+    }
+    pItem->fp = NULL;
+
+    TDNFCurlPoolCountTransfer(pTdnf, pItem->pCurl);
+
+    if (nResult == CURLE_OK)
+    {
+        dwError = curl_easy_getinfo(pItem->pCurl,
+                                    CURLINFO_RESPONSE_CODE,
+                                    &lStatus);
+        BAIL_ON_TDNF_CURL_ERROR(dwError);
+
+        if (lStatus < 400)
+        {
+            dwError = _TDNFDownloadItemVerify(pItem);
+            BAIL_ON_TDNF_ERROR(dwError);
+
+            if (rename(pItem->pszFileTmp, pItem->pszFile) == -1)
+            {
+                dwError = errno;
+                BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
+            }
+            if (chmod(pItem->pszFile, S_IRUSR|S_IWUSR|S_IRGRP|S_IROTH) == -1)
+            {
+                dwError = errno;
+                BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
+            }
+
+            if (!pTdnf->pArgs->nQuiet && pItem->pszProgressData &&
+                (isatty(STDOUT_FILENO) || pTdnf->pArgs->nVerbose))
+            {
+                curl_easy_getinfo(pItem->pCurl, CURLINFO_SIZE_DOWNLOAD_T, &nSize);
+                pr_info("%-35s %10ld 100%%\n", pItem->pszProgressData, (long)nSize);
+            }
+
+            TDNFCurlPoolReleaseHandle(pTdnf, pItem->pCurl);
+            pItem->pCurl = NULL;
+            pItem->nState = DOWNLOAD_DONE;
+            goto cleanup;
+        }
+
+        pr_err("Error: %ld when downloading %s\n. Please check repo url "
+               "or refresh metadata with 'tdnf makecache'.\n",
+               lStatus, pItem->pszLocation);
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+    }
+    else if (nResult == CURLE_WRITE_ERROR && pItem->dwWriteError)
+    {
+        /* aborted by _TDNFDownloadWrite(), retrying will not help */
+        dwError = pItem->dwWriteError;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    else if (pItem->nRetry < pRepo->nRetries && !TDNFCurlErrorIsFatal(nResult))
+    {
+        pItem->nRetry++;
+        pItem->nState = DOWNLOAD_PENDING;
+        /* don't hammer a server that just failed */
+        nDelay = DOWNLOAD_RETRY_DELAY_MS;
+        for (i = 1; i < pItem->nRetry && nDelay < DOWNLOAD_RETRY_DELAY_MAX_MS; i++)
+        {
+            nDelay *= 2;
+        }
+        if (nDelay > DOWNLOAD_RETRY_DELAY_MAX_MS)
+        {
+            nDelay = DOWNLOAD_RETRY_DELAY_MAX_MS;
+        }
+        pItem->qwRetryAt = _TDNFDownloadNow() + nDelay;
+        goto cleanup;
+    }
+    else
+    {
+        dwError = ERROR_TDNF_CURL_BASE + nResult;
+    }
+
+    /* Try one base URL after the other until we succeed */
+    if (pRepo->ppszBaseUrls && pRepo->ppszBaseUrls[0] &&
+        pRepo->ppszBaseUrls[pItem->nUrlIndex + 1])
+    {
+        dwError = 0;
+        pItem->nUrlIndex++;
+        pItem->nRetry = 0;
+        pItem->nState = DOWNLOAD_PENDING;
+        goto cleanup;
+    }
+    BAIL_ON_TDNF_ERROR(dwError);
+
+cleanup:
+    return dwError;
+
+error:
+    if (pItem)
+    {
+        unlink(pItem->pszFileTmp);
+        pItem->nState = DOWNLOAD_DONE;
+    }
+    goto cleanup;
+}
+
+/* CLOCK_MONOTONIC time in ms */
+static
+uint64_t
+_TDNFDownloadNow(
+    void
+    )
+{
+    struct timespec ts = {0};
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static
+int
+_TDNFDownloadRepoLimit(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepo
+    )
+{
+    int nLimit = pTdnf->pConf->nMaxParallelDownloads;
+
+    if (pRepo->nMaxParallelDownloads > 0 &&
+        pRepo->nMaxParallelDownloads < nLimit)
+    {
+        nLimit = pRepo->nMaxParallelDownloads;
+    }
+    return nLimit;
+}
+
+/*
+ * curl write callback for queue items. Writes the data to the
+ * temporary file and feeds the digest. Returning less than the
+ * amount passed in makes curl stop the transfer with
+ * CURLE_WRITE_ERROR, which is done as soon as the file is larger
+ * than expected.
+ */
+static
+size_t
+_TDNFDownloadWrite(
+    char *pData,
+    size_t nSize,
+    size_t nMemb,
+    void *pUserData
+    )
+{
+    PTDNF_DOWNLOAD_ITEM pItem = pUserData;
+    size_t nLength = nSize * nMemb;
+
+    pItem->qwReceived += nLength;
+    if (pItem->qwExpectedSize && pItem->qwReceived > pItem->qwExpectedSize)
+    {
+        pr_err("%s: more data than the expected size (%llu)\n",
+               pItem->pszLocation,
+               (unsigned long long)pItem->qwExpectedSize);
+        pItem->dwWriteError = ERROR_TDNF_SIZE_MISMATCH;
+        return 0;
+    }
+    if (pItem->pDigestCtx &&
+        !EVP_DigestUpdate(pItem->pDigestCtx, pData, nLength))
+    {
+        pItem->dwWriteError = ERROR_TDNF_CHECKSUM_VALIDATION_FAILED;
+        return 0;
+    }
+    return fwrite(pData, 1, nLength, pItem->fp);
+}
+
+/* check the completed transfer of pItem against the expected values */
+static
+uint32_t
+_TDNFDownloadItemVerify(
+    PTDNF_DOWNLOAD_ITEM pItem
+    )
+{
+    uint32_t dwError = 0;
+    uint8_t digest[EVP_MAX_MD_SIZE] = {0};
+    unsigned int nDigestLength = 0;
+
+    if (pItem->qwExpectedSize && pItem->qwReceived != pItem->qwExpectedSize)
+    {
+        pr_err("%s: size (%llu) does not match expected size (%llu)\n",
+               pItem->pszLocation,
+               (unsigned long long)pItem->qwReceived,
+               (unsigned long long)pItem->qwExpectedSize);
+        dwError = ERROR_TDNF_SIZE_MISMATCH;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if (pItem->pDigestCtx)
+    {
+        if (!EVP_DigestFinal_ex(pItem->pDigestCtx, digest, &nDigestLength))
+        {
+            pr_err("Digest Final Failed\n");
+            dwError = ERROR_TDNF_CHECKSUM_VALIDATION_FAILED;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+        if (memcmp(digest, pItem->pbChecksum,
+                   hash_ops[pItem->nChecksumType].length))
+        {
+            pr_err("%s: Checksum FAILED (digest mismatch)\n",
+                   pItem->pszLocation);
+            dwError = ERROR_TDNF_CHECKSUM_MISMATCH;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+        pItem->nVerified = 1;
+    }
+
+cleanup:
+    return dwError;
+error:
+    goto cleanup;
+}
+
+/*
+ * Same checks as _TDNFDownloadItemVerify() for a file that was not
+ * downloaded through the write callback. A bad file is removed.
+ */
+static
+uint32_t
+_TDNFDownloadFileVerify(
+    PTDNF_DOWNLOAD_ITEM pItem
+    )
+{
+    uint32_t dwError = 0;
+    uint8_t digest[EVP_MAX_MD_SIZE] = {0};
+    struct stat st = {0};
+
+    if (pItem->qwExpectedSize)
+    {
+        if (stat(pItem->pszFile, &st) == -1)
+        {
+            dwError = errno;
+            BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
+        }
+        if ((uint64_t)st.st_size != pItem->qwExpectedSize)
+        {
+            pr_err("%s: size (%llu) does not match expected size (%llu)\n",
+                   pItem->pszLocation,
+                   (unsigned long long)st.st_size,
+                   (unsigned long long)pItem->qwExpectedSize);
+            dwError = ERROR_TDNF_SIZE_MISMATCH;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+    }
+
+    if (pItem->pbChecksum)
+    {
+        dwError = TDNFGetDigestForFile(pItem->pszFile,
+                                       hash_ops + pItem->nChecksumType,
+                                       digest);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        if (memcmp(digest, pItem->pbChecksum,
+                   hash_ops[pItem->nChecksumType].length))
+        {
+            pr_err("%s: Checksum FAILED (digest mismatch)\n",
+                   pItem->pszLocation);
+            dwError = ERROR_TDNF_CHECKSUM_MISMATCH;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+        pItem->nVerified = 1;
+    }
+
+cleanup:
+    return dwError;
+error:
+    unlink(pItem->pszFile);
+    goto cleanup;
+}
+
+static
+PTDNF_DOWNLOAD_ITEM
+_TDNFDownloadQueueFind(
+    PTDNF_DOWNLOAD_QUEUE pQueue,
+    const char *pszFile
+    )
+{
+    Id idFile = stringpool_str2id(&pQueue->files, pszFile, 0);
+
+    if (idFile <= 0 || idFile >= pQueue->nItemsById)
+    {
+        return NULL;
+    }
+    return pQueue->ppItemsById[idFile];
+}
+
+static
+void
+_TDNFFreeDownloadItem(
+    PTDNF_DOWNLOAD_ITEM pItem
+    )
+{
+    if (!pItem)
+    {
+        return;
+    }
+    if (pItem->fp && fclose(pItem->fp) != 0)
+    {
+        unlink(pItem->pszFileTmp);
+    }
+    if (pItem->pDigestCtx)
+    {
+        EVP_MD_CTX_destroy(pItem->pDigestCtx);
+    }
+    TDNF_SAFE_FREE_MEMORY(pItem->pbChecksum);
+    TDNF_SAFE_FREE_MEMORY(pItem->pszLocation);
+    TDNF_SAFE_FREE_MEMORY(pItem->pszFile);
+    TDNF_SAFE_FREE_MEMORY(pItem->pszProgressData);
+    TDNF_SAFE_FREE_MEMORY(pItem->pszFileTmp);
+    TDNFFreeMemory(pItem);
+}
+
+static
+uint32_t
+_TDNFCreateCurlPool(
+    PTDNF_CURL_POOL *ppPool
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_CURL_POOL pPool = NULL;
+
+    dwError = TDNFAllocateMemory(1, sizeof(TDNF_CURL_POOL),
+                                 (void **)&pPool);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    pPool->pShare = curl_share_init();
+    if (!pPool->pShare)
+    {
+        dwError = ERROR_TDNF_CURL_INIT;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    /* tdnf is single threaded, no lock callbacks are needed */
+    if (curl_share_setopt(pPool->pShare, CURLSHOPT_SHARE,
+                          CURL_LOCK_DATA_DNS) != CURLSHE_OK ||
+        curl_share_setopt(pPool->pShare, CURLSHOPT_SHARE,
+                          CURL_LOCK_DATA_SSL_SESSION) != CURLSHE_OK ||
+        curl_share_setopt(pPool->pShare, CURLSHOPT_SHARE,
+                          CURL_LOCK_DATA_CONNECT) != CURLSHE_OK)
+    {
+        dwError = ERROR_TDNF_CURL_INIT;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    *ppPool = pPool;
+cleanup:
+    return dwError;
+error:
+    TDNFFreeCurlPool(pPool);
+    goto cleanup;
+}
+
+static
+void
+_TDNFFreeCurlHandle(
+    PTDNF_CURL_HANDLE pHandle
+    )
+{
+    if (!pHandle)
+    {
+        return;
+    }
+    if (pHandle->pCurl)
+    {
+        curl_easy_cleanup(pHandle->pCurl);
+    }
+    TDNF_SAFE_FREE_MEMORY(pHandle->pszRepoId);
+    TDNFFreeMemory(pHandle);
+}
@@ -27,6 +27,7 @@ TDNFGetPackagesWithSpecifiedType(
 {
     uint32_t dwError = 0;
     uint32_t dwCount = 0;
+    uint32_t dwFields = PKGINFO_FIELDS_INSTALL;
     PSolvPackageList pPkgList = NULL;
 
     if(!pTdnf || !pTdnf->pSack|| !pTrans || !pPkgInfo)
@@ -44,11 +45,18 @@ TDNFGetPackagesWithSpecifiedType(
     dwError = SolvGetPackageListSize(pPkgList, &dwCount);
     BAIL_ON_TDNF_ERROR(dwError);
 
+    if(dwType == SOLVER_TRANSACTION_ERASE ||
+       dwType == SOLVER_TRANSACTION_OBSOLETED)
+    {
+        dwFields = PKGINFO_FIELDS_ERASE;
+    }
+
     if(dwCount > 0)
     {
         dwError = TDNFPopulatePkgInfos(
                       pTdnf->pSack,
                       pPkgList,
+                      dwFields,
                       pPkgInfo);
         BAIL_ON_TDNF_ERROR(dwError);
     }
@@ -191,6 +199,7 @@ TDNFGetDownGradePackages(
         dwError = TDNFPopulatePkgInfos(
                       pTdnf->pSack,
                       pRemovePkgList,
+                      PKGINFO_FIELDS_ERASE,
                       pRemovePkgInfo);
         BAIL_ON_TDNF_ERROR(dwError);
     }
@@ -298,6 +307,8 @@ TDNFSolv(
     Transaction *pTrans = NULL;
     int nFlags = 0;
     int nProblems = 0;
+    int nFileListsNeeded = 0;
+    int nFileListsLoaded = 0;
     int retries = 0;
 
     if(!pTdnf || !ppInfo)
@@ -325,7 +336,7 @@ TDNFSolv(
             dwError = ERROR_TDNF_INVALID_PARAMETER;
             BAIL_ON_TDNF_ERROR(dwError);
         }
-        dwError = SolvAddExcludes(pTdnf->pSack->pPool, ppszExcludes);
+        dwError = SolvAddExcludes(pTdnf->pSack, ppszExcludes);
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
@@ -338,6 +349,21 @@ TDNFSolv(
     dwError = TDNFSolvAddMinVersions(pTdnf, pTdnf->pSack->pPool);
     BAIL_ON_TDNF_ERROR(dwError);
 
+    dwError = SolvFinalizeSack(pTdnf->pSack);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    /* an upgrade that requires a file only in the full file lists
+       would be kept back without a problem, so load them up front */
+    dwError = SolvJobsNeedFileLists(pTdnf->pSack, pQueueJobs,
+                                    &nFileListsNeeded);
+    BAIL_ON_TDNF_ERROR(dwError);
+    if (nFileListsNeeded)
+    {
+        dwError = SolvLoadMissingFileProvides(pTdnf->pSack,
+                                              &nFileListsLoaded);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
     pSolv = solver_create(pTdnf->pSack->pPool);
     if(pSolv == NULL)
     {
@@ -372,6 +398,18 @@ TDNFSolv(
 
         nProblems = solver_solve(pSolv, pQueueJobs);
         if (nProblems > 0)
+        {
+            /* a missing file dependency may only be in the full
+               file lists, try again with them */
+            dwError = SolvLoadMissingFileProvides(pTdnf->pSack,
+                                                  &nFileListsLoaded);
+            BAIL_ON_TDNF_ERROR(dwError);
+            if (nFileListsLoaded)
+            {
+                nProblems = solver_solve(pSolv, pQueueJobs);
+            }
+        }
+        if (nProblems > 0)
         {
             dwError = TDNFGetSkipProblemOption(pTdnf, &dwSkipProblem);
             BAIL_ON_TDNF_ERROR(dwError);
@@ -461,7 +499,8 @@ TDNFGoalNoDeps(
     dwError = SolvQueueToPackageList(pQueuePkgList, &pPkgList);
     BAIL_ON_TDNF_ERROR(dwError);
 
-    dwError = TDNFPopulatePkgInfos(pTdnf->pSack, pPkgList, &pPkgInfo);
+    dwError = TDNFPopulatePkgInfos(pTdnf->pSack, pPkgList,
+                                   PKGINFO_FIELDS_INSTALL, &pPkgInfo);
     BAIL_ON_TDNF_ERROR(dwError);
 
     dwError = TDNFAllocateMemory(
@@ -714,6 +753,10 @@ TDNFMarkAutoInstalled(
 {
     uint32_t dwError = 0;
     PTDNF_PKG_INFO pPkgInfo = NULL;
+    const char **ppszNames = NULL;
+    int *pnFlags = NULL;
+    int nCount = 0;
+    int rc;
 
     if (!pTdnf || !pHistoryCtx || !ppInfo)
     {
@@ -736,6 +779,22 @@ TDNFMarkAutoInstalled(
          (but will be in pPkgsToUpgrade) and their status will not change.
     */
     for (pPkgInfo = ppInfo->pPkgsToInstall; pPkgInfo; pPkgInfo = pPkgInfo->pNext)
+    {
+        nCount++;
+    }
+    if (nCount == 0)
+    {
+        goto cleanup;
+    }
+
+    dwError = TDNFAllocateMemory(nCount, sizeof(char *), (void **)&ppszNames);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFAllocateMemory(nCount, sizeof(int), (void **)&pnFlags);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    nCount = 0;
+    for (pPkgInfo = ppInfo->pPkgsToInstall; pPkgInfo; pPkgInfo = pPkgInfo->pNext)
     {
         const char *pszName = pPkgInfo->pszName;
         int nFlag = 1;
@@ -756,15 +815,22 @@ TDNFMarkAutoInstalled(
         }
         if (!nAutoOnly || nFlag == 1)
         {
-            int rc = history_set_auto_flag(pHistoryCtx, pszName, nFlag);
-            if (rc != 0)
-            {
-                dwError = ERROR_TDNF_HISTORY_ERROR;
-                BAIL_ON_TDNF_ERROR(dwError);
-            }
+            ppszNames[nCount] = pszName;
+            pnFlags[nCount] = nFlag;
+            nCount++;
         }
     }
+
+    /* all in one db transaction */
+    rc = history_set_auto_flags(pHistoryCtx, ppszNames, pnFlags, nCount);
+    if (rc != 0)
+    {
+        dwError = ERROR_TDNF_HISTORY_ERROR;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
 cleanup:
+    TDNF_SAFE_FREE_MEMORY(ppszNames);
+    TDNF_SAFE_FREE_MEMORY(pnFlags);
     return dwError;
 error:
     goto cleanup;
@@ -930,6 +996,57 @@ error:
     goto cleanup;
 }
 
+/*
+ * Get the name id of pszName if an installed package has that name,
+ * 0 otherwise. The name is looked up in the name index of the sack.
+ */
+static
+uint32_t
+TDNFSolvGetInstalledNameId(
+    PSolvSack pSack,
+    const char *pszName,
+    Id *pidName
+    )
+{
+    uint32_t dwError = 0;
+    Queue queueSolvables = {0};
+    Pool *pPool = NULL;
+    Id idName = 0;
+    int i;
+
+    queue_init(&queueSolvables);
+    if(!pSack || !pSack->pPool || !pszName || !pidName)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    pPool = pSack->pPool;
+
+    if (pPool->installed && *pszName)
+    {
+        dwError = SolvFindSolvablesByName(pSack, pszName, SEARCH_STRING,
+                                          &queueSolvables);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        for (i = 0; i < queueSolvables.count; i++)
+        {
+            Solvable *s = pool_id2solvable(pPool, queueSolvables.elements[i]);
+            if (s->repo == pPool->installed)
+            {
+                idName = s->name;
+                break;
+            }
+        }
+    }
+    *pidName = idName;
+
+cleanup:
+    queue_free(&queueSolvables);
+    return dwError;
+error:
+    goto cleanup;
+}
+
 uint32_t
 TDNFSolvAddPkgLocks(
     PTDNF pTdnf,
@@ -951,20 +1068,15 @@ TDNFSolvAddPkgLocks(
 
     for (i = 0; ppszPackages && ppszPackages[i]; i++)
     {
-        char *pszPkg = ppszPackages[i];
-        Id idPkg = pool_str2id(pPool, pszPkg, 1);
+        Id idPkg = 0;
+
+        dwError = TDNFSolvGetInstalledNameId(pTdnf->pSack, ppszPackages[i],
+                                             &idPkg);
+        BAIL_ON_TDNF_ERROR(dwError);
+
         if (idPkg)
         {
-            Id p;
-            Solvable *s;
-            FOR_REPO_SOLVABLES(pPool->installed, p, s)
-            {
-                if (idPkg == s->name)
-                {
-                    queue_push2(pQueueJobs, SOLVER_SOLVABLE_NAME|SOLVER_LOCK, idPkg);
-                    break;
-                }
-            }
+            queue_push2(pQueueJobs, SOLVER_SOLVABLE_NAME|SOLVER_LOCK, idPkg);
         }
     }
 
@@ -995,24 +1107,19 @@ TDNFSolvAddInstallOnlyPkgs(
 
     for (i = 0; ppszPackages && ppszPackages[i]; i++)
     {
-        char *pszPkg = ppszPackages[i];
-        Id idPkg = pool_str2id(pPool, pszPkg, 1);
+        Id idPkg = 0;
+
+        /* only mark if they are installed - first install doesn't care */
+        /* we are marking the name, so we just need to mark it once */
+        /* the flag only affects to be installed packages and
+           it has no effect for already installed packages */
+        dwError = TDNFSolvGetInstalledNameId(pTdnf->pSack, ppszPackages[i],
+                                             &idPkg);
+        BAIL_ON_TDNF_ERROR(dwError);
+
         if (idPkg)
         {
-            Id p;
-            Solvable *s;
-            /* only mark if they are installed - first install doesn't care */
-            /* we are marking the name, so we just need to mark it once */
-            /* the flag only affects to be installed packages and
-               it has no effect for already installed packages */
-            FOR_REPO_SOLVABLES(pPool->installed, p, s)
-            {
-                if (idPkg == s->name)
-                {
-                    queue_push2(pQueueJobs, SOLVER_SOLVABLE_NAME|SOLVER_MULTIVERSION, idPkg);
-                    break;
-                }
-            }
+            queue_push2(pQueueJobs, SOLVER_SOLVABLE_NAME|SOLVER_MULTIVERSION, idPkg);
         }
     }
 
@@ -1136,8 +1243,10 @@ TDNFSolvAddMinVersions(
     char **ppszTokens = NULL;
     Map *pMapMinVersions = NULL;
     char *pszTmp = NULL;
+    Queue queueSolvables = {0};
 
-    if(!pTdnf || !pPool)
+    queue_init(&queueSolvables);
+    if(!pTdnf || !pTdnf->pSack || !pPool)
     {
         dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_TDNF_ERROR(dwError);
@@ -1168,21 +1277,21 @@ TDNFSolvAddMinVersions(
         BAIL_ON_TDNF_ERROR(dwError);
 
         if (ppszTokens[0] && ppszTokens[1]) {
-            Dataiterator di;
-
-            dwError = dataiterator_init(&di, pPool, 0, 0, SOLVABLE_NAME, ppszTokens[0], SEARCH_STRING);
+            queue_empty(&queueSolvables);
+            dwError = SolvFindSolvablesByName(pTdnf->pSack, ppszTokens[0],
+                                              SEARCH_STRING, &queueSolvables);
             BAIL_ON_TDNF_ERROR(dwError);
 
-            while (dataiterator_step(&di))
+            for (int j = 0; j < queueSolvables.count; j++)
             {
-                Solvable *pSolv = pool_id2solvable(pPool, di.solvid);
-                const char *pszEvr = solvable_lookup_str(pSolv, SOLVABLE_EVR);
+                Id p = queueSolvables.elements[j];
+                Solvable *pSolv = pool_id2solvable(pPool, p);
+                const char *pszEvr = pool_id2str(pPool, pSolv->evr);
                 if (pool_evrcmp_str( pPool, pszEvr, ppszTokens[1], EVRCMP_COMPARE) < 0)
                 {
-                    MAPSET(pMapMinVersions, di.solvid);
+                    MAPSET(pMapMinVersions, p);
                 }
             }
-            dataiterator_free(&di);
         }
     }
 
@@ -1203,6 +1312,7 @@ cleanup:
         map_free(pMapMinVersions);
         TDNFFreeMemory(pMapMinVersions);
     }
+    queue_free(&queueSolvables);
     TDNF_SAFE_FREE_MEMORY(pszTmp);
     TDNF_SAFE_FREE_STRINGARRAY(ppszTokens);
     return dwError;
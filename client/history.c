@@ -63,6 +63,7 @@ TDNFGetHistoryCtx(
         dwError = ERROR_TDNF_HISTORY_ERROR;
         BAIL_ON_TDNF_ERROR(dwError);
     }
+    ctx->snapshot_interval = pTdnf->pConf->nHistorySnapshotInterval;
 
     *ppCtx = ctx;
 
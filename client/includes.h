@@ -25,6 +25,8 @@
 #include <libgen.h>
 #include <ctype.h>
 #include <sys/file.h>
+#include <sys/wait.h>
+#include <poll.h>
 #include <time.h>
 #include <sys/utsname.h>
 #include <sys/vfs.h>
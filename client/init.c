@@ -70,9 +70,9 @@ TDNFRefreshSack(
 {
     uint32_t dwError = 0;
     char* pszRepoCacheDir = NULL;
-    int nMetadataExpired = 0;
     PTDNF_REPO_DATA pRepo = NULL;
     PTDNF_REPO_DATA *ppRepoArray = NULL;
+    PTDNF_REPO_SYNC *ppSyncArray = NULL;
     uint32_t nCount = 0;
     uint32_t i = 0;
 
@@ -119,50 +119,67 @@ TDNFRefreshSack(
         qsort(ppRepoArray, nCount, sizeof(PTDNF_REPO_DATA), _repo_compare);
     }
 
-    for (i = 0; i < nCount; i++)
+    /* fetch the metadata of all repos concurrently, then load them
+       in priority order */
+    if (pSack && nCount > 0)
     {
-        pRepo = ppRepoArray[i];
-
-        nMetadataExpired = 0;
-        /* Check if expired since last sync per metadata_expire
-           unless requested to ignore. lMetadataExpire < 0 means never expire. */
-        if(pRepo->lMetadataExpire >= 0 && !pTdnf->pArgs->nCacheOnly)
-        {
-            dwError = TDNFGetCachePath(pTdnf, pRepo,
-                                       NULL, NULL,
-                                       &pszRepoCacheDir);
-            BAIL_ON_TDNF_ERROR(dwError);
-
-            dwError = TDNFShouldSyncMetadata(
-                          pszRepoCacheDir,
-                          pRepo->lMetadataExpire,
-                          &nMetadataExpired);
-            BAIL_ON_TDNF_ERROR(dwError);
-
-            TDNF_SAFE_FREE_MEMORY(pszRepoCacheDir);
-            pszRepoCacheDir = NULL;
-        }
+        dwError = TDNFAllocateMemory(nCount, sizeof(PTDNF_REPO_SYNC),
+                                     (void **)&ppSyncArray);
+        BAIL_ON_TDNF_ERROR(dwError);
 
-        if (nMetadataExpired)
+        for (i = 0; i < nCount; i++)
         {
-            dwError = TDNFRepoRemoveCache(pTdnf, pRepo);
-            if (dwError == ERROR_TDNF_FILE_NOT_FOUND)
+            pRepo = ppRepoArray[i];
+            if (!pRepo->nHasMetaData)
             {
-                dwError = 0; // ignore not existing folders
+                continue;
             }
+
+            dwError = TDNFRepoSyncCreate(pTdnf, pRepo, &ppSyncArray[i]);
             BAIL_ON_TDNF_ERROR(dwError);
 
-            dwError = TDNFRemoveSolvCache(pTdnf, pRepo);
-            if (dwError == ERROR_TDNF_FILE_NOT_FOUND)
+            /* Check if expired since last sync per metadata_expire
+               unless requested to ignore. lMetadataExpire < 0 means never
+               expire. An expired repo fetches repomd.xml again, the
+               cached parts are only replaced if it changed. */
+            if(pRepo->lMetadataExpire >= 0 && !pTdnf->pArgs->nCacheOnly)
             {
-                dwError = 0; // ignore not existing folders
+                dwError = TDNFGetCachePath(pTdnf, pRepo,
+                                           NULL, NULL,
+                                           &pszRepoCacheDir);
+                BAIL_ON_TDNF_ERROR(dwError);
+
+                dwError = TDNFShouldSyncMetadata(
+                              pszRepoCacheDir,
+                              pRepo->lMetadataExpire,
+                              &ppSyncArray[i]->nExpired);
+                BAIL_ON_TDNF_ERROR(dwError);
+
+                TDNF_SAFE_FREE_MEMORY(pszRepoCacheDir);
             }
-            BAIL_ON_TDNF_ERROR(dwError);
         }
 
-        if (pSack)
+        dwError = TDNFSyncRepos(pTdnf, ppSyncArray, nCount);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    for (i = 0; i < nCount && pSack; i++)
+    {
+        pRepo = ppRepoArray[i];
+
+        if (ppSyncArray[i])
+        {
+            dwError = ppSyncArray[i]->dwError;
+        }
+        if (!dwError)
+        {
+            dwError = TDNFLoadRepo(pTdnf, pRepo,
+                                   ppSyncArray[i] ? ppSyncArray[i]->pRepoMD : NULL,
+                                   pSack);
+        }
+        if (dwError)
         {
-            dwError = TDNFInitRepo(pTdnf, pRepo, pSack);
+            TDNFRepoSyncFailed(pTdnf, pRepo);
         }
         if (dwError && pRepo->nSkipIfUnavailable)
         {
@@ -175,7 +192,21 @@ TDNFRefreshSack(
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
+    if (pSack)
+    {
+        dwError = SolvFinalizeSack(pSack);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
 cleanup:
+    if (ppSyncArray)
+    {
+        for (i = 0; i < nCount; i++)
+        {
+            TDNFFreeRepoSync(ppSyncArray[i]);
+        }
+        TDNF_SAFE_FREE_MEMORY(ppSyncArray);
+    }
     TDNF_SAFE_FREE_MEMORY(pszRepoCacheDir);
     TDNF_SAFE_FREE_MEMORY(ppRepoArray);
     return dwError;
@@ -70,6 +70,427 @@ error:
     goto cleanup;
 }
 
+/*
+ * The package infos of a result set are allocated from an arena owned
+ * by the set, together with their strings, so a large result takes a
+ * few allocations instead of several per package, and is released in
+ * one go by TDNFFreePackageInfo() or TDNFFreePackageInfoArray().
+ * Strings are copied rather than pointed to in the pool: the pool is
+ * recreated on a refresh, and its string space moves when it grows,
+ * while callers may hold on to the result.
+ * The infos are linked in array order.
+ */
+uint32_t
+TDNFAllocatePkgInfoArray(
+    uint32_t dwCount,
+    PTDNF_PKG_INFO* ppPkgInfos
+    )
+{
+    uint32_t dwError = 0;
+    uint32_t dwIndex = 0;
+    PTDNF_ARENA pArena = NULL;
+    PTDNF_PKG_INFO pPkgInfos = NULL;
+
+    if(!ppPkgInfos || dwCount == 0)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFArenaCreate(&pArena);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFArenaAllocateMemory(
+                  pArena,
+                  dwCount,
+                  sizeof(TDNF_PKG_INFO),
+                  (void**)&pPkgInfos);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    for (dwIndex = 0; dwIndex < dwCount; dwIndex++)
+    {
+        pPkgInfos[dwIndex].pArena = pArena;
+        if (dwIndex < dwCount - 1)
+        {
+            pPkgInfos[dwIndex].pNext = &pPkgInfos[dwIndex+1];
+        }
+    }
+
+    *ppPkgInfos = pPkgInfos;
+
+cleanup:
+    return dwError;
+
+error:
+    TDNFArenaFree(pArena);
+    goto cleanup;
+}
+
+/*
+ * Copy the string dwKey of the package to pPkgInfo's arena. Returns
+ * ERROR_TDNF_NO_DATA if the package doesn't have it.
+ */
+uint32_t
+TDNFPkgInfoLookupString(
+    PSolvSack pSack,
+    Id dwPkgId,
+    PTDNF_PKG_INFO pPkgInfo,
+    Id dwKey,
+    char** ppszValue
+    )
+{
+    uint32_t dwError = 0;
+    Solvable *pSolv = NULL;
+    const char *pszTmp = NULL;
+
+    if(!pSack || !pPkgInfo || !pPkgInfo->pArena || !ppszValue)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    pSolv = pool_id2solvable(pSack->pPool, dwPkgId);
+    if(!pSolv)
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    pszTmp = solvable_lookup_str(pSolv, dwKey);
+    if(!pszTmp)
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFArenaAllocateString(pPkgInfo->pArena, pszTmp, ppszValue);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/* same as TDNFPkgInfoLookupString(), a missing value is not an error */
+static uint32_t
+TDNFPkgInfoLookupOptionalString(
+    PSolvSack pSack,
+    Id dwPkgId,
+    PTDNF_PKG_INFO pPkgInfo,
+    Id dwKey,
+    char** ppszValue
+    )
+{
+    uint32_t dwError = 0;
+
+    dwError = TDNFPkgInfoLookupString(pSack, dwPkgId, pPkgInfo, dwKey, ppszValue);
+    if(dwError == ERROR_TDNF_NO_DATA)
+    {
+        dwError = 0;
+    }
+    return dwError;
+}
+
+/*
+ * Fill in name, arch, evr, epoch, version and release, and the repo
+ * name. The evr is split the same way as SolvSplitEvr() does.
+ */
+static uint32_t
+TDNFPkgInfoSetNevra(
+    PSolvSack pSack,
+    Id dwPkgId,
+    PTDNF_PKG_INFO pPkgInfo
+    )
+{
+    uint32_t dwError = 0;
+    Solvable *pSolv = NULL;
+    char *pszEvr = NULL;
+    char *pszEpoch = NULL;
+    char *pszVersion = NULL;
+    char *pszRelease = NULL;
+    char *pszIt = NULL;
+    int eIndex = 0;
+    int rIndex = 0;
+
+    dwError = TDNFPkgInfoLookupString(pSack, dwPkgId, pPkgInfo,
+                                      SOLVABLE_NAME, &pPkgInfo->pszName);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFPkgInfoLookupString(pSack, dwPkgId, pPkgInfo,
+                                      SOLVABLE_ARCH, &pPkgInfo->pszArch);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFPkgInfoLookupString(pSack, dwPkgId, pPkgInfo,
+                                      SOLVABLE_EVR, &pPkgInfo->pszEVR);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if(IsNullOrEmptyString(pPkgInfo->pszEVR))
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    /* EVR string format: epoch : version-release */
+    dwError = TDNFArenaAllocateString(pPkgInfo->pArena, pPkgInfo->pszEVR, &pszEvr);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    for (pszIt = pszEvr; *pszIt; pszIt++)
+    {
+        if(*pszIt == ':')
+        {
+            eIndex = pszIt - pszEvr;
+        }
+        else if(*pszIt == '-')
+        {
+            rIndex = pszIt - pszEvr;
+        }
+    }
+
+    pszVersion = pszEvr;
+    if(eIndex != 0)
+    {
+        pszEpoch = pszEvr;
+        pszEvr[eIndex] = '\0';
+        pszVersion = pszEvr + eIndex + 1;
+    }
+    if(rIndex != 0 && rIndex > eIndex)
+    {
+        pszRelease = pszEvr + rIndex + 1;
+        pszEvr[rIndex] = '\0';
+    }
+
+    if(!IsNullOrEmptyString(pszEpoch))
+    {
+        pPkgInfo->dwEpoch = strtol(pszEpoch, NULL, 10);
+    }
+    pPkgInfo->pszVersion = IsNullOrEmptyString(pszVersion) ? NULL : pszVersion;
+    pPkgInfo->pszRelease = IsNullOrEmptyString(pszRelease) ? NULL : pszRelease;
+
+    pSolv = pool_id2solvable(pSack->pPool, dwPkgId);
+    if(!pSolv->repo->name)
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFArenaAllocateString(
+                  pPkgInfo->pArena,
+                  pSolv->repo->name,
+                  &pPkgInfo->pszRepoName);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/* fill in the sizes, and their formatted versions */
+static uint32_t
+TDNFPkgInfoSetSizes(
+    PSolvSack pSack,
+    Id dwPkgId,
+    PTDNF_PKG_INFO pPkgInfo
+    )
+{
+    uint32_t dwError = 0;
+    char szSize[35];
+
+    dwError = SolvGetPkgInstallSizeFromId(
+                  pSack,
+                  dwPkgId,
+                  &pPkgInfo->dwInstallSizeBytes);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = SolvGetPkgDownloadSizeFromId(
+                  pSack,
+                  dwPkgId,
+                  &pPkgInfo->dwDownloadSizeBytes);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFUtilsFormatSizeBuf(
+                  pPkgInfo->dwInstallSizeBytes,
+                  szSize,
+                  sizeof(szSize));
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFArenaAllocateString(
+                  pPkgInfo->pArena,
+                  szSize,
+                  &pPkgInfo->pszFormattedSize);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFUtilsFormatSizeBuf(
+                  pPkgInfo->dwDownloadSizeBytes,
+                  szSize,
+                  sizeof(szSize));
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFArenaAllocateString(
+                  pPkgInfo->pArena,
+                  szSize,
+                  &pPkgInfo->pszFormattedDownloadSize);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/* set pszSourcePkg to name-evr.arch of the source rpm */
+static uint32_t
+TDNFPkgInfoSetSourcePkg(
+    PSolvSack pSack,
+    Id dwPkgId,
+    PTDNF_PKG_INFO pPkgInfo
+    )
+{
+    uint32_t dwError = 0;
+    char *pszSrcName = NULL;
+    char *pszSrcArch = NULL;
+    char *pszSrcEVR = NULL;
+
+    /* if the name or evr is the same as the package's we get NULL */
+    dwError = TDNFPkgInfoLookupString(pSack, dwPkgId, pPkgInfo,
+                                      SOLVABLE_SOURCENAME, &pszSrcName);
+    if(dwError == ERROR_TDNF_NO_DATA)
+    {
+        dwError = TDNFPkgInfoLookupString(pSack, dwPkgId, pPkgInfo,
+                                          SOLVABLE_NAME, &pszSrcName);
+    }
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFPkgInfoLookupString(pSack, dwPkgId, pPkgInfo,
+                                      SOLVABLE_SOURCEARCH, &pszSrcArch);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFPkgInfoLookupString(pSack, dwPkgId, pPkgInfo,
+                                      SOLVABLE_SOURCEEVR, &pszSrcEVR);
+    if(dwError == ERROR_TDNF_NO_DATA)
+    {
+        dwError = TDNFPkgInfoLookupString(pSack, dwPkgId, pPkgInfo,
+                                          SOLVABLE_EVR, &pszSrcEVR);
+    }
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFArenaAllocateStringPrintf(
+                  pPkgInfo->pArena,
+                  &pPkgInfo->pszSourcePkg,
+                  "%s-%s.%s",
+                  pszSrcName, pszSrcEVR, pszSrcArch);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/* installed packages do not have a location, that is not an error */
+static uint32_t
+TDNFPkgInfoSetLocation(
+    PSolvSack pSack,
+    Id dwPkgId,
+    PTDNF_PKG_INFO pPkgInfo
+    )
+{
+    uint32_t dwError = 0;
+    Solvable *pSolv = NULL;
+    const char *pszTmp = NULL;
+
+    pSolv = pool_id2solvable(pSack->pPool, dwPkgId);
+    if(!pSolv)
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    pszTmp = solvable_get_location(pSolv, NULL);
+    if(pszTmp)
+    {
+        dwError = TDNFArenaAllocateString(
+                      pPkgInfo->pArena,
+                      pszTmp,
+                      &pPkgInfo->pszLocation);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/* a missing or unsupported checksum is not an error */
+static uint32_t
+TDNFPkgInfoSetChecksum(
+    PSolvSack pSack,
+    Id dwPkgId,
+    PTDNF_PKG_INFO pPkgInfo
+    )
+{
+    uint32_t dwError = 0;
+    Solvable *pSolv = NULL;
+    const unsigned char *pbChecksum = NULL;
+    int nChecksumType = 0;
+
+    pSolv = pool_id2solvable(pSack->pPool, dwPkgId);
+    if(!pSolv)
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    pbChecksum = solvable_lookup_bin_checksum(
+                     pSolv,
+                     SOLVABLE_CHECKSUM,
+                     &nChecksumType);
+    if(pbChecksum)
+    {
+        if (nChecksumType == REPOKEY_TYPE_SHA512)
+        {
+            pPkgInfo->nChecksumType = TDNF_HASH_SHA512;
+        } else if (nChecksumType == REPOKEY_TYPE_SHA256)
+        {
+            pPkgInfo->nChecksumType = TDNF_HASH_SHA256;
+        } else if (nChecksumType == REPOKEY_TYPE_SHA1)
+        {
+            pPkgInfo->nChecksumType = TDNF_HASH_SHA1;
+        } else if (nChecksumType == REPOKEY_TYPE_MD5)
+        {
+            pPkgInfo->nChecksumType = TDNF_HASH_MD5;
+        } else
+        {
+            pbChecksum = NULL;
+        }
+    }
+    if(pbChecksum)
+    {
+        dwError = TDNFArenaAllocateMemory(
+                      pPkgInfo->pArena,
+                      1,
+                      solv_chksum_len(nChecksumType),
+                      (void **)&pPkgInfo->pbChecksum);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        memcpy(pPkgInfo->pbChecksum, pbChecksum,
+               solv_chksum_len(nChecksumType));
+    }
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
 uint32_t
 TDNFPopulatePkgInfoQueryFormat(
     PSolvSack pSack,
@@ -84,9 +505,6 @@ TDNFPopulatePkgInfoQueryFormat(
     Id dwPkgId = 0;
     PTDNF_PKG_INFO pPkgInfos = NULL;
     PTDNF_PKG_INFO pPkgInfo  = NULL;
-    char *pszSrcName = NULL;
-    char *pszSrcArch = NULL;
-    char *pszSrcEVR = NULL;
 
     if(!ppPkgInfo || !pdwCount || !pSack || !pPkgList)
     {
@@ -103,10 +521,7 @@ TDNFPopulatePkgInfoQueryFormat(
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
-    dwError = TDNFAllocateMemory(
-                  dwCount,
-                  sizeof(TDNF_PKG_INFO),
-                  (void**)&pPkgInfos);
+    dwError = TDNFAllocatePkgInfoArray(dwCount, &pPkgInfos);
     BAIL_ON_TDNF_ERROR(dwError);
 
     for (dwPkgIndex = 0; (uint32_t)dwPkgIndex < dwCount; dwPkgIndex++)
@@ -116,92 +531,40 @@ TDNFPopulatePkgInfoQueryFormat(
         dwError = SolvGetPackageId(pPkgList, dwPkgIndex, &dwPkgId);
         BAIL_ON_TDNF_ERROR(dwError);
 
-        dwError = SolvGetNevraFromId(
-                      pSack,
-                      dwPkgId,
-                      &pPkgInfo->dwEpoch,
-                      &pPkgInfo->pszName,
-                      &pPkgInfo->pszVersion,
-                      &pPkgInfo->pszRelease,
-                      &pPkgInfo->pszArch,
-                      &pPkgInfo->pszEVR);
-        BAIL_ON_TDNF_ERROR(dwError);
-
-        dwError = SolvGetPkgRepoNameFromId(
-                      pSack,
-                      dwPkgId,
-                      &pPkgInfo->pszRepoName);
-        BAIL_ON_TDNF_ERROR(dwError);
-
-        dwError = SolvGetPkgInstallSizeFromId(
-                      pSack,
-                      dwPkgId,
-                      &pPkgInfo->dwInstallSizeBytes);
-        BAIL_ON_TDNF_ERROR(dwError);
-
-        dwError = SolvGetPkgDownloadSizeFromId(
-                      pSack,
-                      dwPkgId,
-                      &pPkgInfo->dwDownloadSizeBytes);
-        BAIL_ON_TDNF_ERROR(dwError);
-
-        dwError = TDNFUtilsFormatSize(
-                      pPkgInfo->dwInstallSizeBytes,
-                      &pPkgInfo->pszFormattedSize);
+        dwError = TDNFPkgInfoSetNevra(pSack, dwPkgId, pPkgInfo);
         BAIL_ON_TDNF_ERROR(dwError);
 
-        dwError = TDNFUtilsFormatSize(
-                      pPkgInfo->dwDownloadSizeBytes,
-                      &pPkgInfo->pszFormattedDownloadSize);
+        dwError = TDNFPkgInfoSetSizes(pSack, dwPkgId, pPkgInfo);
         BAIL_ON_TDNF_ERROR(dwError);
 
-        dwError = SolvGetPkgSummaryFromId(
-                      pSack,
-                      dwPkgId,
-                      &pPkgInfo->pszSummary);
-        BAIL_ON_TDNF_ERROR(dwError);
-
-        dwError = SolvGetPkgUrlFromId(pSack, dwPkgId, &pPkgInfo->pszURL);
+        dwError = TDNFPkgInfoLookupString(pSack, dwPkgId, pPkgInfo,
+                                          SOLVABLE_SUMMARY,
+                                          &pPkgInfo->pszSummary);
         BAIL_ON_TDNF_ERROR(dwError);
 
-        dwError = SolvGetPkgLicenseFromId(
-                      pSack,
-                      dwPkgId,
-                      &pPkgInfo->pszLicense);
+        dwError = TDNFPkgInfoLookupOptionalString(pSack, dwPkgId, pPkgInfo,
+                                                  SOLVABLE_URL,
+                                                  &pPkgInfo->pszURL);
         BAIL_ON_TDNF_ERROR(dwError);
 
-        dwError = SolvGetPkgDescriptionFromId(
-                      pSack,
-                      dwPkgId,
-                      &pPkgInfo->pszDescription);
+        dwError = TDNFPkgInfoLookupString(pSack, dwPkgId, pPkgInfo,
+                                          SOLVABLE_LICENSE,
+                                          &pPkgInfo->pszLicense);
         BAIL_ON_TDNF_ERROR(dwError);
 
-        dwError = SolvGetSourceFromId(
-                      pSack,
-                      dwPkgId,
-                      &pszSrcName,
-                      &pszSrcArch,
-                      &pszSrcEVR);
+        dwError = TDNFPkgInfoLookupOptionalString(pSack, dwPkgId, pPkgInfo,
+                                                  SOLVABLE_DESCRIPTION,
+                                                  &pPkgInfo->pszDescription);
         BAIL_ON_TDNF_ERROR(dwError);
 
-        dwError = TDNFAllocateStringPrintf(
-                      &pPkgInfo->pszSourcePkg,
-                      "%s-%s.%s",
-                      pszSrcName, pszSrcEVR, pszSrcArch);
+        dwError = TDNFPkgInfoSetSourcePkg(pSack, dwPkgId, pPkgInfo);
         BAIL_ON_TDNF_ERROR(dwError);
-        if (dwPkgIndex < dwCount - 1)
-        {
-            pPkgInfo->pNext = &pPkgInfos[dwPkgIndex+1];
-        }
     }
 
     *pdwCount = dwCount;
     *ppPkgInfo = pPkgInfos;
 
 cleanup:
-    TDNF_SAFE_FREE_MEMORY(pszSrcName);
-    TDNF_SAFE_FREE_MEMORY(pszSrcArch);
-    TDNF_SAFE_FREE_MEMORY(pszSrcEVR);
     return dwError;
 
 error:
@@ -235,9 +598,6 @@ TDNFPopulatePkgInfoArray(
     Id dwPkgId = 0;
     PTDNF_PKG_INFO pPkgInfos = NULL;
     PTDNF_PKG_INFO pPkgInfo  = NULL;
-    char *pszSrcName = NULL;
-    char *pszSrcArch = NULL;
-    char *pszSrcEVR = NULL;
 
     if(!ppPkgInfo || !pdwCount || !pSack || !pPkgList)
     {
@@ -254,10 +614,7 @@ TDNFPopulatePkgInfoArray(
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
-    dwError = TDNFAllocateMemory(
-                  dwCount,
-                  sizeof(TDNF_PKG_INFO),
-                  (void**)&pPkgInfos);
+    dwError = TDNFAllocatePkgInfoArray(dwCount, &pPkgInfos);
     BAIL_ON_TDNF_ERROR(dwError);
 
     for (dwPkgIndex = 0; (uint32_t)dwPkgIndex < dwCount; dwPkgIndex++)
@@ -267,66 +624,32 @@ TDNFPopulatePkgInfoArray(
         dwError = SolvGetPackageId(pPkgList, dwPkgIndex, &dwPkgId);
         BAIL_ON_TDNF_ERROR(dwError);
 
-        dwError = SolvGetNevraFromId(
-                      pSack,
-                      dwPkgId,
-                      &pPkgInfo->dwEpoch,
-                      &pPkgInfo->pszName,
-                      &pPkgInfo->pszVersion,
-                      &pPkgInfo->pszRelease,
-                      &pPkgInfo->pszArch,
-                      &pPkgInfo->pszEVR);
-        BAIL_ON_TDNF_ERROR(dwError);
-
-        dwError = SolvGetPkgRepoNameFromId(
-                      pSack,
-                      dwPkgId,
-                      &pPkgInfo->pszRepoName);
+        dwError = TDNFPkgInfoSetNevra(pSack, dwPkgId, pPkgInfo);
         BAIL_ON_TDNF_ERROR(dwError);
 
         if(nDetail == DETAIL_INFO)
         {
-            dwError = SolvGetPkgInstallSizeFromId(
-                          pSack,
-                          dwPkgId,
-                          &pPkgInfo->dwInstallSizeBytes);
+            dwError = TDNFPkgInfoSetSizes(pSack, dwPkgId, pPkgInfo);
             BAIL_ON_TDNF_ERROR(dwError);
 
-            dwError = SolvGetPkgDownloadSizeFromId(
-                        pSack,
-                        dwPkgId,
-                        &pPkgInfo->dwDownloadSizeBytes);
+            dwError = TDNFPkgInfoLookupString(pSack, dwPkgId, pPkgInfo,
+                                              SOLVABLE_SUMMARY,
+                                              &pPkgInfo->pszSummary);
             BAIL_ON_TDNF_ERROR(dwError);
 
-            dwError = TDNFUtilsFormatSize(
-                          pPkgInfo->dwInstallSizeBytes,
-                          &pPkgInfo->pszFormattedSize);
+            dwError = TDNFPkgInfoLookupOptionalString(pSack, dwPkgId, pPkgInfo,
+                                                      SOLVABLE_URL,
+                                                      &pPkgInfo->pszURL);
             BAIL_ON_TDNF_ERROR(dwError);
 
-            dwError = TDNFUtilsFormatSize(
-                          pPkgInfo->dwDownloadSizeBytes,
-                          &pPkgInfo->pszFormattedDownloadSize);
+            dwError = TDNFPkgInfoLookupString(pSack, dwPkgId, pPkgInfo,
+                                              SOLVABLE_LICENSE,
+                                              &pPkgInfo->pszLicense);
             BAIL_ON_TDNF_ERROR(dwError);
 
-            dwError = SolvGetPkgSummaryFromId(
-                          pSack,
-                          dwPkgId,
-                          &pPkgInfo->pszSummary);
-            BAIL_ON_TDNF_ERROR(dwError);
-
-            dwError = SolvGetPkgUrlFromId(pSack, dwPkgId, &pPkgInfo->pszURL);
-            BAIL_ON_TDNF_ERROR(dwError);
-
-            dwError = SolvGetPkgLicenseFromId(
-                          pSack,
-                          dwPkgId,
-                          &pPkgInfo->pszLicense);
-            BAIL_ON_TDNF_ERROR(dwError);
-
-            dwError = SolvGetPkgDescriptionFromId(
-                          pSack,
-                          dwPkgId,
-                          &pPkgInfo->pszDescription);
+            dwError = TDNFPkgInfoLookupOptionalString(pSack, dwPkgId, pPkgInfo,
+                                                      SOLVABLE_DESCRIPTION,
+                                                      &pPkgInfo->pszDescription);
             BAIL_ON_TDNF_ERROR(dwError);
         }
         else if (nDetail == DETAIL_CHANGELOG)
@@ -339,33 +662,15 @@ TDNFPopulatePkgInfoArray(
         }
         else if (nDetail == DETAIL_SOURCEPKG)
         {
-            dwError = SolvGetSourceFromId(
-                          pSack,
-                          dwPkgId,
-                          &pszSrcName,
-                          &pszSrcArch,
-                          &pszSrcEVR);
-            BAIL_ON_TDNF_ERROR(dwError);
-
-            dwError = TDNFAllocateStringPrintf(
-                          &pPkgInfo->pszSourcePkg,
-                          "%s-%s.%s",
-                          pszSrcName, pszSrcEVR, pszSrcArch);
+            dwError = TDNFPkgInfoSetSourcePkg(pSack, dwPkgId, pPkgInfo);
             BAIL_ON_TDNF_ERROR(dwError);
         }
-        if (dwPkgIndex < dwCount - 1)
-        {
-            pPkgInfo->pNext = &pPkgInfos[dwPkgIndex+1];
-        }
     }
 
     *pdwCount = dwCount;
     *ppPkgInfo = pPkgInfos;
 
 cleanup:
-    TDNF_SAFE_FREE_MEMORY(pszSrcName);
-    TDNF_SAFE_FREE_MEMORY(pszSrcArch);
-    TDNF_SAFE_FREE_MEMORY(pszSrcEVR);
     return dwError;
 
 error:
@@ -413,44 +718,30 @@ TDNFPopulatePkgInfoForRepoSync(
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
-    dwError = TDNFAllocateMemory(
-                  dwCount,
-                  sizeof(TDNF_PKG_INFO),
-                  (void**)&pPkgInfos);
+    dwError = TDNFAllocatePkgInfoArray(dwCount, &pPkgInfos);
     BAIL_ON_TDNF_ERROR(dwError);
 
     for (dwPkgIndex = 0; (uint32_t)dwPkgIndex < dwCount; dwPkgIndex++)
     {
         pPkgInfo = &pPkgInfos[dwPkgIndex];
-        if ((uint32_t)dwPkgIndex < dwCount-1)
-        {
-            pPkgInfo->pNext = &pPkgInfos[dwPkgIndex+1];
-        }
 
         dwError = SolvGetPackageId(pPkgList, dwPkgIndex, &dwPkgId);
         BAIL_ON_TDNF_ERROR(dwError);
 
-        dwError = SolvGetNevraFromId(
-                      pSack,
-                      dwPkgId,
-                      &pPkgInfo->dwEpoch,
-                      &pPkgInfo->pszName,
-                      &pPkgInfo->pszVersion,
-                      &pPkgInfo->pszRelease,
-                      &pPkgInfo->pszArch,
-                      &pPkgInfo->pszEVR);
+        dwError = TDNFPkgInfoSetNevra(pSack, dwPkgId, pPkgInfo);
         BAIL_ON_TDNF_ERROR(dwError);
 
-        dwError = SolvGetPkgRepoNameFromId(
-                      pSack,
-                      dwPkgId,
-                      &pPkgInfo->pszRepoName);
+        dwError = TDNFPkgInfoSetLocation(pSack, dwPkgId, pPkgInfo);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        /* to verify what is already in the tree, and what we download */
+        dwError = TDNFPkgInfoSetChecksum(pSack, dwPkgId, pPkgInfo);
         BAIL_ON_TDNF_ERROR(dwError);
 
-        dwError = SolvGetPkgLocationFromId(
+        dwError = SolvGetPkgDownloadSizeFromId(
                       pSack,
                       dwPkgId,
-                      &pPkgInfo->pszLocation);
+                      &pPkgInfo->dwDownloadSizeBytes);
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
@@ -1070,10 +1361,16 @@ error:
     return dwError;
 }
 
+/*
+ * Fill in a list of package infos for pPkgList. dwFields is a mask of
+ * TDNF_PKG_INFO_FIELD values, only those columns (and the nevra) are
+ * looked up, the others are left empty.
+ */
 uint32_t
 TDNFPopulatePkgInfos(
     PSolvSack pSack,
     PSolvPackageList pPkgList,
+    uint32_t dwFields,
     PTDNF_PKG_INFO* ppPkgInfos
     )
 {
@@ -1083,7 +1380,6 @@ TDNFPopulatePkgInfos(
     Id dwPkgId = 0;
     PTDNF_PKG_INFO pPkgInfos = NULL;
     PTDNF_PKG_INFO pPkgInfo = NULL;
-    int nChecksumType = 0;
 
     if(!ppPkgInfos)
     {
@@ -1098,99 +1394,45 @@ TDNFPopulatePkgInfos(
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
+    dwError = TDNFAllocatePkgInfoArray(dwCount, &pPkgInfos);
+    BAIL_ON_TDNF_ERROR(dwError);
+
     for (dwPkgIndex = 0; (uint32_t)dwPkgIndex < dwCount; dwPkgIndex++)
     {
-        dwError = SolvGetPackageId(pPkgList, dwPkgIndex, &dwPkgId);
-        BAIL_ON_TDNF_ERROR(dwError);
-
-        dwError = TDNFAllocateMemory(
-                      1,
-                      sizeof(TDNF_PKG_INFO),
-                      (void**)&pPkgInfo);
-        BAIL_ON_TDNF_ERROR(dwError);
-
-        dwError = SolvGetNevraFromId(
-                      pSack,
-                      dwPkgId,
-                      &pPkgInfo->dwEpoch,
-                      &pPkgInfo->pszName,
-                      &pPkgInfo->pszVersion,
-                      &pPkgInfo->pszRelease,
-                      &pPkgInfo->pszArch,
-                      &pPkgInfo->pszEVR);
-        BAIL_ON_TDNF_ERROR(dwError);
-
-        dwError = SolvGetPkgRepoNameFromId(
-                      pSack,
-                      dwPkgId,
-                      &pPkgInfo->pszRepoName);
-        BAIL_ON_TDNF_ERROR(dwError);
+        /* the list is in reverse order of the package list */
+        pPkgInfo = &pPkgInfos[dwCount - 1 - dwPkgIndex];
 
-        dwError = SolvGetPkgSummaryFromId(
-                      pSack,
-                      dwPkgId,
-                      &pPkgInfo->pszSummary);
+        dwError = SolvGetPackageId(pPkgList, dwPkgIndex, &dwPkgId);
         BAIL_ON_TDNF_ERROR(dwError);
 
-        dwError = SolvGetPkgLocationFromId(
-                      pSack,
-                      dwPkgId,
-                      &pPkgInfo->pszLocation);
+        dwError = TDNFPkgInfoSetNevra(pSack, dwPkgId, pPkgInfo);
         BAIL_ON_TDNF_ERROR(dwError);
 
-        dwError = SolvGetPkgChecksumFromId(
-                      pSack,
-                      dwPkgId,
-                      &nChecksumType,
-                      &pPkgInfo->pbChecksum);
-        //Ignore no data
-        if(dwError == ERROR_TDNF_NO_DATA)
-        {
-            dwError = 0;
-        } else if (nChecksumType == REPOKEY_TYPE_SHA512)
-        {
-            pPkgInfo->nChecksumType = TDNF_HASH_SHA512;
-        } else if (nChecksumType == REPOKEY_TYPE_SHA256)
+        if(dwFields & PKGINFO_FIELD_SUMMARY)
         {
-            pPkgInfo->nChecksumType = TDNF_HASH_SHA256;
-        } else if (nChecksumType == REPOKEY_TYPE_SHA1)
-        {
-            pPkgInfo->nChecksumType = TDNF_HASH_SHA1;
-        } else if (nChecksumType == REPOKEY_TYPE_MD5)
-        {
-            pPkgInfo->nChecksumType = TDNF_HASH_MD5;
-        } else
-        {
-            pPkgInfo->pbChecksum = NULL;
+            dwError = TDNFPkgInfoLookupString(pSack, dwPkgId, pPkgInfo,
+                                              SOLVABLE_SUMMARY,
+                                              &pPkgInfo->pszSummary);
+            BAIL_ON_TDNF_ERROR(dwError);
         }
 
-        BAIL_ON_TDNF_ERROR(dwError);
-
-        dwError = SolvGetPkgInstallSizeFromId(
-                      pSack,
-                      dwPkgId,
-                      &pPkgInfo->dwInstallSizeBytes);
-        BAIL_ON_TDNF_ERROR(dwError);
-
-        dwError = SolvGetPkgDownloadSizeFromId(
-                      pSack,
-                      dwPkgId,
-                      &pPkgInfo->dwDownloadSizeBytes);
-        BAIL_ON_TDNF_ERROR(dwError);
-
-        dwError = TDNFUtilsFormatSize(
-                      pPkgInfo->dwInstallSizeBytes,
-                      &pPkgInfo->pszFormattedSize);
-        BAIL_ON_TDNF_ERROR(dwError);
+        if(dwFields & PKGINFO_FIELD_LOCATION)
+        {
+            dwError = TDNFPkgInfoSetLocation(pSack, dwPkgId, pPkgInfo);
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
 
-        dwError = TDNFUtilsFormatSize(
-                      pPkgInfo->dwDownloadSizeBytes,
-                      &pPkgInfo->pszFormattedDownloadSize);
-        BAIL_ON_TDNF_ERROR(dwError);
+        if(dwFields & PKGINFO_FIELD_CHECKSUM)
+        {
+            dwError = TDNFPkgInfoSetChecksum(pSack, dwPkgId, pPkgInfo);
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
 
-        pPkgInfo->pNext = pPkgInfos;
-        pPkgInfos = pPkgInfo;
-        pPkgInfo = NULL;
+        if(dwFields & PKGINFO_FIELD_SIZES)
+        {
+            dwError = TDNFPkgInfoSetSizes(pSack, dwPkgId, pPkgInfo);
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
     }
 
     *ppPkgInfos = pPkgInfos;
@@ -1206,11 +1448,7 @@ error:
     }
     if (pPkgInfos)
     {
-        TDNFFreePackageInfo(pPkgInfos);
-    }
-    if (pPkgInfo)
-    {
-        TDNFFreePackageInfo(pPkgInfo);
+        TDNFFreePackageInfoArray(pPkgInfos, dwCount);
     }
     goto cleanup;
 }
@@ -179,6 +179,13 @@ TDNFDownloadFileFromRepo(
     const char *pszProgressData
 );
 
+uint32_t
+TDNFCurlApplyRepoSettings(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepo,
+    CURL *pCurl
+    );
+
 uint32_t
 TDNFDownloadFile(
     PTDNF pTdnf,
@@ -214,6 +221,13 @@ TDNFDownloadPackageToCache(
     char** ppszFilePath
     );
 
+uint32_t
+TDNFPackagePathInTree(
+    const char* pszPackageLocation,
+    const char* pszNormalRpmCacheDir,
+    char** ppszFilePath
+    );
+
 uint32_t
 TDNFDownloadPackageToTree(
     PTDNF pTdnf,
@@ -234,6 +248,107 @@ TDNFDownloadPackageToDirectory(
     char** ppszFilePath
     );
 
+//download.c
+uint32_t
+TDNFDownloadQueueCreate(
+    PTDNF_DOWNLOAD_QUEUE *ppQueue
+    );
+
+uint32_t
+TDNFDownloadQueueAdd(
+    PTDNF_DOWNLOAD_QUEUE pQueue,
+    PTDNF_REPO_DATA pRepo,
+    const char *pszLocation,
+    const char *pszFile,
+    const char *pszProgressData
+    );
+
+uint32_t
+TDNFDownloadQueueRun(
+    PTDNF pTdnf,
+    PTDNF_DOWNLOAD_QUEUE pQueue
+    );
+
+uint32_t
+TDNFDownloadQueueSetVerify(
+    PTDNF_DOWNLOAD_QUEUE pQueue,
+    const char *pszFile,
+    int nChecksumType,
+    const unsigned char *pbChecksum,
+    uint64_t qwSize
+    );
+
+int
+TDNFDownloadQueueIsVerified(
+    PTDNF_DOWNLOAD_QUEUE pQueue,
+    const char *pszFile
+    );
+
+uint32_t
+TDNFDownloadQueueRepoError(
+    PTDNF_DOWNLOAD_QUEUE pQueue,
+    PTDNF_REPO_DATA pRepo
+    );
+
+void
+TDNFFreeDownloadQueue(
+    PTDNF_DOWNLOAD_QUEUE pQueue
+    );
+
+uint32_t
+TDNFCurlPoolGetHandle(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepo,
+    CURL **ppCurl
+    );
+
+void
+TDNFCurlPoolReleaseHandle(
+    PTDNF pTdnf,
+    CURL *pCurl
+    );
+
+void
+TDNFCurlPoolCountTransfer(
+    PTDNF pTdnf,
+    CURL *pCurl
+    );
+
+void
+TDNFCurlPoolShowStats(
+    PTDNF pTdnf
+    );
+
+void
+TDNFFreeCurlPool(
+    PTDNF_CURL_POOL pPool
+    );
+
+//reposync.c
+uint32_t
+TDNFRepoMirrorCreate(
+    PTDNF pTdnf,
+    PTDNF_REPOSYNC_ARGS pReposyncArgs,
+    const char *pszRootPath,
+    PTDNF_REPOSYNC_CTX *ppSync
+    );
+
+uint32_t
+TDNFRepoMirrorAdd(
+    PTDNF_REPOSYNC_CTX pSync,
+    PTDNF_PKG_INFO pPkgInfo
+    );
+
+uint32_t
+TDNFRepoMirrorRun(
+    PTDNF_REPOSYNC_CTX pSync
+    );
+
+void
+TDNFFreeRepoMirror(
+    PTDNF_REPOSYNC_CTX pSync
+    );
+
 //packageutils.c
 uint32_t
 TDNFMatchForReinstall(
@@ -242,10 +357,26 @@ TDNFMatchForReinstall(
     Queue* pQueueGoal
     );
 
+uint32_t
+TDNFAllocatePkgInfoArray(
+    uint32_t dwCount,
+    PTDNF_PKG_INFO* ppPkgInfos
+    );
+
+uint32_t
+TDNFPkgInfoLookupString(
+    PSolvSack pSack,
+    Id dwPkgId,
+    PTDNF_PKG_INFO pPkgInfo,
+    Id dwKey,
+    char** ppszValue
+    );
+
 uint32_t
 TDNFPopulatePkgInfos(
     PSolvSack pSack,
     PSolvPackageList pPkgList,
+    uint32_t dwFields,
     PTDNF_PKG_INFO* ppPkgInfo
     );
 
@@ -582,12 +713,19 @@ TDNFInitRepoFromMetadata(
     );
 
 uint32_t
-TDNFInitRepo(
+TDNFLoadRepo(
     PTDNF pTdnf,
     PTDNF_REPO_DATA pRepoData,
+    PTDNF_REPO_METADATA pRepoMD,
     PSolvSack pSack
     );
 
+void
+TDNFRepoSyncFailed(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepoData
+    );
+
 uint32_t
 TDNFInitCmdLineRepo(
     PTDNF pTdnf,
@@ -638,11 +776,36 @@ TDNFGetRepoById(
     );
 
 uint32_t
-TDNFGetRepoMD(
+TDNFRepoSyncCreate(
     PTDNF pTdnf,
     PTDNF_REPO_DATA pRepoData,
-    const char *pszRepoDataDir,
-    PTDNF_REPO_METADATA *ppRepoMD
+    PTDNF_REPO_SYNC *ppSync
+    );
+
+uint32_t
+TDNFRepoSyncStart(
+    PTDNF pTdnf,
+    PTDNF_REPO_SYNC pSync,
+    PTDNF_DOWNLOAD_QUEUE pQueue
+    );
+
+uint32_t
+TDNFRepoSyncUpdate(
+    PTDNF pTdnf,
+    PTDNF_REPO_SYNC pSync,
+    PTDNF_DOWNLOAD_QUEUE pQueue
+    );
+
+uint32_t
+TDNFSyncRepos(
+    PTDNF pTdnf,
+    PTDNF_REPO_SYNC *ppSyncs,
+    uint32_t nCount
+    );
+
+void
+TDNFFreeRepoSync(
+    PTDNF_REPO_SYNC pSync
     );
 
 uint32_t
@@ -654,7 +817,8 @@ uint32_t
 TDNFFindRepoMDPart(
     Repo *pSolvRepo,
     const char *pszType,
-    char **ppszPart
+    char **ppszPart,
+    PTDNF_REPO_MD_PART pPart
     );
 
 void
@@ -667,9 +831,25 @@ TDNFEnsureRepoMDParts(
     PTDNF pTdnf,
     PTDNF_REPO_DATA pRepo,
     PTDNF_REPO_METADATA pRepoMDRel,
+    const char *pszReuseDir,
+    int nRepoMDChanged,
+    PTDNF_DOWNLOAD_QUEUE pQueue,
     PTDNF_REPO_METADATA *ppRepoMD
     );
 
+uint32_t
+TDNFDownloadRepoMDPart(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepo,
+    const char *pszLocation,
+    const char *pszDestPath,
+    const char *pszPartName,
+    PTDNF_REPO_MD_PART pPart,
+    const char *pszReuseDir,
+    int nRepoMDChanged,
+    PTDNF_DOWNLOAD_QUEUE pQueue
+    );
+
 uint32_t
 TDNFParseRepoMD(
     PTDNF_REPO_METADATA pRepoMD
@@ -679,7 +859,8 @@ uint32_t
 TDNFFindRepoMDPart(
     Repo *pSolvRepo,
     const char *pszType,
-    char **ppszPart
+    char **ppszPart,
+    PTDNF_REPO_MD_PART pPart
     );
 
 void
@@ -822,11 +1003,28 @@ TDNFTransAddErasePkg(
     const char* pszPkgName
     );
 
+uint32_t
+TDNFTransGetPkgFilePaths(
+    PTDNF pTdnf,
+    PTDNF_PKG_INFO pInfos,
+    char ***pppszFilePaths
+    );
+
+uint32_t
+TDNFTransGetPkgFilePath(
+    PTDNF pTdnf,
+    PTDNF_PKG_INFO pInfo,
+    PTDNF_REPO_DATA pRepo,
+    char **ppszFilePath
+    );
+
 uint32_t
 TDNFTransAddInstallPkgs(
     PTDNFRPMTS pTS,
     PTDNF pTdnf,
     PTDNF_PKG_INFO pInfo,
+    char **ppszFilePaths,
+    PTDNF_DOWNLOAD_QUEUE pQueue,
     int nUpgrade
     );
 
@@ -836,6 +1034,8 @@ TDNFTransAddInstallPkg(
     PTDNF pTdnf,
     PTDNF_PKG_INFO pInfo,
     PTDNF_REPO_DATA pRepo,
+    const char *pszLocalPath,
+    int nVerified,
     int nUpgrade
     );
 
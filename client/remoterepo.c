@@ -146,42 +146,27 @@ error:
     goto cleanup;
 }
 
+/*
+ * Apply the settings every transfer for pRepo needs (credentials,
+ * user agent, proxy, speed limits and SSL) to a curl easy handle.
+ * The caller still sets the URL and the write target.
+ */
 uint32_t
-TDNFDownloadFile(
+TDNFCurlApplyRepoSettings(
     PTDNF pTdnf,
     PTDNF_REPO_DATA pRepo,
-    const char *pszFileUrl,
-    const char *pszFile,
-    const char *pszProgressData
+    CURL *pCurl
     )
 {
     uint32_t dwError = 0;
-    CURL *pCurl = NULL;
-    FILE *fp = NULL;
     char *pszUserPass = NULL;
-    char *pszFileTmp = NULL;
-    /* lStatus reads CURLINFO_RESPONSE_CODE. Must be long */
-    long lStatus = 0;
-    int i;
-    int nNoOutput = 1;
 
-    /* TDNFFetchRemoteGPGKey sends pszProgressData as NULL */
-    if(!pTdnf ||
-       !pRepo ||
-       IsNullOrEmptyString(pszFileUrl) ||
-       IsNullOrEmptyString(pszFile))
+    if(!pTdnf || !pTdnf->pConf || !pRepo || !pCurl)
     {
         dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
-    pCurl = curl_easy_init();
-    if(!pCurl)
-    {
-        dwError = ERROR_TDNF_CURL_INIT;
-        BAIL_ON_TDNF_ERROR(dwError);
-    }
-
     dwError = TDNFRepoGetUserPass(pTdnf, pRepo, &pszUserPass);
     BAIL_ON_TDNF_ERROR(dwError);
 
@@ -212,10 +197,49 @@ TDNFDownloadFile(
     dwError = TDNFRepoApplySSLSettings(pRepo, pCurl);
     BAIL_ON_TDNF_ERROR(dwError);
 
-    dwError = curl_easy_setopt(pCurl, CURLOPT_URL, pszFileUrl);
+    dwError = curl_easy_setopt(pCurl, CURLOPT_FOLLOWLOCATION, 1L);
     BAIL_ON_TDNF_CURL_ERROR(dwError);
 
-    dwError = curl_easy_setopt(pCurl, CURLOPT_FOLLOWLOCATION, 1L);
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszUserPass);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+uint32_t
+TDNFDownloadFile(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepo,
+    const char *pszFileUrl,
+    const char *pszFile,
+    const char *pszProgressData
+    )
+{
+    uint32_t dwError = 0;
+    CURL *pCurl = NULL;
+    FILE *fp = NULL;
+    char *pszFileTmp = NULL;
+    /* lStatus reads CURLINFO_RESPONSE_CODE. Must be long */
+    long lStatus = 0;
+    int i;
+    int nNoOutput = 1;
+
+    /* TDNFFetchRemoteGPGKey sends pszProgressData as NULL */
+    if(!pTdnf ||
+       !pRepo ||
+       IsNullOrEmptyString(pszFileUrl) ||
+       IsNullOrEmptyString(pszFile))
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFCurlPoolGetHandle(pTdnf, pRepo, &pCurl);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = curl_easy_setopt(pCurl, CURLOPT_URL, pszFileUrl);
     BAIL_ON_TDNF_CURL_ERROR(dwError);
 
     if (!pTdnf->pArgs->nQuiet && pszProgressData != NULL)
@@ -251,6 +275,7 @@ TDNFDownloadFile(
             pr_info("retrying %d/%d\n", i, pRepo->nRetries);
         }
         dwError = curl_easy_perform(pCurl);
+        TDNFCurlPoolCountTransfer(pTdnf, pCurl);
         if (dwError == CURLE_OK)
         {
             fclose(fp);
@@ -301,7 +326,6 @@ TDNFDownloadFile(
     }
 
 cleanup:
-    TDNF_SAFE_FREE_MEMORY(pszUserPass);
     TDNF_SAFE_FREE_MEMORY(pszFileTmp);
     if(fp)
     {
@@ -310,7 +334,7 @@ cleanup:
     }
     if(pCurl)
     {
-        curl_easy_cleanup(pCurl);
+        TDNFCurlPoolReleaseHandle(pTdnf, pCurl);
     }
     return dwError;
 
@@ -408,7 +432,16 @@ TDNFDownloadPackage(
     /* don't download if file is already there. Older versions may have left
        size 0 files, so check for those too */
     dwError = TDNFGetFileSize(pszPackageFile, &nSize);
-    if ((dwError == ERROR_TDNF_FILE_NOT_FOUND) || (nSize == 0))
+    if (((dwError == ERROR_TDNF_FILE_NOT_FOUND) || (nSize == 0)) &&
+        pTdnf->pDownloadQueue)
+    {
+        dwError = TDNFDownloadQueueAdd(pTdnf->pDownloadQueue,
+                                       pRepo,
+                                       pszPackageLocation,
+                                       pszPackageFile,
+                                       pszPkgName);
+    }
+    else if ((dwError == ERROR_TDNF_FILE_NOT_FOUND) || (nSize == 0))
     {
         dwError = TDNFDownloadFileFromRepo(pTdnf,
                                    pRepo,
@@ -481,34 +514,26 @@ error:
 }
 
 /*
- * TDNFDownloadPackageToTree()
+ * TDNFPackagePathInTree()
  *
- * Download a package while preserving the directory path. For example,
- * if pszPackageLocation is "RPMS/x86_64/foo-1.2-3.rpm", the destination will
- * be downloaded under the destination directory in RPMS/x86_64/foo-1.2-3.rpm
- * (so 'RPMS/x86_64/' will be preserved).
-*/
+ * Get the path of pszPackageLocation under pszNormalRpmCacheDir, with its
+ * directory path preserved. Fails with ERROR_TDNF_URL_INVALID if the
+ * location would lead outside of the directory.
+ */
 
 uint32_t
-TDNFDownloadPackageToTree(
-    PTDNF pTdnf,
+TDNFPackagePathInTree(
     const char* pszPackageLocation,
-    const char* pszPkgName,
-    PTDNF_REPO_DATA pRepo,
-    char* pszNormalRpmCacheDir,
+    const char* pszNormalRpmCacheDir,
     char** ppszFilePath
     )
 {
     uint32_t dwError = 0;
     char* pszFilePath = NULL;
     char* pszNormalPath = NULL;
-    char* pszDownloadCacheDir = NULL;
     char* pszRemotePath = NULL;
 
-    if(!pTdnf ||
-       IsNullOrEmptyString(pszPackageLocation) ||
-       IsNullOrEmptyString(pszPkgName) ||
-       !pRepo ||
+    if(IsNullOrEmptyString(pszPackageLocation) ||
        IsNullOrEmptyString(pszNormalRpmCacheDir) ||
        !ppszFilePath)
     {
@@ -538,6 +563,56 @@ TDNFDownloadPackageToTree(
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
+    *ppszFilePath = pszNormalPath;
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszFilePath);
+    TDNF_SAFE_FREE_MEMORY(pszRemotePath);
+    return dwError;
+
+error:
+    TDNF_SAFE_FREE_MEMORY(pszNormalPath);
+    goto cleanup;
+}
+
+/*
+ * TDNFDownloadPackageToTree()
+ *
+ * Download a package while preserving the directory path. For example,
+ * if pszPackageLocation is "RPMS/x86_64/foo-1.2-3.rpm", the destination will
+ * be downloaded under the destination directory in RPMS/x86_64/foo-1.2-3.rpm
+ * (so 'RPMS/x86_64/' will be preserved).
+*/
+
+uint32_t
+TDNFDownloadPackageToTree(
+    PTDNF pTdnf,
+    const char* pszPackageLocation,
+    const char* pszPkgName,
+    PTDNF_REPO_DATA pRepo,
+    char* pszNormalRpmCacheDir,
+    char** ppszFilePath
+    )
+{
+    uint32_t dwError = 0;
+    char* pszNormalPath = NULL;
+    char* pszDownloadCacheDir = NULL;
+
+    if(!pTdnf ||
+       IsNullOrEmptyString(pszPackageLocation) ||
+       IsNullOrEmptyString(pszPkgName) ||
+       !pRepo ||
+       IsNullOrEmptyString(pszNormalRpmCacheDir) ||
+       !ppszFilePath)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFPackagePathInTree(pszPackageLocation,
+                                    pszNormalRpmCacheDir,
+                                    &pszNormalPath);
+    BAIL_ON_TDNF_ERROR(dwError);
+
     dwError = TDNFDirName(pszNormalPath, &pszDownloadCacheDir);
     BAIL_ON_TDNF_ERROR(dwError);
 
@@ -567,9 +642,7 @@ TDNFDownloadPackageToTree(
 
     *ppszFilePath = pszNormalPath;
 cleanup:
-    TDNF_SAFE_FREE_MEMORY(pszFilePath);
     TDNF_SAFE_FREE_MEMORY(pszDownloadCacheDir);
-    TDNF_SAFE_FREE_MEMORY(pszRemotePath);
     return dwError;
 
 error:
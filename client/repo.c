@@ -8,56 +8,77 @@
 
 #include "includes.h"
 
-//Download repo metadata and initialize
+static
+void
+_TDNFRepoSyncSetError(
+    PTDNF_REPO_SYNC pSync,
+    uint32_t dwError
+    );
+
+static
+void
+_TDNFGetRepoMDPartInfo(
+    Pool *pPool,
+    PTDNF_REPO_MD_PART pPart
+    );
+
+static
 uint32_t
-TDNFInitRepo(
+_TDNFCheckRepoMDPartDigest(
+    const char *pszFile,
+    PTDNF_REPO_MD_PART pPart
+    );
+
+static
+uint32_t
+_TDNFReuseRepoMDPart(
+    const char *pszReuseDir,
+    const char *pszDestPath,
+    PTDNF_REPO_MD_PART pPart
+    );
+
+static
+uint32_t
+_TDNFGetRepoMDPartCookie(
+    PTDNF_REPO_MD_PART pPart,
+    const unsigned char *pszBaseCookie,
+    const unsigned char *pszRepoMDCookie,
+    unsigned char *pszCookie
+    );
+
+//Add a repo with already synced metadata to the pool
+uint32_t
+TDNFLoadRepo(
     PTDNF pTdnf,
     PTDNF_REPO_DATA pRepoData,
+    PTDNF_REPO_METADATA pRepoMD,
     PSolvSack pSack
     )
 {
     uint32_t dwError = 0;
-    char* pszRepoDataDir = NULL;
     char* pszRepoCacheDir = NULL;
-    PTDNF_REPO_METADATA pRepoMD = NULL;
     Repo* pRepo = NULL;
     Pool* pPool = NULL;
     int nUseMetaDataCache = 0;
     PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo = NULL;
+    struct timespec tsStart = {0}, tsEnd = {0};
+    unsigned char pszRepoMDCookie[SOLV_COOKIE_LEN] = {0};
 
-    if (!pTdnf || !pRepoData || !pSack || !pSack->pPool)
+    if (!pTdnf || !pRepoData || !pSack || !pSack->pPool ||
+        (pRepoData->nHasMetaData && !pRepoMD))
     {
         dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
     pPool = pSack->pPool;
+    clock_gettime(CLOCK_MONOTONIC, &tsStart);
 
     dwError = TDNFGetCachePath(pTdnf, pRepoData,
                                NULL, NULL,
                                &pszRepoCacheDir);
     BAIL_ON_TDNF_ERROR(dwError);
 
-    dwError = TDNFJoinPath(
-                  &pszRepoDataDir,
-                  pszRepoCacheDir,
-                  TDNF_REPODATA_DIR_NAME,
-                  NULL);
-    BAIL_ON_TDNF_ERROR(dwError);
-
-    if (pRepoData->nHasMetaData) {
-        dwError = TDNFUtilsMakeDirs(pszRepoDataDir);
-        if (dwError == ERROR_TDNF_ALREADY_EXISTS)
-        {
-            dwError = 0;
-        }
-        dwError = TDNFGetRepoMD(pTdnf,
-                                pRepoData,
-                                pszRepoDataDir,
-                                &pRepoMD);
-        BAIL_ON_TDNF_ERROR(dwError);
-    }
-
     dwError = TDNFAllocateMemory(
                   1,
                   sizeof(SOLV_REPO_INFO_INTERNAL),
@@ -79,13 +100,52 @@ TDNFInitRepo(
 
     pSolvRepoInfo->pRepo = pRepo;
     pSolvRepoInfo->pszRepoCacheDir = pszRepoCacheDir;
+    pszRepoCacheDir = NULL;
     pRepo->appdata = pSolvRepoInfo;
 
     if (pRepoData->nHasMetaData) {
-        dwError = SolvCalculateCookieForFile(pRepoMD->pszRepoMD, pSolvRepoInfo->cookie);
+        /* each part has a cache of its own, so that a change in one
+           part does not make the others be parsed again */
+        dwError = SolvCalculateCookieForFile(pRepoMD->pszRepoMD, pszRepoMDCookie);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        dwError = _TDNFGetRepoMDPartCookie(&pRepoMD->stPrimary, NULL,
+                      pszRepoMDCookie, pSolvRepoInfo->cookie);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        /* file lists and changelogs extend the primary solvables */
+        dwError = _TDNFGetRepoMDPartCookie(&pRepoMD->stFileLists,
+                      pSolvRepoInfo->cookie, pszRepoMDCookie,
+                      pSolvRepoInfo->ppExtCookie[SOLV_EXT_FILELISTS]);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        dwError = _TDNFGetRepoMDPartCookie(&pRepoMD->stOther,
+                      pSolvRepoInfo->cookie, pszRepoMDCookie,
+                      pSolvRepoInfo->ppExtCookie[SOLV_EXT_OTHER]);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        dwError = _TDNFGetRepoMDPartCookie(&pRepoMD->stUpdateInfo, NULL,
+                      pszRepoMDCookie,
+                      pSolvRepoInfo->ppExtCookie[SOLV_EXT_UPDATEINFO]);
         BAIL_ON_TDNF_ERROR(dwError);
         pSolvRepoInfo->nCookieSet = 1;
 
+        dwError = TDNFSafeAllocateString(
+                      pRepoMD->pszUpdateInfo,
+                      &pSolvRepoInfo->ppszExtMetaData[SOLV_EXT_UPDATEINFO]);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        /* file lists and changelogs are loaded on demand */
+        dwError = TDNFSafeAllocateString(
+                      pRepoMD->pszFileLists,
+                      &pSolvRepoInfo->ppszExtMetaData[SOLV_EXT_FILELISTS]);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        dwError = TDNFSafeAllocateString(
+                      pRepoMD->pszOther,
+                      &pSolvRepoInfo->ppszExtMetaData[SOLV_EXT_OTHER]);
+        BAIL_ON_TDNF_ERROR(dwError);
+
         dwError = SolvUseMetaDataCache(pSack, pSolvRepoInfo, &nUseMetaDataCache);
         BAIL_ON_TDNF_ERROR(dwError);
 
@@ -96,40 +156,59 @@ TDNFInitRepo(
             dwError = SolvCreateMetaDataCache(pSack, pSolvRepoInfo);
             BAIL_ON_TDNF_ERROR(dwError);
         }
+
+        dwError = SolvLoadMetaDataExt(pSack, SOLV_EXT_UPDATEINFO);
+        BAIL_ON_TDNF_ERROR(dwError);
     } else {
         dwError = SolvReadRpmsFromDirectory(pRepo, pRepoData->ppszBaseUrls[0]);
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
-    pool_addfileprovides(pPool);
-    pool_createwhatprovides(pPool);
+    /* the provides index is built once all repos are loaded */
+    pSack->nProvidesDirty = 1;
+
+    if (pTdnf->pArgs->nVerbose)
+    {
+        clock_gettime(CLOCK_MONOTONIC, &tsEnd);
+        pr_info("Loaded repo '%s' from %s in %.1f ms\n",
+                pRepoData->pszId,
+                nUseMetaDataCache ? "solv cache" :
+                    pRepoData->nHasMetaData ? "metadata" : "directory",
+                (tsEnd.tv_sec - tsStart.tv_sec) * 1000.0 +
+                (tsEnd.tv_nsec - tsStart.tv_nsec) / 1000000.0);
+    }
 
 cleanup:
-    TDNFFreeRepoMetadata(pRepoMD);
-    TDNF_SAFE_FREE_MEMORY(pszRepoDataDir);
     TDNF_SAFE_FREE_MEMORY(pszRepoCacheDir);
-    TDNF_SAFE_FREE_MEMORY(pSolvRepoInfo);
     return dwError;
 error:
     if(pRepo)
     {
         repo_free(pRepo, 1);
     }
-    //If there is an error during init, log the error
-    //remove any cache data that could be potentially corrupt.
-    if(pRepoData)
-    {
-        pr_err("Error: Failed to synchronize cache for repo '%s'\n",
-            pRepoData->pszName);
+    SolvFreeRepoInfo(pSolvRepoInfo);
+    goto cleanup;
+}
 
-        if(pTdnf)
-        {
-            TDNFRepoRemoveCache(pTdnf, pRepoData);
-            TDNFRemoveSolvCache(pTdnf, pRepoData);
-            TDNFRemoveLastRefreshMarker(pTdnf, pRepoData);
-        }
+//If there is an error during init, log the error
+//remove any cache data that could be potentially corrupt.
+void
+TDNFRepoSyncFailed(
+    PTDNF pTdnf,
+    PTDNF_REPO_DATA pRepoData
+    )
+{
+    if (!pTdnf || !pRepoData)
+    {
+        return;
     }
-    goto cleanup;
+
+    pr_err("Error: Failed to synchronize cache for repo '%s'\n",
+        pRepoData->pszName);
+
+    TDNFRepoRemoveCache(pTdnf, pRepoData);
+    TDNFRemoveSolvCache(pTdnf, pRepoData);
+    TDNFRemoveLastRefreshMarker(pTdnf, pRepoData);
 }
 
 uint32_t
@@ -151,9 +230,9 @@ TDNFInitRepoFromMetadata(
                   pszRepoName,
                   pRepoMD->pszRepoMD,
                   pRepoMD->pszPrimary,
-                  pRepoMD->pszFileLists,
-                  pRepoMD->pszUpdateInfo,
-                  pRepoMD->pszOther);
+                  NULL,
+                  NULL,
+                  NULL);
 cleanup:
     return dwError;
 
@@ -199,7 +278,6 @@ TDNFInitCmdLineRepo(
     pTdnf->pSolvCmdLineRepo = pRepo;
 
 cleanup:
-    TDNF_SAFE_FREE_MEMORY(pSolvRepoInfo);
     return dwError;
 error:
     /*
@@ -212,6 +290,7 @@ error:
         /* coverity[dead_error_line] */
         repo_free(pRepo, 1);
     }
+    SolvFreeRepoInfo(pSolvRepoInfo);
     goto cleanup;
 }
 
@@ -525,46 +604,97 @@ error:
     goto cleanup;
 }
 
+/*
+ * Syncing the metadata of a repo is split in steps, so that
+ * TDNFSyncRepos() can run the downloads of one step for all repos
+ * through one download queue. Each step adds its downloads to pQueue,
+ * which has to be run before the next step.
+ */
 uint32_t
-TDNFGetRepoMD(
+TDNFRepoSyncCreate(
     PTDNF pTdnf,
     PTDNF_REPO_DATA pRepoData,
-    const char *pszRepoDataDir,
-    PTDNF_REPO_METADATA *ppRepoMD
+    PTDNF_REPO_SYNC *ppSync
     )
 {
     uint32_t dwError = 0;
-    char *pszRepoMDFile = NULL;
-    char *pszRepoMDUrl = NULL;
-    char *pszTmpRepoDataDir = NULL;
-    char *pszTmpRepoMDFile = NULL;
+    char *pszRepoCacheDir = NULL;
+    PTDNF_REPO_SYNC pSync = NULL;
+
+    if (!pTdnf || !pRepoData || !ppSync)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFAllocateMemory(
+                  1,
+                  sizeof(TDNF_REPO_SYNC),
+                  (void **)&pSync);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    pSync->pRepo = pRepoData;
+
+    dwError = TDNFGetCachePath(pTdnf, pRepoData,
+                               NULL, NULL,
+                               &pszRepoCacheDir);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFJoinPath(
+                  &pSync->pszRepoDataDir,
+                  pszRepoCacheDir,
+                  TDNF_REPODATA_DIR_NAME,
+                  NULL);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFJoinPath(&pSync->pszRepoMDFile,
+                           pSync->pszRepoDataDir,
+                           TDNF_REPO_METADATA_FILE_NAME,
+                           NULL);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    *ppSync = pSync;
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszRepoCacheDir);
+    return dwError;
+
+error:
+    TDNFFreeRepoSync(pSync);
+    goto cleanup;
+}
+
+//Get the base urls and start the download of repomd.xml to tmp
+uint32_t
+TDNFRepoSyncStart(
+    PTDNF pTdnf,
+    PTDNF_REPO_SYNC pSync,
+    PTDNF_DOWNLOAD_QUEUE pQueue
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_REPO_DATA pRepoData = NULL;
     char *pszMirrorFile = NULL;
-    char *pszTempBaseUrlFile = NULL;
-    char* pszLastRefreshMarker = NULL;
-    PTDNF_REPO_METADATA pRepoMDRel = NULL;
-    PTDNF_REPO_METADATA pRepoMD = NULL;
-    unsigned char pszMDCookie[SOLV_COOKIE_LEN] = {0};
-    unsigned char pszTmpCookie[SOLV_COOKIE_LEN] = {0};
     int nNeedDownload = 0;
-    int nNewRepoMDFile = 0;
-    int nReplaceRepoMD = 0;
-    int nKeepCache = 0;
-    char *pszError = NULL;
 
-    if (!pTdnf ||
-        !pRepoData ||
-        IsNullOrEmptyString(pszRepoDataDir) ||
-        !ppRepoMD)
+    if (!pTdnf || !pSync || !pSync->pRepo || !pQueue)
     {
         dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_TDNF_ERROR(dwError);
     }
+    pRepoData = pSync->pRepo;
+
+    dwError = TDNFUtilsMakeDirs(pSync->pszRepoDataDir);
+    if (dwError == ERROR_TDNF_ALREADY_EXISTS)
+    {
+        dwError = 0;
+    }
 
     /* plugin event indicating a repomd download is about to start */
     dwError = TDNFEventRepoMDDownloadStart(
                   pTdnf,
                   pRepoData->pszId,
-                  pszRepoDataDir);
+                  pSync->pszRepoDataDir);
     BAIL_ON_TDNF_ERROR(dwError);
 
     if (pRepoData->pszMirrorList) {
@@ -587,6 +717,7 @@ TDNFGetRepoMD(
         } else if ((now - st.st_ctime) > pRepoData->lMetadataExpire)
             needDownload = 1;
 
+        /* the base urls are needed right away, so this is not queued */
         if (needDownload) {
             dwError = TDNFDownloadFile(pTdnf, pRepoData, pRepoData->pszMirrorList, pszMirrorFile, pRepoData->pszId);
             BAIL_ON_TDNF_ERROR(dwError);
@@ -616,33 +747,8 @@ TDNFGetRepoMD(
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
-    nKeepCache = pTdnf->pConf->nKeepCache;
-
-    dwError = TDNFJoinPath(&pszRepoMDFile,
-                           pszRepoDataDir,
-                           TDNF_REPO_METADATA_FILE_NAME,
-                           NULL);
-    BAIL_ON_TDNF_ERROR(dwError);
-
-    dwError = TDNFAllocateMemory(
-                  1,
-                  sizeof(TDNF_REPO_METADATA),
-                  (void **)&pRepoMDRel);
-    BAIL_ON_TDNF_ERROR(dwError);
-
-    dwError = TDNFGetCachePath(pTdnf, pRepoData,
-                               NULL, NULL,
-                               &pRepoMDRel->pszRepoCacheDir);
-    BAIL_ON_TDNF_ERROR(dwError);
-
-    dwError = TDNFAllocateString(pszRepoMDFile, &pRepoMDRel->pszRepoMD);
-    BAIL_ON_TDNF_ERROR(dwError);
-
-    dwError = TDNFAllocateString(pRepoData->pszId, &pRepoMDRel->pszRepo);
-    BAIL_ON_TDNF_ERROR(dwError);
-
     /* if repomd.xml file is not present, set flag to download */
-    if (access(pszRepoMDFile, F_OK))
+    if (access(pSync->pszRepoMDFile, F_OK))
     {
         if (errno != ENOENT)
         {
@@ -652,12 +758,14 @@ TDNFGetRepoMD(
         nNeedDownload = 1;
     }
 
-    /* if refresh flag is set, get shasum of existing repomd file */
-    if (pTdnf->pArgs->nRefresh)
+    /* if refresh flag is set or the metadata expired, get shasum of
+       existing repomd file */
+    if (pTdnf->pArgs->nRefresh || pSync->nExpired)
     {
-        if (!access(pszRepoMDFile, F_OK))
+        if (!access(pSync->pszRepoMDFile, F_OK))
         {
-            dwError = SolvCalculateCookieForFile(pszRepoMDFile, pszMDCookie);
+            dwError = SolvCalculateCookieForFile(pSync->pszRepoMDFile,
+                                                 pSync->pszMDCookie);
             BAIL_ON_TDNF_ERROR(dwError);
         }
         nNeedDownload = 1;
@@ -670,10 +778,10 @@ TDNFGetRepoMD(
         /* always download to tmp */
         dwError = TDNFGetCachePath(pTdnf, pRepoData,
                                    "tmp", NULL,
-                                   &pszTmpRepoDataDir);
+                                   &pSync->pszTmpRepoDataDir);
         BAIL_ON_TDNF_ERROR(dwError);
 
-        dwError = TDNFUtilsMakeDirs(pszTmpRepoDataDir);
+        dwError = TDNFUtilsMakeDirs(pSync->pszTmpRepoDataDir);
         if (dwError == ERROR_TDNF_ALREADY_EXISTS)
         {
             dwError = 0;
@@ -681,58 +789,108 @@ TDNFGetRepoMD(
         BAIL_ON_TDNF_ERROR(dwError);
 
         dwError = TDNFJoinPath(
-                      &pszTmpRepoMDFile,
-                      pszTmpRepoDataDir,
+                      &pSync->pszTmpRepoMDFile,
+                      pSync->pszTmpRepoDataDir,
                       TDNF_REPO_METADATA_FILE_NAME,
                       NULL);
         BAIL_ON_TDNF_ERROR(dwError);
 
-        dwError = TDNFDownloadFileFromRepo(
-                          pTdnf,
-                          pRepoData,
-                          TDNF_REPO_METADATA_FILE_PATH,
-                          pszTmpRepoMDFile,
-                          pRepoData->pszId);
+        dwError = TDNFDownloadQueueAdd(
+                      pQueue,
+                      pRepoData,
+                      TDNF_REPO_METADATA_FILE_PATH,
+                      pSync->pszTmpRepoMDFile,
+                      pRepoData->pszId);
         BAIL_ON_TDNF_ERROR(dwError);
 
+        pSync->nNewRepoMDFile = 1;
+    }
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszMirrorFile);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+//Replace repomd.xml if it changed, parse it and get the parts it lists
+uint32_t
+TDNFRepoSyncUpdate(
+    PTDNF pTdnf,
+    PTDNF_REPO_SYNC pSync,
+    PTDNF_DOWNLOAD_QUEUE pQueue
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_REPO_DATA pRepoData = NULL;
+    char* pszLastRefreshMarker = NULL;
+    PTDNF_REPO_METADATA pRepoMDRel = NULL;
+    unsigned char pszTmpCookie[SOLV_COOKIE_LEN] = {0};
+    int nReplaceRepoMD = 0;
+    char *pszOldRepoDataDir = NULL;
+    const char *pszReuseDir = NULL;
+
+    if (!pTdnf || !pSync || !pSync->pRepo || !pQueue)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    pRepoData = pSync->pRepo;
+
+    if (pSync->nNewRepoMDFile)
+    {
         nReplaceRepoMD = 1;
-        if (pszMDCookie[0])
+        if (pSync->pszMDCookie[0])
         {
-            dwError = SolvCalculateCookieForFile(pszTmpRepoMDFile, pszTmpCookie);
+            dwError = SolvCalculateCookieForFile(pSync->pszTmpRepoMDFile, pszTmpCookie);
             BAIL_ON_TDNF_ERROR(dwError);
-            if (!memcmp (pszMDCookie, pszTmpCookie, sizeof(pszTmpCookie)))
+            if (!memcmp (pSync->pszMDCookie, pszTmpCookie, sizeof(pszTmpCookie)))
             {
                 nReplaceRepoMD = 0;
             }
         }
-        nNewRepoMDFile = 1;
 
         /* plugin event indicating a repomd download happened */
         dwError = TDNFEventRepoMDDownloadEnd(
                       pTdnf,
                       pRepoData->pszId,
-                      pszTmpRepoMDFile);
+                      pSync->pszTmpRepoMDFile);
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
     if (nReplaceRepoMD)
     {
-        /* Remove the old repodata, solvcache and lastRefreshMarker before
-           replacing the new repomd file and metalink files. */
+        /* Parts that did not change are taken from the old repodata,
+           so keep it aside until the new parts are in place. */
+        dwError = TDNFGetCachePath(pTdnf, pRepoData,
+                                   TDNF_REPODATA_OLD_DIR_NAME, NULL,
+                                   &pszOldRepoDataDir);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        TDNFRecursivelyRemoveDir(pszOldRepoDataDir);
+        if (rename(pSync->pszRepoDataDir, pszOldRepoDataDir) == 0)
+        {
+            pszReuseDir = pszOldRepoDataDir;
+        }
+
+        /* Remove the old repodata and lastRefreshMarker before
+           replacing the new repomd file and metalink files. The solv
+           caches are kept, they are keyed by the checksums of their
+           parts and only rebuilt for parts that changed. */
         TDNFRepoRemoveCache(pTdnf, pRepoData);
-        TDNFRemoveSolvCache(pTdnf, pRepoData);
         TDNFRemoveLastRefreshMarker(pTdnf, pRepoData);
-        if (!nKeepCache)
+        if (!pTdnf->pConf->nKeepCache)
         {
             TDNFRemoveRpmCache(pTdnf, pRepoData);
         }
-        dwError = TDNFUtilsMakeDirs(pszRepoDataDir);
+        dwError = TDNFUtilsMakeDirs(pSync->pszRepoDataDir);
         BAIL_ON_TDNF_ERROR(dwError);
-        dwError = TDNFReplaceFile(pszTmpRepoMDFile, pszRepoMDFile);
+        dwError = TDNFReplaceFile(pSync->pszTmpRepoMDFile, pSync->pszRepoMDFile);
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
-    if (nNewRepoMDFile)
+    if (pSync->nNewRepoMDFile)
     {
         dwError = TDNFGetCachePath(pTdnf, pRepoData,
                                    TDNF_REPO_METADATA_MARKER, NULL,
@@ -742,6 +900,23 @@ TDNFGetRepoMD(
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
+    dwError = TDNFAllocateMemory(
+                  1,
+                  sizeof(TDNF_REPO_METADATA),
+                  (void **)&pRepoMDRel);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFGetCachePath(pTdnf, pRepoData,
+                               NULL, NULL,
+                               &pRepoMDRel->pszRepoCacheDir);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFAllocateString(pSync->pszRepoMDFile, &pRepoMDRel->pszRepoMD);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFAllocateString(pRepoData->pszId, &pRepoMDRel->pszRepo);
+    BAIL_ON_TDNF_ERROR(dwError);
+
     dwError = TDNFParseRepoMD(pRepoMDRel);
     if (dwError == ERROR_TDNF_FILE_NOT_FOUND && pTdnf->pArgs->nCacheOnly)
     {
@@ -753,54 +928,155 @@ TDNFGetRepoMD(
                   pTdnf,
                   pRepoData,
                   pRepoMDRel,
-                  &pRepoMD);
+                  pszReuseDir,
+                  nReplaceRepoMD,
+                  pQueue,
+                  &pSync->pRepoMD);
     BAIL_ON_TDNF_ERROR(dwError);
-    *ppRepoMD = pRepoMD;
 
 cleanup:
-    if (!IsNullOrEmptyString(pszTmpRepoDataDir))
+    if (pszOldRepoDataDir)
     {
-        if((TDNFRemoveTmpRepodata(pszTmpRepoDataDir)) &&
-           (dwError == ERROR_TDNF_CHECKSUM_VALIDATION_FAILED))
-	{
-	    pr_crit("Downloaded repomd shasum mismatch, failed to remove %s file. Please remove it manually\n.",
-                pszTmpRepoDataDir);
-	}
+        TDNFRecursivelyRemoveDir(pszOldRepoDataDir);
     }
     TDNFFreeRepoMetadata(pRepoMDRel);
-    TDNF_SAFE_FREE_MEMORY(pszTmpRepoMDFile);
-    TDNF_SAFE_FREE_MEMORY(pszTmpRepoDataDir);
-    TDNF_SAFE_FREE_MEMORY(pszRepoMDFile);
-    TDNF_SAFE_FREE_MEMORY(pszRepoMDUrl);
-    TDNF_SAFE_FREE_MEMORY(pszMirrorFile);
-    TDNF_SAFE_FREE_MEMORY(pszTempBaseUrlFile);
-    TDNF_SAFE_FREE_MEMORY(pszError);
     TDNF_SAFE_FREE_MEMORY(pszLastRefreshMarker);
+    TDNF_SAFE_FREE_MEMORY(pszOldRepoDataDir);
     return dwError;
 
 error:
-    TDNFGetErrorString(dwError, &pszError);
-    if (!IsNullOrEmptyString(pszError))
+    goto cleanup;
+}
+
+/*
+ * Sync the metadata of several repos, running the downloads of each
+ * step for all of them through one download queue. A failure only
+ * affects its own repo and is kept in its pSync->dwError, so that the
+ * caller can apply skip_if_unavailable per repo. Entries of ppSyncs
+ * may be NULL for repos without metadata.
+ */
+uint32_t
+TDNFSyncRepos(
+    PTDNF pTdnf,
+    PTDNF_REPO_SYNC *ppSyncs,
+    uint32_t nCount
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_DOWNLOAD_QUEUE pQueue = NULL;
+    PTDNF_REPO_SYNC pSync = NULL;
+    uint32_t i = 0;
+    int nStep = 0;
+
+    if (!pTdnf || !ppSyncs)
     {
-        pr_err("Error(%u) : %s\n", dwError, pszError);
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
     }
-    TDNFFreeRepoMetadata(pRepoMD);
+
+    /* step 0 fetches repomd.xml, step 1 the parts listed in it */
+    for (nStep = 0; nStep < 2; nStep++)
+    {
+        dwError = TDNFDownloadQueueCreate(&pQueue);
+        BAIL_ON_TDNF_ERROR(dwError);
+        pQueue->nContinueOnError = 1;
+
+        for (i = 0; i < nCount; i++)
+        {
+            pSync = ppSyncs[i];
+            if (!pSync || pSync->dwError)
+            {
+                continue;
+            }
+            if (nStep == 0)
+            {
+                dwError = TDNFRepoSyncStart(pTdnf, pSync, pQueue);
+            }
+            else
+            {
+                dwError = TDNFRepoSyncUpdate(pTdnf, pSync, pQueue);
+            }
+            _TDNFRepoSyncSetError(pSync, dwError);
+            dwError = 0;
+        }
+
+        dwError = TDNFDownloadQueueRun(pTdnf, pQueue);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        for (i = 0; i < nCount; i++)
+        {
+            pSync = ppSyncs[i];
+            if (pSync && !pSync->dwError)
+            {
+                _TDNFRepoSyncSetError(pSync,
+                    TDNFDownloadQueueRepoError(pQueue, pSync->pRepo));
+            }
+        }
+
+        TDNFFreeDownloadQueue(pQueue);
+        pQueue = NULL;
+    }
+
+cleanup:
+    TDNFFreeDownloadQueue(pQueue);
+    return dwError;
+
+error:
     goto cleanup;
 }
 
+void
+TDNFFreeRepoSync(
+    PTDNF_REPO_SYNC pSync
+    )
+{
+    if (!pSync)
+    {
+        return;
+    }
+    if (!IsNullOrEmptyString(pSync->pszTmpRepoDataDir))
+    {
+        if((TDNFRemoveTmpRepodata(pSync->pszTmpRepoDataDir)) &&
+           (pSync->dwError == ERROR_TDNF_CHECKSUM_VALIDATION_FAILED))
+        {
+            pr_crit("Downloaded repomd shasum mismatch, failed to remove %s file. Please remove it manually\n.",
+                pSync->pszTmpRepoDataDir);
+        }
+    }
+    TDNFFreeRepoMetadata(pSync->pRepoMD);
+    TDNF_SAFE_FREE_MEMORY(pSync->pszRepoDataDir);
+    TDNF_SAFE_FREE_MEMORY(pSync->pszRepoMDFile);
+    TDNF_SAFE_FREE_MEMORY(pSync->pszTmpRepoDataDir);
+    TDNF_SAFE_FREE_MEMORY(pSync->pszTmpRepoMDFile);
+    TDNFFreeMemory(pSync);
+}
+
+/*
+ * Make sure the part at pszLocation will be at pszDestPath. An existing
+ * file is kept if its size matches repomd.xml. Parts are verified when
+ * they are placed, so the checksum of a cached file is only checked
+ * again if repomd.xml changed since (nRepoMDChanged). Otherwise the
+ * part is taken from pszReuseDir if a file there has the right
+ * checksum, or queued for download and verified as it arrives.
+ */
 uint32_t
 TDNFDownloadRepoMDPart(
     PTDNF pTdnf,
     PTDNF_REPO_DATA pRepo,
     const char *pszLocation,
     const char *pszDestPath,
-    const char *pszPartName
+    const char *pszPartName,
+    PTDNF_REPO_MD_PART pPart,
+    const char *pszReuseDir,
+    int nRepoMDChanged,
+    PTDNF_DOWNLOAD_QUEUE pQueue
     )
 {
     uint32_t dwError = 0;
-    char *pszInfo;
+    char *pszInfo = NULL;
+    struct stat st = {0};
 
-    if(!pTdnf || !pRepo ||
+    if(!pTdnf || !pRepo || !pPart || !pQueue ||
        IsNullOrEmptyString(pszLocation) ||
        IsNullOrEmptyString(pszDestPath))
     {
@@ -808,27 +1084,62 @@ TDNFDownloadRepoMDPart(
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
-    if(access(pszDestPath, F_OK))
+    if (stat(pszDestPath, &st) == 0)
     {
-        if(errno != ENOENT)
+        if (pPart->qwSize && (uint64_t)st.st_size != pPart->qwSize)
+        {
+            pr_info("%s (%s): cached file has the wrong size, downloading again\n",
+                    pRepo->pszId, pszPartName);
+        }
+        else if (!nRepoMDChanged ||
+                 _TDNFCheckRepoMDPartDigest(pszDestPath, pPart) == 0)
+        {
+            goto cleanup;
+        }
+        else
+        {
+            pr_info("%s (%s): cached file has the wrong checksum, downloading again\n",
+                    pRepo->pszId, pszPartName);
+        }
+        if (unlink(pszDestPath) == -1)
         {
             dwError = errno;
             BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
         }
+    }
+    else if (errno != ENOENT)
+    {
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
+    }
 
-        dwError = TDNFAllocateStringPrintf(&pszInfo, "%s (%s)", pRepo->pszId, pszPartName);
-        BAIL_ON_TDNF_ERROR(dwError);
-
-        dwError = TDNFDownloadFileFromRepo(
-                      pTdnf,
-                      pRepo,
-                      pszLocation,
-                      pszDestPath,
-                      pszInfo);
-        BAIL_ON_TDNF_ERROR(dwError);
+    if (pszReuseDir &&
+        _TDNFReuseRepoMDPart(pszReuseDir, pszDestPath, pPart) == 0)
+    {
+        goto cleanup;
     }
 
+    dwError = TDNFAllocateStringPrintf(&pszInfo, "%s (%s)", pRepo->pszId, pszPartName);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFDownloadQueueAdd(
+                  pQueue,
+                  pRepo,
+                  pszLocation,
+                  pszDestPath,
+                  pszInfo);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFDownloadQueueSetVerify(
+                  pQueue,
+                  pszDestPath,
+                  pPart->nChecksumType,
+                  pPart->nHasChecksum ? pPart->pbChecksum : NULL,
+                  pPart->qwSize);
+    BAIL_ON_TDNF_ERROR(dwError);
+
 cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszInfo);
     return dwError;
 error:
     goto cleanup;
@@ -839,13 +1150,16 @@ TDNFEnsureRepoMDParts(
     PTDNF pTdnf,
     PTDNF_REPO_DATA pRepo,
     PTDNF_REPO_METADATA pRepoMDRel,
+    const char *pszReuseDir,
+    int nRepoMDChanged,
+    PTDNF_DOWNLOAD_QUEUE pQueue,
     PTDNF_REPO_METADATA *ppRepoMD
     )
 {
     uint32_t dwError = 0;
     PTDNF_REPO_METADATA pRepoMD = NULL;
 
-    if(!pTdnf || !pRepoMDRel || !ppRepoMD)
+    if(!pTdnf || !pRepoMDRel || !pQueue || !ppRepoMD)
     {
         dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_TDNF_ERROR(dwError);
@@ -871,7 +1185,11 @@ TDNFEnsureRepoMDParts(
                   pRepo,
                   pRepoMDRel->pszPrimary,
                   pRepoMD->pszPrimary,
-                  "primary");
+                  "primary",
+                  &pRepoMDRel->stPrimary,
+                  pszReuseDir,
+                  nRepoMDChanged,
+                  pQueue);
     BAIL_ON_TDNF_ERROR(dwError);
 
     if(!pRepo->nSkipMDFileLists && !IsNullOrEmptyString(pRepoMDRel->pszFileLists))
@@ -887,7 +1205,11 @@ TDNFEnsureRepoMDParts(
                       pRepo,
                       pRepoMDRel->pszFileLists,
                       pRepoMD->pszFileLists,
-                      "file lists");
+                      "file lists",
+                      &pRepoMDRel->stFileLists,
+                      pszReuseDir,
+                      nRepoMDChanged,
+                      pQueue);
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
@@ -904,7 +1226,11 @@ TDNFEnsureRepoMDParts(
                       pRepo,
                       pRepoMDRel->pszUpdateInfo,
                       pRepoMD->pszUpdateInfo,
-                      "update info");
+                      "update info",
+                      &pRepoMDRel->stUpdateInfo,
+                      pszReuseDir,
+                      nRepoMDChanged,
+                      pQueue);
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
@@ -921,9 +1247,18 @@ TDNFEnsureRepoMDParts(
                       pRepo,
                       pRepoMDRel->pszOther,
                       pRepoMD->pszOther,
-                      "other");
+                      "other",
+                      &pRepoMDRel->stOther,
+                      pszReuseDir,
+                      nRepoMDChanged,
+                      pQueue);
         BAIL_ON_TDNF_ERROR(dwError);
     }
+    pRepoMD->stPrimary = pRepoMDRel->stPrimary;
+    pRepoMD->stFileLists = pRepoMDRel->stFileLists;
+    pRepoMD->stUpdateInfo = pRepoMDRel->stUpdateInfo;
+    pRepoMD->stOther = pRepoMDRel->stOther;
+
     *ppRepoMD = pRepoMD;
 
 cleanup:
@@ -938,7 +1273,8 @@ uint32_t
 TDNFFindRepoMDPart(
     Repo *pSolvRepo,
     const char *pszType,
-    char **ppszPart
+    char **ppszPart,
+    PTDNF_REPO_MD_PART pPart
     )
 {
     uint32_t dwError = 0;
@@ -976,6 +1312,10 @@ TDNFFindRepoMDPart(
                           pPool,
                           SOLVID_POS,
                           REPOSITORY_REPOMD_LOCATION);
+        if (pPart)
+        {
+            _TDNFGetRepoMDPartInfo(pPool, pPart);
+        }
     }
 
     if(!pszPartTemp)
@@ -1041,13 +1381,15 @@ TDNFParseRepoMD(
     dwError = TDNFFindRepoMDPart(
                   pRepo,
                   TDNF_REPOMD_TYPE_PRIMARY,
-                  &pRepoMD->pszPrimary);
+                  &pRepoMD->pszPrimary,
+                  &pRepoMD->stPrimary);
     BAIL_ON_TDNF_ERROR(dwError);
 
     dwError = TDNFFindRepoMDPart(
                   pRepo,
                   TDNF_REPOMD_TYPE_FILELISTS,
-                  &pRepoMD->pszFileLists);
+                  &pRepoMD->pszFileLists,
+                  &pRepoMD->stFileLists);
     /* file lists can be missing (issue #273) */
     if(dwError == ERROR_TDNF_NO_DATA)
     {
@@ -1058,7 +1400,8 @@ TDNFParseRepoMD(
     dwError = TDNFFindRepoMDPart(
                   pRepo,
                   TDNF_REPOMD_TYPE_UPDATEINFO,
-                  &pRepoMD->pszUpdateInfo);
+                  &pRepoMD->pszUpdateInfo,
+                  &pRepoMD->stUpdateInfo);
     /* updateinfo is not mandatory */
     if(dwError == ERROR_TDNF_NO_DATA)
     {
@@ -1069,7 +1412,8 @@ TDNFParseRepoMD(
     dwError = TDNFFindRepoMDPart(
                   pRepo,
                   TDNF_REPOMD_TYPE_OTHER,
-                  &pRepoMD->pszOther);
+                  &pRepoMD->pszOther,
+                  &pRepoMD->stOther);
     if(dwError == ERROR_TDNF_NO_DATA)
     {
         dwError = 0;
@@ -1320,3 +1664,224 @@ error:
     goto cleanup;
 }
 
+//Keep the first error of a repo and log it
+static
+void
+_TDNFRepoSyncSetError(
+    PTDNF_REPO_SYNC pSync,
+    uint32_t dwError
+    )
+{
+    char *pszError = NULL;
+
+    if (!dwError || pSync->dwError)
+    {
+        return;
+    }
+    pSync->dwError = dwError;
+
+    TDNFGetErrorString(dwError, &pszError);
+    if (!IsNullOrEmptyString(pszError))
+    {
+        pr_err("Error(%u) : %s\n", dwError, pszError);
+    }
+    TDNF_SAFE_FREE_MEMORY(pszError);
+}
+
+static
+int
+_TDNFHashTypeFromSolv(
+    Id nSolvType
+    )
+{
+    switch (nSolvType)
+    {
+        case REPOKEY_TYPE_MD5:
+            return TDNF_HASH_MD5;
+        case REPOKEY_TYPE_SHA1:
+            return TDNF_HASH_SHA1;
+        case REPOKEY_TYPE_SHA256:
+            return TDNF_HASH_SHA256;
+        case REPOKEY_TYPE_SHA512:
+            return TDNF_HASH_SHA512;
+        default:
+            return -1;
+    }
+}
+
+//Read checksums and size of the repomd entry at SOLVID_POS
+static
+void
+_TDNFGetRepoMDPartInfo(
+    Pool *pPool,
+    PTDNF_REPO_MD_PART pPart
+    )
+{
+    const unsigned char *pbChecksum = NULL;
+    Id nSolvType = 0;
+    int nType = 0;
+
+    memset(pPart, 0, sizeof(*pPart));
+
+    pbChecksum = pool_lookup_bin_checksum(pPool, SOLVID_POS,
+                                          REPOSITORY_REPOMD_CHECKSUM,
+                                          &nSolvType);
+    nType = _TDNFHashTypeFromSolv(nSolvType);
+    if (pbChecksum && nType >= 0)
+    {
+        pPart->nHasChecksum = 1;
+        pPart->nChecksumType = nType;
+        memcpy(pPart->pbChecksum, pbChecksum, hash_ops[nType].length);
+    }
+
+    pbChecksum = pool_lookup_bin_checksum(pPool, SOLVID_POS,
+                                          REPOSITORY_REPOMD_OPENCHECKSUM,
+                                          &nSolvType);
+    nType = _TDNFHashTypeFromSolv(nSolvType);
+    if (pbChecksum && nType >= 0)
+    {
+        pPart->nHasOpenChecksum = 1;
+        pPart->nOpenChecksumType = nType;
+        memcpy(pPart->pbOpenChecksum, pbChecksum, hash_ops[nType].length);
+    }
+
+    pPart->qwSize = pool_lookup_num(pPool, SOLVID_POS,
+                                    REPOSITORY_REPOMD_SIZE, 0);
+}
+
+/*
+ * Returns 0 if pszFile has the checksum repomd.xml lists for pPart, or
+ * if it lists none.
+ */
+static
+uint32_t
+_TDNFCheckRepoMDPartDigest(
+    const char *pszFile,
+    PTDNF_REPO_MD_PART pPart
+    )
+{
+    uint32_t dwError = 0;
+    uint8_t digest[EVP_MAX_MD_SIZE] = {0};
+
+    if (!pPart->nHasChecksum)
+    {
+        goto cleanup;
+    }
+
+    dwError = TDNFGetDigestForFile(pszFile,
+                                   hash_ops + pPart->nChecksumType,
+                                   digest);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (memcmp(digest, pPart->pbChecksum,
+               hash_ops[pPart->nChecksumType].length))
+    {
+        dwError = ERROR_TDNF_CHECKSUM_VALIDATION_FAILED;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+cleanup:
+    return dwError;
+error:
+    goto cleanup;
+}
+
+/*
+ * Look for a file in pszReuseDir with the size and checksum of pPart,
+ * and hard link it to pszDestPath. Part file names usually contain
+ * their checksum, so an unchanged part may still have a new name.
+ * Returns 0 if the part was reused.
+ */
+static
+uint32_t
+_TDNFReuseRepoMDPart(
+    const char *pszReuseDir,
+    const char *pszDestPath,
+    PTDNF_REPO_MD_PART pPart
+    )
+{
+    uint32_t dwError = 0;
+    DIR *pDir = NULL;
+    struct dirent *pEnt = NULL;
+    struct stat st = {0};
+    char *pszCandidate = NULL;
+    int nFound = 0;
+
+    if (!pPart->nHasChecksum)
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    pDir = opendir(pszReuseDir);
+    if (!pDir)
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    while (!nFound && (pEnt = readdir(pDir)) != NULL)
+    {
+        TDNF_SAFE_FREE_MEMORY(pszCandidate);
+
+        dwError = TDNFJoinPath(&pszCandidate, pszReuseDir, pEnt->d_name, NULL);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        /* the size is cheap to check, the digest only if it matches */
+        if (stat(pszCandidate, &st) != 0 || !S_ISREG(st.st_mode) ||
+            (pPart->qwSize && (uint64_t)st.st_size != pPart->qwSize))
+        {
+            continue;
+        }
+        if (_TDNFCheckRepoMDPartDigest(pszCandidate, pPart) != 0)
+        {
+            continue;
+        }
+        if (link(pszCandidate, pszDestPath) == 0)
+        {
+            nFound = 1;
+        }
+    }
+
+    if (!nFound)
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+cleanup:
+    if (pDir)
+    {
+        closedir(pDir);
+    }
+    TDNF_SAFE_FREE_MEMORY(pszCandidate);
+    return dwError;
+error:
+    goto cleanup;
+}
+
+/*
+ * Cookie for the solv cache of a part, from the checksum repomd.xml
+ * lists for it. Without a checksum the cookie of repomd.xml is used,
+ * so the cache is rebuilt whenever repomd.xml changes.
+ */
+static
+uint32_t
+_TDNFGetRepoMDPartCookie(
+    PTDNF_REPO_MD_PART pPart,
+    const unsigned char *pszBaseCookie,
+    const unsigned char *pszRepoMDCookie,
+    unsigned char *pszCookie
+    )
+{
+    if (pPart->nHasChecksum)
+    {
+        return SolvCalculateCookieForData(
+                   pszBaseCookie,
+                   pPart->pbChecksum,
+                   hash_ops[pPart->nChecksumType].length,
+                   pszCookie);
+    }
+    return SolvCalculateCookieForData(pszBaseCookie, pszRepoMDCookie,
+                                      SOLV_COOKIE_LEN, pszCookie);
+}
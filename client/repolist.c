@@ -393,6 +393,7 @@ TDNFCreateRepo(
     pRepo->nSkipMDFileLists = TDNF_REPO_DEFAULT_SKIP_MD_FILELISTS;
     pRepo->nSkipMDUpdateInfo = TDNF_REPO_DEFAULT_SKIP_MD_UPDATEINFO;
     pRepo->nSkipMDOther = TDNF_REPO_DEFAULT_SKIP_MD_OTHER;
+    pRepo->nMaxParallelDownloads = TDNF_REPO_DEFAULT_MAX_PARALLEL_DOWNLOADS;
 
     *ppRepo = pRepo;
 cleanup:
@@ -632,6 +633,10 @@ TDNFLoadReposFromFile(
             {
                 pRepo->nSkipMDOther = isTrue(cn->value);
             }
+            else if (strcmp(cn->name, TDNF_REPO_KEY_MAX_PARALLEL_DOWNLOADS) == 0)
+            {
+                pRepo->nMaxParallelDownloads = strtoi(cn->value);
+            }
         }
         /* plugin event repo readconfig end */
         dwError = TDNFEventRepoReadConfigEnd(pTdnf, cn_section);
@@ -0,0 +1,1398 @@
+/*
+ * Copyright (C) 2023 VMware, Inc. All Rights Reserved.
+ *
+ * Licensed under the GNU Lesser General Public License v2.1 (the "License");
+ * you may not use this file except in compliance with the License. The terms
+ * of the License are located in the COPYING file of this distribution.
+ */
+
+/*
+ * reposync engine. TDNFRepoSync() adds the packages to mirror with
+ * TDNFRepoMirrorAdd(), TDNFRepoMirrorRun() then brings the tree up to date:
+ *
+ * - files that are already there are kept if their size and digest
+ *   match the metadata, otherwise they are downloaded again
+ * - missing files are downloaded through the download queue, so up to
+ *   max_parallel_downloads at a time, and checked while they arrive
+ * - with gpgcheck, signatures are checked by worker processes
+ * - with delete, *.rpm files that are not part of the sync are removed
+ *
+ * Digests and signatures are checked once. The results are recorded in
+ * a journal in each repo directory, together with the size and mtime of
+ * the file, and trusted as long as these and the digest in the metadata
+ * do not change. The journal is appended to as the sync goes on, so an
+ * interrupted sync picks up where it stopped.
+ */
+
+#include "includes.h"
+
+/* nftw() has no user data argument */
+static Stringpool *pKeepFiles = NULL;
+
+static
+uint32_t
+_TDNFRepoSyncGetRepo(
+    PTDNF_REPOSYNC_CTX pSync,
+    const char *pszRepoId,
+    PTDNF_REPOSYNC_REPO *ppSyncRepo
+    );
+
+static
+uint32_t
+_TDNFRepoSyncJournalRead(
+    PTDNF_REPOSYNC_REPO pSyncRepo
+    );
+
+static
+uint32_t
+_TDNFRepoSyncJournalAdd(
+    PTDNF_REPOSYNC_FILE pFile
+    );
+
+static
+void
+_TDNFRepoSyncJournalFlush(
+    PTDNF_REPOSYNC_CTX pSync
+    );
+
+static
+uint32_t
+_TDNFRepoSyncJournalWrite(
+    PTDNF_REPOSYNC_CTX pSync,
+    PTDNF_REPOSYNC_REPO pSyncRepo
+    );
+
+static
+uint32_t
+_TDNFRepoSyncGetEntry(
+    PTDNF_REPOSYNC_REPO pSyncRepo,
+    Id idFile,
+    PTDNF_REPOSYNC_ENTRY *ppEntry
+    );
+
+static
+void
+_TDNFRepoSyncHexDigest(
+    PTDNF_PKG_INFO pPkgInfo,
+    char *pszHex
+    );
+
+static
+uint32_t
+_TDNFRepoSyncScan(
+    PTDNF_REPOSYNC_CTX pSync
+    );
+
+static
+uint32_t
+_TDNFRepoSyncDownload(
+    PTDNF_REPOSYNC_CTX pSync
+    );
+
+static
+uint32_t
+_TDNFRepoSyncCheckSignatures(
+    PTDNF_REPOSYNC_CTX pSync
+    );
+
+static
+int
+_TDNFRepoSyncRemoveRpm(
+    const char *pszFilePath,
+    const struct stat *sbuf,
+    int type,
+    struct FTW *ftwb
+    );
+
+static
+uint32_t
+_TDNFRepoSyncRemoveUnkept(
+    PTDNF_REPOSYNC_CTX pSync
+    );
+
+static
+uint32_t
+_TDNFRepoSyncRunChecks(
+    PTDNF_REPOSYNC_CTX pSync,
+    int *pnIndexes,
+    int nCount,
+    uint32_t (*pfnCheck)(PTDNF_REPOSYNC_CTX, PTDNF_REPOSYNC_FILE)
+    );
+
+static
+uint32_t
+_TDNFRepoSyncCheckDigest(
+    PTDNF_REPOSYNC_CTX pSync,
+    PTDNF_REPOSYNC_FILE pFile
+    );
+
+static
+uint32_t
+_TDNFRepoSyncCheckSignature(
+    PTDNF_REPOSYNC_CTX pSync,
+    PTDNF_REPOSYNC_FILE pFile
+    );
+
+static
+void
+_TDNFRepoSyncRemoveFile(
+    PTDNF_REPOSYNC_FILE pFile,
+    int nState
+    );
+
+uint32_t
+TDNFRepoMirrorCreate(
+    PTDNF pTdnf,
+    PTDNF_REPOSYNC_ARGS pReposyncArgs,
+    const char *pszRootPath,
+    PTDNF_REPOSYNC_CTX *ppSync
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_REPOSYNC_CTX pSync = NULL;
+
+    if(!pTdnf || !pReposyncArgs || IsNullOrEmptyString(pszRootPath) || !ppSync)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFAllocateMemory(1, sizeof(TDNF_REPOSYNC_CTX),
+                                 (void **)&pSync);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    pSync->pTdnf = pTdnf;
+    pSync->pArgs = pReposyncArgs;
+
+    dwError = TDNFAllocateString(pszRootPath, &pSync->pszRootPath);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (pReposyncArgs->nGPGCheck)
+    {
+        pSync->ts.pTS = rpmtsCreate();
+        if(!pSync->ts.pTS)
+        {
+            dwError = ERROR_TDNF_RPMTS_CREATE_FAILED;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
+    }
+
+    *ppSync = pSync;
+cleanup:
+    return dwError;
+error:
+    TDNFFreeRepoMirror(pSync);
+    goto cleanup;
+}
+
+/* add the package pPkgInfo, it needs the location, checksum and size */
+uint32_t
+TDNFRepoMirrorAdd(
+    PTDNF_REPOSYNC_CTX pSync,
+    PTDNF_PKG_INFO pPkgInfo
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_REPOSYNC_REPO pSyncRepo = NULL;
+    PTDNF_REPOSYNC_FILE pFile = NULL;
+    PTDNF_REPOSYNC_ENTRY pEntry = NULL;
+    char *pszFile = NULL;
+    const char *pszRelPath = NULL;
+    int nFilesAlloc = 0;
+
+    if(!pSync || !pPkgInfo ||
+       IsNullOrEmptyString(pPkgInfo->pszRepoName) ||
+       IsNullOrEmptyString(pPkgInfo->pszLocation))
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = _TDNFRepoSyncGetRepo(pSync, pPkgInfo->pszRepoName, &pSyncRepo);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFPackagePathInTree(pPkgInfo->pszLocation,
+                                    pSyncRepo->pszDir,
+                                    &pszFile);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (pSync->nFiles == pSync->nFilesAlloc)
+    {
+        PTDNF_REPOSYNC_FILE pFiles = pSync->pFiles;
+
+        nFilesAlloc = pSync->nFilesAlloc ? pSync->nFilesAlloc * 2 : 256;
+        dwError = TDNFReAllocateMemory(nFilesAlloc * sizeof(TDNF_REPOSYNC_FILE),
+                                       (void **)&pFiles);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        pSync->pFiles = pFiles;
+        pSync->nFilesAlloc = nFilesAlloc;
+    }
+
+    pszRelPath = pszFile + strlen(pSyncRepo->pszDir);
+    while (*pszRelPath == '/')
+    {
+        pszRelPath++;
+    }
+
+    pFile = &pSync->pFiles[pSync->nFiles];
+    memset(pFile, 0, sizeof(TDNF_REPOSYNC_FILE));
+    pFile->pPkgInfo = pPkgInfo;
+    pFile->pSyncRepo = pSyncRepo;
+    pFile->idFile = stringpool_str2id(&pSyncRepo->files, pszRelPath, 1);
+
+    dwError = _TDNFRepoSyncGetEntry(pSyncRepo, pFile->idFile, &pEntry);
+    BAIL_ON_TDNF_ERROR(dwError);
+    pEntry->nSeen = 1;
+
+    pFile->pszFile = pszFile;
+    pszFile = NULL;
+    pSync->nFiles++;
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszFile);
+    return dwError;
+error:
+    goto cleanup;
+}
+
+uint32_t
+TDNFRepoMirrorRun(
+    PTDNF_REPOSYNC_CTX pSync
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_REPOSYNC_REPO pSyncRepo = NULL;
+
+    if(!pSync)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = _TDNFRepoSyncScan(pSync);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = _TDNFRepoSyncDownload(pSync);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    if (pSync->pArgs->nGPGCheck)
+    {
+        dwError = _TDNFRepoSyncCheckSignatures(pSync);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    for (pSyncRepo = pSync->pRepos; pSyncRepo; pSyncRepo = pSyncRepo->pNext)
+    {
+        dwError = _TDNFRepoSyncJournalWrite(pSync, pSyncRepo);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if (pSync->pArgs->nDelete)
+    {
+        dwError = _TDNFRepoSyncRemoveUnkept(pSync);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+cleanup:
+    return dwError;
+error:
+    goto cleanup;
+}
+
+void
+TDNFFreeRepoMirror(
+    PTDNF_REPOSYNC_CTX pSync
+    )
+{
+    PTDNF_REPOSYNC_REPO pSyncRepo = NULL;
+    int i;
+
+    if (!pSync)
+    {
+        return;
+    }
+    while (pSync->pRepos)
+    {
+        pSyncRepo = pSync->pRepos;
+        pSync->pRepos = pSyncRepo->pNext;
+
+        if (pSyncRepo->fpJournal)
+        {
+            fclose(pSyncRepo->fpJournal);
+        }
+        for (i = 0; i < pSyncRepo->nEntries; i++)
+        {
+            TDNF_SAFE_FREE_MEMORY(pSyncRepo->pEntries[i].pszDigest);
+        }
+        TDNF_SAFE_FREE_MEMORY(pSyncRepo->pEntries);
+        stringpool_free(&pSyncRepo->files);
+        TDNF_SAFE_FREE_MEMORY(pSyncRepo->pszDir);
+        TDNF_SAFE_FREE_MEMORY(pSyncRepo->pszJournal);
+        TDNFFreeMemory(pSyncRepo);
+    }
+    for (i = 0; i < pSync->nFiles; i++)
+    {
+        TDNF_SAFE_FREE_MEMORY(pSync->pFiles[i].pszFile);
+    }
+    TDNF_SAFE_FREE_MEMORY(pSync->pFiles);
+    if (pSync->ts.pTS)
+    {
+        rpmtsCloseDB(pSync->ts.pTS);
+        rpmtsFree(pSync->ts.pTS);
+    }
+    if (pSync->pCheckTS)
+    {
+        rpmtsFree(pSync->pCheckTS);
+    }
+    TDNF_SAFE_FREE_MEMORY(pSync->pszRootPath);
+    TDNFFreeMemory(pSync);
+}
+
+/*
+ * Get the state of the repo pszRepoId, creating its directory and
+ * reading its journal when it's first used.
+ */
+static
+uint32_t
+_TDNFRepoSyncGetRepo(
+    PTDNF_REPOSYNC_CTX pSync,
+    const char *pszRepoId,
+    PTDNF_REPOSYNC_REPO *ppSyncRepo
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_REPOSYNC_REPO pSyncRepo = NULL;
+    PTDNF_REPO_DATA pRepo = NULL;
+    char *pszJournalName = NULL;
+
+    for (pSyncRepo = pSync->pRepos; pSyncRepo; pSyncRepo = pSyncRepo->pNext)
+    {
+        if (!strcmp(pSyncRepo->pRepo->pszId, pszRepoId))
+        {
+            *ppSyncRepo = pSyncRepo;
+            goto cleanup;
+        }
+    }
+
+    dwError = TDNFFindRepoById(pSync->pTdnf, pszRepoId, &pRepo);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFAllocateMemory(1, sizeof(TDNF_REPOSYNC_REPO),
+                                 (void **)&pSyncRepo);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    pSyncRepo->pRepo = pRepo;
+    stringpool_init_empty(&pSyncRepo->files);
+
+    if (!pSync->pArgs->nNoRepoPath)
+    {
+        dwError = TDNFJoinPath(&pSyncRepo->pszDir,
+                               strcmp(pSync->pszRootPath, "/") ? pSync->pszRootPath : "",
+                               pszRepoId,
+                               NULL);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    else
+    {
+        dwError = TDNFAllocateString(pSync->pszRootPath, &pSyncRepo->pszDir);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFUtilsMakeDir(pSyncRepo->pszDir);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    /* with norepopath all repos share a directory, each keeps its
+       own journal so they don't overwrite each other's entries */
+    dwError = TDNFAllocateStringPrintf(&pszJournalName, "%s%s",
+                                       REPOSYNC_JOURNAL_PREFIX, pszRepoId);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFJoinPath(&pSyncRepo->pszJournal,
+                           pSyncRepo->pszDir,
+                           pszJournalName,
+                           NULL);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = _TDNFRepoSyncJournalRead(pSyncRepo);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    pSyncRepo->pNext = pSync->pRepos;
+    pSync->pRepos = pSyncRepo;
+
+    *ppSyncRepo = pSyncRepo;
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszJournalName);
+    return dwError;
+error:
+    if (pSyncRepo)
+    {
+        stringpool_free(&pSyncRepo->files);
+        TDNF_SAFE_FREE_MEMORY(pSyncRepo->pEntries);
+        TDNF_SAFE_FREE_MEMORY(pSyncRepo->pszDir);
+        TDNF_SAFE_FREE_MEMORY(pSyncRepo->pszJournal);
+        TDNFFreeMemory(pSyncRepo);
+    }
+    goto cleanup;
+}
+
+/* get the journal entry for idFile, growing the table as needed */
+static
+uint32_t
+_TDNFRepoSyncGetEntry(
+    PTDNF_REPOSYNC_REPO pSyncRepo,
+    Id idFile,
+    PTDNF_REPOSYNC_ENTRY *ppEntry
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_REPOSYNC_ENTRY pEntries = NULL;
+    int nEntries = 0;
+
+    if (idFile >= pSyncRepo->nEntries)
+    {
+        nEntries = pSyncRepo->nEntries ? pSyncRepo->nEntries * 2 : 256;
+        while (nEntries <= idFile)
+        {
+            nEntries *= 2;
+        }
+
+        pEntries = pSyncRepo->pEntries;
+        dwError = TDNFReAllocateMemory(nEntries * sizeof(TDNF_REPOSYNC_ENTRY),
+                                       (void **)&pEntries);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        memset(pEntries + pSyncRepo->nEntries, 0,
+               (nEntries - pSyncRepo->nEntries) * sizeof(TDNF_REPOSYNC_ENTRY));
+        pSyncRepo->pEntries = pEntries;
+        pSyncRepo->nEntries = nEntries;
+    }
+
+    *ppEntry = &pSyncRepo->pEntries[idFile];
+cleanup:
+    return dwError;
+error:
+    goto cleanup;
+}
+
+/*
+ * Each line of the journal is
+ *   <flags> <size> <mtime seconds> <mtime nanoseconds> <digest> <path>
+ * Later lines for the same path replace earlier ones. A journal that
+ * can't be parsed only means that the files will be checked again.
+ */
+static
+uint32_t
+_TDNFRepoSyncJournalRead(
+    PTDNF_REPOSYNC_REPO pSyncRepo
+    )
+{
+    uint32_t dwError = 0;
+    FILE *fp = NULL;
+    char *pszLine = NULL;
+    size_t nLineSize = 0;
+    ssize_t nLength = 0;
+    char szDigest[2 * EVP_MAX_MD_SIZE + 1];
+    unsigned int dwFlags = 0;
+    unsigned long long qwSize = 0;
+    long long nMtimeSec = 0;
+    long nMtimeNsec = 0;
+    int nPathOffset = 0;
+    Id idFile = 0;
+    PTDNF_REPOSYNC_ENTRY pEntry = NULL;
+
+    fp = fopen(pSyncRepo->pszJournal, "r");
+    if (!fp)
+    {
+        if (errno != ENOENT)
+        {
+            pr_err("unable to read %s: %s\n",
+                   pSyncRepo->pszJournal, strerror(errno));
+        }
+        goto cleanup;
+    }
+
+    while ((nLength = getline(&pszLine, &nLineSize, fp)) > 0)
+    {
+        if (pszLine[nLength - 1] == '\n')
+        {
+            pszLine[nLength - 1] = '\0';
+        }
+        nPathOffset = 0;
+        if (sscanf(pszLine, "%x %llu %lld %ld %128s %n",
+                   &dwFlags, &qwSize, &nMtimeSec, &nMtimeNsec,
+                   szDigest, &nPathOffset) != 5 ||
+            nPathOffset == 0 || pszLine[nPathOffset] == '\0')
+        {
+            continue;
+        }
+
+        idFile = stringpool_str2id(&pSyncRepo->files,
+                                   pszLine + nPathOffset, 1);
+        dwError = _TDNFRepoSyncGetEntry(pSyncRepo, idFile, &pEntry);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        TDNF_SAFE_FREE_MEMORY(pEntry->pszDigest);
+        dwError = TDNFAllocateString(szDigest, &pEntry->pszDigest);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        pEntry->dwFlags = dwFlags;
+        pEntry->qwSize = qwSize;
+        pEntry->nMtimeSec = nMtimeSec;
+        pEntry->nMtimeNsec = nMtimeNsec;
+    }
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszLine);
+    if (fp)
+    {
+        fclose(fp);
+    }
+    return dwError;
+error:
+    goto cleanup;
+}
+
+/* record what was verified for pFile, and append it to the journal */
+static
+uint32_t
+_TDNFRepoSyncJournalAdd(
+    PTDNF_REPOSYNC_FILE pFile
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_REPOSYNC_REPO pSyncRepo = pFile->pSyncRepo;
+    PTDNF_REPOSYNC_ENTRY pEntry = &pSyncRepo->pEntries[pFile->idFile];
+    char szDigest[2 * EVP_MAX_MD_SIZE + 1];
+    struct stat st = {0};
+
+    if (stat(pFile->pszFile, &st) == -1)
+    {
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
+    }
+
+    _TDNFRepoSyncHexDigest(pFile->pPkgInfo, szDigest);
+
+    TDNF_SAFE_FREE_MEMORY(pEntry->pszDigest);
+    dwError = TDNFAllocateString(szDigest, &pEntry->pszDigest);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    pEntry->dwFlags = pFile->dwFlags;
+    pEntry->qwSize = st.st_size;
+    pEntry->nMtimeSec = st.st_mtim.tv_sec;
+    pEntry->nMtimeNsec = st.st_mtim.tv_nsec;
+
+    if (!pSyncRepo->fpJournal)
+    {
+        pSyncRepo->fpJournal = fopen(pSyncRepo->pszJournal, "a");
+        if (!pSyncRepo->fpJournal)
+        {
+            dwError = errno;
+            BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
+        }
+    }
+
+    fprintf(pSyncRepo->fpJournal, "%x %llu %lld %ld %s %s\n",
+            pEntry->dwFlags,
+            (unsigned long long)pEntry->qwSize,
+            pEntry->nMtimeSec,
+            pEntry->nMtimeNsec,
+            pEntry->pszDigest,
+            stringpool_id2str(&pSyncRepo->files, pFile->idFile));
+
+cleanup:
+    return dwError;
+error:
+    goto cleanup;
+}
+
+static
+void
+_TDNFRepoSyncJournalFlush(
+    PTDNF_REPOSYNC_CTX pSync
+    )
+{
+    PTDNF_REPOSYNC_REPO pSyncRepo = NULL;
+
+    for (pSyncRepo = pSync->pRepos; pSyncRepo; pSyncRepo = pSyncRepo->pNext)
+    {
+        if (pSyncRepo->fpJournal)
+        {
+            fflush(pSyncRepo->fpJournal);
+        }
+    }
+}
+
+/*
+ * Replace the journal with one line per file. Entries of files that are
+ * not part of this sync are kept if the file is still the same, unless
+ * it's going to be deleted.
+ */
+static
+uint32_t
+_TDNFRepoSyncJournalWrite(
+    PTDNF_REPOSYNC_CTX pSync,
+    PTDNF_REPOSYNC_REPO pSyncRepo
+    )
+{
+    uint32_t dwError = 0;
+    char *pszTmpFile = NULL;
+    char *pszFile = NULL;
+    FILE *fp = NULL;
+    PTDNF_REPOSYNC_ENTRY pEntry = NULL;
+    struct stat st = {0};
+    Id idFile;
+
+    if (pSyncRepo->fpJournal)
+    {
+        fclose(pSyncRepo->fpJournal);
+        pSyncRepo->fpJournal = NULL;
+    }
+
+    dwError = TDNFAllocateStringPrintf(&pszTmpFile, "%s.tmp",
+                                       pSyncRepo->pszJournal);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    fp = fopen(pszTmpFile, "w");
+    if (!fp)
+    {
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
+    }
+
+    for (idFile = STRID_EMPTY + 1;
+         idFile < pSyncRepo->files.nstrings && idFile < pSyncRepo->nEntries;
+         idFile++)
+    {
+        pEntry = &pSyncRepo->pEntries[idFile];
+        if (!pEntry->dwFlags || !pEntry->pszDigest)
+        {
+            continue;
+        }
+        if (!pEntry->nSeen)
+        {
+            if (pSync->pArgs->nDelete)
+            {
+                continue;
+            }
+            dwError = TDNFJoinPath(&pszFile, pSyncRepo->pszDir,
+                                   stringpool_id2str(&pSyncRepo->files, idFile),
+                                   NULL);
+            BAIL_ON_TDNF_ERROR(dwError);
+
+            if (stat(pszFile, &st) == -1 ||
+                (uint64_t)st.st_size != pEntry->qwSize ||
+                st.st_mtim.tv_sec != pEntry->nMtimeSec ||
+                st.st_mtim.tv_nsec != pEntry->nMtimeNsec)
+            {
+                TDNF_SAFE_FREE_MEMORY(pszFile);
+                continue;
+            }
+            TDNF_SAFE_FREE_MEMORY(pszFile);
+        }
+        fprintf(fp, "%x %llu %lld %ld %s %s\n",
+                pEntry->dwFlags,
+                (unsigned long long)pEntry->qwSize,
+                pEntry->nMtimeSec,
+                pEntry->nMtimeNsec,
+                pEntry->pszDigest,
+                stringpool_id2str(&pSyncRepo->files, idFile));
+    }
+
+    if (fclose(fp) != 0)
+    {
+        fp = NULL;
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
+    }
+    fp = NULL;
+
+    if (rename(pszTmpFile, pSyncRepo->pszJournal) == -1)
+    {
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
+    }
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszFile);
+    TDNF_SAFE_FREE_MEMORY(pszTmpFile);
+    return dwError;
+error:
+    if (fp)
+    {
+        fclose(fp);
+    }
+    if (pszTmpFile)
+    {
+        unlink(pszTmpFile);
+    }
+    goto cleanup;
+}
+
+/* pszHex needs room for 2 * EVP_MAX_MD_SIZE + 1 chars */
+static
+void
+_TDNFRepoSyncHexDigest(
+    PTDNF_PKG_INFO pPkgInfo,
+    char *pszHex
+    )
+{
+    int nLength = 0;
+    int i;
+
+    if (!pPkgInfo->pbChecksum)
+    {
+        strcpy(pszHex, "-");
+        return;
+    }
+    nLength = hash_ops[pPkgInfo->nChecksumType].length;
+    for (i = 0; i < nLength; i++)
+    {
+        sprintf(pszHex + 2 * i, "%02x", pPkgInfo->pbChecksum[i]);
+    }
+}
+
+/*
+ * Sort the files into those that are missing or have the wrong size,
+ * and have to be downloaded, those that the journal knows to be good,
+ * and those whose digest has to be checked. The digests are checked
+ * in parallel.
+ */
+static
+uint32_t
+_TDNFRepoSyncScan(
+    PTDNF_REPOSYNC_CTX pSync
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_REPOSYNC_FILE pFile = NULL;
+    PTDNF_REPOSYNC_ENTRY pEntry = NULL;
+    PTDNF_PKG_INFO pPkgInfo = NULL;
+    char szDigest[2 * EVP_MAX_MD_SIZE + 1];
+    struct stat st = {0};
+    int *pnIndexes = NULL;
+    int nCount = 0;
+    int i;
+
+    if (pSync->nFiles == 0)
+    {
+        goto cleanup;
+    }
+
+    dwError = TDNFAllocateMemory(pSync->nFiles, sizeof(int),
+                                 (void **)&pnIndexes);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    for (i = 0; i < pSync->nFiles; i++)
+    {
+        pFile = &pSync->pFiles[i];
+        pPkgInfo = pFile->pPkgInfo;
+        pEntry = &pFile->pSyncRepo->pEntries[pFile->idFile];
+
+        if (stat(pFile->pszFile, &st) == -1)
+        {
+            if (errno != ENOENT)
+            {
+                dwError = errno;
+                BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
+            }
+            pFile->nState = REPOSYNC_FILE_DOWNLOAD;
+            pEntry->dwFlags = 0;
+            continue;
+        }
+
+        /* older versions may have left size 0 files */
+        if (!S_ISREG(st.st_mode) || st.st_size == 0 ||
+            (pPkgInfo->dwDownloadSizeBytes &&
+             (uint64_t)st.st_size != pPkgInfo->dwDownloadSizeBytes))
+        {
+            pr_info("%s: size does not match, downloading again\n",
+                    pFile->pszFile);
+            _TDNFRepoSyncRemoveFile(pFile, REPOSYNC_FILE_DOWNLOAD);
+            continue;
+        }
+
+        _TDNFRepoSyncHexDigest(pPkgInfo, szDigest);
+        if (pEntry->dwFlags & REPOSYNC_VERIFIED_DIGEST &&
+            pEntry->pszDigest && !strcmp(pEntry->pszDigest, szDigest) &&
+            pEntry->qwSize == (uint64_t)st.st_size &&
+            pEntry->nMtimeSec == st.st_mtim.tv_sec &&
+            pEntry->nMtimeNsec == st.st_mtim.tv_nsec)
+        {
+            pFile->dwFlags = pEntry->dwFlags;
+            pFile->nState = REPOSYNC_FILE_DONE;
+            continue;
+        }
+        pEntry->dwFlags = 0;
+
+        /* nothing to check against */
+        if (!pPkgInfo->pbChecksum)
+        {
+            pFile->dwFlags = REPOSYNC_VERIFIED_DIGEST;
+            pFile->nState = REPOSYNC_FILE_DONE;
+            dwError = _TDNFRepoSyncJournalAdd(pFile);
+            BAIL_ON_TDNF_ERROR(dwError);
+            continue;
+        }
+
+        pFile->nState = REPOSYNC_FILE_CHECK;
+        pnIndexes[nCount++] = i;
+    }
+
+    dwError = _TDNFRepoSyncRunChecks(pSync, pnIndexes, nCount,
+                                     _TDNFRepoSyncCheckDigest);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    for (i = 0; i < nCount; i++)
+    {
+        pFile = &pSync->pFiles[pnIndexes[i]];
+
+        if (pFile->dwResult == ERROR_TDNF_CHECKSUM_MISMATCH)
+        {
+            pr_info("%s: digest does not match, downloading again\n",
+                    pFile->pszFile);
+            _TDNFRepoSyncRemoveFile(pFile, REPOSYNC_FILE_DOWNLOAD);
+            continue;
+        }
+        dwError = pFile->dwResult;
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        pFile->dwFlags = REPOSYNC_VERIFIED_DIGEST;
+        pFile->nState = REPOSYNC_FILE_DONE;
+        dwError = _TDNFRepoSyncJournalAdd(pFile);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+cleanup:
+    if (pSync)
+    {
+        _TDNFRepoSyncJournalFlush(pSync);
+    }
+    TDNF_SAFE_FREE_MEMORY(pnIndexes);
+    return dwError;
+error:
+    goto cleanup;
+}
+
+/*
+ * Download the missing files through the download queue, which checks
+ * their digests and sizes on the way. This is done in batches, so the
+ * journal of an interrupted sync is never far behind.
+ */
+static
+uint32_t
+_TDNFRepoSyncDownload(
+    PTDNF_REPOSYNC_CTX pSync
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_DOWNLOAD_QUEUE pQueue = NULL;
+    PTDNF_REPOSYNC_FILE pFile = NULL;
+    PTDNF_PKG_INFO pPkgInfo = NULL;
+    char *pszDir = NULL;
+    char *pszLastDir = NULL;
+    int nBatchStart = 0;
+    int nQueued = 0;
+    int i, j;
+
+    for (i = 0; i < pSync->nFiles; i = j)
+    {
+        dwError = TDNFDownloadQueueCreate(&pQueue);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        nBatchStart = i;
+        nQueued = 0;
+        for (j = i; j < pSync->nFiles && nQueued < REPOSYNC_DOWNLOAD_BATCH; j++)
+        {
+            pFile = &pSync->pFiles[j];
+            pPkgInfo = pFile->pPkgInfo;
+
+            if (pFile->nState != REPOSYNC_FILE_DOWNLOAD)
+            {
+                continue;
+            }
+
+            dwError = TDNFDirName(pFile->pszFile, &pszDir);
+            BAIL_ON_TDNF_ERROR(dwError);
+
+            /* packages of a directory usually come one after the other */
+            if (!pszLastDir || strcmp(pszLastDir, pszDir))
+            {
+                dwError = TDNFUtilsMakeDirs(pszDir);
+                BAIL_ON_TDNF_ERROR(dwError);
+
+                TDNF_SAFE_FREE_MEMORY(pszLastDir);
+                pszLastDir = pszDir;
+                pszDir = NULL;
+            }
+            TDNF_SAFE_FREE_MEMORY(pszDir);
+
+            dwError = TDNFDownloadQueueAdd(pQueue,
+                                           pFile->pSyncRepo->pRepo,
+                                           pPkgInfo->pszLocation,
+                                           pFile->pszFile,
+                                           pPkgInfo->pszName);
+            BAIL_ON_TDNF_ERROR(dwError);
+
+            dwError = TDNFDownloadQueueSetVerify(pQueue,
+                                                 pFile->pszFile,
+                                                 pPkgInfo->nChecksumType,
+                                                 pPkgInfo->pbChecksum,
+                                                 pPkgInfo->dwDownloadSizeBytes);
+            BAIL_ON_TDNF_ERROR(dwError);
+            nQueued++;
+        }
+
+        dwError = TDNFDownloadQueueRun(pSync->pTdnf, pQueue);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        for (; nBatchStart < j; nBatchStart++)
+        {
+            pFile = &pSync->pFiles[nBatchStart];
+            if (pFile->nState != REPOSYNC_FILE_DOWNLOAD)
+            {
+                continue;
+            }
+            pFile->nState = REPOSYNC_FILE_DONE;
+            if (!pFile->pPkgInfo->pbChecksum ||
+                TDNFDownloadQueueIsVerified(pQueue, pFile->pszFile))
+            {
+                pFile->dwFlags = REPOSYNC_VERIFIED_DIGEST;
+                dwError = _TDNFRepoSyncJournalAdd(pFile);
+                BAIL_ON_TDNF_ERROR(dwError);
+            }
+        }
+        _TDNFRepoSyncJournalFlush(pSync);
+
+        TDNFFreeDownloadQueue(pQueue);
+        pQueue = NULL;
+    }
+
+cleanup:
+    TDNFFreeDownloadQueue(pQueue);
+    TDNF_SAFE_FREE_MEMORY(pszDir);
+    TDNF_SAFE_FREE_MEMORY(pszLastDir);
+    return dwError;
+error:
+    goto cleanup;
+}
+
+/*
+ * Check the signatures of the files that were not checked before. The
+ * worker processes only read the packages. Anything they don't accept
+ * goes through TDNFGPGCheckPackage(), which may import keys and asks
+ * before doing so, and files that still fail are removed.
+ */
+static
+uint32_t
+_TDNFRepoSyncCheckSignatures(
+    PTDNF_REPOSYNC_CTX pSync
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_REPOSYNC_FILE pFile = NULL;
+    int *pnIndexes = NULL;
+    int nCount = 0;
+    int i;
+
+    if (pSync->nFiles == 0)
+    {
+        goto cleanup;
+    }
+
+    dwError = TDNFAllocateMemory(pSync->nFiles, sizeof(int),
+                                 (void **)&pnIndexes);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    for (i = 0; i < pSync->nFiles; i++)
+    {
+        pFile = &pSync->pFiles[i];
+        if (pFile->nState == REPOSYNC_FILE_DONE &&
+            !(pFile->dwFlags & REPOSYNC_VERIFIED_SIGNATURE))
+        {
+            pnIndexes[nCount++] = i;
+        }
+    }
+
+    dwError = _TDNFRepoSyncRunChecks(pSync, pnIndexes, nCount,
+                                     _TDNFRepoSyncCheckSignature);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    for (i = 0; i < nCount; i++)
+    {
+        pFile = &pSync->pFiles[pnIndexes[i]];
+
+        if (pFile->dwResult != RPMRC_OK)
+        {
+            dwError = TDNFGPGCheckPackage(&pSync->ts, pSync->pTdnf,
+                                          pFile->pSyncRepo->pRepo,
+                                          pFile->pszFile, NULL);
+            if (dwError != RPMRC_NOTTRUSTED && dwError != RPMRC_NOKEY)
+            {
+                BAIL_ON_TDNF_ERROR(dwError);
+            }
+            else if (dwError)
+            {
+                pr_crit("checking package %s failed: %d, deleting\n",
+                        pFile->pszFile, dwError);
+                _TDNFRepoSyncRemoveFile(pFile, REPOSYNC_FILE_REMOVED);
+                dwError = 0;
+                continue;
+            }
+        }
+
+        pFile->dwFlags |= REPOSYNC_VERIFIED_SIGNATURE;
+        dwError = _TDNFRepoSyncJournalAdd(pFile);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+cleanup:
+    if (pSync)
+    {
+        _TDNFRepoSyncJournalFlush(pSync);
+    }
+    TDNF_SAFE_FREE_MEMORY(pnIndexes);
+    return dwError;
+error:
+    goto cleanup;
+}
+
+static
+int
+_TDNFRepoSyncRemoveRpm(
+    const char *pszFilePath,
+    const struct stat *sbuf,
+    int type,
+    struct FTW *ftwb
+    )
+{
+    size_t nLength = strlen(pszFilePath);
+
+    UNUSED(sbuf);
+    UNUSED(ftwb);
+
+    if (type != FTW_F)
+    {
+        return 0;
+    }
+
+    if (nLength > 4 && strcmp(&pszFilePath[nLength - 4], ".rpm") == 0)
+    {
+        if (!stringpool_str2id(pKeepFiles, pszFilePath, 0))
+        {
+            pr_info("deleting %s\n", pszFilePath);
+            if(remove(pszFilePath) < 0)
+            {
+                pr_crit("unable to remove %s: %s\n", pszFilePath, strerror(errno));
+            }
+        }
+    }
+    /* marker files of older versions */
+    else if (nLength > 18 &&
+             strcmp(&pszFilePath[nLength - 18], ".rpm.reposync-keep") == 0)
+    {
+        if(remove(pszFilePath) < 0)
+        {
+            pr_crit("unable to remove %s: %s\n", pszFilePath, strerror(errno));
+        }
+    }
+    return 0;
+}
+
+/* delete the *.rpm files in the repo directories that were not synced */
+static
+uint32_t
+_TDNFRepoSyncRemoveUnkept(
+    PTDNF_REPOSYNC_CTX pSync
+    )
+{
+    uint32_t dwError = 0;
+    Stringpool keep = {0};
+    PTDNF_REPO_DATA pRepo = NULL;
+    char *pszRepoDir = NULL;
+    int ret;
+    int i;
+
+    stringpool_init_empty(&keep);
+    for (i = 0; i < pSync->nFiles; i++)
+    {
+        if (pSync->pFiles[i].nState == REPOSYNC_FILE_DONE)
+        {
+            stringpool_str2id(&keep, pSync->pFiles[i].pszFile, 1);
+        }
+    }
+    pKeepFiles = &keep;
+
+    for (pRepo = pSync->pTdnf->pRepos; pRepo; pRepo = pRepo->pNext)
+    {
+        if ((strcmp(pRepo->pszName, CMDLINE_REPO_NAME) == 0) ||
+            (!pRepo->nEnabled))
+        {
+            continue;
+        }
+
+        /* no need to check nNoRepoPath since delete is not allowed with it */
+        dwError = TDNFJoinPath(&pszRepoDir,
+                               strcmp(pSync->pszRootPath, "/") ? pSync->pszRootPath : "",
+                               pRepo->pszId,
+                               NULL);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        ret = nftw(pszRepoDir, _TDNFRepoSyncRemoveRpm, 10, FTW_DEPTH|FTW_PHYS);
+        if (ret < 0)
+        {
+            dwError = errno;
+            BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
+        }
+        TDNF_SAFE_FREE_MEMORY(pszRepoDir);
+    }
+
+cleanup:
+    pKeepFiles = NULL;
+    stringpool_free(&keep);
+    TDNF_SAFE_FREE_MEMORY(pszRepoDir);
+    return dwError;
+error:
+    goto cleanup;
+}
+
+/*
+ * Run pfnCheck for the files at pnIndexes, and store the results in
+ * their dwResult. The files are split among worker processes, one per
+ * cpu, which send back the results through a pipe. Whatever was not
+ * checked, because a worker could not be started or died, is checked
+ * in this process.
+ */
+static
+uint32_t
+_TDNFRepoSyncRunChecks(
+    PTDNF_REPOSYNC_CTX pSync,
+    int *pnIndexes,
+    int nCount,
+    uint32_t (*pfnCheck)(PTDNF_REPOSYNC_CTX, PTDNF_REPOSYNC_FILE)
+    )
+{
+    uint32_t dwError = 0;
+    struct pollfd *pFds = NULL;
+    pid_t *pPids = NULL;
+    int nWorkers = 0;
+    int nStarted = 0;
+    int nOpen = 0;
+    int fds[2];
+    uint32_t dwResult[2];
+    PTDNF_REPOSYNC_FILE pFile = NULL;
+    long nCpus = 0;
+    ssize_t nRead = 0;
+    int i, k;
+
+    for (i = 0; i < nCount; i++)
+    {
+        pSync->pFiles[pnIndexes[i]].nChecked = 0;
+    }
+
+    nCpus = sysconf(_SC_NPROCESSORS_ONLN);
+    nWorkers = nCpus > 1 ? (int)nCpus : 1;
+    if (nWorkers > nCount)
+    {
+        nWorkers = nCount;
+    }
+
+    if (nWorkers > 1)
+    {
+        dwError = TDNFAllocateMemory(nWorkers, sizeof(struct pollfd),
+                                     (void **)&pFds);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        dwError = TDNFAllocateMemory(nWorkers, sizeof(pid_t),
+                                     (void **)&pPids);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        /* don't let the workers write out what is buffered */
+        fflush(NULL);
+
+        for (nStarted = 0; nStarted < nWorkers; nStarted++)
+        {
+            if (pipe(fds) == -1)
+            {
+                break;
+            }
+            pPids[nStarted] = fork();
+            if (pPids[nStarted] == -1)
+            {
+                close(fds[0]);
+                close(fds[1]);
+                break;
+            }
+            if (pPids[nStarted] == 0)
+            {
+                close(fds[0]);
+                for (i = 0; i < nStarted; i++)
+                {
+                    close(pFds[i].fd);
+                }
+                for (k = nStarted; k < nCount; k += nWorkers)
+                {
+                    dwResult[0] = k;
+                    dwResult[1] = pfnCheck(pSync,
+                                           &pSync->pFiles[pnIndexes[k]]);
+                    if (write(fds[1], dwResult, sizeof(dwResult)) !=
+                        sizeof(dwResult))
+                    {
+                        break;
+                    }
+                }
+                _exit(0);
+            }
+            close(fds[1]);
+            pFds[nStarted].fd = fds[0];
+            pFds[nStarted].events = POLLIN;
+        }
+
+        /* a single record is always written, and read, in one go */
+        nOpen = nStarted;
+        while (nOpen > 0)
+        {
+            if (poll(pFds, nStarted, -1) == -1)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                break;
+            }
+            for (i = 0; i < nStarted; i++)
+            {
+                if (pFds[i].fd < 0 || !pFds[i].revents)
+                {
+                    continue;
+                }
+                nRead = read(pFds[i].fd, dwResult, sizeof(dwResult));
+                if (nRead == -1 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (nRead != sizeof(dwResult))
+                {
+                    close(pFds[i].fd);
+                    pFds[i].fd = -1;
+                    nOpen--;
+                    continue;
+                }
+                if ((int)dwResult[0] < nCount)
+                {
+                    pFile = &pSync->pFiles[pnIndexes[dwResult[0]]];
+                    pFile->dwResult = dwResult[1];
+                    pFile->nChecked = 1;
+                }
+            }
+        }
+        for (i = 0; i < nStarted; i++)
+        {
+            if (pFds[i].fd >= 0)
+            {
+                close(pFds[i].fd);
+            }
+            waitpid(pPids[i], NULL, 0);
+        }
+    }
+
+    for (i = 0; i < nCount; i++)
+    {
+        pFile = &pSync->pFiles[pnIndexes[i]];
+        if (!pFile->nChecked)
+        {
+            pFile->dwResult = pfnCheck(pSync, pFile);
+            pFile->nChecked = 1;
+        }
+    }
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pFds);
+    TDNF_SAFE_FREE_MEMORY(pPids);
+    return dwError;
+error:
+    goto cleanup;
+}
+
+/* runs in a worker process, so just return the result */
+static
+uint32_t
+_TDNFRepoSyncCheckDigest(
+    PTDNF_REPOSYNC_CTX pSync,
+    PTDNF_REPOSYNC_FILE pFile
+    )
+{
+    uint32_t dwError = 0;
+    uint8_t digest[EVP_MAX_MD_SIZE] = {0};
+    PTDNF_PKG_INFO pPkgInfo = pFile->pPkgInfo;
+
+    UNUSED(pSync);
+
+    dwError = TDNFGetDigestForFile(pFile->pszFile,
+                                   hash_ops + pPkgInfo->nChecksumType,
+                                   digest);
+    if (dwError == 0 &&
+        memcmp(digest, pPkgInfo->pbChecksum,
+               hash_ops[pPkgInfo->nChecksumType].length))
+    {
+        dwError = ERROR_TDNF_CHECKSUM_MISMATCH;
+    }
+    return dwError;
+}
+
+/*
+ * Runs in a worker process. Every process reads the keyring into its
+ * own transaction set.
+ */
+static
+uint32_t
+_TDNFRepoSyncCheckSignature(
+    PTDNF_REPOSYNC_CTX pSync,
+    PTDNF_REPOSYNC_FILE pFile
+    )
+{
+    uint32_t dwError = 0;
+    FD_t fp = NULL;
+    Header rpmHeader = NULL;
+
+    if (!pSync->pCheckTS)
+    {
+        pSync->pCheckTS = rpmtsCreate();
+        if (!pSync->pCheckTS)
+        {
+            return RPMRC_FAIL;
+        }
+    }
+
+    fp = Fopen(pFile->pszFile, "r.ufdio");
+    if (!fp)
+    {
+        return RPMRC_FAIL;
+    }
+    dwError = rpmReadPackageFile(pSync->pCheckTS, fp, pFile->pszFile,
+                                 &rpmHeader);
+    Fclose(fp);
+    if (rpmHeader)
+    {
+        headerFree(rpmHeader);
+    }
+    return dwError;
+}
+
+/* remove the file of pFile, and forget what the journal knows about it */
+static
+void
+_TDNFRepoSyncRemoveFile(
+    PTDNF_REPOSYNC_FILE pFile,
+    int nState
+    )
+{
+    if (remove(pFile->pszFile) < 0 && errno != ENOENT)
+    {
+        pr_crit("unable to remove %s: %s\n", pFile->pszFile, strerror(errno));
+    }
+    pFile->pSyncRepo->pEntries[pFile->idFile].dwFlags = 0;
+    pFile->dwFlags = 0;
+    pFile->nState = nState;
+}
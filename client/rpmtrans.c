@@ -365,12 +365,58 @@ TDNFPopulateTransaction(
     )
 {
     uint32_t dwError = 0;
+    PTDNF_DOWNLOAD_QUEUE pQueue = NULL;
+    char **ppszInstallFiles = NULL;
+    char **ppszReinstallFiles = NULL;
+    char **ppszUpgradeFiles = NULL;
+    char **ppszDowngradeFiles = NULL;
+
+    /* Resolve the local file of every package first. Packages that
+       need a download are queued and fetched in parallel, so nothing
+       is added to the transaction before all of them are available. */
+    dwError = TDNFDownloadQueueCreate(&pQueue);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    pTdnf->pDownloadQueue = pQueue;
+
+    dwError = TDNFTransGetPkgFilePaths(
+                  pTdnf,
+                  pSolvedInfo->pPkgsToInstall,
+                  &ppszInstallFiles);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFTransGetPkgFilePaths(
+                  pTdnf,
+                  pSolvedInfo->pPkgsToReinstall,
+                  &ppszReinstallFiles);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFTransGetPkgFilePaths(
+                  pTdnf,
+                  pSolvedInfo->pPkgsToUpgrade,
+                  &ppszUpgradeFiles);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFTransGetPkgFilePaths(
+                  pTdnf,
+                  pSolvedInfo->pPkgsToDowngrade,
+                  &ppszDowngradeFiles);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    pTdnf->pDownloadQueue = NULL;
+
+    dwError = TDNFDownloadQueueRun(pTdnf, pQueue);
+    BAIL_ON_TDNF_ERROR(dwError);
+
     if(pSolvedInfo->pPkgsToInstall)
     {
         dwError = TDNFTransAddInstallPkgs(
                       pTS,
                       pTdnf,
-                      pSolvedInfo->pPkgsToInstall, INSTALL_INSTALL);
+                      pSolvedInfo->pPkgsToInstall,
+                      ppszInstallFiles,
+                      pQueue,
+                      INSTALL_INSTALL);
         BAIL_ON_TDNF_ERROR(dwError);
     }
     if(pSolvedInfo->pPkgsToReinstall)
@@ -379,6 +425,8 @@ TDNFPopulateTransaction(
                       pTS,
                       pTdnf,
                       pSolvedInfo->pPkgsToReinstall,
+                      ppszReinstallFiles,
+                      pQueue,
                       INSTALL_REINSTALL);
         BAIL_ON_TDNF_ERROR(dwError);
     }
@@ -388,6 +436,8 @@ TDNFPopulateTransaction(
                       pTS,
                       pTdnf,
                       pSolvedInfo->pPkgsToUpgrade,
+                      ppszUpgradeFiles,
+                      pQueue,
                       INSTALL_UPGRADE);
         BAIL_ON_TDNF_ERROR(dwError);
     }
@@ -411,6 +461,8 @@ TDNFPopulateTransaction(
                       pTS,
                       pTdnf,
                       pSolvedInfo->pPkgsToDowngrade,
+                      ppszDowngradeFiles,
+                      pQueue,
                       INSTALL_INSTALL);
         BAIL_ON_TDNF_ERROR(dwError);
         if(pSolvedInfo->pPkgsRemovedByDowngrade)
@@ -423,6 +475,12 @@ TDNFPopulateTransaction(
     }
 
 cleanup:
+    pTdnf->pDownloadQueue = NULL;
+    TDNFFreeDownloadQueue(pQueue);
+    TDNF_SAFE_FREE_STRINGARRAY(ppszInstallFiles);
+    TDNF_SAFE_FREE_STRINGARRAY(ppszReinstallFiles);
+    TDNF_SAFE_FREE_STRINGARRAY(ppszUpgradeFiles);
+    TDNF_SAFE_FREE_STRINGARRAY(ppszDowngradeFiles);
     return dwError;
 
 error:
@@ -764,71 +822,78 @@ error:
     goto cleanup;
 }
 
+/*
+ * Find the local file for each package in pInfos. Packages that are
+ * not available locally are downloaded, or queued for download when
+ * pTdnf->pDownloadQueue is set. The returned array is parallel to pInfos.
+ */
 uint32_t
-TDNFTransAddInstallPkgs(
-    PTDNFRPMTS pTS,
+TDNFTransGetPkgFilePaths(
     PTDNF pTdnf,
     PTDNF_PKG_INFO pInfos,
-    int nInstallFlag
+    char ***pppszFilePaths
     )
 {
     uint32_t dwError = 0;
     PTDNF_PKG_INFO pInfo;
+    char **ppszFilePaths = NULL;
+    int nCount = 0;
+    int i = 0;
 
-    if(!pInfos)
+    if(!pTdnf || !pppszFilePaths)
     {
-        dwError = ERROR_TDNF_NO_DATA;
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
     for (pInfo = pInfos; pInfo; pInfo = pInfo->pNext)
+    {
+        nCount++;
+    }
+
+    dwError = TDNFAllocateMemory(nCount + 1, sizeof(char *),
+                                 (void **)&ppszFilePaths);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    for (pInfo = pInfos; pInfo; pInfo = pInfo->pNext, i++)
     {
         PTDNF_REPO_DATA pRepo = NULL;
 
         dwError = TDNFFindRepoById(pTdnf, pInfo->pszRepoName, &pRepo);
         BAIL_ON_TDNF_ERROR(dwError);
 
-        dwError = TDNFTransAddInstallPkg(
-                      pTS,
+        dwError = TDNFTransGetPkgFilePath(
                       pTdnf,
                       pInfo,
                       pRepo,
-                      nInstallFlag);
+                      &ppszFilePaths[i]);
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
+    *pppszFilePaths = ppszFilePaths;
+
 cleanup:
     return dwError;
 
 error:
-    if(dwError == ERROR_TDNF_NO_DATA)
-    {
-        dwError = 0;
-    }
+    TDNF_SAFE_FREE_STRINGARRAY(ppszFilePaths);
     goto cleanup;
 }
 
 uint32_t
-TDNFTransAddInstallPkg(
-    PTDNFRPMTS pTS,
+TDNFTransGetPkgFilePath(
     PTDNF pTdnf,
     PTDNF_PKG_INFO pInfo,
     PTDNF_REPO_DATA pRepo,
-    int nInstallFlag
+    char **ppszFilePath
     )
 {
     uint32_t dwError = 0;
-    int nGPGCheck = 0;
     char* pszFilePath = NULL;
-    Header rpmHeader = NULL;
-    PTDNF_CACHED_RPM_ENTRY pRpmCache = NULL;
     const char* pszPackageLocation = NULL;
     const char* pszPkgName = NULL;
-    uint8_t digest_from_file[EVP_MAX_MD_SIZE] = {0};
-    hash_op *hash = NULL;
-    int nSize;
 
-    if(!pTS || !pTdnf || !pInfo || !pRepo)
+    if(!pTdnf || !pInfo || !pRepo || !ppszFilePath)
     {
         dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_TDNF_ERROR(dwError);
@@ -893,8 +958,118 @@ TDNFTransAddInstallPkg(
 
         }
         BAIL_ON_TDNF_ERROR(dwError);
+
+        /* a queued download is checked while it is written */
+        if (pTdnf->pDownloadQueue)
+        {
+            dwError = TDNFDownloadQueueSetVerify(
+                          pTdnf->pDownloadQueue,
+                          pszFilePath,
+                          pInfo->nChecksumType,
+                          pInfo->pbChecksum,
+                          pInfo->dwDownloadSizeBytes);
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
     }
 
+    *ppszFilePath = pszFilePath;
+
+cleanup:
+    return dwError;
+
+error:
+    pr_err("Error processing package: %s\n", pszPackageLocation);
+    TDNF_SAFE_FREE_MEMORY(pszFilePath);
+    goto cleanup;
+}
+
+uint32_t
+TDNFTransAddInstallPkgs(
+    PTDNFRPMTS pTS,
+    PTDNF pTdnf,
+    PTDNF_PKG_INFO pInfos,
+    char **ppszFilePaths,
+    PTDNF_DOWNLOAD_QUEUE pQueue,
+    int nInstallFlag
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_PKG_INFO pInfo;
+    int i = 0;
+
+    if(!pInfos)
+    {
+        dwError = ERROR_TDNF_NO_DATA;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if(!ppszFilePaths)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    for (pInfo = pInfos; pInfo; pInfo = pInfo->pNext, i++)
+    {
+        PTDNF_REPO_DATA pRepo = NULL;
+
+        dwError = TDNFFindRepoById(pTdnf, pInfo->pszRepoName, &pRepo);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        dwError = TDNFTransAddInstallPkg(
+                      pTS,
+                      pTdnf,
+                      pInfo,
+                      pRepo,
+                      ppszFilePaths[i],
+                      TDNFDownloadQueueIsVerified(pQueue, ppszFilePaths[i]),
+                      nInstallFlag);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+cleanup:
+    return dwError;
+
+error:
+    if(dwError == ERROR_TDNF_NO_DATA)
+    {
+        dwError = 0;
+    }
+    goto cleanup;
+}
+
+uint32_t
+TDNFTransAddInstallPkg(
+    PTDNFRPMTS pTS,
+    PTDNF pTdnf,
+    PTDNF_PKG_INFO pInfo,
+    PTDNF_REPO_DATA pRepo,
+    const char *pszLocalPath,
+    int nVerified,
+    int nInstallFlag
+    )
+{
+    uint32_t dwError = 0;
+    int nGPGCheck = 0;
+    char* pszFilePath = NULL;
+    Header rpmHeader = NULL;
+    PTDNF_CACHED_RPM_ENTRY pRpmCache = NULL;
+    const char* pszPackageLocation = NULL;
+    uint8_t digest_from_file[EVP_MAX_MD_SIZE] = {0};
+    hash_op *hash = NULL;
+    int nSize;
+
+    if(!pTS || !pTdnf || !pInfo || !pRepo || IsNullOrEmptyString(pszLocalPath))
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    pszPackageLocation = pInfo->pszLocation;
+
+    dwError = TDNFAllocateString(pszLocalPath, &pszFilePath);
+    BAIL_ON_TDNF_ERROR(dwError);
+
     //A download could have been triggered.
     //So check access and bail if not available
     if(access(pszFilePath, F_OK))
@@ -904,7 +1079,8 @@ TDNFTransAddInstallPkg(
         BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
     }
 
-    if(pInfo->pbChecksum != NULL) {
+    /* digest and size were already checked during the download */
+    if(pInfo->pbChecksum != NULL && !nVerified) {
         hash = hash_ops + pInfo->nChecksumType;
 
         dwError = TDNFGetDigestForFile(pszFilePath, hash, digest_from_file);
@@ -918,13 +1094,16 @@ TDNFTransAddInstallPkg(
         }
     }
 
-    dwError = TDNFGetFileSize(pszFilePath, &nSize);
-    BAIL_ON_TDNF_ERROR(dwError);
-
-    if (nSize != (int)pInfo->dwDownloadSizeBytes) {
-        pr_err("rpm file (%s) size (%u) does not match expected size (%u)\n", pszFilePath, nSize, pInfo->dwDownloadSizeBytes);
-        dwError = ERROR_TDNF_SIZE_MISMATCH;
+    if (!nVerified)
+    {
+        dwError = TDNFGetFileSize(pszFilePath, &nSize);
         BAIL_ON_TDNF_ERROR(dwError);
+
+        if (nSize != (int)pInfo->dwDownloadSizeBytes) {
+            pr_err("rpm file (%s) size (%u) does not match expected size (%u)\n", pszFilePath, nSize, pInfo->dwDownloadSizeBytes);
+            dwError = ERROR_TDNF_SIZE_MISMATCH;
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
     }
 
     dwError = TDNFGPGCheckPackage(pTS, pTdnf, pRepo, pszFilePath, &rpmHeader);
@@ -19,6 +19,66 @@ typedef struct _TDNF_PLUGIN_
     struct _TDNF_PLUGIN_ *pNext;
 } TDNF_PLUGIN;
 
+typedef struct _TDNF_DOWNLOAD_ITEM_
+{
+    PTDNF_REPO_DATA pRepo;
+    char *pszLocation;
+    char *pszFile;
+    char *pszProgressData;
+    /* transfer state, owned by TDNFDownloadQueueRun() */
+    int nState;
+    int nUrlIndex;
+    int nRetry;
+    /* CLOCK_MONOTONIC ms before which a retry is not started */
+    uint64_t qwRetryAt;
+    CURL *pCurl;
+    FILE *fp;
+    char *pszFileTmp;
+    /* set when the queue continues past failed items */
+    uint32_t dwError;
+    /* expected digest and size, checked while the data arrives */
+    int nChecksumType;
+    unsigned char *pbChecksum;
+    uint64_t qwExpectedSize;
+    EVP_MD_CTX *pDigestCtx;
+    uint64_t qwReceived;
+    uint32_t dwWriteError;
+    int nVerified;
+    struct _TDNF_DOWNLOAD_ITEM_ *pNext;
+} TDNF_DOWNLOAD_ITEM, *PTDNF_DOWNLOAD_ITEM;
+
+typedef struct _TDNF_DOWNLOAD_QUEUE_
+{
+    int nCount;
+    /* record errors per item and keep going instead of aborting */
+    int nContinueOnError;
+    PTDNF_DOWNLOAD_ITEM pHead;
+    PTDNF_DOWNLOAD_ITEM pTail;
+    /* items by the id of their pszFile in files */
+    Stringpool files;
+    PTDNF_DOWNLOAD_ITEM *ppItemsById;
+    int nItemsById;
+} TDNF_DOWNLOAD_QUEUE, *PTDNF_DOWNLOAD_QUEUE;
+
+typedef struct _TDNF_CURL_HANDLE_
+{
+    char *pszRepoId;
+    CURL *pCurl;
+    int nInUse;
+    struct _TDNF_CURL_HANDLE_ *pNext;
+} TDNF_CURL_HANDLE, *PTDNF_CURL_HANDLE;
+
+typedef struct _TDNF_CURL_POOL_
+{
+    CURLSH *pShare;
+    PTDNF_CURL_HANDLE pHandles;
+    uint32_t dwHandlesCreated;
+    uint32_t dwHandlesReused;
+    uint32_t dwTransfers;
+    uint32_t dwConnectionsNew;
+    uint32_t dwConnectionsReused;
+} TDNF_CURL_POOL, *PTDNF_CURL_POOL;
+
 typedef struct _TDNF_
 {
     PSolvSack pSack;
@@ -27,6 +87,10 @@ typedef struct _TDNF_
     PTDNF_REPO_DATA pRepos;
     Repo *pSolvCmdLineRepo;
     PTDNF_PLUGIN pPlugins;
+    /* when set, package downloads are queued here instead of
+       being fetched right away */
+    PTDNF_DOWNLOAD_QUEUE pDownloadQueue;
+    PTDNF_CURL_POOL pCurlPool;
 } TDNF;
 
 typedef struct _TDNF_CACHED_RPM_ENTRY
@@ -51,6 +115,20 @@ typedef struct _TDNF_RPM_TS_
     PTDNF_CACHED_RPM_LIST   pCachedRpmsArray;
 } TDNFRPMTS, *PTDNFRPMTS;
 
+/* checksums and size of a metadata part as listed in repomd.xml */
+typedef struct _TDNF_REPO_MD_PART
+{
+    int nHasChecksum;
+    int nChecksumType;
+    unsigned char pbChecksum[EVP_MAX_MD_SIZE];
+    /* checksum of the uncompressed part */
+    int nHasOpenChecksum;
+    int nOpenChecksumType;
+    unsigned char pbOpenChecksum[EVP_MAX_MD_SIZE];
+    /* 0 if not listed */
+    uint64_t qwSize;
+} TDNF_REPO_MD_PART, *PTDNF_REPO_MD_PART;
+
 typedef struct _TDNF_REPO_METADATA
 {
     char *pszRepoCacheDir;
@@ -60,8 +138,87 @@ typedef struct _TDNF_REPO_METADATA
     char *pszFileLists;
     char *pszUpdateInfo;
     char *pszOther;
+    TDNF_REPO_MD_PART stPrimary;
+    TDNF_REPO_MD_PART stFileLists;
+    TDNF_REPO_MD_PART stUpdateInfo;
+    TDNF_REPO_MD_PART stOther;
 } TDNF_REPO_METADATA,*PTDNF_REPO_METADATA;
 
+/* per repo state while its metadata is synced, so that the downloads
+   of all repos can be collected into one download queue */
+typedef struct _TDNF_REPO_SYNC_
+{
+    PTDNF_REPO_DATA pRepo;
+    char *pszRepoDataDir;
+    char *pszRepoMDFile;
+    char *pszTmpRepoDataDir;
+    char *pszTmpRepoMDFile;
+    unsigned char pszMDCookie[SOLV_COOKIE_LEN];
+    /* metadata_expire has passed, check repomd.xml for changes */
+    int nExpired;
+    int nNewRepoMDFile;
+    PTDNF_REPO_METADATA pRepoMD;
+    uint32_t dwError;
+} TDNF_REPO_SYNC, *PTDNF_REPO_SYNC;
+
+/* what the reposync journal knows about a file */
+typedef struct _TDNF_REPOSYNC_ENTRY_
+{
+    /* REPOSYNC_VERIFIED_* */
+    uint32_t dwFlags;
+    uint64_t qwSize;
+    long long nMtimeSec;
+    long nMtimeNsec;
+    /* hex digest from the metadata, "-" if there was none */
+    char *pszDigest;
+    /* the file is part of the current sync */
+    int nSeen;
+} TDNF_REPOSYNC_ENTRY, *PTDNF_REPOSYNC_ENTRY;
+
+typedef struct _TDNF_REPOSYNC_REPO_
+{
+    PTDNF_REPO_DATA pRepo;
+    char *pszDir;
+    char *pszJournal;
+    /* appended to while syncing, rewritten when done */
+    FILE *fpJournal;
+    /* paths relative to pszDir, the entries are indexed by their ids */
+    Stringpool files;
+    PTDNF_REPOSYNC_ENTRY pEntries;
+    int nEntries;
+    struct _TDNF_REPOSYNC_REPO_ *pNext;
+} TDNF_REPOSYNC_REPO, *PTDNF_REPOSYNC_REPO;
+
+typedef struct _TDNF_REPOSYNC_FILE_
+{
+    PTDNF_PKG_INFO pPkgInfo;
+    PTDNF_REPOSYNC_REPO pSyncRepo;
+    char *pszFile;
+    Id idFile;
+    /* REPOSYNC_FILE_* */
+    int nState;
+    /* REPOSYNC_VERIFIED_* */
+    uint32_t dwFlags;
+    /* result of the last check, set by _TDNFRepoSyncRunChecks() */
+    int nChecked;
+    uint32_t dwResult;
+} TDNF_REPOSYNC_FILE, *PTDNF_REPOSYNC_FILE;
+
+typedef struct _TDNF_REPOSYNC_CTX_
+{
+    PTDNF pTdnf;
+    PTDNF_REPOSYNC_ARGS pArgs;
+    char *pszRootPath;
+    PTDNF_REPOSYNC_REPO pRepos;
+    PTDNF_REPOSYNC_FILE pFiles;
+    int nFiles;
+    int nFilesAlloc;
+    /* for the serial signature checks, which may import keys */
+    TDNFRPMTS ts;
+    /* for the parallel signature checks, one per process */
+    rpmts pCheckTS;
+} TDNF_REPOSYNC_CTX, *PTDNF_REPOSYNC_CTX;
+
 typedef struct _TDNF_EVENT_DATA_
 {
     union
@@ -0,0 +1,271 @@
+/*
+ * Copyright (C) 2023 VMware, Inc. All Rights Reserved.
+ *
+ * Licensed under the GNU Lesser General Public License v2.1 (the "License");
+ * you may not use this file except in compliance with the License. The terms
+ * of the License are located in the COPYING file of this distribution.
+ */
+
+/*
+ * A simple bump allocator. Memory is handed out from large blocks and
+ * cannot be freed individually, everything is released at once with
+ * TDNFArenaFree(). Meant for sets of many small allocations that share
+ * the same lifetime, like the package infos of a query result and
+ * their strings.
+ */
+
+#include "includes.h"
+
+#define TDNF_ARENA_BLOCK_SIZE   (64 * 1024)
+#define TDNF_ARENA_ALIGN        (2 * sizeof(void *))
+#define TDNF_ARENA_ROUND(n) \
+    (((n) + TDNF_ARENA_ALIGN - 1) & ~(TDNF_ARENA_ALIGN - 1))
+/* the data of a block starts after its (aligned) header */
+#define TDNF_ARENA_HEADER_SIZE  TDNF_ARENA_ROUND(sizeof(TDNF_ARENA_BLOCK))
+
+static uint32_t
+TDNFArenaAddBlock(
+    PTDNF_ARENA pArena,
+    size_t nSize,
+    PTDNF_ARENA_BLOCK *ppBlock
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_ARENA_BLOCK pBlock = NULL;
+
+    dwError = TDNFAllocateMemory(
+                  1,
+                  TDNF_ARENA_HEADER_SIZE + nSize,
+                  (void **)&pBlock);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    pBlock->nSize = nSize;
+
+    /* the first block is the one we allocate from. A block for a large
+       request is used up right away, keep it behind the current one so
+       the space left there is not wasted. */
+    if (pArena->pBlocks && nSize > TDNF_ARENA_BLOCK_SIZE)
+    {
+        pBlock->pNext = pArena->pBlocks->pNext;
+        pArena->pBlocks->pNext = pBlock;
+    }
+    else
+    {
+        pBlock->pNext = pArena->pBlocks;
+        pArena->pBlocks = pBlock;
+    }
+
+    *ppBlock = pBlock;
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+uint32_t
+TDNFArenaCreate(
+    PTDNF_ARENA *ppArena
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_ARENA pArena = NULL;
+
+    if (!ppArena)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFAllocateMemory(1, sizeof(TDNF_ARENA), (void **)&pArena);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    *ppArena = pArena;
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/*
+ * Same as TDNFAllocateMemory(), but from the arena. The memory is
+ * zeroed.
+ */
+uint32_t
+TDNFArenaAllocateMemory(
+    PTDNF_ARENA pArena,
+    size_t nNumElements,
+    size_t nSize,
+    void **ppMemory
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_ARENA_BLOCK pBlock = NULL;
+    size_t nTotal = 0;
+
+    if (!pArena || !ppMemory || !nSize || !nNumElements)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if (nNumElements > (SIZE_MAX - TDNF_ARENA_BLOCK_SIZE) / nSize)
+    {
+        dwError = ERROR_TDNF_INVALID_ALLOCSIZE;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    nTotal = TDNF_ARENA_ROUND(nNumElements * nSize);
+
+    pBlock = pArena->pBlocks;
+    if (!pBlock || pBlock->nUsed + nTotal > pBlock->nSize)
+    {
+        dwError = TDNFArenaAddBlock(
+                      pArena,
+                      nTotal > TDNF_ARENA_BLOCK_SIZE ? nTotal : TDNF_ARENA_BLOCK_SIZE,
+                      &pBlock);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    *ppMemory = (char *)pBlock + TDNF_ARENA_HEADER_SIZE + pBlock->nUsed;
+    pBlock->nUsed += nTotal;
+
+cleanup:
+    return dwError;
+
+error:
+    if (ppMemory)
+    {
+        *ppMemory = NULL;
+    }
+    goto cleanup;
+}
+
+uint32_t
+TDNFArenaAllocateString(
+    PTDNF_ARENA pArena,
+    const char *pszSrc,
+    char **ppszDst
+    )
+{
+    uint32_t dwError = 0;
+    char *pszDst = NULL;
+    size_t nLen = 0;
+
+    if (!pszSrc || !ppszDst)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    nLen = strlen(pszSrc);
+    dwError = TDNFArenaAllocateMemory(pArena, 1, nLen + 1, (void **)&pszDst);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    memcpy(pszDst, pszSrc, nLen + 1);
+    *ppszDst = pszDst;
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+uint32_t
+TDNFArenaAllocateStringPrintf(
+    PTDNF_ARENA pArena,
+    char **ppszDst,
+    const char *pszFmt,
+    ...
+    )
+{
+    uint32_t dwError = 0;
+    PTDNF_ARENA_BLOCK pBlock = NULL;
+    char *pszDst = NULL;
+    char *pszFree = NULL;
+    size_t nFree = 0;
+    int nLen = 0;
+    va_list args;
+
+    if (!pArena || !ppszDst || !pszFmt)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    /* try to format into the free space of the current block first */
+    pBlock = pArena->pBlocks;
+    if (pBlock)
+    {
+        pszFree = (char *)pBlock + TDNF_ARENA_HEADER_SIZE + pBlock->nUsed;
+        nFree = pBlock->nSize - pBlock->nUsed;
+    }
+
+    va_start(args, pszFmt);
+    nLen = vsnprintf(pszFree, nFree, pszFmt, args);
+    va_end(args);
+
+    if (nLen < 0)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    if ((size_t)nLen < nFree)
+    {
+        pszDst = pszFree;
+        pBlock->nUsed += TDNF_ARENA_ROUND((size_t)nLen + 1);
+        if (pBlock->nUsed > pBlock->nSize)
+        {
+            pBlock->nUsed = pBlock->nSize;
+        }
+    }
+    else
+    {
+        /* the free space is handed out zeroed later, clear what the
+           truncated attempt wrote there */
+        if (pszFree)
+        {
+            memset(pszFree, 0, nFree);
+        }
+
+        dwError = TDNFArenaAllocateMemory(pArena, 1, nLen + 1, (void **)&pszDst);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        va_start(args, pszFmt);
+        vsnprintf(pszDst, nLen + 1, pszFmt, args);
+        va_end(args);
+    }
+
+    *ppszDst = pszDst;
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+void
+TDNFArenaFree(
+    PTDNF_ARENA pArena
+    )
+{
+    PTDNF_ARENA_BLOCK pBlock = NULL;
+
+    if (!pArena)
+    {
+        return;
+    }
+
+    while (pArena->pBlocks)
+    {
+        pBlock = pArena->pBlocks;
+        pArena->pBlocks = pBlock->pNext;
+        TDNFFreeMemory(pBlock);
+    }
+    TDNFFreeMemory(pArena);
+}
@@ -47,6 +47,9 @@
 #define TDNF_CONF_KEY_VARS_DIRS           "varsdir"
 #define TDNF_CONF_KEY_CHECK_UPDATE_COMPAT "dnf_check_update_compat"
 #define TDNF_CONF_KEY_DISTROSYNC_REINSTALL_CHANGED "distrosync_reinstall_changed"
+#define TDNF_CONF_KEY_MAX_PARALLEL_DOWNLOADS "max_parallel_downloads"
+#define TDNF_CONF_KEY_MAX_HOST_CONNECTIONS "max_host_connections"
+#define TDNF_CONF_KEY_HISTORY_SNAPSHOT_INTERVAL "history_snapshot_interval"
 
 //Repo file key names
 #define TDNF_REPO_KEY_BASEURL             "baseurl"
@@ -72,6 +75,7 @@
 #define TDNF_REPO_KEY_SKIP_MD_FILELISTS   "skip_md_filelists"
 #define TDNF_REPO_KEY_SKIP_MD_UPDATEINFO  "skip_md_updateinfo"
 #define TDNF_REPO_KEY_SKIP_MD_OTHER       "skip_md_other"
+#define TDNF_REPO_KEY_MAX_PARALLEL_DOWNLOADS TDNF_CONF_KEY_MAX_PARALLEL_DOWNLOADS
 
 //file names
 #define TDNF_REPO_METADATA_MARKER         "lastrefresh"
@@ -98,12 +102,19 @@
 #define TDNF_DEFAULT_DISTROARCHPKG        "x86_64"
 #define TDNF_RPM_CACHE_DIR_NAME           "rpms"
 #define TDNF_REPODATA_DIR_NAME            "repodata"
+/* previous repodata, kept while parts are reused from it */
+#define TDNF_REPODATA_OLD_DIR_NAME        "repodata.old"
 #define TDNF_SOLVCACHE_DIR_NAME           "solvcache"
 #define TDNF_REPO_METADATA_EXPIRE_NEVER   "never"
 
 #define TDNF_CONF_DEFAULT_OPENMAX            1024
 #define TDNF_CONF_DEFAULT_INSTALLONLY_LIMIT  2
 #define TDNF_CONF_DEFAULT_SSLVERIFY          1
+#define TDNF_CONF_DEFAULT_MAX_PARALLEL_DOWNLOADS 4
+/* per mirror host, like librepo. 0 - no limit */
+#define TDNF_CONF_DEFAULT_MAX_HOST_CONNECTIONS 3
+/* transactions between full snapshots in the history db */
+#define TDNF_CONF_DEFAULT_HISTORY_SNAPSHOT_INTERVAL 100
 
 // repo default settings
 #define TDNF_REPO_DEFAULT_ENABLED            0
@@ -119,6 +130,8 @@
 #define TDNF_REPO_DEFAULT_SKIP_MD_FILELISTS  0
 #define TDNF_REPO_DEFAULT_SKIP_MD_UPDATEINFO 0
 #define TDNF_REPO_DEFAULT_SKIP_MD_OTHER      0
+/* 0 - use the global max_parallel_downloads */
+#define TDNF_REPO_DEFAULT_MAX_PARALLEL_DOWNLOADS 0
 
 // var names
 #define TDNF_VAR_RELEASEVER               "releasever"
@@ -9,6 +9,40 @@
 #ifndef __COMMON_PROTOTYPES_H__
 #define __COMMON_PROTOTYPES_H__
 
+//arena.c
+uint32_t
+TDNFArenaCreate(
+    PTDNF_ARENA *ppArena
+    );
+
+uint32_t
+TDNFArenaAllocateMemory(
+    PTDNF_ARENA pArena,
+    size_t nNumElements,
+    size_t nSize,
+    void **ppMemory
+    );
+
+uint32_t
+TDNFArenaAllocateString(
+    PTDNF_ARENA pArena,
+    const char *pszSrc,
+    char **ppszDst
+    );
+
+uint32_t
+TDNFArenaAllocateStringPrintf(
+    PTDNF_ARENA pArena,
+    char **ppszDst,
+    const char *pszFmt,
+    ...
+    );
+
+void
+TDNFArenaFree(
+    PTDNF_ARENA pArena
+    );
+
 //memory.c
 uint32_t
 TDNFAllocateMemory(
@@ -169,6 +203,13 @@ TDNFUtilsFormatSize(
     char** ppszFormattedSize
     );
 
+uint32_t
+TDNFUtilsFormatSizeBuf(
+    uint64_t unSize,
+    char* pszBuf,
+    size_t nBufSize
+    );
+
 void
 TDNFFreePackageInfoContents(
     PTDNF_PKG_INFO pPkgInfo
@@ -323,6 +364,12 @@ int32_t strtoi(const char *ptr);
 
 int isTrue(const char *str);
 
+uint32_t
+TDNFDigestCreate(
+    hash_op *hash,
+    EVP_MD_CTX **pctx
+    );
+
 uint32_t
 TDNFGetDigestForFile(
     const char *filename,
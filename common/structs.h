@@ -60,6 +60,19 @@ enum {
     TDNF_HASH_SENTINEL
 };
 
+typedef struct _TDNF_ARENA_BLOCK
+{
+    struct _TDNF_ARENA_BLOCK *pNext;
+    size_t nSize;
+    size_t nUsed;
+} TDNF_ARENA_BLOCK, *PTDNF_ARENA_BLOCK;
+
+/* bump allocator, see arena.c */
+typedef struct _TDNF_ARENA
+{
+    PTDNF_ARENA_BLOCK pBlocks;
+} TDNF_ARENA, *PTDNF_ARENA;
+
 typedef struct _hash_op {
     char *hash_type;
     unsigned int length;
@@ -152,22 +152,21 @@ error:
 }
 
 uint32_t
-TDNFUtilsFormatSize(
+TDNFUtilsFormatSizeBuf(
     uint64_t unSize,
-    char** ppszFormattedSize
+    char* pszBuf,
+    size_t nBufSize
     )
 {
     uint32_t dwError = 0;
-    char* pszFormattedSize = NULL;
     const char* pszSizes = "bkMG";
     double dSize = unSize;
 
     int nIndex = 0;
     int nLimit = strlen(pszSizes);
     double dKiloBytes = 1024.0;
-    int nMaxSize = 35;
 
-    if(!ppszFormattedSize)
+    if(!pszBuf || !nBufSize)
     {
       dwError = ERROR_TDNF_INVALID_PARAMETER;
       BAIL_ON_TDNF_ERROR(dwError);
@@ -179,15 +178,41 @@ TDNFUtilsFormatSize(
         nIndex++;
     }
 
-    dwError = TDNFAllocateMemory(1, nMaxSize, (void**)&pszFormattedSize);
-    BAIL_ON_TDNF_ERROR(dwError);
-
-    if(snprintf(pszFormattedSize, nMaxSize, "%6.2f%c", dSize, pszSizes[nIndex]) >= nMaxSize)
+    if(snprintf(pszBuf, nBufSize, "%6.2f%c", dSize, pszSizes[nIndex]) >= (int)nBufSize)
     {
         dwError = ERROR_TDNF_OUT_OF_MEMORY;
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+uint32_t
+TDNFUtilsFormatSize(
+    uint64_t unSize,
+    char** ppszFormattedSize
+    )
+{
+    uint32_t dwError = 0;
+    char* pszFormattedSize = NULL;
+    int nMaxSize = 35;
+
+    if(!ppszFormattedSize)
+    {
+      dwError = ERROR_TDNF_INVALID_PARAMETER;
+      BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    dwError = TDNFAllocateMemory(1, nMaxSize, (void**)&pszFormattedSize);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFUtilsFormatSizeBuf(unSize, pszFormattedSize, nMaxSize);
+    BAIL_ON_TDNF_ERROR(dwError);
+
     *ppszFormattedSize = pszFormattedSize;
 
 cleanup:
@@ -202,19 +227,39 @@ error:
     goto cleanup;
 }
 
+/*
+ * Package infos of a result set may be allocated from an arena, see
+ * TDNFAllocatePkgInfoArray(). Such an arena is freed once all of its
+ * infos have been visited, so a list must not interleave infos of
+ * different result sets.
+ */
 void
 TDNFFreePackageInfo(
     PTDNF_PKG_INFO pPkgInfo
     )
 {
+    PTDNF_ARENA pArena = NULL;
+
     while(pPkgInfo)
     {
         PTDNF_PKG_INFO pPkgInfoTemp = pPkgInfo;
         pPkgInfo = pPkgInfo->pNext;
 
         TDNFFreePackageInfoContents(pPkgInfoTemp);
-        TDNFFreeMemory(pPkgInfoTemp);
+        if (pPkgInfoTemp->pArena)
+        {
+            if (pPkgInfoTemp->pArena != pArena)
+            {
+                TDNFArenaFree(pArena);
+                pArena = pPkgInfoTemp->pArena;
+            }
+        }
+        else
+        {
+            TDNFFreeMemory(pPkgInfoTemp);
+        }
     }
+    TDNFArenaFree(pArena);
 }
 
 void
@@ -223,15 +268,25 @@ TDNFFreePackageInfoArray(
     uint32_t unLength
     )
 {
+    PTDNF_ARENA pArena = NULL;
+
   if (!pPkgInfoArray) {
       return;
     }
 
+    pArena = pPkgInfoArray->pArena;
     while ((int32_t)--unLength >= 0) {
       TDNFFreePackageInfoContents(&pPkgInfoArray[unLength]);
     }
 
-    TDNF_SAFE_FREE_MEMORY(pPkgInfoArray);
+    if (pArena)
+    {
+        TDNFArenaFree(pArena);
+    }
+    else
+    {
+        TDNF_SAFE_FREE_MEMORY(pPkgInfoArray);
+    }
 }
 
 void
@@ -254,7 +309,13 @@ TDNFFreePackageInfoContents(
 {
     PTDNF_PKG_CHANGELOG_ENTRY pEntry, pEntryNext;
 
-    if(pPkgInfo)
+    if(!pPkgInfo)
+    {
+        return;
+    }
+
+    /* strings from an arena are freed with it */
+    if(!pPkgInfo->pArena)
     {
         TDNF_SAFE_FREE_MEMORY(pPkgInfo->pszName);
         TDNF_SAFE_FREE_MEMORY(pPkgInfo->pszRepoName);
@@ -266,28 +327,30 @@ TDNFFreePackageInfoContents(
         TDNF_SAFE_FREE_MEMORY(pPkgInfo->pszLicense);
         TDNF_SAFE_FREE_MEMORY(pPkgInfo->pszDescription);
         TDNF_SAFE_FREE_MEMORY(pPkgInfo->pszFormattedSize);
+        TDNF_SAFE_FREE_MEMORY(pPkgInfo->pszFormattedDownloadSize);
         TDNF_SAFE_FREE_MEMORY(pPkgInfo->pszRelease);
         TDNF_SAFE_FREE_MEMORY(pPkgInfo->pszLocation);
+        TDNF_SAFE_FREE_MEMORY(pPkgInfo->pszSourcePkg);
         TDNF_SAFE_FREE_MEMORY(pPkgInfo->pbChecksum);
+    }
 
-        if(pPkgInfo->pppszDependencies)
+    if(pPkgInfo->pppszDependencies)
+    {
+        int depKey;
+        for (depKey = 0; depKey < REPOQUERY_DEP_KEY_COUNT; depKey++)
         {
-            int depKey;
-            for (depKey = 0; depKey < REPOQUERY_DEP_KEY_COUNT; depKey++)
-            {
-                TDNF_SAFE_FREE_STRINGARRAY(pPkgInfo->pppszDependencies[depKey]);
-            }
-            TDNFFreeMemory(pPkgInfo->pppszDependencies);
+            TDNF_SAFE_FREE_STRINGARRAY(pPkgInfo->pppszDependencies[depKey]);
         }
+        TDNFFreeMemory(pPkgInfo->pppszDependencies);
+    }
 
-        TDNF_SAFE_FREE_STRINGARRAY(pPkgInfo->ppszFileList);
-        for (pEntry = pPkgInfo->pChangeLogEntries;
-             pEntry;
-             pEntry = pEntryNext)
-        {
-            pEntryNext = pEntry->pNext;
-            TDNFFreeChangeLogEntry(pEntry);
-        }
+    TDNF_SAFE_FREE_STRINGARRAY(pPkgInfo->ppszFileList);
+    for (pEntry = pPkgInfo->pChangeLogEntries;
+         pEntry;
+         pEntry = pEntryNext)
+    {
+        pEntryNext = pEntry->pNext;
+        TDNFFreeChangeLogEntry(pEntry);
     }
 }
 
@@ -1011,35 +1074,23 @@ int isTrue(const char *str)
     return !strcasecmp(str, "true") || strtoi(str);
 }
 
+/* create a digest context for hash, free it with EVP_MD_CTX_destroy() */
 uint32_t
-TDNFGetDigestForFile(
-    const char *filename,
+TDNFDigestCreate(
     hash_op *hash,
-    uint8_t *digest
+    EVP_MD_CTX **pctx
     )
 {
     uint32_t dwError = 0;
-    int fd = -1;
-    char buf[BUFSIZ] = {0};
-    int length = 0;
     EVP_MD_CTX *ctx = NULL;
     const EVP_MD *digest_type = NULL;
-    unsigned int digest_length = 0;
 
-    if (IsNullOrEmptyString(filename) || !hash || !digest)
+    if (!hash || !pctx)
     {
         dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
-    fd = open(filename, O_RDONLY);
-    if (fd < 0)
-    {
-        pr_err("ERROR: Checksum validating (%s) FAILED\n", filename);
-        dwError = errno;
-        BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
-    }
-
     digest_type = EVP_get_digestbyname(hash->hash_type);
 
     if (!digest_type)
@@ -1074,8 +1125,52 @@ TDNFGetDigestForFile(
         }
         BAIL_ON_TDNF_ERROR(dwError);
     }
+    dwError = 0;
+
+    *pctx = ctx;
+
+cleanup:
+    return dwError;
+error:
+    if (ctx)
+    {
+        EVP_MD_CTX_destroy(ctx);
+    }
+    goto cleanup;
+}
+
+uint32_t
+TDNFGetDigestForFile(
+    const char *filename,
+    hash_op *hash,
+    uint8_t *digest
+    )
+{
+    uint32_t dwError = 0;
+    int fd = -1;
+    char buf[65536];
+    ssize_t length = 0;
+    EVP_MD_CTX *ctx = NULL;
+    unsigned int digest_length = 0;
+
+    if (IsNullOrEmptyString(filename) || !hash || !digest)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        pr_err("ERROR: Checksum validating (%s) FAILED\n", filename);
+        dwError = errno;
+        BAIL_ON_TDNF_SYSTEM_ERROR_UNCOND(dwError);
+    }
+
+    dwError = TDNFDigestCreate(hash, &ctx);
+    BAIL_ON_TDNF_ERROR(dwError);
 
-    while ((length = read(fd, buf, BUFSIZ - 1)) > 0)
+    while ((length = read(fd, buf, sizeof(buf))) > 0)
     {
         dwError = EVP_DigestUpdate(ctx, buf, length);
         if (!dwError)
@@ -1084,7 +1179,6 @@ TDNFGetDigestForFile(
             dwError = ERROR_TDNF_CHECKSUM_VALIDATION_FAILED;
             BAIL_ON_TDNF_ERROR(dwError);
         }
-        memset(buf, 0, BUFSIZ);
     }
 
     if (length == -1)
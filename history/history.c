@@ -136,6 +136,49 @@
 #define COLUMN_TRANS_ITEMS_TYPE 2
 #define COLUMN_TRANS_ITEMS_RPM_ID 3
 
+/* Snapshots of the installed rpms after a transaction, so that a state
+   can be restored without replaying all deltas since the last base
+   transaction. Each snapshot has a marker row with rpm_id 0 so that
+   empty snapshots can be found too. */
+#define SQL_CREATE_TABLE_SNAPSHOTS \
+    "CREATE TABLE IF NOT EXISTS " \
+        "snapshots(" \
+            "Id INTEGER PRIMARY KEY AUTOINCREMENT," \
+            "trans_id INTEGER," \
+            "rpm_id INTEGER);"
+
+#define COLUMN_SNAPSHOTS_ID 0
+#define COLUMN_SNAPSHOTS_TRANS_ID 1
+#define COLUMN_SNAPSHOTS_RPM_ID 2
+
+/* Schema migrations, indexed by the version they migrate to. The version
+   of a db is stored in "PRAGMA user_version". Tables are created on
+   demand, so create them here too to be able to index them. */
+
+#define SQL_MIGRATE_V1 \
+    SQL_CREATE_TABLE_RPMS \
+    SQL_CREATE_TABLE_NAMES \
+    TABLE_CREATE_TABLE_FLAG_SET \
+    SQL_CREATE_TABLE_TRANSACTIONS \
+    SQL_CREATE_TABLE_TRANS_ITEMS \
+    "CREATE INDEX IF NOT EXISTS rpms_nevra ON rpms(nevra);" \
+    "CREATE INDEX IF NOT EXISTS names_name ON names(name);" \
+    "CREATE INDEX IF NOT EXISTS trans_items_trans_id ON trans_items(trans_id);" \
+    "CREATE INDEX IF NOT EXISTS flag_set_name_id_trans_id ON flag_set(name_id, trans_id);"
+
+#define SQL_MIGRATE_V2 \
+    SQL_CREATE_TABLE_SNAPSHOTS \
+    "CREATE INDEX IF NOT EXISTS snapshots_trans_id ON snapshots(trans_id);"
+
+static const char *db_migrations[] = {
+    NULL,
+    SQL_MIGRATE_V1,
+    SQL_MIGRATE_V2,
+};
+
+#define HISTORY_DB_VERSION \
+    ((int)(sizeof(db_migrations) / sizeof(db_migrations[0])) - 1)
+
 
 static
 int _cmp_int(const void *p1, const void *p2)
@@ -217,6 +260,86 @@ error:
     return db;
 }
 
+/*
+ * Start a (possibly nested) transaction. Must be ended with db_end(),
+ * passing the same name.
+ */
+static
+int db_begin(sqlite3 *db, const char *name)
+{
+    int rc = 0;
+    char sql[64];
+
+    snprintf(sql, sizeof(sql), "SAVEPOINT %s;", name);
+    rc = sqlite3_exec(db, sql, 0, 0, NULL);
+    check_db_rc(db, rc);
+error:
+    return rc;
+}
+
+/* Commit the transaction started with db_begin(), or roll it back. */
+static
+void db_end(sqlite3 *db, const char *name, int rollback)
+{
+    char sql[64];
+
+    if (rollback) {
+        snprintf(sql, sizeof(sql), "ROLLBACK TO %s;", name);
+        sqlite3_exec(db, sql, 0, 0, NULL);
+    }
+    snprintf(sql, sizeof(sql), "RELEASE %s;", name);
+    sqlite3_exec(db, sql, 0, 0, NULL);
+}
+
+/* Bring the schema of the db to HISTORY_DB_VERSION */
+static
+int db_migrate(sqlite3 *db)
+{
+    int rc = 0, step;
+    int version = 0;
+    sqlite3_stmt *res = NULL;
+    char sql[64];
+
+    rc = sqlite3_prepare_v2(db, "PRAGMA user_version;", -1, &res, 0);
+    check_db_rc(db, rc);
+
+    step = sqlite3_step(res);
+    check_cond(step == SQLITE_ROW);
+    version = sqlite3_column_int(res, 0);
+    sqlite3_finalize(res); res = NULL;
+
+    if (version >= HISTORY_DB_VERSION)
+        return 0;
+
+    /* e.g. non root users can still read an old db as it is. The
+       caller accepts SQLITE_READONLY, so don't report it as an error. */
+    if (sqlite3_db_readonly(db, "main") == 1)
+        return SQLITE_READONLY;
+
+    rc = db_begin(db, "migrate");
+    check_rc(rc);
+
+    for (version++; version <= HISTORY_DB_VERSION; version++) {
+        rc = sqlite3_exec(db, db_migrations[version], 0, 0, NULL);
+        if (rc != SQLITE_OK)
+            break;
+    }
+    if (rc == SQLITE_OK) {
+        snprintf(sql, sizeof(sql), "PRAGMA user_version = %d;", HISTORY_DB_VERSION);
+        rc = sqlite3_exec(db, sql, 0, 0, NULL);
+    }
+    db_end(db, "migrate", rc != SQLITE_OK);
+    /* the db may only turn out to be read only when writing to it */
+    if (rc == SQLITE_READONLY)
+        goto error;
+    check_db_rc(db, rc);
+
+error:
+    if (res)
+        sqlite3_finalize(res);
+    return rc;
+}
+
 /* Check if table exists. Returns SQLITE_ROW if it exists, SQLITE_DONE if not,
    or error code in case of error */
 static
@@ -368,71 +491,76 @@ struct history_nevra_map *db_nevra_map(sqlite3 *db)
     return db_string_map(db, "rpms");
 }
 
+/*
+ * Prepare the statements to look up and insert entries in a table used
+ * as a dictionary of strings, so that they can be reused for many entries.
+ * This works for any table with the id in the first column and the
+ * string in field_name, like 'rpms' and 'names'.
+ * pinsert may be NULL if entries will only be looked up.
+ */
 static
-int db_get_dict_entry(sqlite3 *db,
-                      const char *table_name, const char *field_name,
-                      const char *entry, int *pid,
-                      int create)
+int db_dict_prepare(sqlite3 *db,
+                    const char *table_name, const char *field_name,
+                    sqlite3_stmt **pfind, sqlite3_stmt **pinsert)
 {
-    int rc = 0, step;
-    sqlite3_stmt *res = NULL;
+    int rc = 0;
     char sql[256];
 
     snprintf(sql, sizeof(sql), "SELECT * FROM %s WHERE %s = ?;", table_name, field_name);
-
-    rc = sqlite3_prepare_v2(db, sql, -1, &res, 0);
-    check_db_rc(db, rc);
-
-    rc = sqlite3_bind_text(res, 1, entry, -1, NULL);
+    rc = sqlite3_prepare_v2(db, sql, -1, pfind, 0);
     check_db_rc(db, rc);
 
-    step = sqlite3_step(res);
-    if (step == SQLITE_ROW) {
-        int id = sqlite3_column_int(res, COLUMN_RPMS_ID);
-        if (pid)
-            *pid = id;
-        sqlite3_finalize(res);
-        /* we found it, return */
-        return 0;
+    if (pinsert) {
+        snprintf(sql, sizeof(sql), "INSERT INTO %s(%s) VALUES (?);", table_name, field_name);
+        rc = sqlite3_prepare_v2(db, sql, -1, pinsert, 0);
+        check_db_rc(db, rc);
     }
-    sqlite3_finalize(res); res = NULL;
+error:
+    return rc;
+}
 
-    if (!create) {
-        if (pid) *pid = 0;
-        return 0;
-    }
+/*
+ * Look up entry using the statements from db_dict_prepare(). If it's not
+ * found it will be added if insert is not NULL, otherwise the id will
+ * be 0.
+ */
+static
+int db_dict_lookup(sqlite3 *db,
+                   sqlite3_stmt *find, sqlite3_stmt *insert,
+                   const char *entry, int *pid)
+{
+    int rc = 0, step;
+    int id = 0;
 
-    /* add it to db */
-    snprintf(sql, sizeof(sql), "INSERT INTO %s(%s) VALUES (?);", table_name, field_name);
-    rc = sqlite3_prepare_v2(db, sql, -1, &res, 0);
+    sqlite3_reset(find);
+    rc = sqlite3_bind_text(find, 1, entry, -1, NULL);
     check_db_rc(db, rc);
 
-    rc = sqlite3_bind_text(res, 1, entry, -1, NULL);
-    check_db_rc(db, rc);
+    step = sqlite3_step(find);
+    check_db_step(db, step);
+    if (step == SQLITE_ROW) {
+        id = sqlite3_column_int(find, COLUMN_RPMS_ID);
+    } else if (insert) {
+        /* add it to db */
+        sqlite3_reset(insert);
+        rc = sqlite3_bind_text(insert, 1, entry, -1, NULL);
+        check_db_rc(db, rc);
 
-    step = sqlite3_step(res);
-    if (step == SQLITE_DONE) {
-        int id = sqlite3_last_insert_rowid(db);
-        if (pid)
-            *pid = id;
+        step = sqlite3_step(insert);
+        check_cond(step == SQLITE_DONE);
+        id = sqlite3_last_insert_rowid(db);
     }
+    if (pid)
+        *pid = id;
 
 error:
-    if (res)
-        sqlite3_finalize(res);
+    /* don't keep the db locked by an unfinished statement */
+    sqlite3_reset(find);
+    if (insert)
+        sqlite3_reset(insert);
     return rc;
 }
 
-/*
- * Add nevra to db if it's not there already. The id will be returned
- * in *pid if that's not NULL.
-*/
-static
-int db_add_nevra(sqlite3 *db, const char *nevra, int *pid)
-{
-    return db_get_dict_entry(db, "rpms", "nevra", nevra, pid, 1);
-}
-
 /* read transaction items into ht */
 static
 int history_delta_read(sqlite3 *db, struct history_delta *hd, int id)
@@ -479,19 +607,24 @@ error:
     return rc;
 }
 
-/* play one delta transaction on installed_map */
+/* play all delta transactions after trans_id0 up to and including
+   trans_id1 on installed_map */
 static
-int db_play_delta(sqlite3 *db, int trans_id,
-                  char *installed_map, int map_size)
+int db_play_deltas(sqlite3 *db, int trans_id0, int trans_id1,
+                   char *installed_map, int map_size)
 {
     int rc = 0;
     sqlite3_stmt *res = NULL;
-    const char *sql = "SELECT * FROM trans_items WHERE trans_id = ? ORDER BY rpm_id;";
+    const char *sql = "SELECT * FROM trans_items "
+        "WHERE trans_id > ? AND trans_id <= ? ORDER BY trans_id, id;";
 
     rc = sqlite3_prepare_v2(db, sql, -1, &res, 0);
     check_db_rc(db, rc);
 
-    rc = sqlite3_bind_int(res, 1, trans_id);
+    rc = sqlite3_bind_int(res, 1, trans_id0);
+    check_db_rc(db, rc);
+
+    rc = sqlite3_bind_int(res, 2, trans_id1);
     check_db_rc(db, rc);
 
     for(int step = sqlite3_step(res); step == SQLITE_ROW; step = sqlite3_step(res)) {
@@ -543,9 +676,107 @@ error:
     return rc;
 }
 
+/* play one snapshot on installed_map */
+static
+int db_play_snapshot(sqlite3 *db, int trans_id,
+                     char *installed_map, int map_size)
+{
+    int rc = 0;
+    sqlite3_stmt *res = NULL;
+    const char *sql = "SELECT * FROM snapshots WHERE trans_id = ?;";
+
+    rc = sqlite3_prepare_v2(db, sql, -1, &res, 0);
+    check_db_rc(db, rc);
+
+    rc = sqlite3_bind_int(res, 1, trans_id);
+    check_db_rc(db, rc);
+
+    for(int step = sqlite3_step(res); step == SQLITE_ROW; step = sqlite3_step(res)) {
+        int rpm_id = sqlite3_column_int(res, COLUMN_SNAPSHOTS_RPM_ID);
+        if (rpm_id == 0) /* marker */
+            continue;
+        check_cond(rpm_id > 0 && rpm_id <= map_size);
+        map_set(installed_map, rpm_id);
+    }
+
+error:
+    if (res)
+        sqlite3_finalize(res);
+    return rc;
+}
+
+/* helper to run a query returning a single integer, 0 if NULL */
+static
+int db_query_int(sqlite3 *db, const char *sql, int arg1, int arg2, int *pvalue)
+{
+    int rc = 0, step;
+    sqlite3_stmt *res = NULL;
+
+    rc = sqlite3_prepare_v2(db, sql, -1, &res, 0);
+    check_db_rc(db, rc);
+
+    rc = sqlite3_bind_int(res, 1, arg1);
+    check_db_rc(db, rc);
+
+    if (sqlite3_bind_parameter_count(res) > 1) {
+        rc = sqlite3_bind_int(res, 2, arg2);
+        check_db_rc(db, rc);
+    }
+
+    step = sqlite3_step(res);
+    check_cond(step == SQLITE_ROW);
+    *pvalue = sqlite3_column_int(res, 0);
+
+error:
+    if (res)
+        sqlite3_finalize(res);
+    return rc;
+}
+
+/*
+ * Find the most recent full state at or before trans_id, which is either
+ * a HISTORY_TRANS_TYPE_BASE transaction or a snapshot. *pstart_id will
+ * be 0 if there is none.
+ */
+static
+int db_find_start(sqlite3 *db, int trans_id,
+                  int *pstart_id, int *pis_snapshot)
+{
+    int rc = 0;
+    int base_id = 0, snapshot_id = 0;
+
+    rc = db_query_int(db,
+                      "SELECT MAX(id) FROM transactions "
+                          "WHERE type = ? AND id <= ?;",
+                      HISTORY_TRANS_TYPE_BASE, trans_id, &base_id);
+    check_rc(rc);
+
+    /* a db we could not migrate has no snapshots */
+    rc = db_table_exists(db, "snapshots");
+    check_db_step(db, rc);
+    if (rc == SQLITE_ROW) {
+        rc = db_query_int(db,
+                          "SELECT MAX(trans_id) FROM snapshots "
+                              "WHERE trans_id <= ?;",
+                          trans_id, 0, &snapshot_id);
+        check_rc(rc);
+    }
+    rc = 0;
+
+    if (snapshot_id > base_id) {
+        *pstart_id = snapshot_id;
+        *pis_snapshot = 1;
+    } else {
+        *pstart_id = base_id;
+        *pis_snapshot = 0;
+    }
+error:
+    return rc;
+}
+
 /* Replay all transactions on installed_map to reach trans_id by rewinding to
- * the last baseline state and applying all deltas before and
- * including trans_id.
+ * the last baseline state or snapshot and applying all deltas after it
+ * up to and including trans_id.
  * installed_map must have been allocated.
  * Does not install RPMs or modify the db.
  */
@@ -553,40 +784,97 @@ static
 int db_play_transaction(sqlite3 *db, int trans_id,
                         char *installed_map, int map_size)
 {
+    int rc = 0;
+    int start_id = 0, is_snapshot = 0;
+
+    rc = db_find_start(db, trans_id, &start_id, &is_snapshot);
+    check_rc(rc);
+    /* make sure we have found a base line */
+    check_cond(start_id > 0);
+
+    /* we found the most recent full state before trans_id,
+       set to that state ... */
+    if (is_snapshot)
+        rc = db_play_snapshot(db, start_id, installed_map, map_size);
+    else
+        rc = db_play_set(db, start_id, installed_map, map_size);
+    check_rc(rc);
+    /* ... then replay all deltas until we reach the desired trans_id */
+    rc = db_play_deltas(db, start_id, trans_id, installed_map, map_size);
+    check_rc(rc);
+error:
+    return rc;
+}
+
+/* Add a snapshot of rpm_ids as the state after trans_id */
+static
+int db_add_snapshot(sqlite3 *db, int trans_id, int *rpm_ids, int rpm_count)
+{
+    int rc = 0, ret;
+    int i;
     sqlite3_stmt *res = NULL;
-    int step, rc = 0;
-    int base_id = 0;
 
-    /* find most recent HISTORY_TRANS_TYPE_BASE */
     rc = sqlite3_prepare_v2(db,
-                            "SELECT * FROM transactions "
-                                "WHERE type = ? ORDER BY id DESC;",
-                            -1, &res, 0);
+        "INSERT INTO snapshots(trans_id, rpm_id) VALUES (?, ?);",
+        -1, &res, 0);
     check_db_rc(db, rc);
 
-    rc = sqlite3_bind_int(res, 1, HISTORY_TRANS_TYPE_BASE);
+    rc = sqlite3_bind_int(res, 1, trans_id);
     check_db_rc(db, rc);
 
-    for (step = sqlite3_step(res); step == SQLITE_ROW; step = sqlite3_step(res)) {
-        base_id = sqlite3_column_int(res, COLUMN_TRANSACTIONS_ID);
-        if (base_id <= trans_id)
-            break;
+    /* i == -1 is the marker */
+    for (i = -1; i < rpm_count; i++) {
+        rc = sqlite3_bind_int(res, 2, i < 0 ? 0 : rpm_ids[i]);
+        check_db_rc(db, rc);
+
+        ret = sqlite3_step(res);
+        check_cond(ret == SQLITE_DONE);
+
+        sqlite3_reset(res);
     }
-    /* make sure we have found a base line */
-    check_cond(step == SQLITE_ROW);
+error:
+    if (res)
+        sqlite3_finalize(res);
+    return rc;
+}
 
-    /* we found the most recent base state before trans_id,
-       set to that state ... */
-    rc = db_play_set(db, base_id, installed_map, map_size);
+/*
+ * Add a snapshot after trans_id if more than ctx->snapshot_interval
+ * transactions, or more rows than the snapshot itself would have, need
+ * to be replayed to get to the state after trans_id.
+ */
+static
+int db_auto_snapshot(struct history_ctx *ctx, int trans_id,
+                     int *rpm_ids, int rpm_count)
+{
+    int rc = 0;
+    int start_id = 0, is_snapshot = 0;
+    int item_count = 0;
+
+    if (ctx->snapshot_interval <= 0)
+        return 0;
+
+    rc = db_table_exists(ctx->db, "snapshots");
+    if (rc == SQLITE_DONE) /* not migrated */
+        return 0;
+    check_db_step(ctx->db, rc);
+
+    rc = db_find_start(ctx->db, trans_id, &start_id, &is_snapshot);
     check_rc(rc);
-    /* ... then replay all deltas until we reach the desired trans_id */
-    for (int id = base_id + 1; id <= trans_id; id++) {
-        rc = db_play_delta(db, id, installed_map, map_size);
+
+    if (trans_id - start_id < ctx->snapshot_interval) {
+        rc = db_query_int(ctx->db,
+                          "SELECT COUNT(*) FROM trans_items "
+                              "WHERE trans_id > ? AND trans_id <= ?;",
+                          start_id, trans_id, &item_count);
         check_rc(rc);
+        if (item_count <= rpm_count)
+            return 0;
     }
+
+    rc = db_add_snapshot(ctx->db, trans_id, rpm_ids, rpm_count);
+    check_rc(rc);
 error:
-    if (res)
-        sqlite3_finalize(res);
     return rc;
 }
 
@@ -603,6 +891,7 @@ int db_update_rpms(rpmts ts, sqlite3 *db, int **pids, int *pcount)
     Header h;
     rpmdbMatchIterator mi = NULL;
     char *nevra = NULL;
+    sqlite3_stmt *find = NULL, *insert = NULL;
 
     if (pids) {
         /* count installed packages */
@@ -617,10 +906,13 @@ int db_update_rpms(rpmts ts, sqlite3 *db, int **pids, int *pcount)
     rc = sqlite3_exec(db, SQL_CREATE_TABLE_RPMS, 0, 0, NULL);
     check_db_rc(db, rc);
 
+    rc = db_dict_prepare(db, "rpms", "nevra", &find, &insert);
+    check_rc(rc);
+
     mi = rpmtsInitIterator(ts, RPMDBI_PACKAGES, NULL, 0);
     while ((h = rpmdbNextIterator(mi))) {
         nevra = headerGetAsString(h, RPMTAG_NEVRA);
-        rc = db_add_nevra(db, nevra, ids ? &ids[i++] : NULL);
+        rc = db_dict_lookup(db, find, insert, nevra, ids ? &ids[i++] : NULL);
         check_db_rc(db, rc);
         safe_free(nevra);
     }
@@ -635,6 +927,10 @@ int db_update_rpms(rpmts ts, sqlite3 *db, int **pids, int *pcount)
 
 error:
     safe_free(nevra);
+    if (find)
+        sqlite3_finalize(find);
+    if (insert)
+        sqlite3_finalize(insert);
     if (mi)
         rpmdbFreeIterator(mi);
     if (rc && ids)
@@ -688,25 +984,26 @@ int db_add_trans_items(sqlite3 *db, int trans_id, int type,
     int i;
     sqlite3_stmt *res = NULL;
 
-    for (i = 0; i < rpm_count; i++) {
-        rc = sqlite3_prepare_v2(db,
-            "INSERT INTO trans_items(trans_id, type, rpm_id) VALUES (?, ?, ?);",
-            -1, &res, 0);
-        check_db_rc(db, rc);
+    rc = sqlite3_prepare_v2(db,
+        "INSERT INTO trans_items(trans_id, type, rpm_id) VALUES (?, ?, ?);",
+        -1, &res, 0);
+    check_db_rc(db, rc);
 
-        rc = sqlite3_bind_int(res, 1, trans_id);
-        check_db_rc(db, rc);
+    rc = sqlite3_bind_int(res, 1, trans_id);
+    check_db_rc(db, rc);
 
-        rc = sqlite3_bind_int(res, 2, type);
-        check_db_rc(db, rc);
+    rc = sqlite3_bind_int(res, 2, type);
+    check_db_rc(db, rc);
 
+    for (i = 0; i < rpm_count; i++) {
+        /* bindings are kept over a reset */
         rc = sqlite3_bind_int(res, 3, rpm_ids[i]);
         check_db_rc(db, rc);
 
         ret = sqlite3_step(res);
         check_cond(ret == SQLITE_DONE);
 
-        sqlite3_finalize(res); res = NULL;
+        sqlite3_reset(res);
     }
 error:
     if (res)
@@ -745,30 +1042,6 @@ error:
     return rc;
 }
 
-static
-int db_set_auto_flag(sqlite3 *db, int trans_id, const char *name, int value)
-{
-    int rc = 0;
-    int name_id;
-
-    rc = sqlite3_exec(db, SQL_CREATE_TABLE_NAMES,
-        0, 0, NULL);
-    check_db_rc(db, rc);
-
-    rc = db_get_dict_entry(db, "names", "name", name, &name_id, 1);
-    check_db_rc(db, rc);
-
-    rc = sqlite3_exec(db, TABLE_CREATE_TABLE_FLAG_SET,
-        0, 0, NULL);
-    check_db_rc(db, rc);
-
-    rc = db_set_auto_flag_byid(db, trans_id, name_id, value);
-    check_rc(rc);
-
-error:
-    return rc;
-}
-
 static
 int db_get_auto_flag_byid(sqlite3 *db, int trans_id, int name_id, int *pvalue)
 {
@@ -807,69 +1080,259 @@ error:
 }
 
 static
-int db_get_auto_flag(sqlite3 *db, int trans_id, const char *name, int *pvalue)
+int _cmp_flag(const void *p1, const void *p2)
 {
-    int rc = 0;
-    int name_id;
+    return strcmp(((struct history_flag *)p1)->name,
+                  ((struct history_flag *)p2)->name);
+}
 
-    rc = db_table_exists(db, "flag_set");
-    if (rc == SQLITE_DONE) { /* no table */
-        *pvalue = 0;
-        return 0;
+static
+void history_free_auto_flags(struct history_ctx *ctx)
+{
+    if (ctx->flags) {
+        for (int i = 0; i < ctx->flags_count; i++) {
+            safe_free(ctx->flags[i].name);
+        }
+        safe_free(ctx->flags);
     }
-    check_cond(rc == SQLITE_ROW);
+    ctx->flags_count = 0;
+    ctx->flags_trans_id = 0;
+}
 
-    rc = db_table_exists(db, "names");
-    if (rc == SQLITE_DONE) { /* no table */
-        *pvalue = 0;
+/*
+ * Read the auto flags of all names as of ctx->trans_id, so that
+ * history_get_auto_flag() doesn't need to query the db for each name.
+ * Only names that ever had a flag set are in the map, others are 0.
+ * The map is read again if ctx->trans_id changes, and kept up to date
+ * when flags are set.
+ */
+int history_load_auto_flags(struct history_ctx *ctx)
+{
+    int rc = 0, step;
+    int count = 0, n = 0;
+    struct history_flag *flags = NULL;
+    sqlite3_stmt *res = NULL;
+
+    check_ptr(ctx);
+    check_cond(ctx->trans_id > 0);
+
+    if (ctx->flags_trans_id == ctx->trans_id)
+        return 0;
+
+    history_free_auto_flags(ctx);
+
+    rc = db_table_exists(ctx->db, "flag_set");
+    if (rc == SQLITE_ROW)
+        rc = db_table_exists(ctx->db, "names");
+    if (rc == SQLITE_DONE) { /* no table => no flags */
+        ctx->flags_trans_id = ctx->trans_id;
         return 0;
     }
     check_cond(rc == SQLITE_ROW);
 
-    rc = db_get_dict_entry(db, "names", "name", name, &name_id, 0);
-    check_db_rc(db, rc);
+    rc = db_maxid(ctx->db, "names", &count);
+    check_rc(rc);
 
-    if (name_id == 0) {
-        /* not found is valid and means value is 0 (unset) */
-        *pvalue = 0;
-        return 0;
+    flags = (struct history_flag *)calloc(count + 1, sizeof(struct history_flag));
+    check_ptr(flags);
+
+    /* the last entry of each name sets the value, sqlite takes the
+       other columns from the row with the max() */
+    rc = sqlite3_prepare_v2(ctx->db,
+                            "SELECT names.name, flag_set.value, MAX(flag_set.Id) "
+                                "FROM flag_set JOIN names ON names.Id = flag_set.name_id "
+                                "WHERE flag_set.trans_id <= ? "
+                                "GROUP BY flag_set.name_id;",
+                            -1, &res, 0);
+    check_db_rc(ctx->db, rc);
+
+    rc = sqlite3_bind_int(res, 1, ctx->trans_id);
+    check_db_rc(ctx->db, rc);
+
+    for (step = sqlite3_step(res); step == SQLITE_ROW; step = sqlite3_step(res)) {
+        const char *name = (const char *)sqlite3_column_text(res, 0);
+
+        check_cond(n < count);
+        if (name == NULL)
+            continue;
+        flags[n].name = strdup(name);
+        check_ptr(flags[n].name);
+        flags[n].value = sqlite3_column_int(res, 1);
+        n++;
     }
+    check_db_step(ctx->db, step);
 
-    rc = db_get_auto_flag_byid(db, trans_id, name_id, pvalue);
-    check_db_rc(db, rc);
+    qsort(flags, n, sizeof(struct history_flag), _cmp_flag);
 
+    ctx->flags = flags;
+    ctx->flags_count = n;
+    ctx->flags_trans_id = ctx->trans_id;
+    flags = NULL;
 error:
+    if (res)
+        sqlite3_finalize(res);
+    if (flags) {
+        for (int i = 0; i < n; i++) {
+            safe_free(flags[i].name);
+        }
+        free(flags);
+    }
     return rc;
 }
 
-int history_set_auto_flag(struct history_ctx *ctx, const char *name, int value)
+/* ctx->flags must be loaded */
+static
+int history_lookup_auto_flag(struct history_ctx *ctx, const char *name)
+{
+    struct history_flag key = { .name = (char *)name };
+    struct history_flag *flag;
+
+    if (ctx->flags_count == 0)
+        return 0;
+    flag = bsearch(&key, ctx->flags, ctx->flags_count,
+                   sizeof(struct history_flag), _cmp_flag);
+    return flag ? flag->value : 0;
+}
+
+/* ctx->flags must be loaded */
+static
+int history_update_auto_flag(struct history_ctx *ctx, const char *name, int value)
 {
     int rc = 0;
-    int oldval;
+    int lo = 0, hi = ctx->flags_count;
+    struct history_flag *flags;
+    char *name_copy = NULL;
 
-    check_ptr(name);
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        int cmp = strcmp(ctx->flags[mid].name, name);
+
+        if (cmp == 0) {
+            ctx->flags[mid].value = value;
+            return 0;
+        }
+        if (cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    name_copy = strdup(name);
+    check_ptr(name_copy);
+
+    flags = (struct history_flag *)realloc(ctx->flags,
+                (ctx->flags_count + 1) * sizeof(struct history_flag));
+    check_ptr(flags);
+    ctx->flags = flags;
+
+    memmove(&flags[lo + 1], &flags[lo],
+            (ctx->flags_count - lo) * sizeof(struct history_flag));
+    flags[lo].name = name_copy;
+    flags[lo].value = value;
+    ctx->flags_count++;
+    name_copy = NULL;
+error:
+    safe_free(name_copy);
+    return rc;
+}
+
+/*
+ * Set the auto flags of count names for the current transaction, in one
+ * db transaction. Flags that don't change are skipped.
+ */
+int history_set_auto_flags(struct history_ctx *ctx,
+                           const char **names, const int *values, int count)
+{
+    int rc = 0, step;
+    int in_trans = 0, changed = 0;
+    sqlite3_stmt *find = NULL, *insert = NULL, *res = NULL;
+
+    check_ptr(ctx);
     check_cond(ctx->trans_id > 0);
+    if (count == 0)
+        return 0;
+    check_ptr(names);
+    check_ptr(values);
+
+    rc = history_load_auto_flags(ctx);
+    check_rc(rc);
+
+    rc = db_begin(ctx->db, "auto_flags");
+    check_rc(rc);
+    in_trans = 1;
+
+    rc = sqlite3_exec(ctx->db, SQL_CREATE_TABLE_NAMES TABLE_CREATE_TABLE_FLAG_SET,
+        0, 0, NULL);
+    check_db_rc(ctx->db, rc);
 
-    /* setting only when needed avoids cluttering the db */
-    rc = db_get_auto_flag(ctx->db, ctx->trans_id, name, &oldval);
+    rc = db_dict_prepare(ctx->db, "names", "name", &find, &insert);
     check_rc(rc);
 
-    if (oldval != value) {
-        rc = db_set_auto_flag(ctx->db, ctx->trans_id, name, value);
+    /* TODO: check if entry with trans_id and name_id already exists and update,
+       instead of creating a new entry */
+    rc = sqlite3_prepare_v2(ctx->db,
+        "INSERT INTO flag_set(trans_id, name_id, value) VALUES (?, ?, ?);",
+        -1, &res, 0);
+    check_db_rc(ctx->db, rc);
+
+    for (int i = 0; i < count; i++) {
+        int name_id = 0;
+
+        check_ptr(names[i]);
+
+        /* setting only when needed avoids cluttering the db */
+        if (history_lookup_auto_flag(ctx, names[i]) == values[i])
+            continue;
+
+        rc = db_dict_lookup(ctx->db, find, insert, names[i], &name_id);
+        check_rc(rc);
+
+        sqlite3_reset(res);
+        rc = sqlite3_bind_int(res, 1, ctx->trans_id);
+        check_db_rc(ctx->db, rc);
+        rc = sqlite3_bind_int(res, 2, name_id);
+        check_db_rc(ctx->db, rc);
+        rc = sqlite3_bind_int(res, 3, values[i]);
+        check_db_rc(ctx->db, rc);
+
+        step = sqlite3_step(res);
+        check_cond(step == SQLITE_DONE);
+        changed = 1;
+
+        rc = history_update_auto_flag(ctx, names[i], values[i]);
         check_rc(rc);
     }
 error:
+    if (find)
+        sqlite3_finalize(find);
+    if (insert)
+        sqlite3_finalize(insert);
+    if (res)
+        sqlite3_finalize(res);
+    if (in_trans)
+        db_end(ctx->db, "auto_flags", rc != 0);
+    /* rolled back, the map doesn't match the db anymore */
+    if (rc != 0 && changed)
+        history_free_auto_flags(ctx);
     return rc;
 }
 
+int history_set_auto_flag(struct history_ctx *ctx, const char *name, int value)
+{
+    return history_set_auto_flags(ctx, &name, &value, 1);
+}
+
 int history_get_auto_flag(struct history_ctx *ctx, const char *name, int *pvalue)
 {
     int rc = 0;
 
     check_ptr(name);
-    check_cond(ctx->trans_id > 0);
-    rc = db_get_auto_flag(ctx->db, ctx->trans_id, name, pvalue);
+    check_ptr(pvalue);
+
+    rc = history_load_auto_flags(ctx);
     check_rc(rc);
+
+    *pvalue = history_lookup_auto_flag(ctx, name);
 error:
     return rc;
 }
@@ -879,6 +1342,7 @@ int history_restore_auto_flags(struct history_ctx *ctx, int trans_id)
 {
     int rc = 0;
     int i, count;
+    int in_trans = 0;
 
     check_ptr(ctx);
 
@@ -891,6 +1355,10 @@ int history_restore_auto_flags(struct history_ctx *ctx, int trans_id)
     rc = db_maxid(ctx->db, "names", &count);
     check_rc(rc);
 
+    rc = db_begin(ctx->db, "auto_flags");
+    check_rc(rc);
+    in_trans = 1;
+
     for (i = 1; i <= count; i++) {
         int value, oldval;
 
@@ -906,6 +1374,10 @@ int history_restore_auto_flags(struct history_ctx *ctx, int trans_id)
         }
     }
 error:
+    if (in_trans)
+        db_end(ctx->db, "auto_flags", rc != 0);
+    if (ctx)
+        history_free_auto_flags(ctx);
     return rc;
 }
 
@@ -914,6 +1386,7 @@ int history_replay_auto_flags(struct history_ctx *ctx, int from, int to)
 {
     int rc = 0;
     int i, count;
+    int in_trans = 0;
 
     check_ptr(ctx);
 
@@ -926,6 +1399,10 @@ int history_replay_auto_flags(struct history_ctx *ctx, int from, int to)
     rc = db_maxid(ctx->db, "names", &count);
     check_rc(rc);
 
+    rc = db_begin(ctx->db, "auto_flags");
+    check_rc(rc);
+    in_trans = 1;
+
     for (i = 1; i <= count; i++) {
         int val_from, val_to;
 
@@ -948,6 +1425,10 @@ int history_replay_auto_flags(struct history_ctx *ctx, int from, int to)
         }
     }
 error:
+    if (in_trans)
+        db_end(ctx->db, "auto_flags", rc != 0);
+    if (ctx)
+        history_free_auto_flags(ctx);
     return rc;
 }
 
@@ -1243,12 +1724,14 @@ int history_record_state(struct history_ctx *ctx)
     int rc = 0;
     char *err_msg = NULL;
     int trans_id = 0;
+    int in_trans = 0;
 
     check_ptr(ctx);
 
     /* avoid unfinished transaction record on failure or crash */
-    rc = sqlite3_exec(ctx->db, "BEGIN TRANSACTION;", 0, 0, NULL);
-    check_db_rc(ctx->db, rc);
+    rc = db_begin(ctx->db, "record_state");
+    check_rc(rc);
+    in_trans = 1;
 
     rc = sqlite3_exec(ctx->db,
         SQL_CREATE_TABLE_TRANSACTIONS,
@@ -1272,10 +1755,8 @@ int history_record_state(struct history_ctx *ctx)
 error:
     if(err_msg)
         sqlite3_free(err_msg);
-    if (rc)
-        sqlite3_exec(ctx->db, "ROLLBACK;", 0, 0, NULL);
-    else
-        sqlite3_exec(ctx->db, "COMMIT;", 0, 0, NULL);
+    if (in_trans)
+        db_end(ctx->db, "record_state", rc != 0);
     return rc;
 }
 
@@ -1418,6 +1899,7 @@ int history_update_state(struct history_ctx *ctx, rpmts ts, const char *cmdline)
     int *added_ids = NULL, added_count;
     int *removed_ids = NULL, removed_count;
     char *cookie = NULL;
+    int in_trans = 0;
 
     check_ptr(ctx);
     check_ptr(ts);
@@ -1431,6 +1913,12 @@ int history_update_state(struct history_ctx *ctx, rpmts ts, const char *cmdline)
         return 0;
     }
 
+    /* avoid unfinished transaction record on failure or crash, and
+       commit all rows at once */
+    rc = db_begin(ctx->db, "update_state");
+    check_rc(rc);
+    in_trans = 1;
+
     rc = db_update_rpms(ts, ctx->db, &current_ids, &current_count);
     check_rc(rc);
 
@@ -1440,10 +1928,6 @@ int history_update_state(struct history_ctx *ctx, rpmts ts, const char *cmdline)
                 &added_ids, &added_count);
     check_rc(rc);
 
-    /* avoid unfinished transaction record on failure or crash */
-    rc = sqlite3_exec(ctx->db, "BEGIN TRANSACTION;", 0, 0, NULL);
-    check_db_rc(ctx->db, rc);
-
     rc = db_add_transaction(ctx->db, &trans_id, cmdline, time(NULL),
                             cookie, HISTORY_TRANS_TYPE_DELTA);
     check_rc(rc);
@@ -1461,6 +1945,9 @@ int history_update_state(struct history_ctx *ctx, rpmts ts, const char *cmdline)
         check_rc(rc);
     }
 
+    rc = db_auto_snapshot(ctx, trans_id, current_ids, current_count);
+    check_rc(rc);
+
     /* replace ctx->installed_ids */
     safe_free(ctx->installed_ids);
     ctx->installed_ids = current_ids;
@@ -1469,17 +1956,89 @@ int history_update_state(struct history_ctx *ctx, rpmts ts, const char *cmdline)
     history_set_cookie(ctx, cookie);
     ctx->trans_id = trans_id;
 error:
-    if (rc) {
-        sqlite3_exec(ctx->db, "ROLLBACK;", 0, 0, NULL);
+    if (in_trans)
+        db_end(ctx->db, "update_state", rc != 0);
+    if (rc)
         safe_free(current_ids);
-    } else
-        sqlite3_exec(ctx->db, "COMMIT;", 0, 0, NULL);
     safe_free(added_ids);
     safe_free(removed_ids);
     safe_free(cookie);
     return rc;
 }
 
+/*
+ * Collapse all history before trans_id: the state after trans_id is kept
+ * as a snapshot (unless it already is a full state), and all older
+ * transactions, their items, snapshots and superseded auto flags are
+ * removed. Transactions before trans_id can no longer be rolled back to.
+ */
+int history_compact(struct history_ctx *ctx, int trans_id)
+{
+    int rc = 0;
+    char *installed_map = NULL;
+    int map_size = 0;
+    int *ids = NULL, count = 0;
+    int start_id = 0, is_snapshot = 0;
+    int in_trans = 0;
+    sqlite3_stmt *res = NULL;
+    const char *sql_delete[] = {
+        "DELETE FROM trans_items WHERE trans_id < ?;",
+        "DELETE FROM transactions WHERE id < ?;",
+        "DELETE FROM snapshots WHERE trans_id < ?;",
+        /* keep only the most recent value of each flag */
+        "DELETE FROM flag_set WHERE trans_id <= ?1 AND id NOT IN "
+            "(SELECT MAX(id) FROM flag_set WHERE trans_id <= ?1 GROUP BY name_id);",
+        NULL
+    };
+
+    check_ptr(ctx);
+    check_cond(trans_id > 0 && trans_id <= ctx->trans_id);
+
+    rc = db_begin(ctx->db, "compact");
+    check_rc(rc);
+    in_trans = 1;
+
+    rc = db_find_start(ctx->db, trans_id, &start_id, &is_snapshot);
+    check_rc(rc);
+    check_cond(start_id > 0);
+
+    if (start_id != trans_id) {
+        rc = db_rpms_maxid(ctx->db, &map_size);
+        check_rc(rc);
+
+        installed_map = (char *)calloc(map_size, sizeof(char));
+        check_ptr(installed_map);
+
+        rc = db_play_transaction(ctx->db, trans_id, installed_map, map_size);
+        check_rc(rc);
+
+        ids = get_ids_from_map(installed_map, map_size, &count);
+        check_ptr(ids);
+
+        rc = db_add_snapshot(ctx->db, trans_id, ids, count);
+        check_rc(rc);
+    }
+
+    for (int i = 0; sql_delete[i]; i++) {
+        rc = sqlite3_prepare_v2(ctx->db, sql_delete[i], -1, &res, 0);
+        check_db_rc(ctx->db, rc);
+
+        rc = sqlite3_bind_int(res, 1, trans_id);
+        check_db_rc(ctx->db, rc);
+
+        check_cond(sqlite3_step(res) == SQLITE_DONE);
+        sqlite3_finalize(res); res = NULL;
+    }
+error:
+    if (res)
+        sqlite3_finalize(res);
+    if (in_trans)
+        db_end(ctx->db, "compact", rc != 0);
+    safe_free(installed_map);
+    safe_free(ids);
+    return rc;
+}
+
 /* sync history context to current state from ts */
 int history_sync(struct history_ctx *ctx, rpmts ts)
 {
@@ -1487,6 +2046,7 @@ int history_sync(struct history_ctx *ctx, rpmts ts)
     int step, rc = 0;
     char *cookie = NULL;
     int db_isfresh = 1;
+    int in_trans = 0;
 
     check_ptr(ctx);
     check_ptr(ts);
@@ -1496,6 +2056,10 @@ int history_sync(struct history_ctx *ctx, rpmts ts)
     /* this fails if the rpm db isn't opened */
     check_ptr(cookie);
 
+    rc = db_begin(ctx->db, "sync");
+    check_rc(rc);
+    in_trans = 1;
+
     step = db_table_exists(ctx->db, "transactions");
 
     if (step == SQLITE_ROW) {
@@ -1552,6 +2116,8 @@ int history_sync(struct history_ctx *ctx, rpmts ts)
 error:
     if (res)
         sqlite3_finalize(res);
+    if (in_trans)
+        db_end(ctx->db, "sync", rc != 0);
     safe_free(cookie);
     return rc;
 }
@@ -1572,6 +2138,14 @@ struct history_ctx *create_history_ctx(const char *db_filename)
     check_ptr(ctx);
 
     ctx->db = db;
+    ctx->snapshot_interval = HISTORY_SNAPSHOT_INTERVAL;
+
+    rc = db_migrate(db);
+    if (rc == SQLITE_READONLY) {
+        /* we can still read the db, just slower */
+        rc = 0;
+    }
+    check_db_rc(db, rc);
 
     step = db_table_exists(ctx->db, "transactions");
     check_db_step(db, step);
@@ -1607,6 +2181,7 @@ void destroy_history_ctx(struct history_ctx *ctx)
             sqlite3_close(ctx->db);
         safe_free(ctx->installed_ids);
         safe_free(ctx->cookie);
+        history_free_auto_flags(ctx);
         free(ctx);
     }
 }
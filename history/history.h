@@ -20,6 +20,15 @@
 #define HISTORY_ITEM_TYPE_ADD 1
 #define HISTORY_ITEM_TYPE_REMOVE 2
 
+/* default for history_ctx.snapshot_interval */
+#define HISTORY_SNAPSHOT_INTERVAL 100
+
+struct history_flag
+{
+    char *name;
+    int value;
+};
+
 struct history_ctx
 {
     sqlite3 *db;
@@ -27,6 +36,12 @@ struct history_ctx
     int installed_count;
     char *cookie;
     int trans_id;
+    int snapshot_interval; /* transactions between snapshots, 0 to disable */
+    /* auto flags as of flags_trans_id, sorted by name,
+       see history_load_auto_flags() */
+    struct history_flag *flags;
+    int flags_count;
+    int flags_trans_id;
 };
 
 struct history_delta
@@ -78,6 +93,7 @@ struct history_delta *history_get_delta_range(struct history_ctx *ctx, int trans
 int history_add_transaction(struct history_ctx *ctx, const char *cmdline);
 int history_record_state(struct history_ctx *ctx);
 int history_update_state(struct history_ctx *ctx, rpmts ts, const char *cmdline);
+int history_compact(struct history_ctx *ctx, int trans_id);
 
 int history_get_transactions(struct history_ctx *ctx,
                              struct history_transaction **ptas,
@@ -85,7 +101,10 @@ int history_get_transactions(struct history_ctx *ctx,
                              int reverse, int from, int to);
 void history_free_transactions(struct history_transaction *tas, int count);
 
+int history_load_auto_flags(struct history_ctx *ctx);
 int history_set_auto_flag(struct history_ctx *ctx, const char *name, int value);
+int history_set_auto_flags(struct history_ctx *ctx,
+                           const char **names, const int *values, int count);
 int history_get_auto_flag(struct history_ctx *ctx, const char *name, int *pvalue);
 
 int history_restore_auto_flags(struct history_ctx *ctx, int trans_id);
@@ -63,6 +63,14 @@
     }                       \
 }
 
+#define JD_STREAM_SAFE_DESTROY(js) \
+{                                  \
+    if (js) {                      \
+        jd_stream_destroy(js);     \
+        js = NULL;                 \
+    }                              \
+}
+
 #define TDNF_SAFE_FREE_MEMORY(pMemory)          \
     do {                                        \
         if (pMemory) {                          \
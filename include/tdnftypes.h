@@ -173,6 +173,8 @@ typedef struct _TDNF_PKG_INFO
     unsigned char* pbChecksum;
     PTDNF_PKG_CHANGELOG_ENTRY pChangeLogEntries;
     struct _TDNF_PKG_INFO* pNext;
+    /* if set, the info and its strings are owned by this arena */
+    struct _TDNF_ARENA* pArena;
 }TDNF_PKG_INFO, *PTDNF_PKG_INFO;
 
 typedef struct _TDNF_SOLVED_PKG_INFO
@@ -278,6 +280,9 @@ typedef struct _TDNF_CONF
     char **ppszVarsDirs;
     char *pszPluginPath;
     char *pszPluginConfPath;
+    int nMaxParallelDownloads;
+    int nHistorySnapshotInterval;
+    int nMaxHostConnections;
 }TDNF_CONF, *PTDNF_CONF;
 
 typedef struct _TDNF_REPO_DATA
@@ -308,6 +313,7 @@ typedef struct _TDNF_REPO_DATA
     int nSkipMDUpdateInfo;
     int nSkipMDOther;
     char *pszCacheName;
+    int nMaxParallelDownloads;
 
     struct _TDNF_REPO_DATA* pNext;
 }TDNF_REPO_DATA, *PTDNF_REPO_DATA;
@@ -428,7 +434,8 @@ typedef enum {
     HISTORY_CMD_INIT,
     HISTORY_CMD_ROLLBACK,
     HISTORY_CMD_UNDO,
-    HISTORY_CMD_REDO
+    HISTORY_CMD_REDO,
+    HISTORY_CMD_COMPACT
 } HISTORY_CMD;
 
 typedef struct _TDNF_HISTORY_ARGS
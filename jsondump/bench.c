@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2023 VMware, Inc. All Rights Reserved.
+ *
+ * Licensed under the GNU General Public License v2 (the "License");
+ * you may not use this file except in compliance with the License. The terms
+ * of the License are located in the COPYING file of this distribution.
+ */
+
+/*
+ * Micro benchmark for jsondump. Builds a list of count maps (default
+ * 100000) shaped like the output of 'tdnf list', in the different ways
+ * the library can be used, and prints the time and the size of the
+ * document.
+ *
+ * usage: jsondumpbench [count]
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "jsondump.h"
+
+#define BENCH_DEFAULT_COUNT 100000
+
+static
+double _now(void)
+{
+    struct timespec ts = {0};
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static
+int _add_entry(struct json_dump *jd_pkg, int i)
+{
+    char name[32];
+
+    snprintf(name, sizeof(name), "bench-pkg-%d", i);
+
+    if (jd_map_start(jd_pkg) ||
+        jd_map_add_string(jd_pkg, "Name", name) ||
+        jd_map_add_string(jd_pkg, "Arch", "x86_64") ||
+        jd_map_add_fmt(jd_pkg, "Evr", "%d.%d-%d", i % 10, i % 7, i) ||
+        jd_map_add_string(jd_pkg, "Repo", "photon-updates") ||
+        jd_map_add_int(jd_pkg, "InstallSize", i * 1024))
+        return -1;
+    return 0;
+}
+
+/* a new child for every entry */
+static
+int bench_child(int count, unsigned int *size)
+{
+    struct json_dump *jd = jd_create(0);
+    struct json_dump *jd_pkg = NULL;
+    int i, rc = -1;
+
+    if (!jd || jd_list_start(jd))
+        goto out;
+
+    for (i = 0; i < count; i++) {
+        jd_pkg = jd_create(0);
+        if (!jd_pkg || _add_entry(jd_pkg, i) || jd_list_add_child(jd, jd_pkg))
+            goto out;
+        jd_destroy(jd_pkg);
+        jd_pkg = NULL;
+    }
+    *size = jd->pos;
+    rc = 0;
+out:
+    jd_destroy(jd_pkg);
+    jd_destroy(jd);
+    return rc;
+}
+
+/* one child, reused with jd_reset() */
+static
+int bench_reuse(int count, unsigned int *size)
+{
+    struct json_dump *jd = jd_create(0);
+    struct json_dump *jd_pkg = jd_create(0);
+    int i, rc = -1;
+
+    if (!jd || !jd_pkg || jd_list_start(jd))
+        goto out;
+
+    for (i = 0; i < count; i++) {
+        jd_reset(jd_pkg);
+        if (_add_entry(jd_pkg, i) || jd_list_add_child(jd, jd_pkg))
+            goto out;
+    }
+    *size = jd->pos;
+    rc = 0;
+out:
+    jd_destroy(jd_pkg);
+    jd_destroy(jd);
+    return rc;
+}
+
+/* streamed to a temporary file */
+static
+int bench_stream(int count, unsigned int *size)
+{
+    FILE *fp = tmpfile();
+    struct json_stream *js = NULL;
+    char name[32];
+    int i, rc = -1;
+
+    if (!fp)
+        return -1;
+    js = jd_stream_create(fp, 0);
+    if (!js || jd_stream_list_start(js))
+        goto out;
+
+    for (i = 0; i < count; i++) {
+        snprintf(name, sizeof(name), "bench-pkg-%d", i);
+        if (jd_stream_map_start(js) ||
+            jd_stream_map_add_string(js, "Name", name) ||
+            jd_stream_map_add_string(js, "Arch", "x86_64") ||
+            jd_stream_map_add_fmt(js, "Evr", "%d.%d-%d", i % 10, i % 7, i) ||
+            jd_stream_map_add_string(js, "Repo", "photon-updates") ||
+            jd_stream_map_add_int(js, "InstallSize", i * 1024) ||
+            jd_stream_map_end(js))
+            goto out;
+    }
+    if (jd_stream_list_end(js) || jd_stream_flush(js))
+        goto out;
+    *size = ftell(fp);
+    rc = 0;
+out:
+    jd_stream_destroy(js);
+    fclose(fp);
+    return rc;
+}
+
+int main(int argc, char *argv[])
+{
+    int count = BENCH_DEFAULT_COUNT;
+    struct {
+        const char *name;
+        int (*fn)(int count, unsigned int *size);
+    } benches[] = {
+        {"child", bench_child},
+        {"reuse", bench_reuse},
+        {"stream", bench_stream},
+    };
+    unsigned int i, size = 0;
+    double t;
+
+    if (argc > 1)
+        count = atoi(argv[1]);
+    if (count <= 0) {
+        fprintf(stderr, "usage: %s [count]\n", argv[0]);
+        return 1;
+    }
+
+    for (i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+        t = _now();
+        if (benches[i].fn(count, &size)) {
+            fprintf(stderr, "%s: failed\n", benches[i].name);
+            return 1;
+        }
+        printf("%-8s %d entries: %8.2f ms, %u bytes\n",
+               benches[i].name, count, _now() - t, size);
+    }
+    return 0;
+}
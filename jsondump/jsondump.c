@@ -11,6 +11,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <limits.h>
 
 #include "jsondump.h"
 
@@ -91,6 +92,15 @@ struct json_dump *jd_create(unsigned int size)
     return jd;
 }
 
+/* empty the buffer, keeping it allocated to be reused */
+void jd_reset(struct json_dump *jd)
+{
+    if (jd) {
+        jd->pos = 0;
+        jd->buf[0] = 0;
+    }
+}
+
 void jd_destroy(struct json_dump *jd)
 {
     if (jd) {
@@ -100,20 +110,33 @@ void jd_destroy(struct json_dump *jd)
     }
 }
 
-/* make sure we have at least add_size bytes left in buffer by reallocating
- * if needed */
+/*
+ * Make sure we have at least add_size bytes left in buffer, plus the
+ * terminating nul, by reallocating if needed. The size is at least
+ * doubled, so building a document copies every byte only a constant
+ * number of times on average.
+ */
 static
 int _jd_realloc(struct json_dump *jd, unsigned int add_size)
 {
+    unsigned int new_size;
+    char *buf;
+
     if (jd == NULL)
         return -1;
 
-    if (jd->pos + add_size >= jd->buf_size - 1) {
-        add_size += SIZE_INC;
-        jd->buf = (char *)realloc((void *)jd->buf, jd->buf_size + add_size);
-        if (!jd->buf)
+    if (jd->pos + add_size >= jd->buf_size) {
+        new_size = jd->buf_size ? jd->buf_size : SIZE_INC;
+        while (jd->pos + add_size >= new_size) {
+            if (new_size > UINT_MAX / 2)
+                return -1;
+            new_size *= 2;
+        }
+        buf = (char *)realloc((void *)jd->buf, new_size);
+        if (!buf)
             return -1;
-        jd->buf_size = jd->buf_size + add_size;
+        jd->buf = buf;
+        jd->buf_size = new_size;
     }
     return 0;
 }
@@ -125,6 +148,48 @@ int _jd_realloc(struct json_dump *jd, unsigned int add_size)
  * responsibilty to free it.
  */
 
+/*
+ * Write the json representation of c to p, which must have room for two
+ * characters. Returns the number of characters written.
+ */
+static
+int _json_escape_char(char c, char *p)
+{
+    switch (c) {
+        case '"':
+            p[0] = '\\';
+            p[1] = '"';
+            return 2;
+        case '\\':
+            p[0] = '\\';
+            p[1] = '\\';
+            return 2;
+        case '\b':
+            p[0] = '\\';
+            p[1] ='b';
+            return 2;
+        case '\f':
+            p[0] = '\\';
+            p[1] ='f';
+            return 2;
+        case '\n':
+            p[0] = '\\';
+            p[1] ='n';
+            return 2;
+        case '\r':
+            p[0] = '\\';
+            p[1] ='r';
+            return 2;
+        case '\t':
+            p[0] = '\\';
+            p[1] ='t';
+            return 2;
+        default:
+            p[0] = c;
+            return 1;
+    }
+}
+
 char *jsonify_string(const char *str)
 {
     char *p;
@@ -139,38 +204,7 @@ char *jsonify_string(const char *str)
     p = buf;
     *p++ = '\"';
     while(*q) {
-        switch (*q) {
-            case '"':
-                *p++ = '\\';
-                *p++ = '"';
-                break;
-            case '\\':
-                *p++ = '\\';
-                *p++ = '\\';
-                break;
-            case '\b':
-                *p++ = '\\';
-                *p++ ='b';
-                break;
-            case '\f':
-                *p++ = '\\';
-                *p++ ='f';
-                break;
-            case '\n':
-                *p++ = '\\';
-                *p++ ='n';
-                break;
-            case '\r':
-                *p++ = '\\';
-                *p++ ='r';
-                break;
-            case '\t':
-                *p++ = '\\';
-                *p++ ='t';
-                break;
-            default:
-                *p++ = *q;
-        }
+        p += _json_escape_char(*q, p);
         q++;
     }
     *p++ = '\"';
@@ -202,26 +236,125 @@ void _jd_map_prep_append(struct json_dump *jd)
     }
 }
 
-/* helper to add a key value pair with the string 'as-is'
- * (w/out jsonifying and quotes)
+/* append len bytes, the space must have been reserved */
+static
+void _jd_put(struct json_dump *jd, const char *data, unsigned int len)
+{
+    memcpy(&jd->buf[jd->pos], data, len);
+    jd->pos += len;
+}
+
+/* append the closing bracket and terminate the string */
+static
+void _jd_close(struct json_dump *jd, char bracket)
+{
+    jd->buf[jd->pos++] = bracket;
+    jd->buf[jd->pos] = 0;
+}
+
+/* append str jsonified, see jsonify_string(). Space for 2 * len + 2
+ * bytes must have been reserved. */
+static
+void _jd_put_json_string(struct json_dump *jd, const char *str, unsigned int len)
+{
+    char *p = &jd->buf[jd->pos];
+    unsigned int i;
+
+    *p++ = '"';
+    for (i = 0; i < len; i++)
+        p += _json_escape_char(str[i], p);
+    *p++ = '"';
+    jd->pos = p - jd->buf;
+}
+
+/*
+ * Format directly into the buffer and jsonify the result in place,
+ * without a temporary string. Space for at least the quotes must have
+ * been reserved, the caller has to reserve room for its closing bracket
+ * afterwards.
  */
 static
-int _jd_map_add_raw(struct json_dump *jd, const char *key, const char *value)
+int _jd_put_json_vfmt(struct json_dump *jd, const char *format, va_list ap)
 {
-    int add_size = strlen(key) + strlen(value) + 5; /* lengths plus quotes plus colon plus closing bracket plus nul*/
-    int l;
+    char *p, *q;
+    char esc[2];
+    int len, i, n_esc = 0;
+    va_list aq;
+
+    va_copy(aq, ap);
+    /* format behind the opening quote, this fits at the first try in
+       most cases */
+    len = vsnprintf(&jd->buf[jd->pos+1], jd->buf_size - jd->pos - 1, format, ap);
+    if (len >= 0 && jd->pos + 1 + len >= jd->buf_size) {
+        if (_jd_realloc(jd, len + 1)) {
+            va_end(aq);
+            return -1;
+        }
+        len = vsnprintf(&jd->buf[jd->pos+1], jd->buf_size - jd->pos - 1, format, aq);
+    }
+    va_end(aq);
+    if (len < 0)
+        return -1;
+
+    for (i = 0; i < len; i++) {
+        if (_json_escape_char(jd->buf[jd->pos+1+i], esc) > 1)
+            n_esc++;
+    }
+    /* quotes plus closing bracket */
+    if (_jd_realloc(jd, len + n_esc + 3))
+        return -1;
+
+    p = &jd->buf[jd->pos];
+    *p++ = '"';
+    if (n_esc) {
+        /* move the text to the end of its jsonified size and escape it
+           forward, the write position never passes the read position */
+        q = p + n_esc;
+        memmove(q, p, len);
+        for (i = 0; i < len; i++)
+            p += _json_escape_char(q[i], p);
+    } else {
+        p += len;
+    }
+    *p++ = '"';
+    jd->pos = p - jd->buf;
+
+    return 0;
+}
+
+/* reserve room for a value of value_size bytes and write the key */
+static
+int _jd_map_prep_value(struct json_dump *jd, const char *key, unsigned int value_size)
+{
+    unsigned int key_len;
 
     if (jd == NULL)
         return -1;
 
-    if(_jd_realloc(jd, add_size))
+    key_len = strlen(key);
+    /* lengths plus quotes plus colon plus closing bracket */
+    if(_jd_realloc(jd, key_len + value_size + 4))
         return -1;
     _jd_map_prep_append(jd);
 
-    l = snprintf(&(jd->buf[jd->pos]), jd->buf_size - jd->pos, "\"%s\":%s}", key, value);
-    if (l < 0)
+    jd->buf[jd->pos++] = '"';
+    _jd_put(jd, key, key_len);
+    jd->buf[jd->pos++] = '"';
+    jd->buf[jd->pos++] = ':';
+
+    return 0;
+}
+
+/* helper to add a key value pair with the string 'as-is'
+ * (w/out jsonifying and quotes)
+ */
+static
+int _jd_map_add_raw(struct json_dump *jd, const char *key, const char *value, unsigned int len)
+{
+    if (_jd_map_prep_value(jd, key, len))
         return -1;
-    jd->pos += l;
+    _jd_put(jd, value, len);
+    _jd_close(jd, '}');
     return 0;
 }
 
@@ -232,73 +365,81 @@ int _jd_map_add_raw(struct json_dump *jd, const char *key, const char *value)
  */
 int jd_map_add_string(struct json_dump *jd, const char *key, const char *value)
 {
-    int rc;
+    unsigned int len;
 
     if (!value)
         return jd_map_add_null(jd, key);
 
-    char *json_value = jsonify_string(value);
-    if (json_value == NULL)
+    len = strlen(value);
+    /* worst case - every char escaped plus quotes */
+    if (_jd_map_prep_value(jd, key, len * 2 + 2))
         return -1;
+    _jd_put_json_string(jd, value, len);
+    _jd_close(jd, '}');
 
-    rc = _jd_map_add_raw(jd, key, json_value);
-
-    free(json_value);
-
-    return rc;
+    return 0;
 }
 
 int jd_map_add_int(struct json_dump *jd, const char *key, int value)
 {
     char buf[22]; /* 22 = length of 2^64 + 1 */
+    int l;
 
-    if (snprintf(buf, sizeof(buf), "%d", value) < 0)
+    l = snprintf(buf, sizeof(buf), "%d", value);
+    if (l < 0)
         return -1;
-    return _jd_map_add_raw(jd, key, buf);
+    return _jd_map_add_raw(jd, key, buf, l);
 }
 
 int jd_map_add_int64(struct json_dump *jd, const char *key, int64_t value)
 {
     char buf[22]; /* 22 = length of 2^64 + 1 */
+    int l;
 
-    if (snprintf(buf, sizeof(buf), "%ld", value) < 0)
+    l = snprintf(buf, sizeof(buf), "%ld", value);
+    if (l < 0)
         return -1;
-    return _jd_map_add_raw(jd, key, buf);
+    return _jd_map_add_raw(jd, key, buf, l);
 }
 
 int jd_map_add_bool(struct json_dump *jd, const char *key, int value)
 {
-    return _jd_map_add_raw(jd, key, value ? "true": "false");
+    return value ? _jd_map_add_raw(jd, key, "true", 4) :
+                   _jd_map_add_raw(jd, key, "false", 5);
 }
 
 int jd_map_add_null(struct json_dump *jd, const char *key)
 {
-    return _jd_map_add_raw(jd, key, "null");
+    return _jd_map_add_raw(jd, key, "null", 4);
 }
 
 int jd_map_add_fmt(struct json_dump *jd, const char *key, const char *format, ...)
 {
     va_list args;
-    char *buf;
     int rc;
 
+    if (_jd_map_prep_value(jd, key, 2))
+        return -1;
+
     va_start(args, format);
-    buf = _alloc_vsprintf(format, args);
+    rc = _jd_put_json_vfmt(jd, format, args);
     va_end(args);
 
-    if (buf == NULL)
+    if (rc)
         return -1;
+    _jd_close(jd, '}');
 
-    rc = jd_map_add_string(jd, key, buf);
-
-    free(buf);
-
-    return rc;
+    return 0;
 }
 
+/*
+ * Add a child to a map. The child's buffer is appended with a single
+ * copy of its known length. To avoid allocating a child per item, the
+ * same child can be reused after jd_reset().
+ */
 int jd_map_add_child(struct json_dump *jd, const char *key, const struct json_dump *jd_child)
 {
-    return _jd_map_add_raw(jd, key, jd_child->buf);
+    return _jd_map_add_raw(jd, key, jd_child->buf, jd_child->pos);
 }
 
 /* create an empty list */
@@ -324,98 +465,479 @@ int _jd_list_prep_append(struct json_dump *jd)
     return 0;
 }
 
-/* similar to _jd_map_add_raw() but for a list */
+/* similar to _jd_map_prep_value() but for a list */
 static
-int _jd_list_add_raw(struct json_dump *jd, const char *value)
+int _jd_list_prep_value(struct json_dump *jd, unsigned int value_size)
 {
-    int add_size = strlen(value) + 2; /* length plus closing bracket plus nul */
-    int l;
-
     if (jd == NULL)
         return -1;
 
-    if(_jd_realloc(jd, add_size))
+    /* length plus closing bracket */
+    if(_jd_realloc(jd, value_size + 1))
         return -1;
     _jd_list_prep_append(jd);
 
-    l = snprintf(&(jd->buf[jd->pos]), jd->buf_size - jd->pos, "%s]", value);
-    if (l < 0)
-        return -1;
-    jd->pos += l;
+    return 0;
+}
 
+/* similar to _jd_map_add_raw() but for a list */
+static
+int _jd_list_add_raw(struct json_dump *jd, const char *value, unsigned int len)
+{
+    if (_jd_list_prep_value(jd, len))
+        return -1;
+    _jd_put(jd, value, len);
+    _jd_close(jd, ']');
     return 0;
 }
 
 /* similar to jd_map_add_string() but for a list */
 int jd_list_add_string(struct json_dump *jd, const char *value)
 {
-    char *json_value;
-    int rc;
+    unsigned int len;
 
     if (!value)
         return jd_list_add_null(jd);
 
-    json_value = jsonify_string(value);
-    if (json_value == NULL)
+    len = strlen(value);
+    if (_jd_list_prep_value(jd, len * 2 + 2))
         return -1;
+    _jd_put_json_string(jd, value, len);
+    _jd_close(jd, ']');
 
-    rc = _jd_list_add_raw(jd, json_value);
-
-    free(json_value);
-
-    return rc;
+    return 0;
 }
 
 int jd_list_add_int(struct json_dump *jd, int value)
 {
     char buf[22]; /* 22 = length of 2^64 + 1 */
+    int l;
 
-    if (snprintf(buf, sizeof(buf), "%d", value) < 0)
+    l = snprintf(buf, sizeof(buf), "%d", value);
+    if (l < 0)
         return -1;
-    return _jd_list_add_raw(jd, buf);
+    return _jd_list_add_raw(jd, buf, l);
 }
 
 int jd_list_add_int64(struct json_dump *jd, int64_t value)
 {
     char buf[22]; /* 22 = length of 2^64 + 1 */
+    int l;
 
-    if (snprintf(buf, sizeof(buf), "%ld", value) < 0)
+    l = snprintf(buf, sizeof(buf), "%ld", value);
+    if (l < 0)
         return -1;
-    return _jd_list_add_raw(jd, buf);
+    return _jd_list_add_raw(jd, buf, l);
 }
 
 int jd_list_add_bool(struct json_dump *jd, int value)
 {
-    return _jd_list_add_raw(jd, value? "true" : "false");
+    return value ? _jd_list_add_raw(jd, "true", 4) :
+                   _jd_list_add_raw(jd, "false", 5);
 }
 
 int jd_list_add_null(struct json_dump *jd)
 {
-    return _jd_list_add_raw(jd, "null");
+    return _jd_list_add_raw(jd, "null", 4);
 }
 
 int jd_list_add_fmt(struct json_dump *jd, const char *format, ...)
 {
     va_list args;
-    char *buf = NULL;
     int rc;
 
+    if (_jd_list_prep_value(jd, 2))
+        return -1;
+
     va_start(args, format);
-    buf = _alloc_vsprintf(format, args);
+    rc = _jd_put_json_vfmt(jd, format, args);
     va_end(args);
 
-    if (buf == NULL)
+    if (rc)
+        return -1;
+    _jd_close(jd, ']');
+
+    return 0;
+}
+
+/* see jd_map_add_child() */
+int jd_list_add_child(struct json_dump *jd, const struct json_dump *jd_child)
+{
+    return _jd_list_add_raw(jd, jd_child->buf, jd_child->pos);
+}
+
+
+/*
+ * Streaming writer. Instead of building the document in memory, values
+ * are written to a FILE as they are added, through a buffer of fixed
+ * size, so memory use does not depend on the size of the document. The
+ * output is the same as with the functions above. Containers have to be
+ * closed explicitly with jd_stream_map_end() and jd_stream_list_end().
+ * Errors are sticky: once a call failed, all following calls fail too.
+ */
+
+/*
+ * Create a context for writing json to fp. After use it needs to be
+ * free'd using jd_stream_destroy(), after calling jd_stream_flush().
+ * The buffer will be allocated with size bytes, or BUFSIZ bytes if 0.
+ */
+struct json_stream *jd_stream_create(FILE *fp, unsigned int size)
+{
+    struct json_stream *js = NULL;
+
+    if (fp == NULL)
+        return NULL;
+
+    js = calloc(1, sizeof(struct json_stream));
+    if (!js)
+        return NULL;
+
+    if (size == 0)
+        size = BUFSIZ;
+
+    js->buf = (char *)malloc(size);
+    if (!js->buf) {
+        jd_stream_destroy(js);
+        return NULL;
+    }
+    js->buf_size = size;
+    js->fp = fp;
+
+    return js;
+}
+
+/* write out buffered data */
+int jd_stream_flush(struct json_stream *js)
+{
+    if (js == NULL || js->error)
+        return -1;
+
+    if (js->pos > 0) {
+        if (fwrite(js->buf, 1, js->pos, js->fp) != js->pos) {
+            js->error = 1;
+            return -1;
+        }
+        js->pos = 0;
+    }
+    if (fflush(js->fp)) {
+        js->error = 1;
+        return -1;
+    }
+    return 0;
+}
+
+/* free the context. Data not flushed yet is discarded. */
+void jd_stream_destroy(struct json_stream *js)
+{
+    if (js) {
+        if (js->buf)
+            free(js->buf);
+        free(js);
+    }
+}
+
+static
+int _jds_write(struct json_stream *js, const char *data, unsigned int len)
+{
+    if (js->error)
+        return -1;
+
+    if (js->pos + len > js->buf_size) {
+        if (fwrite(js->buf, 1, js->pos, js->fp) != js->pos) {
+            js->error = 1;
+            return -1;
+        }
+        js->pos = 0;
+        /* doesn't fit at all, bypass the buffer */
+        if (len > js->buf_size) {
+            if (fwrite(data, 1, len, js->fp) != len) {
+                js->error = 1;
+                return -1;
+            }
+            return 0;
+        }
+    }
+    memcpy(&js->buf[js->pos], data, len);
+    js->pos += len;
+    return 0;
+}
+
+static
+int _jds_write_str(struct json_stream *js, const char *str)
+{
+    return _jds_write(js, str, strlen(str));
+}
+
+/* write str jsonified, see jsonify_string() */
+static
+int _jds_write_json_string(struct json_stream *js, const char *str)
+{
+    char esc[2];
+
+    if (_jds_write(js, "\"", 1))
+        return -1;
+    for (; *str; str++) {
+        /* fast path for the common case */
+        if (js->pos + 2 <= js->buf_size && !js->error) {
+            js->pos += _json_escape_char(*str, &js->buf[js->pos]);
+        } else {
+            if (_jds_write(js, esc, _json_escape_char(*str, esc)))
+                return -1;
+        }
+    }
+    return _jds_write(js, "\"", 1);
+}
+
+/* called before any value is written, adds a comma if needed */
+static
+int _jds_prep_value(struct json_stream *js)
+{
+    if (js == NULL || js->error)
         return -1;
 
-    rc = jd_list_add_string(jd, buf);
+    if (js->after_key) {
+        js->after_key = 0;
+        return 0;
+    }
+    if (js->depth > 0) {
+        /* values in a map need a key */
+        if (js->stack[js->depth - 1] != '[') {
+            js->error = 1;
+            return -1;
+        }
+        if (js->has_items[js->depth - 1]) {
+            if (_jds_write(js, ",", 1))
+                return -1;
+        }
+        js->has_items[js->depth - 1] = 1;
+    }
+    return 0;
+}
+
+static
+int _jds_container_start(struct json_stream *js, char type)
+{
+    if (_jds_prep_value(js))
+        return -1;
+    if (js->depth >= JD_STREAM_MAX_DEPTH) {
+        js->error = 1;
+        return -1;
+    }
+    js->stack[js->depth] = type;
+    js->has_items[js->depth] = 0;
+    js->depth++;
+    return _jds_write(js, &type, 1);
+}
 
-    free(buf);
+static
+int _jds_container_end(struct json_stream *js, char type)
+{
+    if (js == NULL || js->error)
+        return -1;
+    if (js->depth == 0 || js->stack[js->depth - 1] != type || js->after_key) {
+        js->error = 1;
+        return -1;
+    }
+    js->depth--;
+    return _jds_write(js, type == '{' ? "}" : "]", 1);
+}
+
+/* helper to add a value 'as-is' (w/out jsonifying and quotes) */
+static
+int _jds_add_raw(struct json_stream *js, const char *value)
+{
+    if (_jds_prep_value(js))
+        return -1;
+    return _jds_write_str(js, value);
+}
+
+static
+int _jds_add_string(struct json_stream *js, const char *value)
+{
+    if (!value)
+        return _jds_add_raw(js, "null");
+    if (_jds_prep_value(js))
+        return -1;
+    return _jds_write_json_string(js, value);
+}
+
+static
+int _jds_add_vfmt(struct json_stream *js, const char *format, va_list ap)
+{
+    char buf[256];
+    char *p = buf;
+    int rc, size;
+    va_list aq;
+
+    va_copy(aq, ap);
+    size = vsnprintf(buf, sizeof(buf), format, ap);
+    if (size >= (int)sizeof(buf)) {
+        p = _alloc_vsprintf(format, aq);
+    }
+    va_end(aq);
+
+    if (size < 0 || p == NULL)
+        return -1;
+
+    rc = _jds_add_string(js, p);
+
+    if (p != buf)
+        free(p);
 
     return rc;
 }
 
-int jd_list_add_child(struct json_dump *jd, const struct json_dump *jd_child)
+int jd_stream_map_start(struct json_stream *js)
+{
+    return _jds_container_start(js, '{');
+}
+
+int jd_stream_map_end(struct json_stream *js)
 {
-    return _jd_list_add_raw(jd, jd_child->buf);
+    return _jds_container_end(js, '{');
 }
 
+/*
+ * Add a key to a map. The next value added, or container started,
+ * will be its value.
+ */
+int jd_stream_map_key(struct json_stream *js, const char *key)
+{
+    if (js == NULL || js->error)
+        return -1;
+    if (js->depth == 0 || js->stack[js->depth - 1] != '{' || js->after_key) {
+        js->error = 1;
+        return -1;
+    }
+    if (js->has_items[js->depth - 1]) {
+        if (_jds_write(js, ",", 1))
+            return -1;
+    }
+    js->has_items[js->depth - 1] = 1;
+
+    if (_jds_write(js, "\"", 1) ||
+        _jds_write_str(js, key) ||
+        _jds_write(js, "\":", 2))
+        return -1;
+    js->after_key = 1;
+    return 0;
+}
+
+int jd_stream_map_add_string(struct json_stream *js, const char *key, const char *value)
+{
+    if (jd_stream_map_key(js, key))
+        return -1;
+    return _jds_add_string(js, value);
+}
+
+int jd_stream_map_add_int(struct json_stream *js, const char *key, int value)
+{
+    if (jd_stream_map_key(js, key))
+        return -1;
+    return jd_stream_list_add_int(js, value);
+}
+
+int jd_stream_map_add_int64(struct json_stream *js, const char *key, int64_t value)
+{
+    if (jd_stream_map_key(js, key))
+        return -1;
+    return jd_stream_list_add_int64(js, value);
+}
+
+int jd_stream_map_add_bool(struct json_stream *js, const char *key, int value)
+{
+    if (jd_stream_map_key(js, key))
+        return -1;
+    return _jds_add_raw(js, value ? "true": "false");
+}
+
+int jd_stream_map_add_null(struct json_stream *js, const char *key)
+{
+    if (jd_stream_map_key(js, key))
+        return -1;
+    return _jds_add_raw(js, "null");
+}
+
+int jd_stream_map_add_fmt(struct json_stream *js, const char *key, const char *format, ...)
+{
+    va_list args;
+    int rc;
+
+    if (jd_stream_map_key(js, key))
+        return -1;
+
+    va_start(args, format);
+    rc = _jds_add_vfmt(js, format, args);
+    va_end(args);
+
+    return rc;
+}
+
+/* add a document built with jd_create() */
+int jd_stream_map_add_child(struct json_stream *js, const char *key, const struct json_dump *jd_child)
+{
+    if (jd_stream_map_key(js, key))
+        return -1;
+    return _jds_add_raw(js, jd_child->buf);
+}
+
+int jd_stream_list_start(struct json_stream *js)
+{
+    return _jds_container_start(js, '[');
+}
+
+int jd_stream_list_end(struct json_stream *js)
+{
+    return _jds_container_end(js, '[');
+}
+
+int jd_stream_list_add_string(struct json_stream *js, const char *value)
+{
+    return _jds_add_string(js, value);
+}
+
+/* the int adders are also used for values of maps, after the key */
+int jd_stream_list_add_int(struct json_stream *js, int value)
+{
+    char buf[22]; /* 22 = length of 2^64 + 1 */
+
+    if (snprintf(buf, sizeof(buf), "%d", value) < 0)
+        return -1;
+    return _jds_add_raw(js, buf);
+}
+
+int jd_stream_list_add_int64(struct json_stream *js, int64_t value)
+{
+    char buf[22]; /* 22 = length of 2^64 + 1 */
+
+    if (snprintf(buf, sizeof(buf), "%ld", value) < 0)
+        return -1;
+    return _jds_add_raw(js, buf);
+}
+
+int jd_stream_list_add_bool(struct json_stream *js, int value)
+{
+    return _jds_add_raw(js, value ? "true" : "false");
+}
+
+int jd_stream_list_add_null(struct json_stream *js)
+{
+    return _jds_add_raw(js, "null");
+}
+
+int jd_stream_list_add_fmt(struct json_stream *js, const char *format, ...)
+{
+    va_list args;
+    int rc;
+
+    va_start(args, format);
+    rc = _jds_add_vfmt(js, format, args);
+    va_end(args);
+
+    return rc;
+}
+
+int jd_stream_list_add_child(struct json_stream *js, const struct json_dump *jd_child)
+{
+    return _jds_add_raw(js, jd_child->buf);
+}
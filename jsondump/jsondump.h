@@ -8,6 +8,7 @@
 
 #pragma once
 #include <stdint.h>
+#include <stdio.h>
 
 struct json_dump{
     char *buf;
@@ -15,7 +16,23 @@ struct json_dump{
     unsigned int pos;
 };
 
+#define JD_STREAM_MAX_DEPTH 32
+
+/* writer that streams json to a FILE instead of building it in memory */
+struct json_stream{
+    FILE *fp;
+    char *buf;
+    unsigned int buf_size;
+    unsigned int pos;
+    int depth;
+    char stack[JD_STREAM_MAX_DEPTH];     /* type of open containers, '{' or '[' */
+    char has_items[JD_STREAM_MAX_DEPTH]; /* non-zero if container is not empty */
+    int after_key;                       /* a map key was written, value follows */
+    int error;
+};
+
 struct json_dump *jd_create(unsigned int size);
+void jd_reset(struct json_dump *jd);
 void jd_destroy(struct json_dump *jd);
 
 int jd_map_start(struct json_dump *jd);
@@ -35,3 +52,28 @@ int jd_list_add_bool(struct json_dump *jd, int value);
 int jd_list_add_null(struct json_dump *jd);
 int jd_list_add_fmt(struct json_dump *jd, const char *format, ...);
 int jd_list_add_child(struct json_dump *jd, const struct json_dump *jd_child);
+
+struct json_stream *jd_stream_create(FILE *fp, unsigned int size);
+int jd_stream_flush(struct json_stream *js);
+void jd_stream_destroy(struct json_stream *js);
+
+int jd_stream_map_start(struct json_stream *js);
+int jd_stream_map_end(struct json_stream *js);
+int jd_stream_map_key(struct json_stream *js, const char *key);
+int jd_stream_map_add_string(struct json_stream *js, const char *key, const char *value);
+int jd_stream_map_add_int(struct json_stream *js, const char *key, int value);
+int jd_stream_map_add_int64(struct json_stream *js, const char *key, int64_t value);
+int jd_stream_map_add_bool(struct json_stream *js, const char *key, int value);
+int jd_stream_map_add_null(struct json_stream *js, const char *key);
+int jd_stream_map_add_fmt(struct json_stream *js, const char *key, const char *format, ...);
+int jd_stream_map_add_child(struct json_stream *js, const char *key, const struct json_dump *jd_child);
+
+int jd_stream_list_start(struct json_stream *js);
+int jd_stream_list_end(struct json_stream *js);
+int jd_stream_list_add_string(struct json_stream *js, const char *value);
+int jd_stream_list_add_int(struct json_stream *js, int value);
+int jd_stream_list_add_int64(struct json_stream *js, int64_t value);
+int jd_stream_list_add_bool(struct json_stream *js, int value);
+int jd_stream_list_add_null(struct json_stream *js);
+int jd_stream_list_add_fmt(struct json_stream *js, const char *format, ...);
+int jd_stream_list_add_child(struct json_stream *js, const struct json_dump *jd_child);
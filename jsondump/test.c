@@ -7,6 +7,8 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "jsondump.h"
 
@@ -15,7 +17,11 @@
 
 int main(void)
 {
-    struct json_dump *jd, *jd1;
+    struct json_dump *jd, *jd1, *jd2;
+    struct json_stream *js;
+    FILE *fp;
+    char *stream_buf = NULL;
+    size_t stream_len = 0;
 
     /* flat map with all inds of values */
     jd = jd_create(0);
@@ -98,5 +104,99 @@ int main(void)
 
     jd_destroy(jd);
 
+    /* list of maps, reusing one child, with a string that needs
+       escaping formatted in place */
+    jd = jd_create(0);
+    CHECK_NULL(jd);
+    jd1 = jd_create(0);
+    CHECK_NULL(jd1);
+
+    CHECK_RC(jd_list_start(jd));
+    for(int i = 0; i < 3; i++) {
+        jd_reset(jd1);
+        CHECK_RC(jd_map_start(jd1));
+        CHECK_RC(jd_map_add_int(jd1, "i", i));
+        CHECK_RC(jd_map_add_fmt(jd1, "quote", "\"%d\"\t", i));
+        CHECK_RC(jd_list_add_child(jd, jd1));
+    }
+
+    printf("%s\n", jd->buf);
+
+    jd_destroy(jd);
+    jd_destroy(jd1);
+
+    /* streamed list of maps with nested lists, using a tiny buffer
+       to exercise flushing. It must match the same document built in
+       memory byte for byte. */
+    fp = open_memstream(&stream_buf, &stream_len);
+    CHECK_NULL(fp);
+    js = jd_stream_create(fp, 16);
+    CHECK_NULL(js);
+
+    CHECK_RC(jd_stream_list_start(js));
+    for(int i = 0; i < 3; i++) {
+        CHECK_RC(jd_stream_map_start(js));
+        CHECK_RC(jd_stream_map_add_fmt(js, "name", "pkg-%d", i));
+        CHECK_RC(jd_stream_map_add_string(js, "text", "a \"quoted\"\tvalue that is longer than the buffer"));
+        CHECK_RC(jd_stream_map_add_int(js, "size", i * 1000));
+        CHECK_RC(jd_stream_map_add_bool(js, "odd", i & 1));
+        CHECK_RC(jd_stream_map_add_null(js, "nothing"));
+        CHECK_RC(jd_stream_map_key(js, "files"));
+        CHECK_RC(jd_stream_list_start(js));
+        for(int j = 0; j < i; j++) {
+            CHECK_RC(jd_stream_list_add_fmt(js, "/usr/lib/%d", j));
+        }
+        CHECK_RC(jd_stream_list_end(js));
+        CHECK_RC(jd_stream_map_end(js));
+    }
+    CHECK_RC(jd_stream_list_end(js));
+    CHECK_RC(jd_stream_flush(js));
+    fflush(fp);
+
+    printf("%s\n", stream_buf);
+
+    jd = jd_create(0);
+    CHECK_NULL(jd);
+    jd1 = jd_create(0);
+    CHECK_NULL(jd1);
+    jd2 = jd_create(0);
+    CHECK_NULL(jd2);
+
+    CHECK_RC(jd_list_start(jd));
+    for(int i = 0; i < 3; i++) {
+        jd_reset(jd1);
+        CHECK_RC(jd_map_start(jd1));
+        CHECK_RC(jd_map_add_fmt(jd1, "name", "pkg-%d", i));
+        CHECK_RC(jd_map_add_string(jd1, "text", "a \"quoted\"\tvalue that is longer than the buffer"));
+        CHECK_RC(jd_map_add_int(jd1, "size", i * 1000));
+        CHECK_RC(jd_map_add_bool(jd1, "odd", i & 1));
+        CHECK_RC(jd_map_add_null(jd1, "nothing"));
+        jd_reset(jd2);
+        CHECK_RC(jd_list_start(jd2));
+        for(int j = 0; j < i; j++) {
+            CHECK_RC(jd_list_add_fmt(jd2, "/usr/lib/%d", j));
+        }
+        CHECK_RC(jd_map_add_child(jd1, "files", jd2));
+        CHECK_RC(jd_list_add_child(jd, jd1));
+    }
+
+    if (stream_len != strlen(jd->buf) || strcmp(stream_buf, jd->buf)) {
+        fprintf(stderr, "FAIL: streamed document differs from built one in line %d:\n%s\n", __LINE__, jd->buf);
+    }
+
+    jd_destroy(jd);
+    jd_destroy(jd1);
+    jd_destroy(jd2);
+
+    /* a value without a key in a map is an error */
+    CHECK_RC(jd_stream_map_start(js));
+    if (jd_stream_list_add_int(js, 1) == 0 || jd_stream_flush(js) == 0) {
+        fprintf(stderr, "FAIL: no error for value without key in line %d\n", __LINE__);
+    }
+
+    jd_stream_destroy(js);
+    fclose(fp);
+    free(stream_buf);
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,31 @@
+#
+# tdnf-test-cleanreq-cycle1 spec file
+#
+Summary:    basic install test file.
+Name:       tdnf-test-cleanreq-cycle1
+Version:    1.0.1
+Release:    1
+Vendor:     VMware, Inc.
+Distribution:   Photon
+License:    VMware
+Url:        http://www.vmware.com
+Group:      Applications/tdnftest
+Requires:   tdnf-test-cleanreq-cycle2
+
+%description
+Part of tdnf test spec. Auto installed packages in a dependency cycle.
+
+%prep
+
+%build
+
+%install
+mkdir -p %_topdir/%buildroot/lib/cleanreq/
+touch %_topdir/%buildroot/lib/cleanreq/%name
+
+%files
+/lib/cleanreq/%name
+
+%changelog
+*   Sat Oct 17 2026 Tdnf Test <tdnftest@tdnf.test> 1.0.1-1
+-   clean req cycle test
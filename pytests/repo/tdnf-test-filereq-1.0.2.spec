@@ -0,0 +1,30 @@
+#
+# tdnf-test-filereq spec file version 1.0.2
+#
+Summary:    file requires upgrade test
+Name:       tdnf-test-filereq
+Version:    1.0.2
+Release:    1
+Vendor:     VMware, Inc.
+Distribution:   Photon
+License:    VMware
+Url:        http://www.vmware.com
+Group:      Applications/tdnftest
+Requires:   /usr/share/tdnf-test-filereq/data
+BuildArch:  noarch
+
+%description
+Part of tdnf test spec. The newer version requires a file that is only
+listed in filelists.xml, not in primary.xml.
+
+%prep
+
+%build
+
+%install
+
+%files
+
+%changelog
+*   Sat Oct 17 2026 Tdnf Test <tdnftest@tdnf.test> 1.0.2-1
+-   file requires upgrade test
@@ -0,0 +1,32 @@
+#
+# tdnf-test-filereq-provider spec file
+#
+Summary:    file requires upgrade test
+Name:       tdnf-test-filereq-provider
+Version:    1.0.1
+Release:    1
+Vendor:     VMware, Inc.
+Distribution:   Photon
+License:    VMware
+Url:        http://www.vmware.com
+Group:      Applications/tdnftest
+BuildArch:  noarch
+
+%description
+Part of tdnf test spec. Provides a file outside of the paths listed in
+primary.xml.
+
+%prep
+
+%build
+
+%install
+mkdir -p %_topdir/%buildroot/usr/share/tdnf-test-filereq
+touch %_topdir/%buildroot/usr/share/tdnf-test-filereq/data
+
+%files
+/usr/share/tdnf-test-filereq/data
+
+%changelog
+*   Sat Oct 17 2026 Tdnf Test <tdnftest@tdnf.test> 1.0.1-1
+-   file requires upgrade test
@@ -23,9 +23,12 @@ def setup_test(utils):
 
 
 def teardown_test(utils):
+    utils.erase_package('tdnf-test-cleanreq-chain')
     utils.erase_package('tdnf-test-cleanreq-leaf1')
     utils.erase_package('tdnf-test-cleanreq-leaf2')
     utils.erase_package('tdnf-test-cleanreq-required')
+    utils.run(['tdnf', 'erase', '-y', 'tdnf-test-cleanreq-cycle',
+               'tdnf-test-cleanreq-cycle1', 'tdnf-test-cleanreq-cycle2'])
     shutil.rmtree(CONFDIR)
 
 
@@ -218,3 +221,45 @@ def test_autoremove_noargs2(utils):
     assert utils.check_package(pkgname)
     # also check that the required pkg is still there
     assert utils.check_package(pkgname_req)
+
+
+# chain pulls in leaf1, which pulls in required. Once chain is gone
+# both are unneeded, and should be removed in one go.
+def test_autoremove_noargs_chain(utils):
+    pkgname = 'tdnf-test-cleanreq-chain'
+    pkgname_leaf = 'tdnf-test-cleanreq-leaf1'
+    pkgname_req = 'tdnf-test-cleanreq-required'
+
+    utils.install_package(pkgname)
+    assert utils.check_package(pkgname_leaf)
+    assert utils.check_package(pkgname_req)
+
+    utils.run(['tdnf', '-y', 'remove', '--noautoremove', pkgname])
+    assert utils.check_package(pkgname_leaf)
+
+    utils.run(['tdnf', '-y', 'autoremove'])
+
+    # actual test - the whole chain should be gone
+    assert not utils.check_package(pkgname_leaf)
+    assert not utils.check_package(pkgname_req)
+
+
+# cycle pulls in cycle1 and cycle2, which require each other. Once
+# cycle is gone nothing else needs them, so both should be removed.
+def test_autoremove_noargs_cycle(utils):
+    pkgname = 'tdnf-test-cleanreq-cycle'
+    pkgnames_cycle = ['tdnf-test-cleanreq-cycle1', 'tdnf-test-cleanreq-cycle2']
+
+    utils.install_package(pkgname)
+    for pkgname_cycle in pkgnames_cycle:
+        assert utils.check_package(pkgname_cycle)
+
+    utils.run(['tdnf', '-y', 'remove', '--noautoremove', pkgname])
+    for pkgname_cycle in pkgnames_cycle:
+        assert utils.check_package(pkgname_cycle)
+
+    utils.run(['tdnf', '-y', 'autoremove'])
+
+    # actual test - the cycle should be gone
+    for pkgname_cycle in pkgnames_cycle:
+        assert not utils.check_package(pkgname_cycle)
@@ -8,6 +8,7 @@
 
 import os
 import fnmatch
+import glob
 import pytest
 import shutil
 
@@ -282,3 +283,129 @@ def test_makecache_setopt_cachedir_installroot(utils):
             found = True
     assert found
     shutil.rmtree(CACHEDIR)
+
+
+# the installed packages are cached in @System.solv and the cache
+# follows changes of the rpmdb
+def test_system_solv_cache(utils):
+    pkgname = utils.config["sglversion_pkgname"]
+    utils.erase_package(pkgname)
+
+    ret = utils.run(['tdnf', 'list', 'installed',
+                     f"--setopt=cachedir={CACHEDIR}"])
+    assert ret['retval'] == 0
+    assert os.path.isfile(os.path.join(CACHEDIR, 'solvcache', '@System.solv'))
+
+    utils.install_package(pkgname)
+    ret = utils.run(['tdnf', 'list', 'installed', pkgname,
+                     f"--setopt=cachedir={CACHEDIR}"])
+    assert ret['retval'] == 0
+    assert pkgname in "\n".join(ret['stdout'])
+    shutil.rmtree(CACHEDIR)
+
+
+# file lists are only parsed and cached when they are needed
+def test_filelists_loaded_on_demand(utils):
+    reponame = 'photon-test'
+    ret = utils.run(['tdnf', '--disablerepo=*', f"--enablerepo={reponame}",
+                     'makecache', f"--setopt=cachedir={CACHEDIR}"])
+    assert ret['retval'] == 0
+
+    cache_dir = None
+    for f in os.listdir(CACHEDIR):
+        if fnmatch.fnmatch(f, '{}-*'.format(reponame)):
+            cache_dir = os.path.join(CACHEDIR, f)
+    assert cache_dir is not None
+    filelists_cache = os.path.join(cache_dir, 'solvcache',
+                                   '{}-filelists.solvx'.format(reponame))
+    assert not os.path.isfile(filelists_cache)
+
+    ret = utils.run(['tdnf', '--disablerepo=*', f"--enablerepo={reponame}",
+                     'repoquery', '--list', 'tdnf-repoquery-provides',
+                     f"--setopt=cachedir={CACHEDIR}"])
+    assert ret['retval'] == 0
+    assert '/usr/lib/repoquery/tdnf-repoquery-provides' in '\n'.join(ret['stdout'])
+    assert os.path.isfile(filelists_cache)
+    shutil.rmtree(CACHEDIR)
+
+
+# the solv cache is used on the second run, verbose mode shows it
+def test_solv_cache_load_verbose(utils):
+    reponame = 'photon-test'
+    args = ['tdnf', '-v', '--disablerepo=*', f"--enablerepo={reponame}",
+            f"--setopt=cachedir={CACHEDIR}", 'list', 'available']
+
+    ret = utils.run(args)
+    assert ret['retval'] == 0
+    assert f"Loaded repo '{reponame}' from metadata" in "\n".join(ret['stdout'])
+
+    ret = utils.run(args)
+    assert ret['retval'] == 0
+    assert f"Loaded repo '{reponame}' from solv cache" in "\n".join(ret['stdout'])
+    shutil.rmtree(CACHEDIR)
+
+
+# a damaged metadata part in the cache is detected by its size and
+# downloaded again
+def test_damaged_repomd_part(utils):
+    reponame = 'photon-test'
+    args = ['tdnf', '--disablerepo=*', f"--enablerepo={reponame}",
+            f"--setopt=cachedir={CACHEDIR}"]
+
+    ret = utils.run(args + ['makecache'])
+    assert ret['retval'] == 0
+
+    cache_dir = None
+    for f in os.listdir(CACHEDIR):
+        if fnmatch.fnmatch(f, '{}-*'.format(reponame)):
+            cache_dir = os.path.join(CACHEDIR, f)
+    assert cache_dir is not None
+    primary = glob.glob(os.path.join(cache_dir, 'repodata', '*primary*'))
+    assert len(primary) == 1
+    with open(primary[0], 'ab') as f:
+        f.write(b'garbage')
+    shutil.rmtree(os.path.join(cache_dir, 'solvcache'))
+
+    ret = utils.run(args + ['list', utils.config["sglversion_pkgname"]])
+    assert ret['retval'] == 0
+    assert utils.config["sglversion_pkgname"] in "\n".join(ret['stdout'])
+    shutil.rmtree(CACHEDIR)
+
+
+# each metadata part has its own solv cache, a part that changed is
+# parsed again without touching the caches of the others
+def test_solv_cache_per_part(utils):
+    reponame = 'photon-test'
+    args = ['tdnf', '--disablerepo=*', f"--enablerepo={reponame}",
+            f"--setopt=cachedir={CACHEDIR}", 'updateinfo', '--list']
+
+    ret = utils.run(args)
+    assert ret['retval'] == 0
+    updates = ret['stdout']
+
+    cache_dir = None
+    for f in os.listdir(CACHEDIR):
+        if fnmatch.fnmatch(f, '{}-*'.format(reponame)):
+            cache_dir = os.path.join(CACHEDIR, f)
+    assert cache_dir is not None
+    solv_dir = os.path.join(cache_dir, 'solvcache')
+    primary_cache = os.path.join(solv_dir, '{}.solv'.format(reponame))
+    updateinfo_cache = os.path.join(solv_dir, '{}-updateinfo.solvx'.format(reponame))
+    assert os.path.isfile(primary_cache)
+    assert os.path.isfile(updateinfo_cache)
+
+    st = os.stat(primary_cache)
+    os.remove(updateinfo_cache)
+
+    ret = utils.run(args)
+    assert ret['retval'] == 0
+    assert ret['stdout'] == updates
+    assert os.path.isfile(updateinfo_cache)
+    st_new = os.stat(primary_cache)
+    assert (st.st_ino, st.st_mtime_ns) == (st_new.st_ino, st_new.st_mtime_ns)
+
+    # patches from the updateinfo cache
+    ret = utils.run(args)
+    assert ret['retval'] == 0
+    assert ret['stdout'] == updates
+    shutil.rmtree(CACHEDIR)
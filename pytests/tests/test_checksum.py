@@ -23,7 +23,7 @@ def setup_test(utils):
 
 
 def teardown_test(utils):
-    utils.run(['tdnf', 'erase', '-y', 'tdnf-test-one'])
+    utils.run(['tdnf', 'erase', '-y', 'tdnf-test-one', 'tdnf-test-two'])
     if os.path.isdir(WORKDIR):
         shutil.rmtree(WORKDIR)
 
@@ -65,6 +65,66 @@ def test_install_package_with_sha512_checksum(utils):
     assert ret['retval'] == 0
 
 
+# more than one package is downloaded in parallel, with the checksums
+# verified while downloading
+def test_install_packages_parallel_sha512_checksum(utils):
+    utils.run(['tdnf', 'erase', '-y', 'tdnf-test-one', 'tdnf-test-two'])
+    utils.run(['tdnf', 'clean', 'packages', '--enablerepo=photon-test-sha512'])
+
+    ret = utils.run(['tdnf', '-y', '--nogpgcheck', 'install',
+                     'tdnf-test-one', 'tdnf-test-two',
+                     '--disablerepo=*', '--enablerepo=photon-test-sha512'])
+    assert ret['retval'] == 0
+    assert utils.check_package('tdnf-test-one')
+    assert utils.check_package('tdnf-test-two')
+
+    ret = utils.run(['tdnf', 'erase', '-y', 'tdnf-test-one', 'tdnf-test-two'])
+    assert ret['retval'] == 0
+
+
+# damage a package in the published repo, and download it in parallel
+# with another one. The download must be rejected while it is written.
+def install_parallel_damaged(utils, damage):
+    rpm_dir = os.path.join(utils.config['repo_path'], 'photon-test-sha512', 'RPMS', ARCH)
+    rpm_path = glob.glob(os.path.join(rpm_dir, 'tdnf-test-two*.rpm'))[0]
+    backup_path = os.path.join(WORKDIR, os.path.basename(rpm_path))
+    utils.makedirs(WORKDIR)
+    shutil.copy2(rpm_path, backup_path)
+
+    utils.run(['tdnf', 'erase', '-y', 'tdnf-test-one', 'tdnf-test-two'])
+    utils.run(['tdnf', 'clean', 'packages', '--enablerepo=photon-test-sha512'])
+    try:
+        damage(rpm_path)
+        ret = utils.run(['tdnf', '-y', '--nogpgcheck', 'install',
+                         'tdnf-test-one', 'tdnf-test-two',
+                         '--disablerepo=*', '--enablerepo=photon-test-sha512'])
+    finally:
+        shutil.copy2(backup_path, rpm_path)
+    assert not utils.check_package('tdnf-test-one')
+    assert not utils.check_package('tdnf-test-two')
+    return ret
+
+
+def test_install_packages_parallel_corrupt(utils):
+    def damage(path):
+        size = os.path.getsize(path)
+        with open(path, 'r+b') as f:
+            f.seek(size // 2)
+            f.write(b'\0' * 16)
+
+    ret = install_parallel_damaged(utils, damage)
+    assert ret['retval'] == 1528
+
+
+def test_install_packages_parallel_oversized(utils):
+    def damage(path):
+        with open(path, 'ab') as f:
+            f.write(b'\0' * 4096)
+
+    ret = install_parallel_damaged(utils, damage)
+    assert ret['retval'] == 1527
+
+
 # install package with incorrect SHA512
 def test_install_package_with_incorrect_sha512_checksum(utils):
     workdir = WORKDIR
@@ -56,6 +56,21 @@ def test_install_package_without_version_suffix(utils):
     assert not utils.check_package(pkgname)
 
 
+# a glob matches the names of excluded packages (negative test)
+def test_install_package_with_glob(utils):
+    pkgname = utils.config["mulversion_pkgname"]
+    utils.erase_package(pkgname)
+
+    ret = utils.run(['tdnf', 'install', '--exclude=' + pkgname[:-1] + '*', '-y', '--nogpgcheck', pkgname])
+    assert ret['retval'] != 0
+    assert not utils.check_package(pkgname)
+
+    # the same install works without the exclude
+    ret = utils.run(['tdnf', 'install', '-y', '--nogpgcheck', pkgname])
+    assert ret['retval'] == 0
+    assert utils.check_package(pkgname)
+
+
 # excluded dependency (negative test)
 def test_install_package_with_excluded_dependency(utils):
     pkgname = utils.config["requiring_package"]
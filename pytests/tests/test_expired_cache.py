@@ -7,6 +7,7 @@
 #
 #   Author: Oliver Kurth <okurth@vmware.com>
 
+import glob
 import os
 import pytest
 import time
@@ -53,6 +54,24 @@ def test_cached_expired(utils):
     assert "Refreshing metadata" in "\n".join(ret['stdout'])
 
 
+# an expired repo with an unchanged repomd.xml keeps its cached parts
+def test_cached_expired_keeps_parts(utils):
+    expire = 10
+    repoconf = os.path.join(utils.config['repo_path'], "yum.repos.d", REPOFILENAME)
+    generate_repofile_expire(utils, repoconf, REPOID, expire)
+
+    utils.run(['tdnf', '--repoid={}'.format(REPOID), 'makecache'])
+    cache_dir = utils.tdnf_config.get('main', 'cachedir')
+    parts = glob.glob(os.path.join(cache_dir, '{}-*'.format(REPOID), 'repodata', '*primary*'))
+    assert len(parts) == 1
+    before = os.stat(parts[0]).st_ino
+
+    time.sleep(expire + 2)
+    ret = utils.run(['tdnf', '--repoid={}'.format(REPOID), 'list'])
+    assert "Refreshing metadata" in "\n".join(ret['stdout'])
+    assert os.stat(parts[0]).st_ino == before
+
+
 def test_cached_not_expired(utils):
     expire = 86400
     repoconf = os.path.join(utils.config['repo_path'], "yum.repos.d", REPOFILENAME)
@@ -8,6 +8,10 @@
 
 import pytest
 import os
+import sqlite3
+
+
+HISTORY_DB = '/var/lib/tdnf/history.db'
 
 
 @pytest.fixture(scope='function', autouse=True)
@@ -250,6 +254,22 @@ def test_history_redo_and_autoinstall(utils):
     assert pkgname_req not in "\n".join(ret['stdout'])
 
 
+def test_history_db_schema(utils):
+    ret = utils.run(['tdnf', 'history'])
+    assert ret['retval'] == 0
+
+    db = sqlite3.connect(HISTORY_DB)
+    try:
+        assert db.execute('PRAGMA user_version').fetchone()[0] >= 1
+        # a WAL db cannot be read by users without write access to its dir
+        assert db.execute('PRAGMA journal_mode').fetchone()[0] == 'delete'
+        indexes = [r[0] for r in db.execute("SELECT name FROM sqlite_master WHERE type='index'")]
+    finally:
+        db.close()
+    for index in ['rpms_nevra', 'names_name', 'trans_items_trans_id', 'flag_set_name_id_trans_id']:
+        assert index in indexes
+
+
 def test_history_memcheck(utils):
     ret = utils.run_memcheck(['tdnf', 'history'])
     assert ret['retval'] == 0
@@ -286,3 +306,34 @@ def test_history_pubkey_added(utils):
 
     ret = utils.run(['tdnf', 'history', '-y', 'rollback', '--to', baseline])
     assert ret['retval'] == 0
+
+
+# keep this last, it removes older history
+def test_history_compact(utils):
+    pkgname = utils.config["mulversion_pkgname"]
+
+    utils.erase_package(pkgname)
+    ret = utils.run(['tdnf', 'history'])
+    baseline = ret['stdout'][-1].split()[0]
+
+    utils.install_package(pkgname)
+    ret = utils.run(['tdnf', 'history'])
+    trans_id = ret['stdout'][-1].split()[0]
+
+    ret = utils.run(['tdnf', 'history', 'compact', trans_id])
+    assert ret['retval'] == 0
+
+    ret = utils.run(['tdnf', 'history'])
+    assert ret['retval'] == 0
+    assert ret['stdout'][1].split()[0] == trans_id
+
+    # older states are gone ...
+    ret = utils.run(['tdnf', 'history', '-y', 'rollback', '--to', baseline])
+    assert ret['retval'] != 0
+    assert utils.check_package(pkgname)
+
+    # ... but the compacted state can still be restored
+    utils.erase_package(pkgname)
+    ret = utils.run(['tdnf', 'history', '-y', 'rollback', '--to', trans_id])
+    assert ret['retval'] == 0
+    assert utils.check_package(pkgname)
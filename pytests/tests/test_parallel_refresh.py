@@ -0,0 +1,61 @@
+#
+# Copyright (C) 2023 VMware, Inc. All Rights Reserved.
+#
+# Licensed under the GNU General Public License v2 (the "License");
+# you may not use this file except in compliance with the License. The terms
+# of the License are located in the COPYING file of this distribution.
+#
+
+import os
+import pytest
+
+REPOFILENAME = 'parallel-refresh.repo'
+GOODREPO = 'parallel-good'
+BADREPO = 'parallel-bad'
+
+
+@pytest.fixture(scope='function', autouse=True)
+def setup_test(utils):
+    filename = os.path.join(utils.config['repo_path'], "yum.repos.d", REPOFILENAME)
+    utils.create_repoconf(filename, "http://localhost:8080/photon-test", GOODREPO)
+    with open(filename, "a") as f:
+        f.write("""
+[{name}]
+name=Broken Repo
+baseurl=http://localhost:8080/doesntexist
+enabled=1
+gpgcheck=0
+skip_if_unavailable=1
+""".format(name=BADREPO))
+    utils.edit_config({'max_parallel_downloads': '4'})
+    yield
+    teardown_test(utils)
+
+
+def teardown_test(utils):
+    utils.edit_config({'max_parallel_downloads': None})
+    filename = os.path.join(utils.config['repo_path'], "yum.repos.d", REPOFILENAME)
+    if os.path.isfile(filename):
+        os.remove(filename)
+
+
+def enable_args(*repos):
+    return ['--disablerepo=*'] + ['--enablerepo={}'.format(r) for r in repos]
+
+
+# a broken repo does not stop the others from being refreshed
+def test_refresh_skip_unavailable(utils):
+    ret = utils.run(['tdnf'] + enable_args(GOODREPO, BADREPO) + ['makecache'])
+    assert ret['retval'] == 0
+    assert "Disabling Repo: 'Broken Repo'" in "\n".join(ret['stdout'])
+
+    ret = utils.run(['tdnf'] + enable_args(GOODREPO, BADREPO) +
+                    ['list', utils.config["mulversion_pkgname"]])
+    assert ret['retval'] == 0
+
+
+def test_refresh_unavailable_fails(utils):
+    utils.edit_config({'skip_if_unavailable': '0'}, section=BADREPO,
+                      filename=os.path.join(utils.config['repo_path'], "yum.repos.d", REPOFILENAME))
+    ret = utils.run(['tdnf'] + enable_args(GOODREPO, BADREPO) + ['makecache'])
+    assert ret['retval'] != 0
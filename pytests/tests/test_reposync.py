@@ -152,6 +152,8 @@ def test_reposync_download_path_norepopath(utils):
     assert os.path.isdir(downloaddir)
 
     check_synced_repo(utils, reponame, downloaddir)
+    # repos share the directory, so the journal is named by repo
+    assert os.path.isfile(os.path.join(downloaddir, '.reposync-state-' + reponame))
 
 
 # reposync excluding the repo name and delete option is incompatible
@@ -249,6 +251,11 @@ def test_reposync_delete(utils):
     # file should be gone
     assert not os.path.isfile(faked_rpm)
 
+    # no marker files should be left behind
+    for root, dirs, files in os.walk(synced_dir):
+        for f in files:
+            assert not f.endswith('.reposync-keep')
+
     shutil.rmtree(synced_dir)
 
 
@@ -282,6 +289,52 @@ def test_reposync_no_delete(utils):
     shutil.rmtree(synced_dir)
 
 
+# a second sync keeps good files, and replaces damaged ones
+def test_reposync_resync(utils):
+    reponame = TESTREPO
+    workdir = WORKDIR
+    utils.makedirs(workdir)
+
+    cmd = ['tdnf',
+           '--disablerepo=*', '--enablerepo={}'.format(reponame),
+           'reposync']
+    ret = utils.run(cmd, cwd=workdir)
+    assert ret['retval'] == 0
+    synced_dir = os.path.join(workdir, reponame)
+    check_synced_repo(utils, reponame, synced_dir)
+    assert os.path.isfile(os.path.join(synced_dir, '.reposync-state-' + reponame))
+
+    rpm_dir = os.path.join(synced_dir, 'RPMS', ARCH)
+    rpms = sorted(f for f in os.listdir(rpm_dir) if f.endswith('.rpm'))
+    assert len(rpms) > 1
+
+    kept_rpm = os.path.join(rpm_dir, rpms[0])
+    kept_mtime = os.stat(kept_rpm).st_mtime_ns
+
+    # same size, different content
+    damaged_rpm = os.path.join(rpm_dir, rpms[1])
+    size = os.path.getsize(damaged_rpm)
+    with open(damaged_rpm, 'r+b') as f:
+        f.seek(size // 2)
+        f.write(b'\0' * 16)
+    truncated_rpm = os.path.join(rpm_dir, rpms[-1])
+    with open(truncated_rpm, 'r+b') as f:
+        f.truncate(16)
+
+    ret = utils.run(cmd, cwd=workdir)
+    assert ret['retval'] == 0
+    check_synced_repo(utils, reponame, synced_dir)
+
+    local_dir = os.path.join(utils.config['repo_path'], reponame, 'RPMS', ARCH)
+    for rpm in [rpms[1], rpms[-1]]:
+        with open(os.path.join(rpm_dir, rpm), 'rb') as f1:
+            with open(os.path.join(local_dir, rpm), 'rb') as f2:
+                assert f1.read() == f2.read()
+    assert os.stat(kept_rpm).st_mtime_ns == kept_mtime
+
+    shutil.rmtree(synced_dir)
+
+
 # reposync with gpgcheck
 def test_reposync_gpgcheck(utils):
     reponame = TESTREPO
@@ -6,7 +6,13 @@
 # of the License are located in the COPYING file of this distribution.
 #
 
+import os
+import glob
 import pytest
+import shutil
+
+
+CACHEDIR = '/root/cache-search'
 
 
 @pytest.fixture(scope='module', autouse=True)
@@ -16,7 +22,8 @@ def setup_test(utils):
 
 
 def teardown_test(utils):
-    pass
+    if os.path.isdir(CACHEDIR):
+        shutil.rmtree(CACHEDIR)
 
 
 def test_search_no_arg(utils):
@@ -37,3 +44,33 @@ def test_search_single(utils):
 def test_search_multiple(utils):
     ret = utils.run(['tdnf', 'search', 'tdnf', 'wget', 'gzip'])
     assert ret['retval'] == 0
+
+
+def search_names(ret):
+    return [line.split(' : ')[0] for line in ret['stdout']]
+
+
+def test_search_index(utils):
+    args = ['tdnf', '--disablerepo=*', '--enablerepo=photon-test',
+            f"--setopt=cachedir={CACHEDIR}", 'search']
+    # only in the description of tdnf-test-filereq, in another case. The
+    # description of tdnf-test-filereq-provider has most of its trigrams
+    # but not all of them.
+    term = 'LISTED IN FILELISTS'
+
+    ret = utils.run(args + [term])
+    assert ret['retval'] == 0
+    names = search_names(ret)
+    assert 'tdnf-test-filereq' in names
+    assert 'tdnf-test-filereq-provider' not in names
+
+    indexes = glob.glob(os.path.join(CACHEDIR, 'photon-test-*', 'solvcache', 'photon-test-search.idx'))
+    assert len(indexes) == 1
+
+    # without the index the search must give the same result,
+    # and the index is created again
+    os.remove(indexes[0])
+    ret_noidx = utils.run(args + [term])
+    assert ret_noidx['retval'] == 0
+    assert ret_noidx['stdout'] == ret['stdout']
+    assert os.path.isfile(indexes[0])
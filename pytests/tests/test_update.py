@@ -19,6 +19,7 @@ def teardown_test(utils):
     mpkg = utils.config["mulversion_pkgname"]
     spkg = utils.config["sglversion_pkgname"]
     utils.run(['tdnf', 'erase', '-y', spkg, mpkg])
+    utils.run(['tdnf', 'erase', '-y', 'tdnf-test-filereq', 'tdnf-test-filereq-provider'])
 
 
 def test_update_invalid_arg(utils):
@@ -51,3 +52,17 @@ def test_update_multi_version_package(utils):
     # Verify that it cannot be further upgraded
     ret = utils.run(['tdnf', 'update', '-y', mpkg])
     assert ret['stderr'][0] == 'Nothing to do.'
+
+
+# the newer version requires a file that is only in filelists.xml, the
+# upgrade must not be kept back because primary.xml does not list it
+@pytest.mark.parametrize('args', [['tdnf-test-filereq'], []])
+def test_update_file_requires_from_filelists(utils, args):
+    pkgname = 'tdnf-test-filereq'
+    utils.run(['tdnf', 'erase', '-y', pkgname, pkgname + '-provider'])
+    utils.install_package(pkgname, '1.0.1')
+
+    ret = utils.run(['tdnf', 'update', '-y', '--nogpgcheck'] + args)
+    assert ret['retval'] == 0
+    assert utils.check_package(pkgname, version='1.0.2-1')
+    assert utils.check_package(pkgname + '-provider')
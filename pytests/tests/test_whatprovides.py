@@ -6,7 +6,13 @@
 # of the License are located in the COPYING file of this distribution.
 #
 
+import os
+import glob
 import pytest
+import shutil
+
+
+CACHEDIR = '/root/cache-whatprovides'
 
 
 @pytest.fixture(scope='module', autouse=True)
@@ -16,7 +22,8 @@ def setup_test(utils):
 
 
 def teardown_test(utils):
-    pass
+    if os.path.isdir(CACHEDIR):
+        shutil.rmtree(CACHEDIR)
 
 
 def test_whatprovides_no_arg(utils):
@@ -40,3 +47,31 @@ def test_whatprovides_valid_file_installed(utils):
     ret = utils.run(['tdnf', 'whatprovides', '/lib/systemd/system/tdnf-test-one.service'])
     assert 'tdnf-test-one' in "\n".join(ret['stdout'])
     assert ret['retval'] == 0
+
+
+def test_whatprovides_file_index(utils):
+    args = ['tdnf', '--disablerepo=*', '--enablerepo=photon-test',
+            f"--setopt=cachedir={CACHEDIR}", 'whatprovides']
+    # not in primary.xml, and the unit files of several packages
+    pattern = '/lib/systemd/system/tdnf-*.service'
+    pkgnames = ['tdnf-test-one', 'tdnf-test-noarch', 'tdnf-missing-dep', 'tdnf-verbose-scripts']
+
+    ret = utils.run(args + [pattern])
+    assert ret['retval'] == 0
+    for pkgname in pkgnames:
+        assert pkgname in "\n".join(ret['stdout'])
+
+    indexes = glob.glob(os.path.join(CACHEDIR, 'photon-test-*', 'solvcache', 'photon-test-files.idx'))
+    assert len(indexes) == 1
+
+    # a path in no package is not in the index either
+    ret_none = utils.run(args + ['/lib/systemd/system/tdnf-no-such-package.service'])
+    assert ret_none['stderr'][0] == 'No data available'
+
+    # without the index the result must be the same,
+    # and the index is created again
+    os.remove(indexes[0])
+    ret_noidx = utils.run(args + [pattern])
+    assert ret_noidx['retval'] == 0
+    assert ret_noidx['stdout'] == ret['stdout']
+    assert os.path.isfile(indexes[0])
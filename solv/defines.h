@@ -3,7 +3,9 @@
 
 #define SYSTEM_REPO_NAME "@System"
 #define CMDLINE_REPO_NAME "@cmdline"
-#define SOLV_COOKIE_IDENT "tdnf"
+/* part of every cookie, change it when the layout of the solv caches
+   changes so that old caches are not used */
+#define SOLV_COOKIE_IDENT "tdnf-parts"
 #define TDNF_SOLVCACHE_DIR_NAME "solvcache"
 #define SOLV_COOKIE_LEN   32
 
@@ -15,12 +15,44 @@ extern "C" {
 #define TDNF_ID_DEPENDS "tdnf:depends"
 #define TDNF_ID_REQUIRES_PRE "tdnf:requires-pre"
 
+/*
+ * Solvables by their own names, or by the names in one type of their
+ * dependencies. The
+ * solvables of name id n are pSolvables[pOffsets[n]] up to
+ * pSolvables[pOffsets[n + 1]].
+ */
+typedef struct _SolvNameIndex
+{
+    Id          *pOffsets;
+    Id          *pSolvables;
+    int         nNames;
+    /* pool->nsolvables it was built for, 0 if not built */
+    int         nSolvables;
+} SolvNameIndex;
+
 typedef struct _SolvSack
 {
     Pool*       pPool;
     uint32_t    dwNumOfCommandPkgs;
     char*       pszCacheDir;
     char*       pszRootDir;
+    /* set when solvables were added since the provides index was
+       last built, see SolvFinalizeSack() */
+    int         nProvidesDirty;
+    /* set when a file dependency had no provider in primary.xml, see
+       SolvLoadMissingFileProvides() */
+    int         nFileProvidesMissing;
+    /* updateinfo collection entries as (name, arch, evr, advisory)
+       sorted by name, built on first use for pool->nsolvables
+       solvables, see SolvGetUpdateAdvisories() */
+    Queue       queueAdvisoryIndex;
+    int         nAdvisoryIndexSolvables;
+    /* indexed by REPOQUERY_WHAT_KEY, built on first use and dropped
+       with the provides index, see SolvApplyDepsFilter() */
+    SolvNameIndex depIndex[REPOQUERY_WHAT_KEY_DEPENDS];
+    /* solvables by name, same lifetime as depIndex, see
+       SolvFindSolvablesByName() */
+    SolvNameIndex nameIndex;
 } SolvSack, *PSolvSack;
 
 typedef struct _SolvQuery
@@ -41,12 +73,39 @@ typedef struct _SolvPackageList
     Queue       queuePackages;
 } SolvPackageList, *PSolvPackageList;
 
+/* repo metadata that is kept out of the main solv cache in a solv file
+   of its own, see SolvLoadRepoMetaDataExt(). Updateinfo is loaded with the
+   repo, the others only when needed. */
+typedef enum
+{
+    SOLV_EXT_FILELISTS,
+    SOLV_EXT_OTHER,
+    SOLV_EXT_UPDATEINFO,
+    SOLV_EXT_COUNT
+} SOLV_EXT_TYPE;
+
 typedef struct _SOLV_REPO_INFO_INTERNAL_
 {
     Repo*         pRepo;
+    /* cookie of the main cache, which only holds primary */
     unsigned char cookie[SOLV_COOKIE_LEN];
     int           nCookieSet;
     char          *pszRepoCacheDir;
+    /* metadata files of the extensions, the cookies of their caches
+       and whether they were loaded */
+    char          *ppszExtMetaData[SOLV_EXT_COUNT];
+    unsigned char ppExtCookie[SOLV_EXT_COUNT][SOLV_COOKIE_LEN];
+    int           nExtLoaded[SOLV_EXT_COUNT];
+    /* end of the primary solvables, patches from updateinfo follow */
+    Id            nPrimaryEnd;
+    /* mapped search index, see SolvSearchRepo() */
+    void          *pSearchIndex;
+    size_t        nSearchIndexSize;
+    int           nSearchIndexLoaded;
+    /* mapped file index, see SolvFindFileProviders() */
+    void          *pFileIndex;
+    size_t        nFileIndexSize;
+    int           nFileIndexLoaded;
 }SOLV_REPO_INFO_INTERNAL, *PSOLV_REPO_INFO_INTERNAL;
 
 extern Id allDepKeyIds[];
@@ -324,13 +383,6 @@ SolvGetChangeLogFromId(
     PTDNF_PKG_CHANGELOG_ENTRY *ppEntries
     );
 
-uint32_t
-SolvIdIsOrphaned(
-    PSolvSack pSack,
-    Id p,
-    int *pnIsOrphan
-);
-
 uint32_t
 SolvGetAutoInstalledOrphans(
     PSolvSack pSack,
@@ -357,6 +409,24 @@ SolvInitSack(
     const char* pszRootDir
 );
 
+uint32_t
+SolvFinalizeSack(
+    PSolvSack pSack
+);
+
+uint32_t
+SolvLoadMissingFileProvides(
+    PSolvSack pSack,
+    int *pnLoaded
+);
+
+uint32_t
+SolvJobsNeedFileLists(
+    PSolvSack pSack,
+    Queue *pQueueJobs,
+    int *pnNeeded
+);
+
 // tdnfquery.c
 uint32_t
 SolvCreateQuery(
@@ -488,6 +558,19 @@ SolvApplyDepsFilter(
     char **ppszDeps,
     REPOQUERY_WHAT_KEY whatKey);
 
+void
+SolvFreeNameIndexes(
+    PSolvSack pSack
+    );
+
+uint32_t
+SolvFindSolvablesByName(
+    PSolvSack pSack,
+    const char *pszName,
+    int nSearchFlags,
+    Queue *pQueue
+    );
+
 uint32_t
 SolvApplyExtrasFilter(
     PSolvQuery pQuery);
@@ -537,8 +620,14 @@ SolvReadRpmsFromDirectory(
 
 uint32_t
 SolvReadInstalledRpms(
-    Repo* pRepo,
-    const char *pszCacheFileName
+    PSolvSack pSack,
+    const char *pszCacheDir
+);
+
+uint32_t
+SolvCalculateCookieForRpmDb(
+    Pool *pPool,
+    unsigned char *pszCookie
 );
 
 uint32_t
@@ -574,13 +663,13 @@ SolvReportProblems(
 
 uint32_t
 SolvAddExcludes(
-    Pool* pPool,
+    PSolvSack pSack,
     char** ppszExcludes
     );
 
 uint32_t
 SolvDataIterator(
-     Pool* pPool,
+     PSolvSack pSack,
      char** ppszExcludes,
      Map* pMap
      );
@@ -596,6 +685,14 @@ SolvCalculateCookieForFile(
     unsigned char* pszCookie
     );
 
+uint32_t
+SolvCalculateCookieForData(
+    const unsigned char* pszBaseCookie,
+    const unsigned char* pbData,
+    size_t nLen,
+    unsigned char* pszCookie
+    );
+
 uint32_t
 SolvCreateRepoCacheName(
     const char *pszName,
@@ -621,6 +718,29 @@ SolvCreateMetaDataCache(
     PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo
     );
 
+uint32_t
+SolvMapCacheFile(
+    const char *pszCacheFilePath,
+    const unsigned char *pszCookie,
+    void **ppMap,
+    size_t *pnSize
+    );
+
+uint32_t
+SolvCreateCacheTempFile(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo,
+    FILE **ppFile,
+    char **ppszTempFile
+    );
+
+uint32_t
+SolvAddSolvCacheFile(
+    Repo *pRepo,
+    const char *pszCacheFilePath,
+    const unsigned char *pszCookie,
+    int nFlags
+    );
+
 uint32_t
 SolvUseMetaDataCache(
     PSolvSack pSack,
@@ -628,6 +748,31 @@ SolvUseMetaDataCache(
     int       *nUseMetaDataCache
     );
 
+uint32_t
+SolvGetMetaDataExtCachePath(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo,
+    SOLV_EXT_TYPE nExt,
+    char** ppszCachePath
+    );
+
+uint32_t
+SolvLoadMetaDataExt(
+    PSolvSack pSack,
+    SOLV_EXT_TYPE nExt
+    );
+
+uint32_t
+SolvLoadRepoMetaDataExt(
+    PSolvSack pSack,
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo,
+    SOLV_EXT_TYPE nExt
+    );
+
+void
+SolvFreeRepoInfo(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo
+    );
+
 uint32_t
 SolvFindSolvablesByNevraStr(
     Pool *pool,
@@ -643,6 +788,33 @@ SolvRequiresFromQueue(
     Queue *pq_deps   /* string ids */
 );
 
+// tdnffileindex.c
+uint32_t
+SolvCreateFileIndex(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo
+    );
+
+uint32_t
+SolvFindFileProviders(
+    PSolvSack pSack,
+    const char *pszFile,
+    int nSearchFlags,
+    Queue *pQueueSolvables
+    );
+
+// tdnfsearch.c
+uint32_t
+SolvCreateSearchIndex(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo
+    );
+
+uint32_t
+SolvSearchRepo(
+    Repo *pRepo,
+    const char *pszTerm,
+    Queue *pQueueSel
+    );
+
 #ifdef __cplusplus
 }
 #endif
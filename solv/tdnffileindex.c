@@ -0,0 +1,729 @@
+/*
+ * Copyright (C) 2023 VMware, Inc. All Rights Reserved.
+ *
+ * Licensed under the GNU Lesser General Public License v2.1 (the "License");
+ * you may not use this file except in compliance with the License. The terms
+ * of the License are located in the COPYING file of this distribution.
+ */
+
+/*
+ * Index of the file lists of the primary solvables of a repo, kept
+ * next to its solv cache. It maps the hash of each file path, and of
+ * each directory that has files in it or below it (with a trailing
+ * '/'), to the solvables with that file or directory. An exact path
+ * is looked up without loading the file lists at all, a glob only
+ * needs to check the solvables with files below its fixed directory
+ * prefix.
+ *
+ * The file has a header, the start of each hash bucket in the entries,
+ * the entries sorted by bucket, hash and offset, and the cookie of the
+ * file lists cache. The low bits of the 64 bit FNV-1a hash of a path
+ * select its bucket. An entry holds the full hash, so exact paths are
+ * matched without the file lists, and the offset of its solvable from
+ * the start of the repo.
+ */
+
+#define _GNU_SOURCE 1
+#include "includes.h"
+
+#define FILE_INDEX_MAGIC     "tdnffix2"
+#define FILE_INDEX_MAGIC_LEN 8
+
+typedef struct _SOLV_FILE_INDEX_HEADER
+{
+    char     szMagic[FILE_INDEX_MAGIC_LEN];
+    uint32_t dwSolvables;
+    /* a power of two */
+    uint32_t dwBuckets;
+    uint32_t dwEntries;
+} SOLV_FILE_INDEX_HEADER, *PSOLV_FILE_INDEX_HEADER;
+
+typedef struct _SOLV_FILE_INDEX_ENTRY
+{
+    uint32_t dwHashLow;
+    uint32_t dwHashHigh;
+    uint32_t dwOffset;
+} SOLV_FILE_INDEX_ENTRY, *PSOLV_FILE_INDEX_ENTRY;
+
+static
+uint32_t
+_SolvGetFileIndexPath(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo,
+    char **ppszIndexPath
+    );
+
+static
+Id
+_SolvFileIndexEnd(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo
+    );
+
+static
+void
+_SolvLoadFileIndex(
+    PSolvSack pSack,
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo
+    );
+
+static
+uint64_t
+_SolvHashPath(
+    const char *pszPath,
+    size_t nLen
+    );
+
+static
+void
+_SolvAddFileHashes(
+    Queue *pQueueFiles,
+    Queue *pQueueDirs,
+    const char *pszPath,
+    Id nOffset
+    );
+
+static
+int
+_SolvCmpFileEntries(
+    const void *pEntry1,
+    const void *pEntry2,
+    void *pData
+    );
+
+static
+int
+_SolvCmpIds(
+    const void *pId1,
+    const void *pId2,
+    void *pData
+    );
+
+static
+uint32_t
+_SolvLookupFileIndex(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo,
+    uint64_t qwHash,
+    Queue *pQueueSolvables
+    );
+
+/*
+ * Write the file index of the primary solvables of a repo whose file
+ * lists were just loaded. It is bound to the file lists cache by its
+ * cookie.
+ */
+uint32_t
+SolvCreateFileIndex(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo
+    )
+{
+    uint32_t dwError = 0;
+    Repo *pRepo = NULL;
+    Dataiterator di;
+    int nDiInit = 0;
+    Queue queueEntries = {0};
+    Queue queueDirs = {0};
+    Id nEnd = 0;
+    Id nSolvId = 0;
+    int i = 0;
+    int nCount = 0;
+    uint32_t dwMask = 0;
+    uint32_t dwBucket = 0;
+    SOLV_FILE_INDEX_HEADER stHeader = {0};
+    uint32_t *pdwBuckets = NULL;
+    PSOLV_FILE_INDEX_ENTRY pEntries = NULL;
+    FILE *fp = NULL;
+    char *pszTempFile = NULL;
+    char *pszIndexPath = NULL;
+
+    if (!pSolvRepoInfo || !pSolvRepoInfo->pRepo ||
+        !pSolvRepoInfo->nCookieSet)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+    pRepo = pSolvRepoInfo->pRepo;
+    nEnd = _SolvFileIndexEnd(pSolvRepoInfo);
+
+    /* (low hash, high hash, offset) for each file and directory of
+       each solvable. The directories of a solvable are mostly the same
+       for all its files, so they are made unique before they are
+       added. */
+    queue_init(&queueEntries);
+    queue_init(&queueDirs);
+    dataiterator_init(&di, pRepo->pool, pRepo, 0, SOLVABLE_FILELIST, NULL,
+                      SEARCH_FILES | SEARCH_COMPLETE_FILELIST);
+    nDiInit = 1;
+    for (;;)
+    {
+        int nMore = dataiterator_step(&di);
+
+        if (!nMore || di.solvid != nSolvId)
+        {
+            solv_sort(queueDirs.elements, queueDirs.count / 3, 3 * sizeof(Id),
+                      _SolvCmpFileEntries, NULL);
+            for (i = 0; i < queueDirs.count; i += 3)
+            {
+                if (i == 0 ||
+                    _SolvCmpFileEntries(&queueDirs.elements[i],
+                                        &queueDirs.elements[i - 3], NULL))
+                {
+                    queue_insertn(&queueEntries, queueEntries.count, 3,
+                                  &queueDirs.elements[i]);
+                }
+            }
+            queue_empty(&queueDirs);
+            if (!nMore)
+            {
+                break;
+            }
+            nSolvId = di.solvid;
+        }
+        if (di.solvid < pRepo->start || di.solvid >= nEnd)
+        {
+            continue;
+        }
+        _SolvAddFileHashes(&queueEntries, &queueDirs, di.kv.str,
+                           di.solvid - pRepo->start);
+    }
+
+    nCount = queueEntries.count / 3;
+    for (stHeader.dwBuckets = 1;
+         stHeader.dwBuckets < (uint32_t)nCount / 4 &&
+         stHeader.dwBuckets < 0x40000000;
+         stHeader.dwBuckets <<= 1)
+        ;
+    dwMask = stHeader.dwBuckets - 1;
+    solv_sort(queueEntries.elements, nCount, 3 * sizeof(Id),
+              _SolvCmpFileEntries, &dwMask);
+
+    dwError = TDNFAllocateMemory(stHeader.dwBuckets + 1, sizeof(uint32_t),
+                                 (void **)&pdwBuckets);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFAllocateMemory(nCount + 1, sizeof(SOLV_FILE_INDEX_ENTRY),
+                                 (void **)&pEntries);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    /* the same file may be listed twice */
+    for (i = 0; i < nCount; i++)
+    {
+        Id *pEntry = &queueEntries.elements[3 * i];
+
+        if (i > 0 && !_SolvCmpFileEntries(pEntry, pEntry - 3, NULL))
+        {
+            continue;
+        }
+        dwBucket = (uint32_t)pEntry[0] & dwMask;
+        pdwBuckets[dwBucket + 1]++;
+        pEntries[stHeader.dwEntries].dwHashLow = pEntry[0];
+        pEntries[stHeader.dwEntries].dwHashHigh = pEntry[1];
+        pEntries[stHeader.dwEntries].dwOffset = pEntry[2];
+        stHeader.dwEntries++;
+    }
+    for (dwBucket = 0; dwBucket < stHeader.dwBuckets; dwBucket++)
+    {
+        pdwBuckets[dwBucket + 1] += pdwBuckets[dwBucket];
+    }
+
+    memcpy(stHeader.szMagic, FILE_INDEX_MAGIC, FILE_INDEX_MAGIC_LEN);
+    stHeader.dwSolvables = nEnd - pRepo->start;
+
+    dwError = _SolvGetFileIndexPath(pSolvRepoInfo, &pszIndexPath);
+    BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+
+    dwError = SolvCreateCacheTempFile(pSolvRepoInfo, &fp, &pszTempFile);
+    BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+
+    if (fwrite(&stHeader, sizeof(stHeader), 1, fp) != 1 ||
+        fwrite(pdwBuckets, sizeof(uint32_t), stHeader.dwBuckets + 1, fp) !=
+            stHeader.dwBuckets + 1 ||
+        fwrite(pEntries, sizeof(SOLV_FILE_INDEX_ENTRY),
+               stHeader.dwEntries, fp) != stHeader.dwEntries ||
+        fwrite(pSolvRepoInfo->ppExtCookie[SOLV_EXT_FILELISTS],
+               SOLV_COOKIE_LEN, 1, fp) != 1)
+    {
+        dwError = ERROR_TDNF_SOLV_IO;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+    if (fclose(fp))
+    {
+        fp = NULL;
+        dwError = ERROR_TDNF_SOLV_IO;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+    fp = NULL;
+
+    if (rename(pszTempFile, pszIndexPath) == -1)
+    {
+        dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+
+cleanup:
+    if (nDiInit)
+    {
+        dataiterator_free(&di);
+    }
+    queue_free(&queueEntries);
+    queue_free(&queueDirs);
+    TDNF_SAFE_FREE_MEMORY(pdwBuckets);
+    TDNF_SAFE_FREE_MEMORY(pEntries);
+    TDNF_SAFE_FREE_MEMORY(pszTempFile);
+    TDNF_SAFE_FREE_MEMORY(pszIndexPath);
+    return dwError;
+error:
+    if (fp)
+    {
+        fclose(fp);
+    }
+    if (pszTempFile)
+    {
+        unlink(pszTempFile);
+    }
+    goto cleanup;
+}
+
+/*
+ * Set pQueueSolvables to the solvables with a file matching pszFile,
+ * in the order a dataiterator over the pool has them. nSearchFlags is
+ * SEARCH_STRING or SEARCH_GLOB, optionally with SEARCH_NOCASE. Repos
+ * with a file index answer exact paths from it, and globs with a
+ * directory prefix from the solvables it lists under that directory.
+ * Other repos, and case insensitive lookups, search the file lists as
+ * before.
+ */
+uint32_t
+SolvFindFileProviders(
+    PSolvSack pSack,
+    const char *pszFile,
+    int nSearchFlags,
+    Queue *pQueueSolvables
+    )
+{
+    uint32_t dwError = 0;
+    Pool *pool = NULL; /* FOR_REPOS needs this name */
+    Repo *pRepo = NULL;
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo = NULL;
+    Queue queueCandidates = {0};
+    Dataiterator di;
+    const char *pszGlob = NULL;
+    size_t nPrefixLen = 0;
+    uint64_t qwHash = 0;
+    int nGlob = 0;
+    int nIndexed = 0;
+    int i = 0;
+    int j = 0;
+    Id p = 0;
+
+    if (!pSack || !pSack->pPool || IsNullOrEmptyString(pszFile) ||
+        !pQueueSolvables)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+    pool = pSack->pPool;
+    queue_init(&queueCandidates);
+    queue_empty(pQueueSolvables);
+
+    nGlob = (nSearchFlags & SEARCH_STRINGMASK) == SEARCH_GLOB;
+    if (nGlob)
+    {
+        /* the directory before the first wildcard, with its '/' */
+        pszGlob = strpbrk(pszFile, "[*?");
+        nPrefixLen = pszGlob ? (size_t)(pszGlob - pszFile) : strlen(pszFile);
+        while (nPrefixLen > 0 && pszFile[nPrefixLen - 1] != '/')
+        {
+            nPrefixLen--;
+        }
+    }
+    else
+    {
+        nPrefixLen = strlen(pszFile);
+        /* that would be a directory */
+        if (pszFile[nPrefixLen - 1] == '/')
+        {
+            nPrefixLen = 0;
+        }
+    }
+    qwHash = _SolvHashPath(pszFile, nPrefixLen);
+
+    FOR_REPOS(i, pRepo)
+    {
+        pSolvRepoInfo = pRepo->appdata;
+        nIndexed = 0;
+        /* "/" alone would make all solvables candidates */
+        if (pSolvRepoInfo && !(nSearchFlags & SEARCH_NOCASE) &&
+            nPrefixLen > 1)
+        {
+            _SolvLoadFileIndex(pSack, pSolvRepoInfo);
+            if (pSolvRepoInfo->pFileIndex &&
+                _SolvLookupFileIndex(pSolvRepoInfo, qwHash,
+                                     &queueCandidates) == 0)
+            {
+                nIndexed = 1;
+            }
+        }
+
+        if (nIndexed && !nGlob)
+        {
+            /* hash collisions can list a solvable twice */
+            solv_sort(queueCandidates.elements, queueCandidates.count,
+                      sizeof(Id), _SolvCmpIds, NULL);
+            for (j = 0; j < queueCandidates.count; j++)
+            {
+                if (j == 0 ||
+                    queueCandidates.elements[j] !=
+                        queueCandidates.elements[j - 1])
+                {
+                    queue_push(pQueueSolvables, queueCandidates.elements[j]);
+                }
+            }
+        }
+        else if (nIndexed)
+        {
+            solv_sort(queueCandidates.elements, queueCandidates.count,
+                      sizeof(Id), _SolvCmpIds, NULL);
+            if (queueCandidates.count)
+            {
+                dwError = SolvLoadRepoMetaDataExt(pSack, pSolvRepoInfo,
+                                                  SOLV_EXT_FILELISTS);
+                BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+            }
+            for (j = 0; j < queueCandidates.count; j++)
+            {
+                p = queueCandidates.elements[j];
+                if (j > 0 && p == queueCandidates.elements[j - 1])
+                {
+                    continue;
+                }
+                dataiterator_init(&di, pool, pRepo, p, SOLVABLE_FILELIST,
+                                  pszFile, SEARCH_FILES | nSearchFlags);
+                if (dataiterator_step(&di))
+                {
+                    queue_push(pQueueSolvables, p);
+                }
+                dataiterator_free(&di);
+            }
+        }
+        else
+        {
+            /* the installed and command line repos have their file
+               lists anyway */
+            if (pSolvRepoInfo)
+            {
+                dwError = SolvLoadRepoMetaDataExt(pSack, pSolvRepoInfo,
+                                                  SOLV_EXT_FILELISTS);
+                BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+            }
+
+            dataiterator_init(&di, pool, pRepo, 0, SOLVABLE_FILELIST,
+                              pszFile, SEARCH_FILES | nSearchFlags);
+            while (dataiterator_step(&di))
+            {
+                queue_push(pQueueSolvables, di.solvid);
+                dataiterator_skip_solvable(&di);
+            }
+            dataiterator_free(&di);
+        }
+    }
+
+cleanup:
+    queue_free(&queueCandidates);
+    return dwError;
+error:
+    if (pQueueSolvables)
+    {
+        queue_empty(pQueueSolvables);
+    }
+    goto cleanup;
+}
+
+static
+uint32_t
+_SolvGetFileIndexPath(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo,
+    char **ppszIndexPath
+    )
+{
+    uint32_t dwError = 0;
+    char *pszIndexPath = NULL;
+
+    if (!pSolvRepoInfo->pszRepoCacheDir ||
+        IsNullOrEmptyString(pSolvRepoInfo->pRepo->name))
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+
+    dwError = TDNFAllocateStringPrintf(
+                  &pszIndexPath,
+                  "%s/%s/%s-files.idx",
+                  pSolvRepoInfo->pszRepoCacheDir,
+                  TDNF_SOLVCACHE_DIR_NAME,
+                  pSolvRepoInfo->pRepo->name);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    *ppszIndexPath = pszIndexPath;
+cleanup:
+    return dwError;
+error:
+    TDNF_SAFE_FREE_MEMORY(pszIndexPath);
+    goto cleanup;
+}
+
+/* file lists only extend the primary solvables */
+static
+Id
+_SolvFileIndexEnd(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo
+    )
+{
+    return pSolvRepoInfo->nPrimaryEnd ? pSolvRepoInfo->nPrimaryEnd :
+                                        pSolvRepoInfo->pRepo->end;
+}
+
+/*
+ * Map the file index of a repo on first use. If it is missing or
+ * stale, the file lists are loaded and it is created, and lookups go
+ * without it if that fails too.
+ */
+static
+void
+_SolvLoadFileIndex(
+    PSolvSack pSack,
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo
+    )
+{
+    uint32_t dwError = 0;
+    char *pszIndexPath = NULL;
+    void *pMap = NULL;
+    size_t nSize = 0;
+    PSOLV_FILE_INDEX_HEADER pHeader = NULL;
+    const unsigned char *pszCookie = NULL;
+    Repo *pRepo = pSolvRepoInfo->pRepo;
+
+    if (pSolvRepoInfo->nFileIndexLoaded || !pSolvRepoInfo->nCookieSet ||
+        IsNullOrEmptyString(
+            pSolvRepoInfo->ppszExtMetaData[SOLV_EXT_FILELISTS]))
+    {
+        goto cleanup;
+    }
+    pSolvRepoInfo->nFileIndexLoaded = 1;
+    pszCookie = pSolvRepoInfo->ppExtCookie[SOLV_EXT_FILELISTS];
+
+    dwError = _SolvGetFileIndexPath(pSolvRepoInfo, &pszIndexPath);
+    BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+
+    dwError = SolvMapCacheFile(pszIndexPath, pszCookie, &pMap, &nSize);
+    if (dwError == ERROR_TDNF_SOLV_CACHE_NOT_CREATED)
+    {
+        /* creates the index too if the file lists are parsed */
+        dwError = SolvLoadRepoMetaDataExt(pSack, pSolvRepoInfo,
+                                          SOLV_EXT_FILELISTS);
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+
+        dwError = SolvMapCacheFile(pszIndexPath, pszCookie, &pMap, &nSize);
+    }
+    if (dwError == ERROR_TDNF_SOLV_CACHE_NOT_CREATED)
+    {
+        dwError = SolvCreateFileIndex(pSolvRepoInfo);
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+
+        dwError = SolvMapCacheFile(pszIndexPath, pszCookie, &pMap, &nSize);
+    }
+    BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+
+    /* the index must fit the primary solvables it was created for */
+    pHeader = pMap;
+    if (nSize < sizeof(*pHeader) + SOLV_COOKIE_LEN ||
+        memcmp(pHeader->szMagic, FILE_INDEX_MAGIC, FILE_INDEX_MAGIC_LEN) ||
+        pHeader->dwSolvables !=
+            (uint32_t)(_SolvFileIndexEnd(pSolvRepoInfo) - pRepo->start) ||
+        !pHeader->dwBuckets ||
+        (pHeader->dwBuckets & (pHeader->dwBuckets - 1)) ||
+        (nSize - sizeof(*pHeader) - SOLV_COOKIE_LEN) / sizeof(uint32_t) <=
+            pHeader->dwBuckets ||
+        (nSize - sizeof(*pHeader) - SOLV_COOKIE_LEN -
+            (pHeader->dwBuckets + 1) * sizeof(uint32_t)) /
+            sizeof(SOLV_FILE_INDEX_ENTRY) < pHeader->dwEntries)
+    {
+        dwError = ERROR_TDNF_SOLV_CACHE_NOT_CREATED;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+
+    pSolvRepoInfo->pFileIndex = pMap;
+    pSolvRepoInfo->nFileIndexSize = nSize;
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszIndexPath);
+    return;
+error:
+    if (pMap)
+    {
+        munmap(pMap, nSize);
+    }
+    goto cleanup;
+}
+
+/* 64 bit FNV-1a */
+static
+uint64_t
+_SolvHashPath(
+    const char *pszPath,
+    size_t nLen
+    )
+{
+    uint64_t qwHash = 0xcbf29ce484222325ULL;
+    size_t i = 0;
+
+    for (i = 0; i < nLen; i++)
+    {
+        qwHash ^= (unsigned char)pszPath[i];
+        qwHash *= 0x100000001b3ULL;
+    }
+    return qwHash;
+}
+
+/*
+ * Add the entry of pszPath to pQueueFiles, and those of the
+ * directories it is in to pQueueDirs. The hash of a directory is the
+ * one of the path up to and including the '/' after it, so it is
+ * taken on the way.
+ */
+static
+void
+_SolvAddFileHashes(
+    Queue *pQueueFiles,
+    Queue *pQueueDirs,
+    const char *pszPath,
+    Id nOffset
+    )
+{
+    uint64_t qwHash = 0xcbf29ce484222325ULL;
+    const char *psz = NULL;
+
+    for (psz = pszPath; *psz; psz++)
+    {
+        qwHash ^= (unsigned char)*psz;
+        qwHash *= 0x100000001b3ULL;
+        /* skip the root, all files are below it */
+        if (*psz == '/' && psz != pszPath)
+        {
+            queue_push2(pQueueDirs, (Id)(uint32_t)qwHash,
+                        (Id)(uint32_t)(qwHash >> 32));
+            queue_push(pQueueDirs, nOffset);
+        }
+    }
+    queue_push2(pQueueFiles, (Id)(uint32_t)qwHash,
+                (Id)(uint32_t)(qwHash >> 32));
+    queue_push(pQueueFiles, nOffset);
+}
+
+/*
+ * Entries are (low hash, high hash, offset). With a bucket mask in
+ * pData they are ordered by bucket first, otherwise by the hash.
+ */
+static
+int
+_SolvCmpFileEntries(
+    const void *pEntry1,
+    const void *pEntry2,
+    void *pData
+    )
+{
+    const uint32_t *pdw1 = pEntry1;
+    const uint32_t *pdw2 = pEntry2;
+    uint32_t dwMask = pData ? *(const uint32_t *)pData : 0xffffffff;
+
+    if ((pdw1[0] & dwMask) != (pdw2[0] & dwMask))
+    {
+        return (pdw1[0] & dwMask) < (pdw2[0] & dwMask) ? -1 : 1;
+    }
+    if (pdw1[1] != pdw2[1])
+    {
+        return pdw1[1] < pdw2[1] ? -1 : 1;
+    }
+    if (pdw1[2] != pdw2[2])
+    {
+        return pdw1[2] < pdw2[2] ? -1 : 1;
+    }
+    if (pdw1[0] != pdw2[0])
+    {
+        return pdw1[0] < pdw2[0] ? -1 : 1;
+    }
+    return 0;
+}
+
+static
+int
+_SolvCmpIds(
+    const void *pId1,
+    const void *pId2,
+    void *pData
+    )
+{
+    Id id1 = *(const Id *)pId1;
+    Id id2 = *(const Id *)pId2;
+
+    UNUSED(pData);
+
+    return id1 < id2 ? -1 : id1 > id2;
+}
+
+/*
+ * Set pQueueSolvables to the solvables the index lists under qwHash.
+ * A bucket reaching past the entries means a damaged index.
+ */
+static
+uint32_t
+_SolvLookupFileIndex(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo,
+    uint64_t qwHash,
+    Queue *pQueueSolvables
+    )
+{
+    uint32_t dwError = 0;
+    PSOLV_FILE_INDEX_HEADER pHeader = pSolvRepoInfo->pFileIndex;
+    const uint32_t *pdwBuckets = (const uint32_t *)(pHeader + 1);
+    PSOLV_FILE_INDEX_ENTRY pEntries = NULL;
+    Repo *pRepo = pSolvRepoInfo->pRepo;
+    uint32_t dwBucket = (uint32_t)qwHash & (pHeader->dwBuckets - 1);
+    uint32_t dwHashLow = (uint32_t)qwHash;
+    uint32_t dwHashHigh = (uint32_t)(qwHash >> 32);
+    uint32_t i = 0;
+    Id p = 0;
+
+    pEntries = (PSOLV_FILE_INDEX_ENTRY)(pdwBuckets + pHeader->dwBuckets + 1);
+    queue_empty(pQueueSolvables);
+
+    if (pdwBuckets[dwBucket] > pdwBuckets[dwBucket + 1] ||
+        pdwBuckets[dwBucket + 1] > pHeader->dwEntries)
+    {
+        dwError = ERROR_TDNF_SOLV_IO;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+
+    for (i = pdwBuckets[dwBucket]; i < pdwBuckets[dwBucket + 1]; i++)
+    {
+        if (pEntries[i].dwHashLow != dwHashLow ||
+            pEntries[i].dwHashHigh != dwHashHigh)
+        {
+            continue;
+        }
+        if (pEntries[i].dwOffset >= pHeader->dwSolvables)
+        {
+            dwError = ERROR_TDNF_SOLV_IO;
+            BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+        }
+        p = pRepo->start + pEntries[i].dwOffset;
+        if (pRepo->pool->solvables[p].repo == pRepo)
+        {
+            queue_push(pQueueSolvables, p);
+        }
+    }
+
+cleanup:
+    return dwError;
+error:
+    queue_empty(pQueueSolvables);
+    goto cleanup;
+}
@@ -1032,6 +1032,85 @@ error:
     goto cleanup;
 }
 
+/*
+ * Find the packages named exactly pszName with the name index instead
+ * of a query. Only the solvables a name selection of the query would
+ * take are used: installed ones, and others that are not source or
+ * badarch packages and are considered. *ppPkgList is set to NULL if
+ * this gives no match in the wanted repos, the caller then runs the
+ * query, which also tries provides, nevra and case insensitive matches.
+ */
+static
+uint32_t
+SolvFindPkgByExactName(
+    PSolvSack pSack,
+    const char* pszName,
+    int nInstalled,
+    int nAvailable,
+    PSolvPackageList* ppPkgList
+    )
+{
+    uint32_t dwError = 0;
+    Pool *pPool = pSack->pPool;
+    PSolvPackageList pPkgList = NULL;
+    Queue queueSolvables = {0};
+    Solvable *pSolv = NULL;
+    Id p;
+    int i, j;
+
+    queue_init(&queueSolvables);
+    *ppPkgList = NULL;
+
+    if (!pPool->whatprovides || SolvIsGlob(pszName) ||
+        !strncmp(pszName, "patch:", 6))
+    {
+        goto cleanup;
+    }
+
+    dwError = SolvFindSolvablesByName(pSack, pszName, SEARCH_STRING,
+                                      &queueSolvables);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    for (i = j = 0; i < queueSolvables.count; i++)
+    {
+        p = queueSolvables.elements[i];
+        pSolv = pool_id2solvable(pPool, p);
+        if (pSolv->repo != pPool->installed)
+        {
+            if (pSolv->arch == ARCH_SRC || pSolv->arch == ARCH_NOSRC ||
+                pool_badarch_solvable(pPool, pSolv) ||
+                pool_disabled_solvable(pPool, pSolv))
+            {
+                continue;
+            }
+            if (!nAvailable)
+            {
+                continue;
+            }
+        }
+        else if (!nInstalled)
+        {
+            continue;
+        }
+        queueSolvables.elements[j++] = p;
+    }
+    queue_truncate(&queueSolvables, j);
+
+    if (queueSolvables.count)
+    {
+        dwError = SolvQueueToPackageList(&queueSolvables, &pPkgList);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    *ppPkgList = pPkgList;
+
+cleanup:
+    queue_free(&queueSolvables);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
 uint32_t
 SolvCountPkgByName(
     PSolvSack pSack,
@@ -1052,21 +1131,30 @@ SolvCountPkgByName(
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
-    dwError = SolvCreateQuery(pSack, &pQuery);
-    BAIL_ON_TDNF_ERROR(dwError);
-
-    if (nSource) {
-        pQuery->nScope = SCOPE_SOURCE;
+    if (!nSource)
+    {
+        dwError = SolvFindPkgByExactName(pSack, pszName, 1, 1, &pPkgList);
+        BAIL_ON_TDNF_ERROR(dwError);
     }
 
-    dwError = SolvApplySinglePackageFilter(pQuery, pszName);
-    BAIL_ON_TDNF_ERROR(dwError);
+    if (!pPkgList)
+    {
+        dwError = SolvCreateQuery(pSack, &pQuery);
+        BAIL_ON_TDNF_ERROR(dwError);
 
-    dwError = SolvApplyListQuery(pQuery);
-    BAIL_ON_TDNF_ERROR(dwError);
+        if (nSource) {
+            pQuery->nScope = SCOPE_SOURCE;
+        }
 
-    dwError = SolvGetQueryResult(pQuery, &pPkgList);
-    BAIL_ON_TDNF_ERROR(dwError);
+        dwError = SolvApplySinglePackageFilter(pQuery, pszName);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        dwError = SolvApplyListQuery(pQuery);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        dwError = SolvGetQueryResult(pQuery, &pPkgList);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
 
     dwError = SolvGetPackageListSize(pPkgList, &dwCount);
     BAIL_ON_TDNF_ERROR(dwError);
@@ -1109,20 +1197,26 @@ SolvFindInstalledPkgByName(
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
-    dwError = SolvCreateQuery(pSack, &pQuery);
+    dwError = SolvFindPkgByExactName(pSack, pszName, 1, 0, &pPkgList);
     BAIL_ON_TDNF_ERROR(dwError);
 
-    dwError = SolvAddSystemRepoFilter(pQuery);
-    BAIL_ON_TDNF_ERROR(dwError);
+    if (!pPkgList)
+    {
+        dwError = SolvCreateQuery(pSack, &pQuery);
+        BAIL_ON_TDNF_ERROR(dwError);
 
-    dwError = SolvApplySinglePackageFilter(pQuery, pszName);
-    BAIL_ON_TDNF_ERROR(dwError);
+        dwError = SolvAddSystemRepoFilter(pQuery);
+        BAIL_ON_TDNF_ERROR(dwError);
 
-    dwError = SolvApplyListQuery(pQuery);
-    BAIL_ON_TDNF_ERROR(dwError);
+        dwError = SolvApplySinglePackageFilter(pQuery, pszName);
+        BAIL_ON_TDNF_ERROR(dwError);
 
-    dwError = SolvGetQueryResult(pQuery, &pPkgList);
-    BAIL_ON_TDNF_ERROR(dwError);
+        dwError = SolvApplyListQuery(pQuery);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        dwError = SolvGetQueryResult(pQuery, &pPkgList);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
 
     *ppPkgList = pPkgList;
 cleanup:
@@ -1206,20 +1300,26 @@ SolvFindAvailablePkgByName(
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
-    dwError = SolvCreateQuery(pSack, &pQuery);
+    dwError = SolvFindPkgByExactName(pSack, pszName, 0, 1, &pPkgList);
     BAIL_ON_TDNF_ERROR(dwError);
 
-    dwError = SolvAddAvailableRepoFilter(pQuery);
-    BAIL_ON_TDNF_ERROR(dwError);
+    if (!pPkgList)
+    {
+        dwError = SolvCreateQuery(pSack, &pQuery);
+        BAIL_ON_TDNF_ERROR(dwError);
 
-    dwError = SolvApplySinglePackageFilter(pQuery, pszName);
-    BAIL_ON_TDNF_ERROR(dwError);
+        dwError = SolvAddAvailableRepoFilter(pQuery);
+        BAIL_ON_TDNF_ERROR(dwError);
 
-    dwError = SolvApplyListQuery(pQuery);
-    BAIL_ON_TDNF_ERROR(dwError);
+        dwError = SolvApplySinglePackageFilter(pQuery, pszName);
+        BAIL_ON_TDNF_ERROR(dwError);
 
-    dwError = SolvGetQueryResult(pQuery, &pPkgList);
-    BAIL_ON_TDNF_ERROR(dwError);
+        dwError = SolvApplyListQuery(pQuery);
+        BAIL_ON_TDNF_ERROR(dwError);
+
+        dwError = SolvGetQueryResult(pQuery, &pPkgList);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
     *ppPkgList = pPkgList;
 
 cleanup:
@@ -1396,6 +1496,9 @@ SolvFindBestAvailable(
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
+    dwError = SolvFinalizeSack(pSack);
+    BAIL_ON_TDNF_ERROR(dwError);
+
     pool = pSack->pPool;
     idName = pool_str2id(pool, pszPkgName, 1);
 
@@ -1908,18 +2011,20 @@ SolvReportProblems(
 
 uint32_t
 SolvAddExcludes(
-    Pool* pPool,
+    PSolvSack pSack,
     char** ppszExcludes
     )
 {
      uint32_t dwError = 0;
      Map *pExcludes = NULL;
+     Pool *pPool = NULL;
 
-     if (!pPool || !ppszExcludes)
+     if (!pSack || !pSack->pPool || !ppszExcludes)
      {
          dwError = ERROR_TDNF_INVALID_PARAMETER;
          BAIL_ON_TDNF_ERROR(dwError);
      }
+     pPool = pSack->pPool;
 
      dwError = TDNFAllocateMemory(
                            1,
@@ -1929,7 +2034,7 @@ SolvAddExcludes(
 
      map_init(pExcludes, pPool->nsolvables);
 
-     dwError = SolvDataIterator(pPool, ppszExcludes, pExcludes);
+     dwError = SolvDataIterator(pSack, ppszExcludes, pExcludes);
      BAIL_ON_TDNF_ERROR(dwError);
 
      if (!pPool->considered)
@@ -1950,19 +2055,24 @@ error:
     goto cleanup;
 }
 
+/*
+ * Mark the solvables named by ppszExcludes in pMap. Plain names are
+ * looked up in the name index, only globs scan all names.
+ */
 uint32_t
 SolvDataIterator(
-     Pool* pPool,
+     PSolvSack pSack,
      char** ppszExcludes,
      Map* pMap
      )
 {
-    Dataiterator di;
-    Id keyname = SOLVABLE_NAME;
     char **ppszPkg = NULL;
+    Queue queueSolvables = {0};
     uint32_t dwError = 0;
+    int i;
 
-    if (!pPool || !ppszExcludes || !pMap)
+    queue_init(&queueSolvables);
+    if (!pSack || !ppszExcludes || !pMap)
     {
         dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_TDNF_ERROR(dwError);
@@ -1975,15 +2085,17 @@ SolvDataIterator(
           {
               flags = SEARCH_GLOB;
           }
-          dwError = dataiterator_init(&di, pPool, 0, 0, keyname, *ppszPkg, flags);
+          queue_empty(&queueSolvables);
+          dwError = SolvFindSolvablesByName(pSack, *ppszPkg, flags,
+                                            &queueSolvables);
           BAIL_ON_TDNF_ERROR(dwError);
-          while (dataiterator_step(&di))
+          for (i = 0; i < queueSolvables.count; i++)
           {
-              MAPSET(pMap, di.solvid);
+              MAPSET(pMap, queueSolvables.elements[i]);
           }
-          dataiterator_free(&di);
     }
 cleanup:
+    queue_free(&queueSolvables);
     return dwError;
 error:
     goto cleanup;
@@ -2257,6 +2369,9 @@ SolvGetFileListFromId(
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
+    dwError = SolvLoadMetaDataExt(pSack, SOLV_EXT_FILELISTS);
+    BAIL_ON_TDNF_ERROR(dwError);
+
     dataiterator_init(&di, pSack->pPool, pSolv->repo, dwPkgId, SOLVABLE_FILELIST, NULL,
                       SEARCH_FILES | SEARCH_COMPLETE_FILELIST);
     while (dataiterator_step(&di)) {
@@ -2306,6 +2421,9 @@ SolvGetFileQueueFromId(
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
+    dwError = SolvLoadMetaDataExt(pSack, SOLV_EXT_FILELISTS);
+    BAIL_ON_TDNF_ERROR(dwError);
+
     queue_init(pQueueFiles);
 
     dataiterator_init(&di, pSack->pPool, pSolv->repo, dwPkgId,
@@ -2445,6 +2563,9 @@ SolvGetChangeLogFromId(
         BAIL_ON_TDNF_ERROR(dwError);
     }
 
+    dwError = SolvLoadMetaDataExt(pSack, SOLV_EXT_OTHER);
+    BAIL_ON_TDNF_ERROR(dwError);
+
     dataiterator_init(&di, pSack->pPool, pSolv->repo, dwPkgId,
                       SOLVABLE_CHANGELOG_AUTHOR, NULL, 0);
     dataiterator_prepend_keyname(&di, SOLVABLE_CHANGELOG);
@@ -2490,17 +2611,40 @@ error:
     goto cleanup;
 }
 
+/*
+ * Get the auto installed packages that nothing else installed needs,
+ * directly or through other such packages. A package is needed by
+ * another one if it provides one of its requires, recommends,
+ * suggests, supplements or enhances, which includes its name and the
+ * files it has that are required.
+ *
+ * Which installed package needs which is looked up once with the
+ * whatprovides index. Everything reachable from the user installed
+ * packages is needed, the auto installed packages left over are the
+ * orphans. So a package whose last user is an orphan is an orphan too,
+ * and so are auto installed packages that only need each other.
+ */
 uint32_t
-SolvIdIsOrphaned(
+SolvGetAutoInstalledOrphans(
     PSolvSack pSack,
-    Id p,
-    int *pnIsOrphan
-)
+    struct history_ctx *pHistoryCtx,
+    Queue *pQueueAutoInstalled)
 {
     uint32_t dwError = 0;
-    Id q;
-    Solvable *s, *t;
-    int nIsOrphan = 1;
+    Pool *pool; /* FOR_PROVIDES needs this name */
+    Repo *pRepo;
+    Id p, q, pp;
+    Solvable *s;
+    int rc;
+    int nSolvables, i, k, nEdgesStart;
+    /* the installed packages each one needs, at pnEdges[p] in qEdges */
+    Queue qEdges = {0};
+    int *pnEdges = NULL;
+    Queue qDeps = {0};
+    Queue qWork = {0};
+    Map mapEdges = {0};
+    Map mapAuto = {0};
+    Map mapNeeded = {0};
     Id allDepKeys[] = {
         SOLVABLE_REQUIRES,
         SOLVABLE_RECOMMENDS,
@@ -2508,150 +2652,128 @@ SolvIdIsOrphaned(
         SOLVABLE_SUPPLEMENTS,
         SOLVABLE_ENHANCES
     };
-    Pool *pPool;
-    Queue qFiles = {0};
-    Queue qProvides = {0};
 
-    if(!pSack || !pnIsOrphan)
+    if(!pSack || !pQueueAutoInstalled || !pHistoryCtx)
     {
         dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
     }
-    pPool = pSack->pPool;
-    s = pool_id2solvable(pPool, p);
+    pool = pSack->pPool;
 
-    /* Loop through installed, if any one requires p (aka s) it's not an orphan. */
-    FOR_REPO_SOLVABLES(pPool->installed, q, t)
-    {
-        if (p == q)
-        {
-            continue;
-        }
+    queue_init(pQueueAutoInstalled);
+    queue_init(&qEdges);
+    queue_init(&qDeps);
+    queue_init(&qWork);
+    map_init(&mapEdges, pool->nsolvables);
+    map_init(&mapAuto, pool->nsolvables);
+    map_init(&mapNeeded, pool->nsolvables);
 
-        for (unsigned int k = 0; k < ARRAY_SIZE(allDepKeys); k++)
-        {
-            /* deps are names, not solvables, hence we check for s->name
-               and not p */
-            if (solvable_matchesdep(t, allDepKeys[k], s->name, 0))
-            {
-                nIsOrphan = 0;
-                goto loopexit; /* we can skip other checks */
-            }
-        }
+    pRepo = pool->installed;
+    if (!pRepo || pRepo->start >= pRepo->end)
+    {
+        goto cleanup;
     }
 
-    /* check if p provides files that are needed by anything installed */
-    dwError = SolvGetFileQueueFromId(pSack, p, &qFiles);
-    BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    dwError = SolvFinalizeSack(pSack);
+    BAIL_ON_TDNF_ERROR(dwError);
 
-    FOR_REPO_SOLVABLES(pPool->installed, q, t)
+    nSolvables = pRepo->end - pRepo->start;
+    dwError = TDNFAllocateMemory(nSolvables + 1, sizeof(int), (void **)&pnEdges);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    for (p = pRepo->start; p < pRepo->end; p++)
     {
-        if (p == q)
+        nEdgesStart = qEdges.count;
+        pnEdges[p - pRepo->start] = nEdgesStart;
+
+        s = pool_id2solvable(pool, p);
+        if (s->repo != pRepo)
         {
             continue;
         }
 
-        for (int i = 0; i < qFiles.count; i++)
+        for (k = 0; k < (int)ARRAY_SIZE(allDepKeys); k++)
         {
-            for (unsigned int k = 0; k < ARRAY_SIZE(allDepKeys); k++)
+            /* the queue is left as it is if s has no such deps */
+            queue_empty(&qDeps);
+            solvable_lookup_deparray(s, allDepKeys[k], &qDeps, 0);
+            for (i = 0; i < qDeps.count; i++)
             {
-                if (solvable_matchesdep(t, allDepKeys[k], qFiles.elements[i], 0))
+                if (qDeps.elements[i] == SOLVABLE_PREREQMARKER)
                 {
-                    nIsOrphan = 0;
-                    goto loopexit; /* save 3 break statements */
+                    continue;
                 }
-            }
-        }
-    }
-
-    /* Check if p provides something in its provides list needed by an
-       installed package.
-       Corner case: two (or more) packages providing the same provide, in
-       which case all but one of them can be an orphan but we cannot decide which
-       one. We mark none of them as an orphan. */
-    solvable_lookup_deparray(s, SOLVABLE_PROVIDES, &qProvides, -1);
-
-    FOR_REPO_SOLVABLES(pPool->installed, q, t)
-    {
-        if (p == q)
-        {
-            continue;
-        }
-
-        for (int i = 0; i < qProvides.count; i++)
-        {
-            for (unsigned int k = 0; k < ARRAY_SIZE(allDepKeys); k++)
-            {
-                if (solvable_matchesdep(t, allDepKeys[k], qProvides.elements[i], 0))
+                FOR_PROVIDES(q, pp, qDeps.elements[i])
                 {
-                    nIsOrphan = 0;
-                    goto loopexit; /* save 3 break statements */
+                    if (q == p || pool->solvables[q].repo != pRepo ||
+                        MAPTST(&mapEdges, q))
+                    {
+                        continue;
+                    }
+                    MAPSET(&mapEdges, q);
+                    queue_push(&qEdges, q);
                 }
             }
         }
-    }
-
-loopexit:
-
-    *pnIsOrphan = nIsOrphan;
-
-cleanup:
-    queue_free(&qFiles);
-    queue_free(&qProvides);
-    return dwError;
-error:
-    goto cleanup;
-}
 
-uint32_t
-SolvGetAutoInstalledOrphans(
-    PSolvSack pSack,
-    struct history_ctx *pHistoryCtx,
-    Queue *pQueueAutoInstalled)
-{
-    uint32_t dwError = 0;
-    Pool *pPool;
-    Id p;
-    Solvable *s;
-    int rc;
-
-    if(!pSack || !pQueueAutoInstalled || !pHistoryCtx)
-    {
-        dwError = ERROR_TDNF_INVALID_PARAMETER;
-        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+        for (i = nEdgesStart; i < qEdges.count; i++)
+        {
+            MAPCLR(&mapEdges, qEdges.elements[i]);
+        }
     }
-    pPool = pSack->pPool;
-
-    queue_init(pQueueAutoInstalled);
+    pnEdges[nSolvables] = qEdges.count;
 
-    FOR_REPO_SOLVABLES(pPool->installed, p, s)
+    FOR_REPO_SOLVABLES(pRepo, p, s)
     {
-        const char *pszName;
-        int nIsAuto = 0, nIsOrphan = 0;
+        int nIsAuto = 0;
 
-        pszName = pool_id2str(pPool, s->name);
-        rc = history_get_auto_flag(pHistoryCtx, pszName, &nIsAuto);
+        rc = history_get_auto_flag(pHistoryCtx, pool_id2str(pool, s->name), &nIsAuto);
         if (rc != 0)
         {
             dwError = ERROR_TDNF_HISTORY_ERROR;
             BAIL_ON_TDNF_ERROR(dwError);
         }
-        if (nIsAuto == 0)
+        if (nIsAuto)
         {
-            continue;
+            MAPSET(&mapAuto, p);
         }
+        else
+        {
+            MAPSET(&mapNeeded, p);
+            queue_push(&qWork, p);
+        }
+    }
 
-        dwError = SolvIdIsOrphaned(pSack, p, &nIsOrphan);
-        BAIL_ON_TDNF_ERROR(dwError);
-        if (!nIsOrphan)
+    while (qWork.count)
+    {
+        p = queue_pop(&qWork);
+        for (i = pnEdges[p - pRepo->start]; i < pnEdges[p - pRepo->start + 1]; i++)
         {
-            continue;
+            q = qEdges.elements[i];
+            if (!MAPTST(&mapNeeded, q))
+            {
+                MAPSET(&mapNeeded, q);
+                queue_push(&qWork, q);
+            }
         }
+    }
 
-        queue_push(pQueueAutoInstalled, p);
+    FOR_REPO_SOLVABLES(pRepo, p, s)
+    {
+        if (MAPTST(&mapAuto, p) && !MAPTST(&mapNeeded, p))
+        {
+            queue_push(pQueueAutoInstalled, p);
+        }
     }
 
 cleanup:
+    TDNF_SAFE_FREE_MEMORY(pnEdges);
+    queue_free(&qEdges);
+    queue_free(&qDeps);
+    queue_free(&qWork);
+    map_free(&mapEdges);
+    map_free(&mapAuto);
+    map_free(&mapNeeded);
     return dwError;
 error:
     goto cleanup;
@@ -8,6 +8,20 @@
 
 #include "includes.h"
 
+static
+int
+_SolvIsUpgradeCandidate(
+    Pool *pool,
+    Solvable *pSolv
+    );
+
+static
+int
+_SolvRequiresMissingFile(
+    Pool *pool,
+    Solvable *pSolv
+    );
+
 uint32_t
 SolvCreateSack(
     PSolvSack* ppSack
@@ -24,6 +38,7 @@ SolvCreateSack(
 
     dwError = TDNFAllocateMemory(1, sizeof(SolvSack), (void **)&pSack);
     BAIL_ON_TDNF_ERROR(dwError);
+    queue_init(&pSack->queueAdvisoryIndex);
 
     *ppSack = pSack;
 cleanup:
@@ -48,6 +63,19 @@ SolvFreeSack(
         Pool* pPool = pSack->pPool;
         if(pPool)
         {
+            Repo *pRepo = NULL;
+            int i = 0;
+
+            /* repos own their SOLV_REPO_INFO_INTERNAL */
+            for (i = 1; i < pPool->nrepos; i++)
+            {
+                pRepo = pPool->repos[i];
+                if (pRepo)
+                {
+                    SolvFreeRepoInfo(pRepo->appdata);
+                    pRepo->appdata = NULL;
+                }
+            }
             if (pPool->considered)
             {
                 /* shouldn't this be owned by pPool? */
@@ -56,6 +84,8 @@ SolvFreeSack(
             }
             pool_free(pPool);
         }
+        queue_free(&pSack->queueAdvisoryIndex);
+        SolvFreeNameIndexes(pSack);
         TDNF_SAFE_FREE_MEMORY(pSack->pszCacheDir);
         TDNF_SAFE_FREE_MEMORY(pSack->pszRootDir);
         TDNF_SAFE_FREE_MEMORY(pSack);
@@ -180,3 +210,252 @@ error:
     }
     goto cleanup;
 }
+
+/*
+ * Build the file provides and whatprovides index of the pool if repos
+ * were added since it was last built. Loading repos only marks the
+ * sack dirty, so the index is built once after all of them are in.
+ */
+uint32_t
+SolvFinalizeSack(
+    PSolvSack pSack
+    )
+{
+    uint32_t dwError = 0;
+    Pool *pool = NULL; /* FOR_PROVIDES needs this name */
+    Queue queueFileDeps = {0};
+    Id idProvider = 0, idProviderPos = 0;
+    int i = 0, nMissing = 0;
+
+    if(!pSack || !pSack->pPool)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+    pool = pSack->pPool;
+
+    if (!pSack->nProvidesDirty && pool->whatprovides)
+    {
+        goto cleanup;
+    }
+
+    queue_init(&queueFileDeps);
+    pool_addfileprovides_queue(pool, &queueFileDeps, NULL);
+    pool_createwhatprovides(pool);
+    pSack->nProvidesDirty = 0;
+    /* file provides may have been added */
+    SolvFreeNameIndexes(pSack);
+
+    /* primary.xml only has the commonly used files. Remember if a file
+       dependency cannot be resolved with those, the full file lists are
+       only loaded when that matters, see SolvLoadMissingFileProvides() */
+    for (i = 0; i < queueFileDeps.count && !nMissing; i++)
+    {
+        nMissing = 1;
+        FOR_PROVIDES(idProvider, idProviderPos, queueFileDeps.elements[i])
+        {
+            nMissing = 0;
+            break;
+        }
+    }
+    pSack->nFileProvidesMissing = nMissing;
+
+cleanup:
+    queue_free(&queueFileDeps);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/*
+ * Load the file lists of all repos if a file dependency had no provider
+ * in primary.xml when the sack was last finalized, and build the
+ * provides index again. *pnLoaded is set if they were loaded, callers
+ * use it to retry what failed without them, like a solver run.
+ */
+uint32_t
+SolvLoadMissingFileProvides(
+    PSolvSack pSack,
+    int *pnLoaded
+    )
+{
+    uint32_t dwError = 0;
+    Pool *pool = NULL;
+
+    if(!pSack || !pSack->pPool || !pnLoaded)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+    pool = pSack->pPool;
+    *pnLoaded = 0;
+
+    if (!pSack->nFileProvidesMissing)
+    {
+        goto cleanup;
+    }
+    pSack->nFileProvidesMissing = 0;
+
+    dwError = SolvLoadMetaDataExt(pSack, SOLV_EXT_FILELISTS);
+    BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+
+    if (pSack->nProvidesDirty)
+    {
+        pool_addfileprovides(pool);
+        pool_createwhatprovides(pool);
+        pSack->nProvidesDirty = 0;
+        SolvFreeNameIndexes(pSack);
+        *pnLoaded = 1;
+    }
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/*
+ * Set *pnNeeded if a package the install, update or distro-sync jobs in
+ * pQueueJobs select requires a file that has no provider without the
+ * file lists. For jobs on all packages only upgrades of installed
+ * packages are considered. The solver does not report a problem for
+ * such an upgrade, it just keeps the old version, so this has to be
+ * checked before solving.
+ */
+uint32_t
+SolvJobsNeedFileLists(
+    PSolvSack pSack,
+    Queue *pQueueJobs,
+    int *pnNeeded
+    )
+{
+    uint32_t dwError = 0;
+    Pool *pool = NULL;
+    Queue queueSelection = {0};
+    Queue queueSolvables = {0};
+    Solvable *pSolv = NULL;
+    Id idHow = 0, idJob = 0;
+    int i = 0, j = 0, nAll = 0, nNeeded = 0;
+
+    if(!pSack || !pSack->pPool || !pQueueJobs || !pnNeeded)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+    pool = pSack->pPool;
+
+    queue_init(&queueSelection);
+    queue_init(&queueSolvables);
+
+    for (i = 0; i + 1 < pQueueJobs->count &&
+                pSack->nFileProvidesMissing && !nNeeded; i += 2)
+    {
+        idHow = pQueueJobs->elements[i];
+        idJob = idHow & SOLVER_JOBMASK;
+        if (idJob != SOLVER_INSTALL &&
+            idJob != SOLVER_UPDATE &&
+            idJob != SOLVER_DISTUPGRADE)
+        {
+            continue;
+        }
+        nAll = (idHow & SOLVER_SELECTMASK) == SOLVER_SOLVABLE_ALL;
+
+        queue_empty(&queueSelection);
+        queue_push2(&queueSelection, idHow, pQueueJobs->elements[i + 1]);
+        queue_empty(&queueSolvables);
+        selection_solvables(pool, &queueSelection, &queueSolvables);
+
+        for (j = 0; j < queueSolvables.count && !nNeeded; j++)
+        {
+            pSolv = pool_id2solvable(pool, queueSolvables.elements[j]);
+            if (pool->installed && pSolv->repo == pool->installed)
+            {
+                continue;
+            }
+            if (nAll && !_SolvIsUpgradeCandidate(pool, pSolv))
+            {
+                continue;
+            }
+            nNeeded = _SolvRequiresMissingFile(pool, pSolv);
+        }
+    }
+    *pnNeeded = nNeeded;
+
+cleanup:
+    queue_free(&queueSelection);
+    queue_free(&queueSolvables);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+//Is there an older installed package of the same name
+static
+int
+_SolvIsUpgradeCandidate(
+    Pool *pool,
+    Solvable *pSolv
+    )
+{
+    Solvable *pInstalled = NULL;
+    Id idProvider = 0, idProviderPos = 0;
+
+    if (!pool->installed)
+    {
+        return 0;
+    }
+    FOR_PROVIDES(idProvider, idProviderPos, pSolv->name)
+    {
+        pInstalled = pool_id2solvable(pool, idProvider);
+        if (pInstalled->repo == pool->installed &&
+            pInstalled->name == pSolv->name &&
+            pool_evrcmp(pool, pSolv->evr, pInstalled->evr, EVRCMP_COMPARE) > 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+//Does pSolv require a file nothing provides with the current provides
+static
+int
+_SolvRequiresMissingFile(
+    Pool *pool,
+    Solvable *pSolv
+    )
+{
+    Id *pDeps = NULL;
+    Id idDep = 0;
+    Id idProvider = 0, idProviderPos = 0;
+    const char *pszDep = NULL;
+    int nMissing = 0;
+
+    if (!pSolv->repo || !pSolv->requires)
+    {
+        return 0;
+    }
+    for (pDeps = pSolv->repo->idarraydata + pSolv->requires;
+         (idDep = *pDeps) != 0 && !nMissing; pDeps++)
+    {
+        if (idDep == SOLVABLE_PREREQMARKER || ISRELDEP(idDep))
+        {
+            continue;
+        }
+        pszDep = pool_id2str(pool, idDep);
+        if (*pszDep != '/')
+        {
+            continue;
+        }
+        nMissing = 1;
+        FOR_PROVIDES(idProvider, idProviderPos, idDep)
+        {
+            nMissing = 0;
+            break;
+        }
+    }
+    return nMissing;
+}
@@ -191,6 +191,9 @@ SolvCreateQuery(
         BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
     }
 
+    dwError = SolvFinalizeSack(pSack);
+    BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+
     dwError = TDNFAllocateMemory(1, sizeof(SolvQuery), (void **)&pQuery);
     BAIL_ON_TDNF_ERROR(dwError);
 
@@ -415,6 +418,106 @@ error:
     goto cleanup;
 }
 
+/*
+ * selection_make(), with the file list match of paths done with
+ * SolvFindFileProviders(). Like selection_make(), a match in the file
+ * lists is used as it is, and other matches are only tried without
+ * one. So the file lists do not need to be loaded, and file provides
+ * from them do not need to be added, to look up a path.
+ */
+static uint32_t
+_SolvMakeSelection(
+    PSolvSack pSack,
+    Queue *pQueueJob,
+    const char *pszName,
+    uint32_t nFlags,
+    uint32_t *pnRetFlags
+    )
+{
+    uint32_t dwError = 0;
+    Pool *pPool = pSack->pPool;
+    Queue queueFiles = {0};
+    Solvable *pSolvable = NULL;
+    int nSearchFlags = 0;
+    int i, j;
+
+    queue_init(&queueFiles);
+    queue_empty(pQueueJob);
+    *pnRetFlags = 0;
+
+    if ((nFlags & SELECTION_FILELIST) && *pszName == '/')
+    {
+        nSearchFlags = (nFlags & SELECTION_GLOB) && strpbrk(pszName, "[*?") ?
+                       SEARCH_GLOB : SEARCH_STRING;
+        if (nFlags & SELECTION_NOCASE)
+        {
+            nSearchFlags |= SEARCH_NOCASE;
+        }
+        dwError = SolvFindFileProviders(pSack, pszName, nSearchFlags,
+                                        &queueFiles);
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+
+        /* the solvables selection_make() would take */
+        for (i = j = 0; i < queueFiles.count; i++)
+        {
+            pSolvable = pool_id2solvable(pPool, queueFiles.elements[i]);
+            if (pSolvable->arch == ARCH_SRC || pSolvable->arch == ARCH_NOSRC)
+            {
+                if (!(nFlags & (SELECTION_SOURCE_ONLY | SELECTION_WITH_SOURCE)))
+                {
+                    continue;
+                }
+            }
+            else if (nFlags & SELECTION_SOURCE_ONLY)
+            {
+                continue;
+            }
+            /* like libsolv, installed packages are always taken */
+            if (pSolvable->repo != pPool->installed)
+            {
+                if (!(nFlags & SELECTION_WITH_BADARCH) &&
+                    pool_badarch_solvable(pPool, pSolvable))
+                {
+                    continue;
+                }
+                if (!(nFlags & SELECTION_WITH_DISABLED) &&
+                    pool_disabled_solvable(pPool, pSolvable))
+                {
+                    continue;
+                }
+            }
+            queueFiles.elements[j++] = queueFiles.elements[i];
+        }
+        queue_truncate(&queueFiles, j);
+
+        if (queueFiles.count > 1)
+        {
+            queue_push2(pQueueJob, SOLVER_SOLVABLE_ONE_OF,
+                        pool_queuetowhatprovides(pPool, &queueFiles));
+        }
+        else if (queueFiles.count == 1)
+        {
+            queue_push2(pQueueJob, SOLVER_SOLVABLE | SOLVER_NOAUTOSET,
+                        queueFiles.elements[0]);
+        }
+        if (queueFiles.count)
+        {
+            *pnRetFlags = SELECTION_FILELIST;
+            goto cleanup;
+        }
+        nFlags &= ~SELECTION_FILELIST;
+    }
+
+    *pnRetFlags = selection_make(pPool, pQueueJob, pszName, nFlags);
+
+cleanup:
+    queue_free(&queueFiles);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
 uint32_t
 SolvGenerateCommonJob(
     PSolvQuery pQuery,
@@ -445,17 +548,24 @@ SolvGenerateCommonJob(
             nRetFlags = 0;
 
             queue_empty(&queueJob);
+            if ((nFlags & SELECTION_FILELIST) && **ppszPkgNames == '/')
+            {
+                dwError = SolvFinalizeSack(pQuery->pSack);
+                BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+            }
             if (!pPool || !pPool->solvables || !pPool->whatprovides)
             {
                 dwError = ERROR_TDNF_INVALID_PARAMETER;
                 BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
             }
 
-            nRetFlags = selection_make(
-                         pPool,
+            dwError = _SolvMakeSelection(
+                         pQuery->pSack,
                          &queueJob,
                          *ppszPkgNames,
-                         nFlags);
+                         nFlags,
+                         &nRetFlags);
+            BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
 
             if (pQuery->queueRepoFilter.count)
             {
@@ -464,11 +574,13 @@ SolvGenerateCommonJob(
             if (!queueJob.count)
             {
                 nFlags |= SELECTION_NOCASE;
-                nRetFlags = selection_make(
-                                pPool,
+                dwError = _SolvMakeSelection(
+                                pQuery->pSack,
                                 &queueJob,
                                 *ppszPkgNames,
-                                nFlags);
+                                nFlags,
+                                &nRetFlags);
+                BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
                 if (pQuery->queueRepoFilter.count)
                 {
                     selection_filter(
@@ -700,10 +812,11 @@ SolvApplySearch(
     int dwEndIndex
     )
 {
-    Dataiterator di = {0};
-    Pool* pPool = NULL;
+    Pool* pool = NULL; /* FOR_REPOS needs this name */
+    Repo* pRepo = NULL;
     uint32_t dwError = 0;
     int nIndex = 0;
+    int nRepo = 0;
     Queue queueSel = {0};
     Queue queueResult = {0};
 
@@ -714,29 +827,22 @@ SolvApplySearch(
     }
     queue_init(&queueSel);
     queue_init(&queueResult);
-    pPool = pQuery->pSack->pPool;
+    pool = pQuery->pSack->pPool;
 
     for(nIndex = dwStartIndex; nIndex < dwEndIndex; nIndex++)
     {
         queue_empty(&queueSel);
         queue_empty(&queueResult);
-        dataiterator_init(&di, pPool, 0, 0, 0, ppszSearchStrings[nIndex],
-                          SEARCH_SUBSTRING|SEARCH_NOCASE);
-        dataiterator_set_keyname(&di, SOLVABLE_NAME);
-        dataiterator_set_search(&di, 0, 0);
-        while (dataiterator_step(&di))
-            queue_push2(&queueSel, SOLVER_SOLVABLE, di.solvid);
-        dataiterator_set_keyname(&di, SOLVABLE_SUMMARY);
-        dataiterator_set_search(&di, 0, 0);
-        while (dataiterator_step(&di))
-            queue_push2(&queueSel, SOLVER_SOLVABLE, di.solvid);
-        dataiterator_set_keyname(&di, SOLVABLE_DESCRIPTION);
-        dataiterator_set_search(&di, 0, 0);
-        while (dataiterator_step(&di))
-            queue_push2(&queueSel, SOLVER_SOLVABLE, di.solvid);
-        dataiterator_free(&di);
+        /* repos with a search index only check the strings of the
+           solvables it has all trigrams of the term for */
+        FOR_REPOS(nRepo, pRepo)
+        {
+            dwError = SolvSearchRepo(pRepo, ppszSearchStrings[nIndex],
+                                     &queueSel);
+            BAIL_ON_TDNF_ERROR(dwError);
+        }
 
-        selection_solvables(pPool, &queueSel, &queueResult);
+        selection_solvables(pool, &queueSel, &queueResult);
         queue_insertn(&pQuery->queueResult,
                       pQuery->queueResult.count,
                       queueResult.count,
@@ -806,6 +912,83 @@ error:
     goto cleanup;
 }
 
+/* entries of SolvSack::queueAdvisoryIndex */
+#define ADVISORY_INDEX_NAME     0
+#define ADVISORY_INDEX_ARCH     1
+#define ADVISORY_INDEX_EVR      2
+#define ADVISORY_INDEX_ADVISORY 3
+#define ADVISORY_INDEX_STRIDE   4
+
+static int
+_SolvCmpAdvisoryIndex(
+    const void *pEntry1,
+    const void *pEntry2,
+    void *pData
+    )
+{
+    const Id *pId1 = pEntry1;
+    const Id *pId2 = pEntry2;
+
+    UNUSED(pData);
+
+    if (pId1[ADVISORY_INDEX_NAME] != pId2[ADVISORY_INDEX_NAME])
+    {
+        return pId1[ADVISORY_INDEX_NAME] < pId2[ADVISORY_INDEX_NAME] ? -1 : 1;
+    }
+    /* keeps the advisories of a name in solvable order */
+    return pId1[ADVISORY_INDEX_ADVISORY] - pId2[ADVISORY_INDEX_ADVISORY];
+}
+
+/*
+ * Collect the package entries of all advisories in one pass over the
+ * pool, so that looking up the advisories of a package does not need
+ * a search of its own. The index is rebuilt if solvables were added.
+ */
+static void
+_SolvBuildAdvisoryIndex(
+    PSolvSack pSack
+    )
+{
+    Pool *pPool = pSack->pPool;
+    Queue *pIndex = &pSack->queueAdvisoryIndex;
+    Dataiterator di = {0};
+    Id dwName = 0;
+    Id dwEvr = 0;
+
+    if (pSack->nAdvisoryIndexSolvables == pPool->nsolvables)
+    {
+        return;
+    }
+    queue_empty(pIndex);
+
+    dataiterator_init(&di,
+                      pPool,
+                      0,
+                      0,
+                      UPDATE_COLLECTION_NAME,
+                      0,
+                      0);
+    dataiterator_prepend_keyname(&di, UPDATE_COLLECTION);
+    while (dataiterator_step(&di))
+    {
+        dataiterator_setpos_parent(&di);
+        dwName = pool_lookup_id(pPool, SOLVID_POS, UPDATE_COLLECTION_NAME);
+        dwEvr = pool_lookup_id(pPool, SOLVID_POS, UPDATE_COLLECTION_EVR);
+        if (!dwName || !dwEvr)
+        {
+            continue;
+        }
+        queue_push2(pIndex, dwName,
+                    pool_lookup_id(pPool, SOLVID_POS, UPDATE_COLLECTION_ARCH));
+        queue_push2(pIndex, dwEvr, di.solvid);
+    }
+    dataiterator_free(&di);
+
+    solv_sort(pIndex->elements, pIndex->count / ADVISORY_INDEX_STRIDE,
+              ADVISORY_INDEX_STRIDE * sizeof(Id), _SolvCmpAdvisoryIndex, NULL);
+    pSack->nAdvisoryIndexSolvables = pPool->nsolvables;
+}
+
 uint32_t
 SolvGetUpdateAdvisories(
     PSolvSack pSack,
@@ -813,14 +996,14 @@ SolvGetUpdateAdvisories(
     PSolvPackageList* ppPkgList)
 {
     uint32_t dwError = 0;
-    Dataiterator di = {0};
-    Id dwEvr = 0;
-    Id dwArch = 0;
-    int nCompareResult = 0;
     Queue queueAdv = {0};
     PSolvPackageList pPkgList = NULL;
     Solvable *pSolvable = NULL;
-    const char* pszPkgName = NULL;
+    const Id *pEntry = NULL;
+    int nLow = 0;
+    int nHigh = 0;
+    int nMid = 0;
+    int nCount = 0;
 
     if(!pSack || !pSack->pPool)
     {
@@ -835,43 +1018,51 @@ SolvGetUpdateAdvisories(
         BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
     }
 
-    pszPkgName = pool_id2str(pSack->pPool, pSolvable->name);
+    _SolvBuildAdvisoryIndex(pSack);
 
-    dataiterator_init(&di,
-                      pSack->pPool,
-                      0,
-                      0,
-                      UPDATE_COLLECTION_NAME,
-                      pszPkgName,
-                      SEARCH_STRING);
+    /* first entry for the name */
+    nCount = pSack->queueAdvisoryIndex.count / ADVISORY_INDEX_STRIDE;
+    nHigh = nCount;
+    while (nLow < nHigh)
+    {
+        nMid = nLow + (nHigh - nLow) / 2;
+        pEntry = pSack->queueAdvisoryIndex.elements +
+                 nMid * ADVISORY_INDEX_STRIDE;
+        if (pEntry[ADVISORY_INDEX_NAME] < pSolvable->name)
+        {
+            nLow = nMid + 1;
+        }
+        else
+        {
+            nHigh = nMid;
+        }
+    }
 
-    dataiterator_prepend_keyname(&di, UPDATE_COLLECTION);
-    while (dataiterator_step(&di))
+    for (; nLow < nCount; nLow++)
     {
-        dataiterator_setpos_parent(&di);
-        dwArch = pool_lookup_id(
-                     pSack->pPool,
-                     SOLVID_POS,
-                     UPDATE_COLLECTION_ARCH);
-        if (dwArch!= pSolvable->arch)
+        pEntry = pSack->queueAdvisoryIndex.elements +
+                 nLow * ADVISORY_INDEX_STRIDE;
+        if (pEntry[ADVISORY_INDEX_NAME] != pSolvable->name)
+        {
+            break;
+        }
+        if (pEntry[ADVISORY_INDEX_ARCH] != pSolvable->arch)
+        {
             continue;
-        dwEvr = pool_lookup_id(
-                    pSack->pPool,
-                    SOLVID_POS,
-                    UPDATE_COLLECTION_EVR);
-
-        if (!dwEvr)
+        }
+        /* an advisory can list a package more than once */
+        if (queueAdv.count &&
+            queueAdv.elements[queueAdv.count - 1] ==
+                pEntry[ADVISORY_INDEX_ADVISORY])
+        {
             continue;
-
-        nCompareResult = pool_evrcmp(
-                             pSack->pPool,
-                             dwEvr,
-                             pSolvable->evr,
-                             EVRCMP_COMPARE);
-        if (nCompareResult > 0 )
+        }
+        if (pool_evrcmp(pSack->pPool,
+                        pEntry[ADVISORY_INDEX_EVR],
+                        pSolvable->evr,
+                        EVRCMP_COMPARE) > 0)
         {
-            queue_push(&queueAdv, di.solvid);
-            dataiterator_skip_solvable(&di);
+            queue_push(&queueAdv, pEntry[ADVISORY_INDEX_ADVISORY]);
         }
     }
 
@@ -881,7 +1072,6 @@ SolvGetUpdateAdvisories(
     *ppPkgList = pPkgList;
 
 cleanup:
-    dataiterator_free(&di);
     queue_free(&queueAdv);
     return dwError;
 
@@ -1017,6 +1207,344 @@ error:
     goto cleanup;
 }
 
+/*
+ * Add the names that idDep can be matched by with a plain name to
+ * pQueueNames. These are the name of a versioned dependency, and the
+ * names in both branches of a rich one. Some may not actually match,
+ * see pool_match_dep().
+ */
+static void
+_SolvGetDepNames(
+    Pool *pPool,
+    Id idDep,
+    Queue *pQueueNames
+    )
+{
+    Reldep *pRelDep = NULL;
+
+    while (ISRELDEP(idDep))
+    {
+        pRelDep = GETRELDEP(pPool, idDep);
+        switch (pRelDep->flags)
+        {
+            case REL_AND:
+            case REL_OR:
+            case REL_WITH:
+            case REL_WITHOUT:
+            case REL_COND:
+            case REL_UNLESS:
+            case REL_ELSE:
+                _SolvGetDepNames(pPool, pRelDep->name, pQueueNames);
+                idDep = pRelDep->evr;
+                break;
+            default:
+                idDep = pRelDep->name;
+                break;
+        }
+    }
+    queue_push(pQueueNames, idDep);
+}
+
+/*
+ * Fill pIndex from (name, solvable) pairs, with a counting sort by
+ * name that keeps the solvables of a name in order.
+ */
+static uint32_t
+_SolvFillNameIndex(
+    Pool *pPool,
+    Queue *pQueuePairs,
+    SolvNameIndex *pIndex
+    )
+{
+    uint32_t dwError = 0;
+    int i, nNames;
+
+    nNames = pPool->ss.nstrings;
+    dwError = TDNFAllocateMemory(nNames + 1, sizeof(Id),
+                                 (void **)&pIndex->pOffsets);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    dwError = TDNFAllocateMemory(pQueuePairs->count / 2 + 1, sizeof(Id),
+                                 (void **)&pIndex->pSolvables);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    for (i = 0; i < pQueuePairs->count; i += 2)
+    {
+        pIndex->pOffsets[pQueuePairs->elements[i] + 1]++;
+    }
+    for (i = 0; i < nNames; i++)
+    {
+        pIndex->pOffsets[i + 1] += pIndex->pOffsets[i];
+    }
+    /* use the start of the next name as the fill position, then shift */
+    for (i = 0; i < pQueuePairs->count; i += 2)
+    {
+        Id idName = pQueuePairs->elements[i];
+
+        pIndex->pSolvables[pIndex->pOffsets[idName]++] =
+            pQueuePairs->elements[i + 1];
+    }
+    for (i = nNames; i > 0; i--)
+    {
+        pIndex->pOffsets[i] = pIndex->pOffsets[i - 1];
+    }
+    pIndex->pOffsets[0] = 0;
+
+    pIndex->nNames = nNames;
+    pIndex->nSolvables = pPool->nsolvables;
+
+cleanup:
+    return dwError;
+
+error:
+    TDNF_SAFE_FREE_MEMORY(pIndex->pOffsets);
+    TDNF_SAFE_FREE_MEMORY(pIndex->pSolvables);
+    goto cleanup;
+}
+
+/*
+ * Index all solvables of the pool by the names in their idKey
+ * dependencies. Unlike the whatprovides index, this has all solvables,
+ * including source packages and excluded ones, which repoquery shows
+ * too.
+ */
+static uint32_t
+_SolvBuildDepIndex(
+    PSolvSack pSack,
+    Id idKey,
+    SolvNameIndex *pIndex
+    )
+{
+    uint32_t dwError = 0;
+    Pool *pPool = pSack->pPool;
+    Queue queueDeps = {0};
+    Queue queueNames = {0};
+    Queue queuePairs = {0};
+    Solvable *pSolvable = NULL;
+    Id p;
+    int i;
+
+    queue_init(&queueDeps);
+    queue_init(&queueNames);
+    queue_init(&queuePairs);
+
+    /* (name, solvable) pairs, in order of the solvables */
+    for (p = 2; p < pPool->nsolvables; p++)
+    {
+        pSolvable = pool_id2solvable(pPool, p);
+        if (!pSolvable->repo)
+        {
+            continue;
+        }
+        /* the queue is left as it is if there are no such deps */
+        queue_empty(&queueDeps);
+        solvable_lookup_deparray(pSolvable, idKey, &queueDeps, 0);
+
+        queue_empty(&queueNames);
+        for (i = 0; i < queueDeps.count; i++)
+        {
+            if (queueDeps.elements[i] != SOLVABLE_PREREQMARKER &&
+                queueDeps.elements[i] != SOLVABLE_FILEMARKER)
+            {
+                _SolvGetDepNames(pPool, queueDeps.elements[i], &queueNames);
+            }
+        }
+        for (i = 0; i < queueNames.count; i++)
+        {
+            queue_push2(&queuePairs, queueNames.elements[i], p);
+        }
+    }
+
+    dwError = _SolvFillNameIndex(pPool, &queuePairs, pIndex);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+cleanup:
+    queue_free(&queueDeps);
+    queue_free(&queueNames);
+    queue_free(&queuePairs);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/*
+ * Index all solvables of the pool by their name, see
+ * SolvFindSolvablesByName().
+ */
+static uint32_t
+_SolvBuildNameIndex(
+    PSolvSack pSack,
+    SolvNameIndex *pIndex
+    )
+{
+    uint32_t dwError = 0;
+    Pool *pPool = pSack->pPool;
+    Queue queuePairs = {0};
+    Solvable *pSolvable = NULL;
+    Id p;
+
+    queue_init(&queuePairs);
+    for (p = 2; p < pPool->nsolvables; p++)
+    {
+        pSolvable = pool_id2solvable(pPool, p);
+        if (pSolvable->repo)
+        {
+            queue_push2(&queuePairs, pSolvable->name, p);
+        }
+    }
+
+    dwError = _SolvFillNameIndex(pPool, &queuePairs, pIndex);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+cleanup:
+    queue_free(&queuePairs);
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+static uint32_t
+_SolvGetDepIndex(
+    PSolvSack pSack,
+    REPOQUERY_WHAT_KEY whatKey,
+    SolvNameIndex **ppIndex
+    )
+{
+    uint32_t dwError = 0;
+    SolvNameIndex *pIndex = &pSack->depIndex[whatKey];
+    Id _allDepKeyIds[] = {
+        SOLVABLE_PROVIDES,
+        SOLVABLE_OBSOLETES,
+        SOLVABLE_CONFLICTS,
+        SOLVABLE_REQUIRES,
+        SOLVABLE_RECOMMENDS,
+        SOLVABLE_SUGGESTS,
+        SOLVABLE_SUPPLEMENTS,
+        SOLVABLE_ENHANCES
+    };
+
+    if (pIndex->nSolvables != pSack->pPool->nsolvables)
+    {
+        TDNF_SAFE_FREE_MEMORY(pIndex->pOffsets);
+        TDNF_SAFE_FREE_MEMORY(pIndex->pSolvables);
+        pIndex->nSolvables = 0;
+
+        dwError = _SolvBuildDepIndex(pSack, _allDepKeyIds[whatKey], pIndex);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    *ppIndex = pIndex;
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+void
+SolvFreeNameIndexes(
+    PSolvSack pSack
+    )
+{
+    int i;
+
+    if (!pSack)
+    {
+        return;
+    }
+    for (i = 0; i < REPOQUERY_WHAT_KEY_DEPENDS; i++)
+    {
+        TDNF_SAFE_FREE_MEMORY(pSack->depIndex[i].pOffsets);
+        TDNF_SAFE_FREE_MEMORY(pSack->depIndex[i].pSolvables);
+        pSack->depIndex[i].nNames = 0;
+        pSack->depIndex[i].nSolvables = 0;
+    }
+    TDNF_SAFE_FREE_MEMORY(pSack->nameIndex.pOffsets);
+    TDNF_SAFE_FREE_MEMORY(pSack->nameIndex.pSolvables);
+    pSack->nameIndex.nNames = 0;
+    pSack->nameIndex.nSolvables = 0;
+}
+
+/*
+ * Add the solvables named pszName to pQueue, in pool order. With
+ * SEARCH_STRING the name is resolved with pool_str2id() and taken from
+ * the name index, which is built on first use. Only SEARCH_GLOB scans
+ * the names of all solvables.
+ */
+uint32_t
+SolvFindSolvablesByName(
+    PSolvSack pSack,
+    const char *pszName,
+    int nSearchFlags,
+    Queue *pQueue
+    )
+{
+    uint32_t dwError = 0;
+    Pool *pPool = NULL;
+    SolvNameIndex *pIndex = NULL;
+    Dataiterator di = {0};
+    Id idName;
+    int i;
+
+    if (!pSack || !pSack->pPool || IsNullOrEmptyString(pszName) || !pQueue)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+    pPool = pSack->pPool;
+
+    if ((nSearchFlags & SEARCH_STRINGMASK) != SEARCH_STRING)
+    {
+        dwError = dataiterator_init(&di, pPool, 0, 0, SOLVABLE_NAME,
+                                    pszName, nSearchFlags);
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+        while (dataiterator_step(&di))
+        {
+            queue_push(pQueue, di.solvid);
+        }
+        dataiterator_free(&di);
+        goto cleanup;
+    }
+
+    pIndex = &pSack->nameIndex;
+    if (pIndex->nSolvables != pPool->nsolvables)
+    {
+        TDNF_SAFE_FREE_MEMORY(pIndex->pOffsets);
+        TDNF_SAFE_FREE_MEMORY(pIndex->pSolvables);
+        pIndex->nSolvables = 0;
+
+        dwError = _SolvBuildNameIndex(pSack, pIndex);
+        BAIL_ON_TDNF_ERROR(dwError);
+    }
+
+    /* a name that is not in the pool can't be the name of a solvable */
+    idName = pool_str2id(pPool, pszName, 0);
+    if (!idName || idName >= pIndex->nNames)
+    {
+        goto cleanup;
+    }
+    for (i = pIndex->pOffsets[idName]; i < pIndex->pOffsets[idName + 1]; i++)
+    {
+        queue_push(pQueue, pIndex->pSolvables[i]);
+    }
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
+/*
+ * Keep the solvables of the query that have one of ppszDeps in their
+ * whatKey dependencies, or with REPOQUERY_WHAT_KEY_DEPENDS in any of
+ * requires, recommends, suggests, supplements and enhances. The
+ * candidates come from the dependency index and are checked with
+ * solvable_matchesdep(), so only they are looked at instead of every
+ * solvable of the query.
+ */
 uint32_t
 SolvApplyDepsFilter(
     PSolvQuery pQuery,
@@ -1024,96 +1552,97 @@ SolvApplyDepsFilter(
     REPOQUERY_WHAT_KEY whatKey)
 {
     uint32_t dwError = 0;
-    Queue queueDeps = {0};
+    Pool *pPool = NULL;
     Queue queueFiltered = {0};
-    int i, j;
-    Id idDep;
-
-    if(!pQuery || !pQuery->pSack || !ppszDeps)
+    Map mapQuery = {0};
+    Map mapMatches = {0};
+    SolvNameIndex *pIndex = NULL;
+    REPOQUERY_WHAT_KEY keys[REPOQUERY_WHAT_KEY_DEPENDS];
+    int nKeys = 0;
+    int i, j, k;
+    Id idDep, p;
+    Id _allDepKeyIds[] = {
+        SOLVABLE_PROVIDES,
+        SOLVABLE_OBSOLETES,
+        SOLVABLE_CONFLICTS,
+        SOLVABLE_REQUIRES,
+        SOLVABLE_RECOMMENDS,
+        SOLVABLE_SUGGESTS,
+        SOLVABLE_SUPPLEMENTS,
+        SOLVABLE_ENHANCES
+    };
+
+    if(!pQuery || !pQuery->pSack || !ppszDeps ||
+       whatKey < 0 || whatKey > REPOQUERY_WHAT_KEY_DEPENDS)
     {
         dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
     }
+    pPool = pQuery->pSack->pPool;
 
-    /* convert string dep array to id queue */
-    queue_init(&queueDeps);
-    for(i = 0; ppszDeps[i] != NULL; i++)
+    if (whatKey != REPOQUERY_WHAT_KEY_DEPENDS)
     {
-        idDep = pool_str2id(pQuery->pSack->pPool, ppszDeps[i], 0);
-        /* if it's not found, nothing can depend on it */
-        if (idDep)
-        {
-            queue_push(&queueDeps, idDep);
-        }
+        /* single dependency type */
+        keys[nKeys++] = whatKey;
+    }
+    else
+    {
+        keys[nKeys++] = REPOQUERY_WHAT_KEY_REQUIRES;
+        keys[nKeys++] = REPOQUERY_WHAT_KEY_RECOMMENDS;
+        keys[nKeys++] = REPOQUERY_WHAT_KEY_SUGGESTS;
+        keys[nKeys++] = REPOQUERY_WHAT_KEY_SUPPLEMENTS;
+        keys[nKeys++] = REPOQUERY_WHAT_KEY_ENHANCES;
     }
 
-    queue_init(&queueFiltered);
+    map_init(&mapQuery, pPool->nsolvables);
+    map_init(&mapMatches, pPool->nsolvables);
     for (j = 0; j < pQuery->queueResult.count; j++)
     {
-        Id idPkg = pQuery->queueResult.elements[j];
-        Solvable *pSolvable = pool_id2solvable(pQuery->pSack->pPool, idPkg);
+        MAPSET(&mapQuery, pQuery->queueResult.elements[j]);
+    }
 
-        if(!pSolvable)
-        {
-            dwError = ERROR_TDNF_NO_DATA;
-            BAIL_ON_TDNF_ERROR(dwError);
-        }
+    for (k = 0; k < nKeys; k++)
+    {
+        dwError = _SolvGetDepIndex(pQuery->pSack, keys[k], &pIndex);
+        BAIL_ON_TDNF_ERROR(dwError);
 
-        for (i = 0; i < queueDeps.count; i++)
+        for(i = 0; ppszDeps[i] != NULL; i++)
         {
-            idDep = queueDeps.elements[i];
-
-            if (whatKey != REPOQUERY_WHAT_KEY_DEPENDS)
+            idDep = pool_str2id(pPool, ppszDeps[i], 0);
+            /* if it's not found, nothing can depend on it */
+            if (!idDep || idDep >= pIndex->nNames)
             {
-                Id _allDepKeyIds[] = {
-                    SOLVABLE_PROVIDES,
-                    SOLVABLE_OBSOLETES,
-                    SOLVABLE_CONFLICTS,
-                    SOLVABLE_REQUIRES,
-                    SOLVABLE_RECOMMENDS,
-                    SOLVABLE_SUGGESTS,
-                    SOLVABLE_SUPPLEMENTS,
-                    SOLVABLE_ENHANCES
-                };
-                /* single dependency type */
-                if (solvable_matchesdep(pSolvable, _allDepKeyIds[whatKey], idDep, 0))
-                {
-                    queue_push(&queueFiltered, idPkg);
-                    break;
-                }
+                continue;
             }
-            else
+            for (j = pIndex->pOffsets[idDep]; j < pIndex->pOffsets[idDep + 1]; j++)
             {
-                size_t k;
-                Id allDepKeys[] = {
-                    SOLVABLE_REQUIRES,
-                    SOLVABLE_RECOMMENDS,
-                    SOLVABLE_SUGGESTS,
-                    SOLVABLE_SUPPLEMENTS,
-                    SOLVABLE_ENHANCES
-                };
-
-                for (k = 0; k < ARRAY_SIZE(allDepKeys); k++)
+                p = pIndex->pSolvables[j];
+                if (MAPTST(&mapQuery, p) && !MAPTST(&mapMatches, p) &&
+                    solvable_matchesdep(pool_id2solvable(pPool, p),
+                                        _allDepKeyIds[keys[k]], idDep, 0))
                 {
-                    if (solvable_matchesdep(pSolvable, allDepKeys[k], idDep, 0))
-                    {
-                        queue_push(&queueFiltered, idPkg);
-                        break;
-                    }
-                }
-                if (k < ARRAY_SIZE(allDepKeys))
-                {
-                    break;
+                    MAPSET(&mapMatches, p);
                 }
             }
         }
     }
 
+    /* keep the order of the query */
+    queue_init(&queueFiltered);
+    for (j = 0; j < pQuery->queueResult.count; j++)
+    {
+        if (MAPTST(&mapMatches, pQuery->queueResult.elements[j]))
+        {
+            queue_push(&queueFiltered, pQuery->queueResult.elements[j]);
+        }
+    }
+
     queue_free(&pQuery->queueResult);
     pQuery->queueResult = queueFiltered;
 
 cleanup:
-    queue_free(&queueDeps);
+    map_free(&mapQuery);
+    map_free(&mapMatches);
     return dwError;
 
 error:
@@ -1121,6 +1650,45 @@ error:
     goto cleanup;
 }
 
+/*
+ * Look up a solvable with the name, arch and, if nWithEvr is set, evr
+ * of p in the open addressing table pTable of size nMask + 1. If there
+ * is none and nAdd is set, p is added. Returns the solvable found or 0.
+ */
+static Id
+_SolvHashLookup(
+    Pool *pPool,
+    Id *pTable,
+    Hashval nMask,
+    Id p,
+    int nWithEvr,
+    int nAdd
+    )
+{
+    const Solvable *pSolvable = pool_id2solvable(pPool, p);
+    const Solvable *pSolvable2 = NULL;
+    Hashval h = 0;
+    Hashval hh = HASHCHAIN_START;
+
+    h = relhash(pSolvable->name, nWithEvr ? pSolvable->evr : 0,
+                pSolvable->arch) & nMask;
+    for (; pTable[h]; h = HASHCHAIN_NEXT(h, hh, nMask))
+    {
+        pSolvable2 = pool_id2solvable(pPool, pTable[h]);
+        if (pSolvable2->name == pSolvable->name &&
+            pSolvable2->arch == pSolvable->arch &&
+            (!nWithEvr || pSolvable2->evr == pSolvable->evr))
+        {
+            return pTable[h];
+        }
+    }
+    if (nAdd)
+    {
+        pTable[h] = p;
+    }
+    return 0;
+}
+
 uint32_t
 SolvApplyExtrasFilter(
     PSolvQuery pQuery)
@@ -1128,7 +1696,9 @@ SolvApplyExtrasFilter(
     uint32_t dwError = 0;
     Pool *pPool;
     Queue queueExtras = {0};
-    int i, j;
+    Id *pTable = NULL;
+    Hashval nMask = 0;
+    int i;
 
     if(!pQuery)
     {
@@ -1140,58 +1710,42 @@ SolvApplyExtrasFilter(
 
     queue_init(&queueExtras);
 
-    /* Outer loop iterates over all installed solvables,
-       inner loop over all solvables that are *not* installed.
-       If we don't find a match, it's an extra package */
     for (i = 0; i < pQuery->queueResult.count; i++)
     {
-        Id idPkg = pQuery->queueResult.elements[i];
-        const Solvable *pSolvable = pool_id2solvable(pPool, idPkg);
-
-        if(!pSolvable)
+        if(!pool_id2solvable(pPool, pQuery->queueResult.elements[i]))
         {
             dwError = ERROR_TDNF_NO_DATA;
             BAIL_ON_TDNF_ERROR(dwError);
         }
+    }
 
-        if (pSolvable->repo == pPool->installed)
-        {
-            int nFound = 0;
-            for (j = 0; j < pQuery->queueResult.count; j++)
-            {
-                if (i != j)
-                {
-                    Id idPkg2 = pQuery->queueResult.elements[j];
-                    const Solvable *pSolvable2 = pool_id2solvable(pPool, idPkg2);
-
-                    if(!pSolvable2)
-                    {
-                        dwError = ERROR_TDNF_NO_DATA;
-                        BAIL_ON_TDNF_ERROR(dwError);
-                    }
+    /* Hash all solvables that are *not* installed by name, arch and
+       evr. An installed solvable without a match is an extra package. */
+    nMask = mkmask(pQuery->queueResult.count);
+    pTable = solv_calloc(nMask + 1, sizeof(Id));
+    for (i = 0; i < pQuery->queueResult.count; i++)
+    {
+        Id idPkg = pQuery->queueResult.elements[i];
 
-                    if (pSolvable2->repo == pPool->installed)
-                    {
-                        continue;
-                    }
+        if (pPool->solvables[idPkg].repo != pPool->installed)
+        {
+            _SolvHashLookup(pPool, pTable, nMask, idPkg, 1, 1);
+        }
+    }
+    for (i = 0; i < pQuery->queueResult.count; i++)
+    {
+        Id idPkg = pQuery->queueResult.elements[i];
 
-                    if (pSolvable2->name == pSolvable->name &&
-                        pSolvable2->arch == pSolvable->arch &&
-                        pSolvable2->evr == pSolvable->evr)
-                    {
-                        nFound = 1;
-                    }
-                }
-            }
-            if (!nFound)
-            {
-                queue_push(&queueExtras, idPkg);
-            }
+        if (pPool->solvables[idPkg].repo == pPool->installed &&
+            !_SolvHashLookup(pPool, pTable, nMask, idPkg, 1, 0))
+        {
+            queue_push(&queueExtras, idPkg);
         }
     }
     queue_free(&pQuery->queueResult);
     pQuery->queueResult = queueExtras;
 cleanup:
+    solv_free(pTable);
     return dwError;
 error:
     queue_free(&queueExtras);
@@ -1205,7 +1759,9 @@ SolvApplyDuplicatesFilter(
     uint32_t dwError = 0;
     Pool *pPool;
     Queue queueDuplicates = {0};
-    int i, j;
+    Id *pTable = NULL;
+    Hashval nMask = 0;
+    int i;
 
     if(!pQuery)
     {
@@ -1219,49 +1775,40 @@ SolvApplyDuplicatesFilter(
 
     for (i = 0; i < pQuery->queueResult.count; i++)
     {
-        Id idPkg = pQuery->queueResult.elements[i];
-        const Solvable *pSolvable = pool_id2solvable(pPool, idPkg);
-
-        if(!pSolvable)
+        if(!pool_id2solvable(pPool, pQuery->queueResult.elements[i]))
         {
             dwError = ERROR_TDNF_NO_DATA;
             BAIL_ON_TDNF_ERROR(dwError);
         }
+    }
 
-        if (pSolvable->repo == pPool->installed)
-        {
-            int nFound = 0;
-            /* no need to compare b with a if we already compared b with a,
-               so we can start with j = i + 1 */
-            for (j = i + 1; j < pQuery->queueResult.count; j++)
-            {
-                Id idPkg2 = pQuery->queueResult.elements[j];
-                const Solvable *pSolvable2 = pool_id2solvable(pPool, idPkg2);
+    /* An installed solvable is a duplicate if another installed one
+       with the same name and arch follows it. Going backwards, that is
+       the case if one was hashed already. */
+    nMask = mkmask(pQuery->queueResult.count);
+    pTable = solv_calloc(nMask + 1, sizeof(Id));
+    for (i = pQuery->queueResult.count - 1; i >= 0; i--)
+    {
+        Id idPkg = pQuery->queueResult.elements[i];
 
-                if(!pSolvable2)
-                {
-                    dwError = ERROR_TDNF_NO_DATA;
-                    BAIL_ON_TDNF_ERROR(dwError);
-                }
-                if (pSolvable2->repo != pPool->installed)
-                {
-                    continue;
-                }
-                if (pSolvable2->name == pSolvable->name &&
-                    pSolvable2->arch == pSolvable->arch)
-                {
-                    nFound = 1;
-                }
-            }
-            if (nFound)
-            {
-                queue_push(&queueDuplicates, idPkg);
-            }
+        if (pPool->solvables[idPkg].repo == pPool->installed &&
+            _SolvHashLookup(pPool, pTable, nMask, idPkg, 0, 1))
+        {
+            queue_push(&queueDuplicates, idPkg);
         }
     }
+    /* back to the order of the result */
+    for (i = 0; i < queueDuplicates.count / 2; i++)
+    {
+        Id idTmp = queueDuplicates.elements[i];
+        queueDuplicates.elements[i] =
+            queueDuplicates.elements[queueDuplicates.count - 1 - i];
+        queueDuplicates.elements[queueDuplicates.count - 1 - i] = idTmp;
+    }
     queue_free(&pQuery->queueResult);
     pQuery->queueResult = queueDuplicates;
 cleanup:
+    solv_free(pTable);
     return dwError;
 error:
     queue_free(&queueDuplicates);
@@ -1334,7 +1881,8 @@ SolvApplyFileProvidesFilter(
     uint32_t dwError = 0;
     Pool *pool;
     Queue queueFiltered = {0};
-    Dataiterator di;
+    Queue queueFiles = {0};
+    Map mapFiles = {0};
     int i;
 
     if(!pQuery || IsNullOrEmptyString(pszFile))
@@ -1346,22 +1894,31 @@ SolvApplyFileProvidesFilter(
     pool = pQuery->pSack->pPool;
 
     queue_init(&queueFiltered);
+    queue_init(&queueFiles);
+    map_init(&mapFiles, pool->nsolvables);
 
+    dwError = SolvFindFileProviders(pQuery->pSack, pszFile, SEARCH_STRING,
+                                    &queueFiles);
+    BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+
+    for (i = 0; i < queueFiles.count; i++)
+    {
+        MAPSET(&mapFiles, queueFiles.elements[i]);
+    }
     for (i = 0; i < pQuery->queueResult.count; i++)
     {
         Id idPkg = pQuery->queueResult.elements[i];
 
-        dataiterator_init(&di, pool, NULL, idPkg, SOLVABLE_FILELIST, pszFile,
-                          SEARCH_FILES | SEARCH_STRING);
-        /* using 'if' instead of 'while' because one match is enough */
-        if (dataiterator_step(&di)) {
+        if (MAPTST(&mapFiles, idPkg))
+        {
             queue_push(&queueFiltered, idPkg);
         }
-        dataiterator_free(&di);
     }
     queue_free(&pQuery->queueResult);
     pQuery->queueResult = queueFiltered;
 cleanup:
+    queue_free(&queueFiles);
+    map_free(&mapFiles);
     return dwError;
 error:
     queue_free(&queueFiltered);
@@ -9,6 +9,29 @@
 
 #include "includes.h"
 
+/* file name suffixes of the extension caches, see SOLV_EXT_TYPE */
+static const char *aszSolvExtNames[SOLV_EXT_COUNT] = {
+    "filelists",
+    "other",
+    "updateinfo"
+};
+
+static
+uint32_t
+_SolvWriteSolvFile(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo,
+    Repowriter *pWriter,
+    const unsigned char *pszCookie,
+    char **ppszTempSolvFile
+    );
+
+static
+uint32_t
+_SolvLoadRepoExt(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo,
+    SOLV_EXT_TYPE nExt
+    );
+
 uint32_t
 SolvLoadRepomd(
     Repo* pRepo,
@@ -352,32 +375,65 @@ error:
     goto cleanup;
 }
 
+/*
+ * Read the installed packages into the @System repo. A solv copy of it
+ * is kept as <cachedir>/solvcache/@System.solv, with a cookie of the
+ * rpmdb state appended. If the cookie still matches the rpmdb, the
+ * solv file is loaded as is. Otherwise it is used as the reference
+ * for repo_add_rpmdb_reffp() so only changed headers are read, and
+ * written again afterwards.
+ */
 uint32_t
 SolvReadInstalledRpms(
-    Repo* pRepo,
-    const char *pszCacheFileName
+    PSolvSack pSack,
+    const char *pszCacheDir
     )
 {
     uint32_t dwError = 0;
+    Repo *pRepo = NULL;
     FILE *pCacheFile = NULL;
     int  dwFlags = 0;
+    char *pszCacheFilePath = NULL;
+    SOLV_REPO_INFO_INTERNAL stSolvRepoInfo = {0};
 
-    if(!pRepo)
+    if(!pSack || !pSack->pPool || !pSack->pPool->installed)
     {
         dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
     }
+    pRepo = pSack->pPool->installed;
 
-    if(pszCacheFileName && access(pszCacheFileName, F_OK) == 0)
+    if (pszCacheDir)
     {
-        /* coverity[toctou] */
-        pCacheFile = fopen(pszCacheFileName, "r");
+        stSolvRepoInfo.pRepo = pRepo;
+        stSolvRepoInfo.pszRepoCacheDir = (char *)pszCacheDir;
+
+        dwError = SolvCalculateCookieForRpmDb(pRepo->pool, stSolvRepoInfo.cookie);
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+        stSolvRepoInfo.nCookieSet = 1;
 
-        if(!pCacheFile)
+        dwError = SolvGetMetaDataCachePath(&stSolvRepoInfo, &pszCacheFilePath);
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+
+        dwError = SolvAddSolvCacheFile(pRepo, pszCacheFilePath,
+                                       stSolvRepoInfo.cookie, 0);
+        if (dwError == 0)
         {
-            dwError = errno;
-            BAIL_ON_TDNF_SYSTEM_ERROR(dwError);
+            pSack->nProvidesDirty = 1;
+            goto cleanup;
+        }
+        if (dwError == ERROR_TDNF_SOLV_CACHE_NOT_CREATED)
+        {
+            /* stale, but good enough as a reference */
+            /* coverity[toctou] */
+            pCacheFile = fopen(pszCacheFilePath, "r");
+        }
+        else
+        {
+            /* unusable cache, fall back to reading the whole rpmdb */
+            repo_empty(pRepo, 1);
         }
+        dwError = 0;
     }
 
     dwFlags = REPO_REUSE_REPODATA | RPM_ADD_WITH_HDRID | REPO_USE_ROOTDIR;
@@ -388,16 +444,75 @@ SolvReadInstalledRpms(
         dwError = ERROR_TDNF_SOLV_IO;
         BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
     }
+    pSack->nProvidesDirty = 1;
+
+    /* the cache is only an optimization, e.g. non root users
+       cannot write it */
+    if (stSolvRepoInfo.nCookieSet)
+    {
+        SolvCreateMetaDataCache(pSack, &stSolvRepoInfo);
+    }
 
 cleanup:
     if (pCacheFile)
         fclose(pCacheFile);
+    TDNF_SAFE_FREE_MEMORY(pszCacheFilePath);
     return dwError;
 
 error:
     goto cleanup;
 }
 
+/* Cookie for the state of the rpmdb, changes with every transaction */
+uint32_t
+SolvCalculateCookieForRpmDb(
+    Pool *pPool,
+    unsigned char *pszCookie
+    )
+{
+    uint32_t dwError = 0;
+    void *pRpmState = NULL;
+    Chksum *pChkSum = NULL;
+
+    if (!pPool || !pszCookie)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+
+    pRpmState = rpm_state_create(pPool, pool_get_rootdir(pPool));
+
+    pChkSum = solv_chksum_create(REPOKEY_TYPE_SHA256);
+    if (!pChkSum)
+    {
+        dwError = ERROR_TDNF_SOLV_CHKSUM;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+    solv_chksum_add(pChkSum, SOLV_COOKIE_IDENT, strlen(SOLV_COOKIE_IDENT));
+
+    if (rpm_hash_database_state(pRpmState, pChkSum))
+    {
+        dwError = ERROR_TDNF_SOLV_IO;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+    solv_chksum_free(pChkSum, pszCookie);
+    pChkSum = NULL;
+
+cleanup:
+    if (pRpmState)
+    {
+        rpm_state_free(pRpmState);
+    }
+    return dwError;
+
+error:
+    if (pChkSum)
+    {
+        solv_chksum_free(pChkSum, NULL);
+    }
+    goto cleanup;
+}
+
 uint32_t
 SolvCalculateCookieForFile(
     const char *pszFilePath,
@@ -450,6 +565,46 @@ error:
     goto cleanup;
 }
 
+/* Cookie for a metadata part from its checksum in repomd.xml. A cache
+   that depends on another one includes that one's cookie as base. */
+uint32_t
+SolvCalculateCookieForData(
+    const unsigned char *pszBaseCookie,
+    const unsigned char *pbData,
+    size_t nLen,
+    unsigned char *pszCookie
+    )
+{
+    uint32_t dwError = 0;
+    Chksum *pChkSum = NULL;
+
+    if (!pbData || !nLen || !pszCookie)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+
+    pChkSum = solv_chksum_create(REPOKEY_TYPE_SHA256);
+    if (!pChkSum)
+    {
+        dwError = ERROR_TDNF_SOLV_CHKSUM;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+    solv_chksum_add(pChkSum, SOLV_COOKIE_IDENT, strlen(SOLV_COOKIE_IDENT));
+    if (pszBaseCookie)
+    {
+        solv_chksum_add(pChkSum, pszBaseCookie, SOLV_COOKIE_LEN);
+    }
+    solv_chksum_add(pChkSum, pbData, nLen);
+    solv_chksum_free(pChkSum, pszCookie);
+
+cleanup:
+    return dwError;
+
+error:
+    goto cleanup;
+}
+
 /* Create a name for the repo cache path based on repo name and
    a hash of the url.
 */
@@ -588,6 +743,136 @@ error:
     goto cleanup;
 }
 
+/*
+ * Map a cache file read only and check the cookie at its end. Returns
+ * ERROR_TDNF_SOLV_CACHE_NOT_CREATED if the file does not exist or the
+ * cookie does not match pszCookie. The size returned includes the
+ * cookie.
+ */
+uint32_t
+SolvMapCacheFile(
+    const char *pszCacheFilePath,
+    const unsigned char *pszCookie,
+    void **ppMap,
+    size_t *pnSize
+    )
+{
+    uint32_t dwError = 0;
+    int fd = -1;
+    struct stat st = {0};
+    void *pMap = MAP_FAILED;
+
+    if (IsNullOrEmptyString(pszCacheFilePath) || !ppMap || !pnSize)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+
+    fd = open(pszCacheFilePath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        dwError = ERROR_TDNF_SOLV_CACHE_NOT_CREATED;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+    if (fstat(fd, &st) == -1)
+    {
+        dwError = ERROR_TDNF_SOLV_IO;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+    /* too short to hold a cookie, treat like a stale cache */
+    if (st.st_size <= SOLV_COOKIE_LEN)
+    {
+        dwError = ERROR_TDNF_SOLV_CACHE_NOT_CREATED;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+
+    pMap = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (pMap == MAP_FAILED)
+    {
+        dwError = ERROR_TDNF_SOLV_IO;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+
+    if (pszCookie &&
+        memcmp((const char *)pMap + st.st_size - SOLV_COOKIE_LEN,
+               pszCookie, SOLV_COOKIE_LEN) != 0)
+    {
+        dwError = ERROR_TDNF_SOLV_CACHE_NOT_CREATED;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+
+    *ppMap = pMap;
+    *pnSize = st.st_size;
+
+cleanup:
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    return dwError;
+error:
+    if (pMap != MAP_FAILED)
+    {
+        munmap(pMap, st.st_size);
+    }
+    goto cleanup;
+}
+
+/*
+ * Add a solv cache file to pRepo. The file is mapped and handed to
+ * libsolv as a memory backed stream, and the cookie at its end is
+ * compared in place. Returns ERROR_TDNF_SOLV_CACHE_NOT_CREATED if the
+ * file does not exist or the cookie does not match pszCookie.
+ */
+uint32_t
+SolvAddSolvCacheFile(
+    Repo *pRepo,
+    const char *pszCacheFilePath,
+    const unsigned char *pszCookie,
+    int nFlags
+    )
+{
+    uint32_t dwError = 0;
+    void *pMap = NULL;
+    size_t nSize = 0;
+    FILE *fp = NULL;
+
+    if (!pRepo || IsNullOrEmptyString(pszCacheFilePath))
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+
+    dwError = SolvMapCacheFile(pszCacheFilePath, pszCookie, &pMap, &nSize);
+    BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    madvise(pMap, nSize, MADV_SEQUENTIAL);
+
+    fp = fmemopen(pMap, nSize, "r");
+    if (fp == NULL)
+    {
+        dwError = ERROR_TDNF_SOLV_IO;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+    if (repo_add_solv(pRepo, fp, nFlags))
+    {
+        dwError = ERROR_TDNF_ADD_SOLV;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+
+cleanup:
+    if (fp != NULL)
+    {
+        fclose(fp);
+    }
+    if (pMap)
+    {
+        munmap(pMap, nSize);
+    }
+    return dwError;
+error:
+    goto cleanup;
+}
+
 uint32_t
 SolvUseMetaDataCache(
     const PSolvSack pSack,
@@ -596,10 +881,8 @@ SolvUseMetaDataCache(
     )
 {
     uint32_t dwError = 0;
-    FILE *fp = NULL;
     Repo *pRepo = NULL;
     const unsigned char *pszCookie = NULL;
-    unsigned char pszTempCookie[32];
     char *pszCacheFilePath = NULL;
 
     if (!pSack || !pSolvRepoInfo || !pSolvRepoInfo->pRepo)
@@ -618,69 +901,253 @@ SolvUseMetaDataCache(
         dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
     }
-    fp = fopen(pszCacheFilePath, "r");
-    if (fp == NULL)
+    // a missing or stale cache is recreated
+    dwError = SolvAddSolvCacheFile(pRepo, pszCacheFilePath, pszCookie, 0);
+    BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+
+    *nUseMetaDataCache = 1;
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszCacheFilePath);
+    return dwError;
+error:
+    if (dwError == ERROR_TDNF_SOLV_CACHE_NOT_CREATED)
     {
-        dwError = ERROR_TDNF_SOLV_CACHE_NOT_CREATED;
-        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+        dwError = 0;
     }
-    // Reading the cookie from cached Solv File
-    if (fseek (fp, -sizeof(pszTempCookie), SEEK_END) || fread (pszTempCookie, sizeof(pszTempCookie), 1, fp) != 1)
+    goto cleanup;
+}
+
+uint32_t
+SolvCreateMetaDataCache(
+    const PSolvSack pSack,
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo
+    )
+{
+    uint32_t dwError = 0;
+    char *pszTempSolvFile = NULL;
+    char *pszCacheFilePath = NULL;
+
+    if (!pSack || !pSolvRepoInfo)
     {
-        dwError = ERROR_TDNF_SOLV_IO;
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
     }
-    // compare the calculated cookie with the one read from Solv file
-    if (pszCookie && memcmp (pszCookie, pszTempCookie, sizeof(pszTempCookie)) != 0)
+
+    dwError = _SolvWriteSolvFile(pSolvRepoInfo, NULL,
+                                 pSolvRepoInfo->cookie, &pszTempSolvFile);
+    BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+
+    dwError = SolvAddSolvMetaData(pSolvRepoInfo, pszTempSolvFile);
+    BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+
+    dwError = SolvGetMetaDataCachePath(pSolvRepoInfo, &pszCacheFilePath);
+    BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+
+    if (IsNullOrEmptyString(pszCacheFilePath))
     {
-        dwError = ERROR_TDNF_SOLV_IO;
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
     }
-    rewind(fp);
-    if (repo_add_solv(pRepo, fp, 0))
+
+    if (rename(pszTempSolvFile, pszCacheFilePath) == -1)
     {
-        dwError = ERROR_TDNF_ADD_SOLV;
+        dwError = ERROR_TDNF_SYSTEM_BASE + errno;
         BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
     }
-    *nUseMetaDataCache = 1;
 
-cleanup:
-    if (fp != NULL)
+    /* search can do without its index, so failing to write it is
+       not an error. The rpmdb changes with every transaction and is
+       searched without one, see SolvApplySearch(). */
+    if (strcmp(pSolvRepoInfo->pRepo->name, SYSTEM_REPO_NAME))
     {
-       fclose(fp);
+        SolvCreateSearchIndex(pSolvRepoInfo);
     }
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszTempSolvFile);
     TDNF_SAFE_FREE_MEMORY(pszCacheFilePath);
     return dwError;
 error:
-    if (dwError == ERROR_TDNF_SOLV_CACHE_NOT_CREATED)
+    if (pszTempSolvFile)
     {
-        dwError = 0;
+        unlink(pszTempSolvFile);
     }
     goto cleanup;
 }
 
 uint32_t
-SolvCreateMetaDataCache(
-    const PSolvSack pSack,
-    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo
+SolvGetMetaDataExtCachePath(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo,
+    SOLV_EXT_TYPE nExt,
+    char** ppszCachePath
+    )
+{
+    uint32_t dwError = 0;
+    char *pszCachePath = NULL;
+    Repo *pRepo = NULL;
+
+    if (!pSolvRepoInfo || !pSolvRepoInfo->pRepo ||
+        nExt >= SOLV_EXT_COUNT || !ppszCachePath ||
+        IsNullOrEmptyString(pSolvRepoInfo->pRepo->name))
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+    pRepo = pSolvRepoInfo->pRepo;
+
+    dwError = TDNFAllocateStringPrintf(
+                  &pszCachePath,
+                  "%s/%s/%s-%s.solvx",
+                  pSolvRepoInfo->pszRepoCacheDir,
+                  TDNF_SOLVCACHE_DIR_NAME,
+                  pRepo->name,
+                  aszSolvExtNames[nExt]);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    *ppszCachePath = pszCachePath;
+cleanup:
+    return dwError;
+error:
+    TDNF_SAFE_FREE_MEMORY(pszCachePath);
+    goto cleanup;
+}
+
+/*
+ * Load extension nExt (file lists, changelogs or updateinfo) for all
+ * repos that have not loaded it yet, see SolvLoadRepoMetaDataExt().
+ */
+uint32_t
+SolvLoadMetaDataExt(
+    PSolvSack pSack,
+    SOLV_EXT_TYPE nExt
     )
 {
     uint32_t dwError = 0;
+    Pool *pool = NULL; /* FOR_REPOS needs this name */
     Repo *pRepo = NULL;
+    int i = 0;
+
+    if (!pSack || !pSack->pPool || nExt >= SOLV_EXT_COUNT)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+    pool = pSack->pPool;
+
+    FOR_REPOS(i, pRepo)
+    {
+        if (!pRepo->appdata)
+        {
+            continue;
+        }
+        dwError = SolvLoadRepoMetaDataExt(pSack, pRepo->appdata, nExt);
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+
+cleanup:
+    return dwError;
+error:
+    goto cleanup;
+}
+
+/*
+ * Load extension nExt for one repo, unless it was loaded already. The
+ * extension is read from its own solv file next to the main cache, or
+ * parsed from the metadata and cached if that file is missing or
+ * stale. Since file lists add file provides, loading them marks the
+ * sack dirty.
+ */
+uint32_t
+SolvLoadRepoMetaDataExt(
+    PSolvSack pSack,
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo,
+    SOLV_EXT_TYPE nExt
+    )
+{
+    uint32_t dwError = 0;
+
+    if (!pSack || !pSolvRepoInfo || nExt >= SOLV_EXT_COUNT)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+    if (pSolvRepoInfo->nExtLoaded[nExt])
+    {
+        goto cleanup;
+    }
+    /* try only once, even if loading fails */
+    pSolvRepoInfo->nExtLoaded[nExt] = 1;
+    if (IsNullOrEmptyString(pSolvRepoInfo->ppszExtMetaData[nExt]))
+    {
+        goto cleanup;
+    }
+
+    dwError = _SolvLoadRepoExt(pSolvRepoInfo, nExt);
+    BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+
+    if (nExt == SOLV_EXT_FILELISTS)
+    {
+        pSack->nProvidesDirty = 1;
+    }
+
+cleanup:
+    return dwError;
+error:
+    goto cleanup;
+}
+
+void
+SolvFreeRepoInfo(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo
+    )
+{
+    int i = 0;
+
+    if (!pSolvRepoInfo)
+    {
+        return;
+    }
+    for (i = 0; i < SOLV_EXT_COUNT; i++)
+    {
+        TDNF_SAFE_FREE_MEMORY(pSolvRepoInfo->ppszExtMetaData[i]);
+    }
+    if (pSolvRepoInfo->pSearchIndex)
+    {
+        munmap(pSolvRepoInfo->pSearchIndex, pSolvRepoInfo->nSearchIndexSize);
+    }
+    if (pSolvRepoInfo->pFileIndex)
+    {
+        munmap(pSolvRepoInfo->pFileIndex, pSolvRepoInfo->nFileIndexSize);
+    }
+    TDNF_SAFE_FREE_MEMORY(pSolvRepoInfo->pszRepoCacheDir);
+    TDNFFreeMemory(pSolvRepoInfo);
+}
+
+/*
+ * Create a new temporary file in the solv cache dir of the repo, to be
+ * renamed to the cache file once it is written.
+ */
+uint32_t
+SolvCreateCacheTempFile(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo,
+    FILE **ppFile,
+    char **ppszTempFile
+    )
+{
+    uint32_t dwError = 0;
     FILE *fp = NULL;
-    int fd = 0;
+    int fd = -1;
     char *pszSolvCacheDir = NULL;
-    char *pszTempSolvFile = NULL;
-    char *pszCacheFilePath = NULL;
+    char *pszTempFile = NULL;
     mode_t mask = 0;
 
-    if (!pSack || !pSolvRepoInfo)
+    if (!pSolvRepoInfo || !pSolvRepoInfo->pszRepoCacheDir ||
+        !ppFile || !ppszTempFile)
     {
         dwError = ERROR_TDNF_INVALID_PARAMETER;
         BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
     }
 
-    pRepo = pSolvRepoInfo->pRepo;
     dwError = TDNFJoinPath(
                   &pszSolvCacheDir,
                   pSolvRepoInfo->pszRepoCacheDir,
@@ -704,10 +1171,10 @@ SolvCreateMetaDataCache(
         BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
     }
 
-    pszTempSolvFile = solv_dupjoin(pszSolvCacheDir, "/", ".newsolv-XXXXXX");
+    pszTempFile = solv_dupjoin(pszSolvCacheDir, "/", ".newsolv-XXXXXX");
     mask = umask(S_IRUSR | S_IWUSR | S_IRWXG);
     umask(mask);
-    fd = mkstemp(pszTempSolvFile);
+    fd = mkstemp(pszTempFile);
     if (fd < 0)
     {
         dwError = ERROR_TDNF_SOLV_IO;
@@ -720,7 +1187,46 @@ SolvCreateMetaDataCache(
         dwError = ERROR_TDNF_SOLV_IO;
         BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
     }
-    if (repo_write(pRepo, fp))
+
+    *ppFile = fp;
+    *ppszTempFile = pszTempFile;
+    pszTempFile = NULL;
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszTempFile);
+    TDNF_SAFE_FREE_MEMORY(pszSolvCacheDir);
+    return dwError;
+error:
+    if (fd >= 0)
+    {
+        close(fd);
+        unlink(pszTempFile);
+    }
+    goto cleanup;
+}
+
+/*
+ * Write what pWriter selects, or the whole repo if pWriter is NULL,
+ * followed by the cookie to a new temporary file in the solv cache dir
+ * of the repo.
+ */
+static
+uint32_t
+_SolvWriteSolvFile(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo,
+    Repowriter *pWriter,
+    const unsigned char *pszCookie,
+    char **ppszTempSolvFile
+    )
+{
+    uint32_t dwError = 0;
+    FILE *fp = NULL;
+    char *pszTempSolvFile = NULL;
+
+    dwError = SolvCreateCacheTempFile(pSolvRepoInfo, &fp, &pszTempSolvFile);
+    BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+
+    if (pWriter ? repowriter_write(pWriter, fp) :
+                  repo_write(pSolvRepoInfo->pRepo, fp))
     {
         dwError = ERROR_TDNF_REPO_WRITE;
         BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
@@ -728,7 +1234,7 @@ SolvCreateMetaDataCache(
 
     if (pSolvRepoInfo->nCookieSet)
     {
-        if (fwrite(pSolvRepoInfo->cookie, SOLV_COOKIE_LEN, 1, fp) != 1)
+        if (fwrite(pszCookie, SOLV_COOKIE_LEN, 1, fp) != 1)
         {
             dwError = ERROR_TDNF_SOLV_IO;
             BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
@@ -742,39 +1248,134 @@ SolvCreateMetaDataCache(
         BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
     }
     fp = NULL;
-    dwError = SolvAddSolvMetaData(pSolvRepoInfo, pszTempSolvFile);
-    BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
 
-    dwError = SolvGetMetaDataCachePath(pSolvRepoInfo, &pszCacheFilePath);
-    BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    *ppszTempSolvFile = pszTempSolvFile;
+    pszTempSolvFile = NULL;
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszTempSolvFile);
+    return dwError;
+error:
+    if (fp != NULL)
+    {
+        fclose(fp);
+    }
+    if (pszTempSolvFile)
+    {
+        unlink(pszTempSolvFile);
+    }
+    goto cleanup;
+}
 
-    if (IsNullOrEmptyString(pszCacheFilePath))
+/*
+ * File lists and changelogs extend the primary solvables, while
+ * updateinfo adds patches after them. So the extensions are read with
+ * the repo narrowed to the primary solvables, and the updateinfo cache
+ * only holds the patches and their repodata. That way each cache
+ * depends on its own part (and primary) only.
+ */
+static
+uint32_t
+_SolvLoadRepoExt(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo,
+    SOLV_EXT_TYPE nExt
+    )
+{
+    uint32_t dwError = 0;
+    Repo *pRepo = pSolvRepoInfo->pRepo;
+    char *pszCacheFilePath = NULL;
+    char *pszTempSolvFile = NULL;
+    Repowriter *pWriter = NULL;
+    int nRepoDataStart = pRepo->nrepodata;
+    int nFlags = 0;
+    Id nRepoEnd = pRepo->end;
+
+    if (nExt == SOLV_EXT_UPDATEINFO)
     {
-        dwError = ERROR_TDNF_INVALID_PARAMETER;
-        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+        pSolvRepoInfo->nPrimaryEnd = pRepo->end;
+    }
+    else
+    {
+        nFlags = REPO_EXTEND_SOLVABLES | REPO_LOCALPOOL;
+        if (pSolvRepoInfo->nPrimaryEnd)
+        {
+            pRepo->end = pSolvRepoInfo->nPrimaryEnd;
+        }
     }
 
-    if (rename(pszTempSolvFile, pszCacheFilePath) == -1)
+    if (pSolvRepoInfo->nCookieSet && pSolvRepoInfo->pszRepoCacheDir)
     {
-        dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+        dwError = SolvGetMetaDataExtCachePath(pSolvRepoInfo, nExt,
+                                              &pszCacheFilePath);
         BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+
+        if (SolvAddSolvCacheFile(pRepo, pszCacheFilePath,
+                                 pSolvRepoInfo->ppExtCookie[nExt],
+                                 nFlags) == 0)
+        {
+            goto cleanup;
+        }
+    }
+
+    switch (nExt)
+    {
+        case SOLV_EXT_FILELISTS:
+            dwError = SolvLoadRepomdFilelists(pRepo,
+                          pSolvRepoInfo->ppszExtMetaData[nExt]);
+            break;
+        case SOLV_EXT_OTHER:
+            dwError = SolvLoadRepomdOther(pRepo,
+                          pSolvRepoInfo->ppszExtMetaData[nExt]);
+            break;
+        default:
+            dwError = SolvLoadRepomdUpdateinfo(pRepo,
+                          pSolvRepoInfo->ppszExtMetaData[nExt]);
+            break;
     }
-    unlink(pszTempSolvFile);
+    BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+
+    /* cache for next time. Not being able to, e.g. as non root user,
+       is not an error. */
+    if (pszCacheFilePath)
+    {
+        pWriter = repowriter_create(pRepo);
+        repowriter_set_repodatarange(pWriter, nRepoDataStart,
+                                     pRepo->nrepodata);
+        if (nExt == SOLV_EXT_UPDATEINFO)
+        {
+            repowriter_set_solvablerange(pWriter,
+                                         pSolvRepoInfo->nPrimaryEnd,
+                                         pRepo->end);
+        }
+        else
+        {
+            repowriter_set_flags(pWriter, REPOWRITER_NO_STORAGE_SOLVABLE);
+        }
+        if (!_SolvWriteSolvFile(pSolvRepoInfo, pWriter,
+                                pSolvRepoInfo->ppExtCookie[nExt],
+                                &pszTempSolvFile) &&
+            rename(pszTempSolvFile, pszCacheFilePath) == -1)
+        {
+            unlink(pszTempSolvFile);
+        }
+        /* file lookups can do without their index */
+        if (nExt == SOLV_EXT_FILELISTS)
+        {
+            SolvCreateFileIndex(pSolvRepoInfo);
+        }
+    }
+
 cleanup:
-    TDNF_SAFE_FREE_MEMORY(pszTempSolvFile);
-    TDNF_SAFE_FREE_MEMORY(pszSolvCacheDir);
-    TDNF_SAFE_FREE_MEMORY(pszCacheFilePath);
-    return dwError;
-error:
-    if (fp != NULL)
+    if (nExt != SOLV_EXT_UPDATEINFO)
     {
-        fclose(fp);
-        unlink(pszTempSolvFile);
+        pRepo->end = nRepoEnd;
     }
-    else if (fd > 0)
+    if (pWriter)
     {
-        close(fd);
-        unlink(pszTempSolvFile);
+        repowriter_free(pWriter);
     }
+    TDNF_SAFE_FREE_MEMORY(pszCacheFilePath);
+    TDNF_SAFE_FREE_MEMORY(pszTempSolvFile);
+    return dwError;
+error:
     goto cleanup;
 }
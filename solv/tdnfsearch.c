@@ -0,0 +1,713 @@
+/*
+ * Copyright (C) 2023 VMware, Inc. All Rights Reserved.
+ *
+ * Licensed under the GNU Lesser General Public License v2.1 (the "License");
+ * you may not use this file except in compliance with the License. The terms
+ * of the License are located in the COPYING file of this distribution.
+ */
+
+/*
+ * Trigram index over name, summary and description of the primary
+ * solvables of a repo, kept next to its solv cache. Search narrows the
+ * candidates with it and only checks those against the strings.
+ *
+ * The file has a header, the trigram table sorted by trigram, the
+ * postings and the cookie of the main cache. The postings of a trigram
+ * are the offsets of its solvables from the start of the repo, in
+ * ascending order and delta coded as varints.
+ */
+
+#define _GNU_SOURCE 1
+#include <ctype.h>
+#include "includes.h"
+
+#define SEARCH_INDEX_MAGIC     "tdnfsix1"
+#define SEARCH_INDEX_MAGIC_LEN 8
+
+typedef struct _SOLV_SEARCH_INDEX_HEADER
+{
+    char     szMagic[SEARCH_INDEX_MAGIC_LEN];
+    uint32_t dwSolvables;
+    uint32_t dwTrigrams;
+} SOLV_SEARCH_INDEX_HEADER, *PSOLV_SEARCH_INDEX_HEADER;
+
+typedef struct _SOLV_SEARCH_INDEX_ENTRY
+{
+    uint32_t dwTrigram;
+    uint32_t dwCount;
+    /* start of the postings, from the end of the table */
+    uint32_t dwOffset;
+} SOLV_SEARCH_INDEX_ENTRY, *PSOLV_SEARCH_INDEX_ENTRY;
+
+static
+uint32_t
+_SolvGetSearchIndexPath(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo,
+    char **ppszIndexPath
+    );
+
+static
+Id
+_SolvSearchIndexEnd(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo
+    );
+
+static
+void
+_SolvLoadSearchIndex(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo
+    );
+
+static
+void
+_SolvAddTrigrams(
+    Queue *pQueue,
+    const char *pszString
+    );
+
+static
+int
+_SolvCmpIds(
+    const void *pId1,
+    const void *pId2,
+    void *pData
+    );
+
+static
+int
+_SolvCmpIdPairs(
+    const void *pId1,
+    const void *pId2,
+    void *pData
+    );
+
+static
+PSOLV_SEARCH_INDEX_ENTRY
+_SolvFindTrigram(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo,
+    Id dwTrigram
+    );
+
+static
+uint32_t
+_SolvDecodePostings(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo,
+    PSOLV_SEARCH_INDEX_ENTRY pEntry,
+    Queue *pQueue
+    );
+
+static
+uint32_t
+_SolvSearchCandidates(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo,
+    const char *pszTerm,
+    Queue *pQueueCandidates
+    );
+
+static
+int
+_SolvSolvableMatches(
+    Solvable *pSolvable,
+    const char *pszTerm
+    );
+
+/*
+ * Write the search index of the primary solvables of a repo that was
+ * just loaded. It is bound to the main cache by its cookie.
+ */
+uint32_t
+SolvCreateSearchIndex(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo
+    )
+{
+    uint32_t dwError = 0;
+    Repo *pRepo = NULL;
+    Pool *pPool = NULL;
+    Solvable *pSolvable = NULL;
+    Queue queueTrigrams = {0};
+    Queue queuePairs = {0};
+    Id p = 0;
+    Id nEnd = 0;
+    int i = 0;
+    int nCount = 0;
+    SOLV_SEARCH_INDEX_HEADER stHeader = {0};
+    PSOLV_SEARCH_INDEX_ENTRY pEntries = NULL;
+    PSOLV_SEARCH_INDEX_ENTRY pEntry = NULL;
+    unsigned char *pbPostings = NULL;
+    uint32_t dwPostingsLen = 0;
+    uint32_t dwDelta = 0;
+    Id nLast = 0;
+    FILE *fp = NULL;
+    char *pszTempFile = NULL;
+    char *pszIndexPath = NULL;
+
+    if (!pSolvRepoInfo || !pSolvRepoInfo->pRepo ||
+        !pSolvRepoInfo->nCookieSet)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+    pRepo = pSolvRepoInfo->pRepo;
+    pPool = pRepo->pool;
+    nEnd = _SolvSearchIndexEnd(pSolvRepoInfo);
+
+    queue_init(&queueTrigrams);
+    queue_init(&queuePairs);
+
+    /* (trigram, offset) for each distinct trigram of each solvable */
+    for (p = pRepo->start; p < nEnd; p++)
+    {
+        pSolvable = pool_id2solvable(pPool, p);
+        if (pSolvable->repo != pRepo)
+        {
+            continue;
+        }
+        queue_empty(&queueTrigrams);
+        _SolvAddTrigrams(&queueTrigrams, pool_id2str(pPool, pSolvable->name));
+        _SolvAddTrigrams(&queueTrigrams,
+                         solvable_lookup_str(pSolvable, SOLVABLE_SUMMARY));
+        _SolvAddTrigrams(&queueTrigrams,
+                         solvable_lookup_str(pSolvable, SOLVABLE_DESCRIPTION));
+        solv_sort(queueTrigrams.elements, queueTrigrams.count, sizeof(Id),
+                  _SolvCmpIds, NULL);
+        for (i = 0; i < queueTrigrams.count; i++)
+        {
+            if (i == 0 ||
+                queueTrigrams.elements[i] != queueTrigrams.elements[i - 1])
+            {
+                queue_push2(&queuePairs, queueTrigrams.elements[i],
+                            p - pRepo->start);
+            }
+        }
+    }
+    nCount = queuePairs.count / 2;
+    solv_sort(queuePairs.elements, nCount, 2 * sizeof(Id),
+              _SolvCmpIdPairs, NULL);
+
+    dwError = TDNFAllocateMemory(nCount + 1, sizeof(SOLV_SEARCH_INDEX_ENTRY),
+                                 (void **)&pEntries);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    /* a varint of 32 bits takes at most 5 bytes */
+    dwError = TDNFAllocateMemory((size_t)nCount * 5 + 1, 1,
+                                 (void **)&pbPostings);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    for (i = 0; i < nCount; i++)
+    {
+        Id dwTrigram = queuePairs.elements[2 * i];
+        Id nOffset = queuePairs.elements[2 * i + 1];
+
+        if (!pEntry || (Id)pEntry->dwTrigram != dwTrigram)
+        {
+            pEntry = &pEntries[stHeader.dwTrigrams++];
+            pEntry->dwTrigram = dwTrigram;
+            pEntry->dwOffset = dwPostingsLen;
+            nLast = 0;
+        }
+        pEntry->dwCount++;
+        for (dwDelta = nOffset - nLast; dwDelta >= 0x80; dwDelta >>= 7)
+        {
+            pbPostings[dwPostingsLen++] = (dwDelta & 0x7f) | 0x80;
+        }
+        pbPostings[dwPostingsLen++] = dwDelta;
+        nLast = nOffset;
+    }
+
+    memcpy(stHeader.szMagic, SEARCH_INDEX_MAGIC, SEARCH_INDEX_MAGIC_LEN);
+    stHeader.dwSolvables = nEnd - pRepo->start;
+
+    dwError = _SolvGetSearchIndexPath(pSolvRepoInfo, &pszIndexPath);
+    BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+
+    dwError = SolvCreateCacheTempFile(pSolvRepoInfo, &fp, &pszTempFile);
+    BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+
+    if (fwrite(&stHeader, sizeof(stHeader), 1, fp) != 1 ||
+        fwrite(pEntries, sizeof(SOLV_SEARCH_INDEX_ENTRY),
+               stHeader.dwTrigrams, fp) != stHeader.dwTrigrams ||
+        fwrite(pbPostings, 1, dwPostingsLen, fp) != dwPostingsLen ||
+        fwrite(pSolvRepoInfo->cookie, SOLV_COOKIE_LEN, 1, fp) != 1)
+    {
+        dwError = ERROR_TDNF_SOLV_IO;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+    if (fclose(fp))
+    {
+        fp = NULL;
+        dwError = ERROR_TDNF_SOLV_IO;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+    fp = NULL;
+
+    if (rename(pszTempFile, pszIndexPath) == -1)
+    {
+        dwError = ERROR_TDNF_SYSTEM_BASE + errno;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+
+cleanup:
+    queue_free(&queueTrigrams);
+    queue_free(&queuePairs);
+    TDNF_SAFE_FREE_MEMORY(pEntries);
+    TDNF_SAFE_FREE_MEMORY(pbPostings);
+    TDNF_SAFE_FREE_MEMORY(pszTempFile);
+    TDNF_SAFE_FREE_MEMORY(pszIndexPath);
+    return dwError;
+error:
+    if (fp)
+    {
+        fclose(fp);
+    }
+    if (pszTempFile)
+    {
+        unlink(pszTempFile);
+    }
+    goto cleanup;
+}
+
+/*
+ * Add a SOLVER_SOLVABLE selection to pQueueSel for each solvable of
+ * pRepo whose name, summary or description contains pszTerm, ignoring
+ * case. Solvables covered by the search index of the repo are only
+ * checked if the index has all trigrams of the term for them, the
+ * others (installed packages, patches) are all checked.
+ */
+uint32_t
+SolvSearchRepo(
+    Repo *pRepo,
+    const char *pszTerm,
+    Queue *pQueueSel
+    )
+{
+    uint32_t dwError = 0;
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo = NULL;
+    Solvable *pSolvable = NULL;
+    Queue queueCandidates = {0};
+    Id p = 0;
+    Id nIndexEnd = 0;
+    int i = 0;
+
+    if (!pRepo || !pszTerm || !pQueueSel)
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+    queue_init(&queueCandidates);
+
+    pSolvRepoInfo = pRepo->appdata;
+    if (pSolvRepoInfo)
+    {
+        _SolvLoadSearchIndex(pSolvRepoInfo);
+    }
+
+    nIndexEnd = pRepo->start;
+    if (pSolvRepoInfo && pSolvRepoInfo->pSearchIndex &&
+        strlen(pszTerm) >= 3)
+    {
+        dwError = _SolvSearchCandidates(pSolvRepoInfo, pszTerm,
+                                        &queueCandidates);
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+        nIndexEnd = _SolvSearchIndexEnd(pSolvRepoInfo);
+    }
+
+    for (i = 0; i < queueCandidates.count; i++)
+    {
+        p = pRepo->start + queueCandidates.elements[i];
+        pSolvable = pool_id2solvable(pRepo->pool, p);
+        if (pSolvable->repo == pRepo &&
+            _SolvSolvableMatches(pSolvable, pszTerm))
+        {
+            queue_push2(pQueueSel, SOLVER_SOLVABLE, p);
+        }
+    }
+    for (p = nIndexEnd; p < pRepo->end; p++)
+    {
+        pSolvable = pool_id2solvable(pRepo->pool, p);
+        if (pSolvable->repo == pRepo &&
+            _SolvSolvableMatches(pSolvable, pszTerm))
+        {
+            queue_push2(pQueueSel, SOLVER_SOLVABLE, p);
+        }
+    }
+
+cleanup:
+    queue_free(&queueCandidates);
+    return dwError;
+error:
+    goto cleanup;
+}
+
+static
+uint32_t
+_SolvGetSearchIndexPath(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo,
+    char **ppszIndexPath
+    )
+{
+    uint32_t dwError = 0;
+    char *pszIndexPath = NULL;
+
+    if (!pSolvRepoInfo->pszRepoCacheDir ||
+        IsNullOrEmptyString(pSolvRepoInfo->pRepo->name))
+    {
+        dwError = ERROR_TDNF_INVALID_PARAMETER;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+
+    dwError = TDNFAllocateStringPrintf(
+                  &pszIndexPath,
+                  "%s/%s/%s-search.idx",
+                  pSolvRepoInfo->pszRepoCacheDir,
+                  TDNF_SOLVCACHE_DIR_NAME,
+                  pSolvRepoInfo->pRepo->name);
+    BAIL_ON_TDNF_ERROR(dwError);
+
+    *ppszIndexPath = pszIndexPath;
+cleanup:
+    return dwError;
+error:
+    TDNF_SAFE_FREE_MEMORY(pszIndexPath);
+    goto cleanup;
+}
+
+/* the index covers the primary solvables, patches follow them */
+static
+Id
+_SolvSearchIndexEnd(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo
+    )
+{
+    return pSolvRepoInfo->nPrimaryEnd ? pSolvRepoInfo->nPrimaryEnd :
+                                        pSolvRepoInfo->pRepo->end;
+}
+
+/*
+ * Map the search index of a repo on first use. If it is missing or
+ * stale it is created, and search goes without it if that fails too.
+ */
+static
+void
+_SolvLoadSearchIndex(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo
+    )
+{
+    uint32_t dwError = 0;
+    char *pszIndexPath = NULL;
+    void *pMap = NULL;
+    size_t nSize = 0;
+    PSOLV_SEARCH_INDEX_HEADER pHeader = NULL;
+    Repo *pRepo = pSolvRepoInfo->pRepo;
+
+    if (pSolvRepoInfo->nSearchIndexLoaded || !pSolvRepoInfo->nCookieSet)
+    {
+        goto cleanup;
+    }
+    pSolvRepoInfo->nSearchIndexLoaded = 1;
+
+    dwError = _SolvGetSearchIndexPath(pSolvRepoInfo, &pszIndexPath);
+    BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+
+    dwError = SolvMapCacheFile(pszIndexPath, pSolvRepoInfo->cookie,
+                               &pMap, &nSize);
+    if (dwError == ERROR_TDNF_SOLV_CACHE_NOT_CREATED)
+    {
+        dwError = SolvCreateSearchIndex(pSolvRepoInfo);
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+
+        dwError = SolvMapCacheFile(pszIndexPath, pSolvRepoInfo->cookie,
+                                   &pMap, &nSize);
+    }
+    BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+
+    /* the index must fit the primary solvables it was created for */
+    pHeader = pMap;
+    if (nSize < sizeof(*pHeader) + SOLV_COOKIE_LEN ||
+        memcmp(pHeader->szMagic, SEARCH_INDEX_MAGIC, SEARCH_INDEX_MAGIC_LEN) ||
+        pHeader->dwSolvables !=
+            (uint32_t)(_SolvSearchIndexEnd(pSolvRepoInfo) - pRepo->start) ||
+        (nSize - sizeof(*pHeader) - SOLV_COOKIE_LEN) /
+            sizeof(SOLV_SEARCH_INDEX_ENTRY) < pHeader->dwTrigrams)
+    {
+        dwError = ERROR_TDNF_SOLV_CACHE_NOT_CREATED;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+
+    pSolvRepoInfo->pSearchIndex = pMap;
+    pSolvRepoInfo->nSearchIndexSize = nSize;
+
+cleanup:
+    TDNF_SAFE_FREE_MEMORY(pszIndexPath);
+    return;
+error:
+    if (pMap)
+    {
+        munmap(pMap, nSize);
+    }
+    goto cleanup;
+}
+
+static
+void
+_SolvAddTrigrams(
+    Queue *pQueue,
+    const char *pszString
+    )
+{
+    const unsigned char *psz = (const unsigned char *)pszString;
+
+    if (!psz)
+    {
+        return;
+    }
+    for (; psz[0] && psz[1] && psz[2]; psz++)
+    {
+        queue_push(pQueue, tolower(psz[0]) << 16 |
+                           tolower(psz[1]) << 8 |
+                           tolower(psz[2]));
+    }
+}
+
+static
+int
+_SolvCmpIds(
+    const void *pId1,
+    const void *pId2,
+    void *pData
+    )
+{
+    Id id1 = *(const Id *)pId1;
+    Id id2 = *(const Id *)pId2;
+
+    UNUSED(pData);
+
+    return id1 < id2 ? -1 : id1 > id2;
+}
+
+/* by the first Id of the pair, then the second */
+static
+int
+_SolvCmpIdPairs(
+    const void *pId1,
+    const void *pId2,
+    void *pData
+    )
+{
+    const Id *pIds1 = pId1;
+    const Id *pIds2 = pId2;
+
+    if (pIds1[0] != pIds2[0])
+    {
+        return _SolvCmpIds(pIds1, pIds2, pData);
+    }
+    return _SolvCmpIds(pIds1 + 1, pIds2 + 1, pData);
+}
+
+static
+PSOLV_SEARCH_INDEX_ENTRY
+_SolvFindTrigram(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo,
+    Id dwTrigram
+    )
+{
+    PSOLV_SEARCH_INDEX_HEADER pHeader = pSolvRepoInfo->pSearchIndex;
+    PSOLV_SEARCH_INDEX_ENTRY pEntries = (PSOLV_SEARCH_INDEX_ENTRY)(pHeader + 1);
+    uint32_t dwLow = 0;
+    uint32_t dwHigh = pHeader->dwTrigrams;
+    uint32_t dwMid = 0;
+
+    while (dwLow < dwHigh)
+    {
+        dwMid = dwLow + (dwHigh - dwLow) / 2;
+        if (pEntries[dwMid].dwTrigram == (uint32_t)dwTrigram)
+        {
+            return &pEntries[dwMid];
+        }
+        if (pEntries[dwMid].dwTrigram < (uint32_t)dwTrigram)
+        {
+            dwLow = dwMid + 1;
+        }
+        else
+        {
+            dwHigh = dwMid;
+        }
+    }
+    return NULL;
+}
+
+static
+uint32_t
+_SolvDecodePostings(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo,
+    PSOLV_SEARCH_INDEX_ENTRY pEntry,
+    Queue *pQueue
+    )
+{
+    uint32_t dwError = 0;
+    PSOLV_SEARCH_INDEX_HEADER pHeader = pSolvRepoInfo->pSearchIndex;
+    const unsigned char *pbPostings = NULL;
+    const unsigned char *pbEnd = NULL;
+    const unsigned char *pb = NULL;
+    uint32_t dwValue = 0;
+    uint32_t dwOffset = 0;
+    uint32_t i = 0;
+    int nShift = 0;
+
+    pbPostings = (const unsigned char *)
+                 ((PSOLV_SEARCH_INDEX_ENTRY)(pHeader + 1) + pHeader->dwTrigrams);
+    pbEnd = (const unsigned char *)pSolvRepoInfo->pSearchIndex +
+            pSolvRepoInfo->nSearchIndexSize - SOLV_COOKIE_LEN;
+    if (pEntry->dwOffset > (size_t)(pbEnd - pbPostings))
+    {
+        dwError = ERROR_TDNF_SOLV_IO;
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+    }
+
+    queue_empty(pQueue);
+    pb = pbPostings + pEntry->dwOffset;
+    for (i = 0; i < pEntry->dwCount; i++)
+    {
+        dwValue = 0;
+        for (nShift = 0; ; nShift += 7)
+        {
+            if (pb >= pbEnd || nShift > 28)
+            {
+                dwError = ERROR_TDNF_SOLV_IO;
+                BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+            }
+            dwValue |= (uint32_t)(*pb & 0x7f) << nShift;
+            if (!(*pb++ & 0x80))
+            {
+                break;
+            }
+        }
+        dwOffset += dwValue;
+        if (dwOffset >= pHeader->dwSolvables)
+        {
+            dwError = ERROR_TDNF_SOLV_IO;
+            BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+        }
+        queue_push(pQueue, dwOffset);
+    }
+
+cleanup:
+    return dwError;
+error:
+    goto cleanup;
+}
+
+/*
+ * Offsets of the indexed solvables that have all trigrams of pszTerm,
+ * starting from the rarest trigram. A damaged index makes all
+ * solvables candidates.
+ */
+static
+uint32_t
+_SolvSearchCandidates(
+    PSOLV_REPO_INFO_INTERNAL pSolvRepoInfo,
+    const char *pszTerm,
+    Queue *pQueueCandidates
+    )
+{
+    uint32_t dwError = 0;
+    PSOLV_SEARCH_INDEX_HEADER pHeader = pSolvRepoInfo->pSearchIndex;
+    PSOLV_SEARCH_INDEX_ENTRY pEntry = NULL;
+    PSOLV_SEARCH_INDEX_ENTRY pRarest = NULL;
+    Queue queueTrigrams = {0};
+    Queue queuePostings = {0};
+    Map mapPostings = {0};
+    int i = 0;
+    int j = 0;
+    int k = 0;
+
+    queue_init(&queueTrigrams);
+    queue_init(&queuePostings);
+    map_init(&mapPostings, pHeader->dwSolvables);
+    queue_empty(pQueueCandidates);
+
+    _SolvAddTrigrams(&queueTrigrams, pszTerm);
+    for (i = 0; i < queueTrigrams.count; i++)
+    {
+        pEntry = _SolvFindTrigram(pSolvRepoInfo, queueTrigrams.elements[i]);
+        if (!pEntry)
+        {
+            /* no solvable has this trigram */
+            goto cleanup;
+        }
+        if (!pRarest || pEntry->dwCount < pRarest->dwCount)
+        {
+            pRarest = pEntry;
+        }
+    }
+
+    dwError = _SolvDecodePostings(pSolvRepoInfo, pRarest, pQueueCandidates);
+    BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+
+    for (i = 0; i < queueTrigrams.count && pQueueCandidates->count; i++)
+    {
+        pEntry = _SolvFindTrigram(pSolvRepoInfo, queueTrigrams.elements[i]);
+        if (pEntry == pRarest)
+        {
+            continue;
+        }
+        dwError = _SolvDecodePostings(pSolvRepoInfo, pEntry, &queuePostings);
+        BAIL_ON_TDNF_LIBSOLV_ERROR(dwError);
+
+        map_empty(&mapPostings);
+        for (j = 0; j < queuePostings.count; j++)
+        {
+            MAPSET(&mapPostings, queuePostings.elements[j]);
+        }
+        for (j = k = 0; j < pQueueCandidates->count; j++)
+        {
+            if (MAPTST(&mapPostings, pQueueCandidates->elements[j]))
+            {
+                pQueueCandidates->elements[k++] = pQueueCandidates->elements[j];
+            }
+        }
+        queue_truncate(pQueueCandidates, k);
+    }
+
+cleanup:
+    queue_free(&queueTrigrams);
+    queue_free(&queuePostings);
+    map_free(&mapPostings);
+    return dwError;
+error:
+    /* check everything instead */
+    dwError = 0;
+    queue_empty(pQueueCandidates);
+    for (i = 0; i < (int)pHeader->dwSolvables; i++)
+    {
+        queue_push(pQueueCandidates, i);
+    }
+    goto cleanup;
+}
+
+/* same as a SEARCH_SUBSTRING|SEARCH_NOCASE dataiterator match */
+static
+int
+_SolvSolvableMatches(
+    Solvable *pSolvable,
+    const char *pszTerm
+    )
+{
+    const char *pszValue = NULL;
+
+    pszValue = pool_id2str(pSolvable->repo->pool, pSolvable->name);
+    if (pszValue && strcasestr(pszValue, pszTerm))
+    {
+        return 1;
+    }
+    pszValue = solvable_lookup_str(pSolvable, SOLVABLE_SUMMARY);
+    if (pszValue && strcasestr(pszValue, pszTerm))
+    {
+        return 1;
+    }
+    pszValue = solvable_lookup_str(pSolvable, SOLVABLE_DESCRIPTION);
+    if (pszValue && strcasestr(pszValue, pszTerm))
+    {
+        return 1;
+    }
+    return 0;
+}
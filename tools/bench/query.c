@@ -0,0 +1,519 @@
+/*
+ * Copyright (C) 2023 VMware, Inc. All Rights Reserved.
+ *
+ * Licensed under the GNU Lesser General Public License v2.1 (the "License");
+ * you may not use this file except in compliance with the License. The terms
+ * of the License are located in the COPYING file of this distribution.
+ */
+
+/*
+ * Benchmark of the repoquery filters on a synthetic pool.
+ *
+ * usage: tdnf-bench-query [-r] [count]
+ *
+ * count solvables (default 100000) are split between an installed and
+ * an available repo. Each package provides a capability and requires
+ * the next package and a capability, every 50th with a rich dependency.
+ * With -r the former nested loop versions of the filters, and the
+ * name scan of the excludes, are run as well, and their results
+ * compared.
+ */
+
+#include <time.h>
+#include <getopt.h>
+
+#include "../../solv/includes.h"
+
+#define BENCH_DEFAULT_COUNT 100000
+
+typedef uint32_t (*PFN_FILTER)(PSolvQuery pQuery);
+
+/* looked up by the dependency filters */
+static char *_ppszBenchDeps[] = {
+    "bench-pkg-10",
+    "bench-pkg-1000",
+    "bench-cap-20",
+    "bench-cap-4000",
+    "bench-cap-4001",
+    "bench-none",
+    NULL
+};
+
+/* package names for the excludes, looked up by name or matched */
+static char *_ppszBenchExcludes[] = {
+    "bench-pkg-10",
+    "bench-pkg-2000",
+    "bench-pkg-3000",
+    "bench-pkg-12*",
+    "bench-none",
+    NULL
+};
+
+static double
+_BenchNow(void)
+{
+    struct timespec ts = {0};
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static void
+_BenchAddSolvable(
+    Repo *pRepo,
+    int nName,
+    int nRelease
+    )
+{
+    Pool *pPool = pRepo->pool;
+    Solvable *pSolvable = pool_id2solvable(pPool, repo_add_solvable(pRepo));
+    char szBuf[64];
+
+    snprintf(szBuf, sizeof(szBuf), "bench-pkg-%d", nName);
+    pSolvable->name = pool_str2id(pPool, szBuf, 1);
+    snprintf(szBuf, sizeof(szBuf), "1.0-%d", nRelease);
+    pSolvable->evr = pool_str2id(pPool, szBuf, 1);
+    pSolvable->arch = pool_str2id(pPool, "x86_64", 1);
+
+    snprintf(szBuf, sizeof(szBuf), "bench-cap-%d", nName);
+    pSolvable->provides = repo_addid_dep(pRepo, pSolvable->provides,
+        pool_rel2id(pPool, pool_str2id(pPool, szBuf, 1),
+                    pSolvable->evr, REL_EQ, 1), 0);
+    snprintf(szBuf, sizeof(szBuf), "bench-pkg-%d", nName + 1);
+    pSolvable->requires = repo_addid_dep(pRepo, pSolvable->requires,
+        pool_str2id(pPool, szBuf, 1), 0);
+    snprintf(szBuf, sizeof(szBuf), "bench-cap-%d", nName / 2);
+    pSolvable->requires = repo_addid_dep(pRepo, pSolvable->requires,
+        pool_rel2id(pPool, pool_str2id(pPool, szBuf, 1),
+                    pool_str2id(pPool, "1.0", 1), REL_GT | REL_EQ, 1), 0);
+    if (nName % 50 == 0)
+    {
+        /* (bench-pkg-<n + 2> if bench-cap-<n / 4>) */
+        Id idPkg, idCap;
+
+        snprintf(szBuf, sizeof(szBuf), "bench-pkg-%d", nName + 2);
+        idPkg = pool_str2id(pPool, szBuf, 1);
+        snprintf(szBuf, sizeof(szBuf), "bench-cap-%d", nName / 4);
+        idCap = pool_str2id(pPool, szBuf, 1);
+        pSolvable->recommends = repo_addid_dep(pRepo, pSolvable->recommends,
+            pool_rel2id(pPool, idPkg, idCap, REL_COND, 1), 0);
+    }
+}
+
+/*
+ * Half of the solvables are installed. Every 10th installed package
+ * has no counterpart in the available repo (an extra), and every 20th
+ * is installed twice (a duplicate).
+ */
+static Pool *
+_BenchCreatePool(
+    int nCount
+    )
+{
+    Pool *pPool = pool_create();
+    Repo *pInstalled = repo_create(pPool, SYSTEM_REPO_NAME);
+    Repo *pAvailable = repo_create(pPool, "bench");
+    int nInstalled = nCount / 2;
+    int i;
+
+    pool_setdisttype(pPool, DISTTYPE_RPM);
+    for (i = 0; i < nInstalled; i++)
+    {
+        _BenchAddSolvable(pInstalled, i, i % 20 == 0 ? 2 : 1);
+        if (i % 20 == 0 && ++i < nInstalled)
+        {
+            _BenchAddSolvable(pInstalled, i - 1, 1);
+        }
+    }
+    for (i = 0; i < nCount - nInstalled; i++)
+    {
+        _BenchAddSolvable(pAvailable, i, i % 10 == 0 ? 3 : 1);
+    }
+    pool_set_installed(pPool, pInstalled);
+    return pPool;
+}
+
+/* the filters as they were before they were hashed */
+static uint32_t
+_BenchNestedExtras(
+    PSolvQuery pQuery
+    )
+{
+    Pool *pPool = pQuery->pSack->pPool;
+    Queue queueExtras;
+    int i, j;
+
+    queue_init(&queueExtras);
+    for (i = 0; i < pQuery->queueResult.count; i++)
+    {
+        Solvable *s = pool_id2solvable(pPool, pQuery->queueResult.elements[i]);
+        int nFound = 0;
+
+        if (s->repo != pPool->installed)
+        {
+            continue;
+        }
+        for (j = 0; j < pQuery->queueResult.count; j++)
+        {
+            Solvable *s2 = pool_id2solvable(pPool, pQuery->queueResult.elements[j]);
+
+            if (i != j && s2->repo != pPool->installed &&
+                s2->name == s->name && s2->arch == s->arch && s2->evr == s->evr)
+            {
+                nFound = 1;
+            }
+        }
+        if (!nFound)
+        {
+            queue_push(&queueExtras, pQuery->queueResult.elements[i]);
+        }
+    }
+    queue_free(&pQuery->queueResult);
+    pQuery->queueResult = queueExtras;
+    return 0;
+}
+
+static uint32_t
+_BenchNestedDuplicates(
+    PSolvQuery pQuery
+    )
+{
+    Pool *pPool = pQuery->pSack->pPool;
+    Queue queueDuplicates;
+    int i, j;
+
+    queue_init(&queueDuplicates);
+    for (i = 0; i < pQuery->queueResult.count; i++)
+    {
+        Solvable *s = pool_id2solvable(pPool, pQuery->queueResult.elements[i]);
+        int nFound = 0;
+
+        if (s->repo != pPool->installed)
+        {
+            continue;
+        }
+        for (j = i + 1; j < pQuery->queueResult.count; j++)
+        {
+            Solvable *s2 = pool_id2solvable(pPool, pQuery->queueResult.elements[j]);
+
+            if (s2->repo == pPool->installed &&
+                s2->name == s->name && s2->arch == s->arch)
+            {
+                nFound = 1;
+            }
+        }
+        if (nFound)
+        {
+            queue_push(&queueDuplicates, pQuery->queueResult.elements[i]);
+        }
+    }
+    queue_free(&pQuery->queueResult);
+    pQuery->queueResult = queueDuplicates;
+    return 0;
+}
+
+static uint32_t
+_BenchNestedDeps(
+    PSolvQuery pQuery,
+    char **ppszDeps,
+    REPOQUERY_WHAT_KEY whatKey
+    )
+{
+    Pool *pPool = pQuery->pSack->pPool;
+    Queue queueFiltered;
+    Id allDepKeys[] = {
+        SOLVABLE_PROVIDES,
+        SOLVABLE_OBSOLETES,
+        SOLVABLE_CONFLICTS,
+        SOLVABLE_REQUIRES,
+        SOLVABLE_RECOMMENDS,
+        SOLVABLE_SUGGESTS,
+        SOLVABLE_SUPPLEMENTS,
+        SOLVABLE_ENHANCES
+    };
+    int nFirst = whatKey == REPOQUERY_WHAT_KEY_DEPENDS ?
+                 REPOQUERY_WHAT_KEY_REQUIRES : whatKey;
+    int nLast = whatKey == REPOQUERY_WHAT_KEY_DEPENDS ?
+                REPOQUERY_WHAT_KEY_ENHANCES : whatKey;
+    int i, j, k;
+
+    queue_init(&queueFiltered);
+    for (j = 0; j < pQuery->queueResult.count; j++)
+    {
+        Solvable *s = pool_id2solvable(pPool, pQuery->queueResult.elements[j]);
+        int nFound = 0;
+
+        for (i = 0; ppszDeps[i] && !nFound; i++)
+        {
+            Id idDep = pool_str2id(pPool, ppszDeps[i], 0);
+
+            for (k = nFirst; idDep && k <= nLast && !nFound; k++)
+            {
+                nFound = solvable_matchesdep(s, allDepKeys[k], idDep, 0);
+            }
+        }
+        if (nFound)
+        {
+            queue_push(&queueFiltered, pQuery->queueResult.elements[j]);
+        }
+    }
+    queue_free(&pQuery->queueResult);
+    pQuery->queueResult = queueFiltered;
+    return 0;
+}
+
+static uint32_t
+_BenchNestedWhatProvides(
+    PSolvQuery pQuery
+    )
+{
+    return _BenchNestedDeps(pQuery, _ppszBenchDeps,
+                            REPOQUERY_WHAT_KEY_PROVIDES);
+}
+
+static uint32_t
+_BenchNestedWhatRequires(
+    PSolvQuery pQuery
+    )
+{
+    return _BenchNestedDeps(pQuery, _ppszBenchDeps,
+                            REPOQUERY_WHAT_KEY_REQUIRES);
+}
+
+static uint32_t
+_BenchNestedWhatDepends(
+    PSolvQuery pQuery
+    )
+{
+    return _BenchNestedDeps(pQuery, _ppszBenchDeps,
+                            REPOQUERY_WHAT_KEY_DEPENDS);
+}
+
+static uint32_t
+_BenchWhatProvides(
+    PSolvQuery pQuery
+    )
+{
+    return SolvApplyDepsFilter(pQuery, _ppszBenchDeps,
+                               REPOQUERY_WHAT_KEY_PROVIDES);
+}
+
+static uint32_t
+_BenchWhatRequires(
+    PSolvQuery pQuery
+    )
+{
+    return SolvApplyDepsFilter(pQuery, _ppszBenchDeps,
+                               REPOQUERY_WHAT_KEY_REQUIRES);
+}
+
+static uint32_t
+_BenchWhatDepends(
+    PSolvQuery pQuery
+    )
+{
+    return SolvApplyDepsFilter(pQuery, _ppszBenchDeps,
+                               REPOQUERY_WHAT_KEY_DEPENDS);
+}
+
+/* keep the solvables of the query in pMap */
+static void
+_BenchKeepMapped(
+    PSolvQuery pQuery,
+    Map *pMap
+    )
+{
+    int i, j;
+
+    for (i = j = 0; i < pQuery->queueResult.count; i++)
+    {
+        if (MAPTST(pMap, pQuery->queueResult.elements[i]))
+        {
+            pQuery->queueResult.elements[j++] = pQuery->queueResult.elements[i];
+        }
+    }
+    queue_truncate(&pQuery->queueResult, j);
+}
+
+static uint32_t
+_BenchNestedExcludes(
+    PSolvQuery pQuery
+    )
+{
+    Pool *pPool = pQuery->pSack->pPool;
+    Dataiterator di;
+    Map mapExcludes;
+    int i;
+
+    map_init(&mapExcludes, pPool->nsolvables);
+    for (i = 0; _ppszBenchExcludes[i]; i++)
+    {
+        dataiterator_init(&di, pPool, 0, 0, SOLVABLE_NAME,
+                          _ppszBenchExcludes[i],
+                          SolvIsGlob(_ppszBenchExcludes[i]) ?
+                          SEARCH_GLOB : SEARCH_STRING);
+        while (dataiterator_step(&di))
+        {
+            MAPSET(&mapExcludes, di.solvid);
+        }
+        dataiterator_free(&di);
+    }
+    _BenchKeepMapped(pQuery, &mapExcludes);
+    map_free(&mapExcludes);
+    return 0;
+}
+
+static uint32_t
+_BenchExcludes(
+    PSolvQuery pQuery
+    )
+{
+    uint32_t dwError = 0;
+    Map mapExcludes;
+
+    map_init(&mapExcludes, pQuery->pSack->pPool->nsolvables);
+    dwError = SolvDataIterator(pQuery->pSack, _ppszBenchExcludes,
+                               &mapExcludes);
+    if (!dwError)
+    {
+        _BenchKeepMapped(pQuery, &mapExcludes);
+    }
+    map_free(&mapExcludes);
+    return dwError;
+}
+
+/* run pfnFilter on all solvables, returns the time in ms */
+static double
+_BenchRun(
+    PSolvSack pSack,
+    PFN_FILTER pfnFilter,
+    Queue *pResult
+    )
+{
+    PSolvQuery pQuery = NULL;
+    double dStart = 0;
+    double dTime = 0;
+
+    if (SolvCreateQuery(pSack, &pQuery))
+    {
+        fprintf(stderr, "failed to create query\n");
+        exit(1);
+    }
+    pool_job2solvables(pSack->pPool, &pQuery->queueResult,
+                       SOLVER_SOLVABLE_ALL, 0);
+
+    dStart = _BenchNow();
+    if (pfnFilter(pQuery))
+    {
+        fprintf(stderr, "filter failed\n");
+        exit(1);
+    }
+    dTime = _BenchNow() - dStart;
+
+    queue_init_clone(pResult, &pQuery->queueResult);
+    SolvFreeQuery(pQuery);
+    return dTime;
+}
+
+static int
+_BenchCompare(
+    const char *pszName,
+    PSolvSack pSack,
+    PFN_FILTER pfnFilter,
+    PFN_FILTER pfnReference,
+    int nReference
+    )
+{
+    Queue queueResult;
+    Queue queueReference;
+    double dTime = 0;
+    double dRefTime = 0;
+    int nRet = 0;
+
+    dTime = _BenchRun(pSack, pfnFilter, &queueResult);
+    printf("%-12s hashed: %10.1f ms, %d results\n",
+           pszName, dTime, queueResult.count);
+
+    if (nReference)
+    {
+        dRefTime = _BenchRun(pSack, pfnReference, &queueReference);
+        printf("%-12s nested: %10.1f ms, %d results, %.0fx\n",
+               pszName, dRefTime, queueReference.count,
+               dTime > 0 ? dRefTime / dTime : 0);
+        if (queueResult.count != queueReference.count ||
+            memcmp(queueResult.elements, queueReference.elements,
+                   queueResult.count * sizeof(Id)))
+        {
+            fprintf(stderr, "%s: results differ\n", pszName);
+            nRet = 1;
+        }
+        queue_free(&queueReference);
+    }
+    queue_free(&queueResult);
+    return nRet;
+}
+
+int
+main(
+    int argc,
+    char *argv[]
+    )
+{
+    PSolvSack pSack = NULL;
+    int nCount = BENCH_DEFAULT_COUNT;
+    int nReference = 0;
+    int nRet = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r")) != -1)
+    {
+        switch (opt)
+        {
+            case 'r':
+                nReference = 1;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-r] [count]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (optind < argc)
+    {
+        nCount = atoi(argv[optind]);
+    }
+    if (nCount <= 0)
+    {
+        fprintf(stderr, "invalid count\n");
+        return 1;
+    }
+
+    if (SolvCreateSack(&pSack))
+    {
+        fprintf(stderr, "failed to create sack\n");
+        return 1;
+    }
+    pSack->pPool = _BenchCreatePool(nCount);
+    printf("%d solvables\n", nCount);
+
+    nRet |= _BenchCompare("extras", pSack, SolvApplyExtrasFilter,
+                          _BenchNestedExtras, nReference);
+    nRet |= _BenchCompare("duplicates", pSack, SolvApplyDuplicatesFilter,
+                          _BenchNestedDuplicates, nReference);
+    /* the first run of each includes building its dependency index */
+    nRet |= _BenchCompare("whatprovides", pSack, _BenchWhatProvides,
+                          _BenchNestedWhatProvides, nReference);
+    nRet |= _BenchCompare("whatrequires", pSack, _BenchWhatRequires,
+                          _BenchNestedWhatRequires, nReference);
+    nRet |= _BenchCompare("whatreq-warm", pSack, _BenchWhatRequires,
+                          _BenchNestedWhatRequires, nReference);
+    nRet |= _BenchCompare("whatdepends", pSack, _BenchWhatDepends,
+                          _BenchNestedWhatDepends, nReference);
+    /* the first run includes building the name index */
+    nRet |= _BenchCompare("excludes", pSack, _BenchExcludes,
+                          _BenchNestedExcludes, nReference);
+    nRet |= _BenchCompare("excl-warm", pSack, _BenchExcludes,
+                          _BenchNestedExcludes, nReference);
+
+    SolvFreeSack(pSack);
+    return nRet;
+}
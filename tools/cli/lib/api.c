@@ -136,8 +136,7 @@ TDNFCliListPackagesPrint(
     uint32_t dwError = 0;
     uint32_t dwIndex = 0;
     PTDNF_PKG_INFO pPkg = NULL;
-    struct json_dump *jd = NULL;
-    struct json_dump *jd_pkg = NULL;
+    struct json_stream *js = NULL;
 
     #define MAX_COL_LEN 256
     char szNameAndArch[MAX_COL_LEN] = {0};
@@ -150,29 +149,25 @@ TDNFCliListPackagesPrint(
 
     if (nJsonOutput)
     {
-        jd = jd_create(0);
-        CHECK_JD_NULL(jd);
+        js = jd_stream_create(stdout, 0);
+        CHECK_JD_NULL(js);
 
-        jd_list_start(jd);
+        CHECK_JD_RC(jd_stream_list_start(js));
 
     	for(dwIndex = 0; dwIndex < dwCount; ++dwIndex)
         {
-            jd_pkg = jd_create(0);
-            CHECK_JD_NULL(jd_pkg);
-
-            CHECK_JD_RC(jd_map_start(jd_pkg));
             pPkg = &pPkgInfo[dwIndex];
 
-            CHECK_JD_RC(jd_map_add_string(jd_pkg, "Name", pPkg->pszName));
-            CHECK_JD_RC(jd_map_add_string(jd_pkg, "Arch", pPkg->pszArch));
-            CHECK_JD_RC(jd_map_add_string(jd_pkg, "Evr", pPkg->pszEVR));
-            CHECK_JD_RC(jd_map_add_string(jd_pkg, "Repo", pPkg->pszRepoName));
-
-            CHECK_JD_RC(jd_list_add_child(jd, jd_pkg));
-            JD_SAFE_DESTROY(jd_pkg);
+            CHECK_JD_RC(jd_stream_map_start(js));
+            CHECK_JD_RC(jd_stream_map_add_string(js, "Name", pPkg->pszName));
+            CHECK_JD_RC(jd_stream_map_add_string(js, "Arch", pPkg->pszArch));
+            CHECK_JD_RC(jd_stream_map_add_string(js, "Evr", pPkg->pszEVR));
+            CHECK_JD_RC(jd_stream_map_add_string(js, "Repo", pPkg->pszRepoName));
+            CHECK_JD_RC(jd_stream_map_end(js));
         }
-        pr_json(jd->buf);
-        JD_SAFE_DESTROY(jd);
+        CHECK_JD_RC(jd_stream_list_end(js));
+        CHECK_JD_RC(jd_stream_flush(js));
+        JD_STREAM_SAFE_DESTROY(js);
     }
     else
     {
@@ -217,8 +212,7 @@ cleanup:
     return dwError;
 
 error:
-    JD_SAFE_DESTROY(jd);
-    JD_SAFE_DESTROY(jd_pkg);
+    JD_STREAM_SAFE_DESTROY(js);
     goto cleanup;
 }
 
@@ -285,8 +279,7 @@ TDNFCliInfoCommand(
     uint32_t dwIndex = 0;
     uint64_t dwTotalSize = 0;
 
-    struct json_dump *jd = NULL;
-    struct json_dump *jd_pkg = NULL;
+    struct json_stream *js = NULL;
 
     if(!pContext || !pContext->hTdnf || !pContext->pFnInfo)
     {
@@ -306,38 +299,34 @@ TDNFCliInfoCommand(
 
     if (pCmdArgs->nJsonOutput)
     {
-        jd = jd_create(1024);
-        CHECK_JD_NULL(jd);
+        js = jd_stream_create(stdout, 0);
+        CHECK_JD_NULL(js);
 
-        CHECK_JD_RC(jd_list_start(jd));
+        CHECK_JD_RC(jd_stream_list_start(js));
 
         for(dwIndex = 0; dwIndex < dwCount; ++dwIndex)
         {
-            jd_pkg = jd_create(0);
-            CHECK_JD_NULL(jd_pkg);
-
-            CHECK_JD_RC(jd_map_start(jd_pkg));
             pPkg = &pPkgInfo[dwIndex];
 
-            CHECK_JD_RC(jd_map_add_string(jd_pkg, "Name", pPkg->pszName));
-            CHECK_JD_RC(jd_map_add_string(jd_pkg, "Arch", pPkg->pszArch));
-            CHECK_JD_RC(jd_map_add_string(jd_pkg, "Evr", pPkg->pszEVR));
-            CHECK_JD_RC(jd_map_add_string(jd_pkg, "Repo", pPkg->pszRepoName));
-            CHECK_JD_RC(jd_map_add_string(jd_pkg, "Url", pPkg->pszURL));
-            CHECK_JD_RC(jd_map_add_int(jd_pkg, "InstallSize", pPkg->dwInstallSizeBytes));
+            CHECK_JD_RC(jd_stream_map_start(js));
+            CHECK_JD_RC(jd_stream_map_add_string(js, "Name", pPkg->pszName));
+            CHECK_JD_RC(jd_stream_map_add_string(js, "Arch", pPkg->pszArch));
+            CHECK_JD_RC(jd_stream_map_add_string(js, "Evr", pPkg->pszEVR));
+            CHECK_JD_RC(jd_stream_map_add_string(js, "Repo", pPkg->pszRepoName));
+            CHECK_JD_RC(jd_stream_map_add_string(js, "Url", pPkg->pszURL));
+            CHECK_JD_RC(jd_stream_map_add_int(js, "InstallSize", pPkg->dwInstallSizeBytes));
             if (pPkg->dwDownloadSizeBytes)
             {
-                CHECK_JD_RC(jd_map_add_int(jd_pkg, "DownloadSize", pPkg->dwDownloadSizeBytes));
+                CHECK_JD_RC(jd_stream_map_add_int(js, "DownloadSize", pPkg->dwDownloadSizeBytes));
             }
-            CHECK_JD_RC(jd_map_add_string(jd_pkg, "Summary", pPkg->pszSummary));
-            CHECK_JD_RC(jd_map_add_string(jd_pkg, "License", pPkg->pszLicense));
-            CHECK_JD_RC(jd_map_add_string(jd_pkg, "Description", pPkg->pszDescription));
-
-            CHECK_JD_RC(jd_list_add_child(jd, jd_pkg));
-            JD_SAFE_DESTROY(jd_pkg);
+            CHECK_JD_RC(jd_stream_map_add_string(js, "Summary", pPkg->pszSummary));
+            CHECK_JD_RC(jd_stream_map_add_string(js, "License", pPkg->pszLicense));
+            CHECK_JD_RC(jd_stream_map_add_string(js, "Description", pPkg->pszDescription));
+            CHECK_JD_RC(jd_stream_map_end(js));
         }
-        pr_json(jd->buf);
-        JD_SAFE_DESTROY(jd);
+        CHECK_JD_RC(jd_stream_list_end(js));
+        CHECK_JD_RC(jd_stream_flush(js));
+        JD_STREAM_SAFE_DESTROY(js);
     }
     else
     {
@@ -388,8 +377,7 @@ cleanup:
     return dwError;
 
 error:
-    JD_SAFE_DESTROY(jd);
-    JD_SAFE_DESTROY(jd_pkg);
+    JD_STREAM_SAFE_DESTROY(js);
     goto cleanup;
 }
 
@@ -425,10 +413,11 @@ TDNFCliRepoListCommand(
 
         jd_list_start(jd);
 
+        jd_repo = jd_create(0);
+        CHECK_JD_NULL(jd_repo);
         for(pRepo = pRepoList; pRepo; pRepo = pRepo->pNext)
         {
-            jd_repo = jd_create(0);
-            CHECK_JD_NULL(jd_repo);
+            jd_reset(jd_repo);
             CHECK_JD_RC(jd_map_start(jd_repo));
 
             CHECK_JD_RC(jd_map_add_string(jd_repo, "Repo", pRepo->pszId));
@@ -436,8 +425,8 @@ TDNFCliRepoListCommand(
             CHECK_JD_RC(jd_map_add_bool(jd_repo, "Enabled", pRepo->nEnabled));
 
             CHECK_JD_RC(jd_list_add_child(jd, jd_repo));
-            JD_SAFE_DESTROY(jd_repo);
         }
+        JD_SAFE_DESTROY(jd_repo);
         pr_json(jd->buf);
         JD_SAFE_DESTROY(jd);
     }
@@ -501,10 +490,11 @@ TDNFCliSearchCommand(
 
         jd_list_start(jd);
 
+        jd_pkg = jd_create(0);
+        CHECK_JD_NULL(jd_pkg);
         for(dwIndex = 0; dwIndex < dwCount; ++dwIndex)
         {
-            jd_pkg = jd_create(0);
-            CHECK_JD_NULL(jd_pkg);
+            jd_reset(jd_pkg);
 
             CHECK_JD_RC(jd_map_start(jd_pkg));
 
@@ -514,8 +504,8 @@ TDNFCliSearchCommand(
             CHECK_JD_RC(jd_map_add_string(jd_pkg, "Summary", pPkg->pszSummary));
 
             CHECK_JD_RC(jd_list_add_child(jd, jd_pkg));
-            JD_SAFE_DESTROY(jd_pkg);
         }
+        JD_SAFE_DESTROY(jd_pkg);
         pr_json(jd->buf);
         JD_SAFE_DESTROY(jd);
     }
@@ -606,10 +596,11 @@ TDNFCliProvidesCommand(
 
         jd_list_start(jd);
 
+        jd_pkg = jd_create(0);
+        CHECK_JD_NULL(jd_pkg);
         for(pPkg = pPkgInfos; pPkg; pPkg = pPkg->pNext)
         {
-            jd_pkg = jd_create(0);
-            CHECK_JD_NULL(jd_pkg);
+            jd_reset(jd_pkg);
 
             CHECK_JD_RC(jd_map_start(jd_pkg));
 
@@ -619,8 +610,8 @@ TDNFCliProvidesCommand(
             CHECK_JD_RC(jd_map_add_string(jd_pkg, "Summary", pPkg->pszSummary));
 
             CHECK_JD_RC(jd_list_add_child(jd, jd_pkg));
-            JD_SAFE_DESTROY(jd_pkg);
         }
+        JD_SAFE_DESTROY(jd_pkg);
         pr_json(jd->buf);
         JD_SAFE_DESTROY(jd);
     }
@@ -882,10 +873,7 @@ TDNFCliRepoQueryCommand(
     char *pszResult = NULL;
     int nCount = 0, depkey, i, j, k;
     char **ppszLines = NULL;
-    struct json_dump *jd = NULL;
-    struct json_dump *jd_pkg = NULL;
-    struct json_dump *jd_list = NULL;
-    struct json_dump *jd_entry = NULL;
+    struct json_stream *js = NULL;
     char *pszQueryFormat = NULL;
     int  pszQueryFormat_len = 0;
     int  length = 0;
@@ -955,44 +943,38 @@ TDNFCliRepoQueryCommand(
 
     if (pCmdArgs->nJsonOutput)
     {
-        jd = jd_create(0);
-        CHECK_JD_NULL(jd);
+        js = jd_stream_create(stdout, 0);
+        CHECK_JD_NULL(js);
 
-        jd_list_start(jd);
+        CHECK_JD_RC(jd_stream_list_start(js));
 
         for (i = 0; i < (int)dwCount; i++)
         {
-            jd_pkg = jd_create(0);
-            CHECK_JD_NULL(jd_pkg);
-
-            CHECK_JD_RC(jd_map_start(jd_pkg));
+            CHECK_JD_RC(jd_stream_map_start(js));
 
             pPkgInfo = &pPkgInfos[i];
 
-            CHECK_JD_RC(jd_map_add_fmt(jd_pkg, "Nevra", "%s-%s-%s.%s",
-                                       pPkgInfo->pszName,
-                                       pPkgInfo->pszVersion,
-                                       pPkgInfo->pszRelease,
-                                       pPkgInfo->pszArch));
+            CHECK_JD_RC(jd_stream_map_add_fmt(js, "Nevra", "%s-%s-%s.%s",
+                                              pPkgInfo->pszName,
+                                              pPkgInfo->pszVersion,
+                                              pPkgInfo->pszRelease,
+                                              pPkgInfo->pszArch));
 
-            CHECK_JD_RC(jd_map_add_string(jd_pkg, "Name", pPkgInfo->pszName));
-            CHECK_JD_RC(jd_map_add_string(jd_pkg, "Arch", pPkgInfo->pszArch));
-            CHECK_JD_RC(jd_map_add_string(jd_pkg, "Evr", pPkgInfo->pszEVR));
-            CHECK_JD_RC(jd_map_add_string(jd_pkg, "Repo", pPkgInfo->pszRepoName));
+            CHECK_JD_RC(jd_stream_map_add_string(js, "Name", pPkgInfo->pszName));
+            CHECK_JD_RC(jd_stream_map_add_string(js, "Arch", pPkgInfo->pszArch));
+            CHECK_JD_RC(jd_stream_map_add_string(js, "Evr", pPkgInfo->pszEVR));
+            CHECK_JD_RC(jd_stream_map_add_string(js, "Repo", pPkgInfo->pszRepoName));
 
             if (pPkgInfo->ppszFileList)
             {
-                jd_list = jd_create(0);
-                CHECK_JD_NULL(jd_list);
-
-                CHECK_JD_RC(jd_list_start(jd_list));
+                CHECK_JD_RC(jd_stream_map_key(js, "Files"));
+                CHECK_JD_RC(jd_stream_list_start(js));
 
                 for (j = 0; pPkgInfo->ppszFileList[j]; j++)
                 {
-                    CHECK_JD_RC(jd_list_add_string(jd_list, pPkgInfo->ppszFileList[j]));
+                    CHECK_JD_RC(jd_stream_list_add_string(js, pPkgInfo->ppszFileList[j]));
                 }
-                CHECK_JD_RC(jd_map_add_child(jd_pkg, "Files", jd_list));
-                JD_SAFE_DESTROY(jd_list);
+                CHECK_JD_RC(jd_stream_list_end(js));
             }
             if ((pRepoqueryArgs->depKeySet & (1 << depkey)) && (pPkgInfo->pppszDependencies[depkey]))
             {
@@ -1001,58 +983,48 @@ TDNFCliRepoQueryCommand(
                                       "Supplements", "Enhances", "Depends",
                                       "RequiresPre"};
 
-                jd_list = jd_create(0);
-                CHECK_JD_NULL(jd_list);
-
-                jd_list_start(jd_list);
+                CHECK_JD_RC(jd_stream_map_key(js, strDepKeys[depkey]));
+                CHECK_JD_RC(jd_stream_list_start(js));
 
                 for (j = 0; pPkgInfo->pppszDependencies[depkey][j]; j++)
                 {
-                    CHECK_JD_RC(jd_list_add_string(jd_list, pPkgInfo->pppszDependencies[depkey][j]));
+                    CHECK_JD_RC(jd_stream_list_add_string(js, pPkgInfo->pppszDependencies[depkey][j]));
                 }
-                CHECK_JD_RC(jd_map_add_child(jd_pkg, strDepKeys[depkey], jd_list));
-                JD_SAFE_DESTROY(jd_list);
+                CHECK_JD_RC(jd_stream_list_end(js));
             }
             if (pPkgInfo->pChangeLogEntries)
             {
-                jd_list = jd_create(0);
-                CHECK_JD_NULL(jd_list);
-
-                CHECK_JD_RC(jd_list_start(jd_list));
+                CHECK_JD_RC(jd_stream_map_key(js, "ChangeLogs"));
+                CHECK_JD_RC(jd_stream_list_start(js));
 
                 PTDNF_PKG_CHANGELOG_ENTRY pEntry;
                 for (pEntry = pPkgInfo->pChangeLogEntries; pEntry; pEntry = pEntry->pNext)
                 {
-                    jd_entry = jd_create(0);
-                    CHECK_JD_NULL(jd_entry);
-
                     char szTime[20] = {0};
 
-                    jd_map_start(jd_entry);
+                    CHECK_JD_RC(jd_stream_map_start(js));
 
                     if (strftime(szTime, 20, "%a %b %d %Y", localtime(&pEntry->timeTime)))
                     {
-                        CHECK_JD_RC(jd_map_add_string(jd_entry, "Time", szTime));
+                        CHECK_JD_RC(jd_stream_map_add_string(js, "Time", szTime));
                     }
-                    CHECK_JD_RC(jd_map_add_string(jd_entry, "Author", pEntry->pszAuthor));
-                    CHECK_JD_RC(jd_map_add_string(jd_entry, "Text", pEntry->pszText));
+                    CHECK_JD_RC(jd_stream_map_add_string(js, "Author", pEntry->pszAuthor));
+                    CHECK_JD_RC(jd_stream_map_add_string(js, "Text", pEntry->pszText));
 
-                    CHECK_JD_RC(jd_list_add_child(jd_list, jd_entry));
-                    JD_SAFE_DESTROY(jd_entry);
+                    CHECK_JD_RC(jd_stream_map_end(js));
                 }
-                CHECK_JD_RC(jd_map_add_child(jd_pkg, "ChangeLogs", jd_list));
-                JD_SAFE_DESTROY(jd_list);
+                CHECK_JD_RC(jd_stream_list_end(js));
             }
             if (pPkgInfo->pszSourcePkg)
             {
-                CHECK_JD_RC(jd_map_add_string(jd_pkg, "Source", pPkgInfo->pszSourcePkg));
+                CHECK_JD_RC(jd_stream_map_add_string(js, "Source", pPkgInfo->pszSourcePkg));
             }
 
-            CHECK_JD_RC(jd_list_add_child(jd, jd_pkg));
-            JD_SAFE_DESTROY(jd_pkg);
+            CHECK_JD_RC(jd_stream_map_end(js));
         }
-        pr_json(jd->buf);
-        JD_SAFE_DESTROY(jd);
+        CHECK_JD_RC(jd_stream_list_end(js));
+        CHECK_JD_RC(jd_stream_flush(js));
+        JD_STREAM_SAFE_DESTROY(js);
     }
     else if (pRepoqueryArgs->pszQueryFormat)
     {
@@ -1172,10 +1144,7 @@ cleanup:
     return dwError;
 
 error:
-    JD_SAFE_DESTROY(jd);
-    JD_SAFE_DESTROY(jd_pkg);
-    JD_SAFE_DESTROY(jd_list);
-    JD_SAFE_DESTROY(jd_entry);
+    JD_STREAM_SAFE_DESTROY(js);
     goto cleanup;
 }
 
@@ -1338,7 +1307,8 @@ TDNFCliHistoryAlter(
     dwError = pContext->pFnHistoryResolve(pContext, pHistoryArgs, &pSolvedPkgInfo);
     BAIL_ON_CLI_ERROR(dwError);
 
-    if (pHistoryArgs->nCommand == HISTORY_CMD_INIT)
+    if (pHistoryArgs->nCommand == HISTORY_CMD_INIT ||
+        pHistoryArgs->nCommand == HISTORY_CMD_COMPACT)
     {
         /* There is nothing to do here. */
     }
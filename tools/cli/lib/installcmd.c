@@ -362,10 +362,11 @@ JDPkgList(
     CHECK_JD_NULL(jd_list);
 
     jd_list_start(jd_list);
+    jd_pkg = jd_create(0);
+    CHECK_JD_NULL(jd_pkg);
     for(pPkgInfo = pPkgInfos; pPkgInfo; pPkgInfo = pPkgInfo->pNext)
     {
-        jd_pkg = jd_create(0);
-        CHECK_JD_NULL(jd_pkg);
+        jd_reset(jd_pkg);
 
         CHECK_JD_RC(jd_map_start(jd_pkg));
 
@@ -376,8 +377,8 @@ JDPkgList(
         CHECK_JD_RC(jd_map_add_string(jd_pkg, "Repo", pPkgInfo->pszRepoName));
 
         CHECK_JD_RC(jd_list_add_child(jd_list, jd_pkg));
-        JD_SAFE_DESTROY(jd_pkg);
     }
+    JD_SAFE_DESTROY(jd_pkg);
     *ppJDList = jd_list;
 cleanup:
     return dwError;
@@ -65,6 +65,10 @@ TDNFCliParseHistoryArgs(
         {
             pHistoryArgs->nCommand = HISTORY_CMD_REDO;
         }
+        else if (strcmp(pArgs->ppszCmds[1], "compact") == 0)
+        {
+            pHistoryArgs->nCommand = HISTORY_CMD_COMPACT;
+        }
     }
 
     if (pArgs->nCmdCount > 2 && isdigit(pArgs->ppszCmds[2][0]))
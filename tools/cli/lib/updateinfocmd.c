@@ -195,47 +195,37 @@ TDNFCliUpdateInfoOutputJson(
 {
     uint32_t dwError = 0;
     PTDNF_UPDATEINFO_PKG pPkg = NULL;
-    struct json_dump *jd = jd_create(0);
-    struct json_dump *jd_info = NULL;
-    struct json_dump *jd_pkgs = NULL;
+    struct json_stream *js = jd_stream_create(stdout, 0);
 
-    CHECK_JD_NULL(jd);
-    CHECK_JD_RC(jd_list_start(jd));
+    CHECK_JD_NULL(js);
+    CHECK_JD_RC(jd_stream_list_start(js));
 
     for(; pInfo; pInfo = pInfo->pNext)
     {
-        jd_info = jd_create(0);
-        CHECK_JD_NULL(jd_info);
-        jd_pkgs = jd_create(0);
-        CHECK_JD_NULL(jd_pkgs);
+        CHECK_JD_RC(jd_stream_map_start(js));
 
-        CHECK_JD_RC(jd_map_start(jd_info));
-
-        CHECK_JD_RC(jd_map_add_string(jd_info, "Type", TDNFGetUpdateInfoType(pInfo->nType)));
-        CHECK_JD_RC(jd_map_add_string(jd_info, "UpdateID", pInfo->pszID));
+        CHECK_JD_RC(jd_stream_map_add_string(js, "Type", TDNFGetUpdateInfoType(pInfo->nType)));
+        CHECK_JD_RC(jd_stream_map_add_string(js, "UpdateID", pInfo->pszID));
         if (mode == OUTPUT_INFO)
         {
-            CHECK_JD_RC(jd_map_add_string(jd_info, "Updated", pInfo->pszDate));
-            CHECK_JD_RC(jd_map_add_bool(jd_info, "NeedsReboot", pInfo->nRebootRequired));
-            CHECK_JD_RC(jd_map_add_string(jd_info, "Description", pInfo->pszDescription));
+            CHECK_JD_RC(jd_stream_map_add_string(js, "Updated", pInfo->pszDate));
+            CHECK_JD_RC(jd_stream_map_add_bool(js, "NeedsReboot", pInfo->nRebootRequired));
+            CHECK_JD_RC(jd_stream_map_add_string(js, "Description", pInfo->pszDescription));
         }
-        CHECK_JD_RC(jd_list_start(jd_pkgs));
+        CHECK_JD_RC(jd_stream_map_key(js, "Packages"));
+        CHECK_JD_RC(jd_stream_list_start(js));
 
         for(pPkg = pInfo->pPackages; pPkg; pPkg = pPkg->pNext)
         {
-            CHECK_JD_RC(jd_list_add_string(jd_pkgs, pPkg->pszFileName));
+            CHECK_JD_RC(jd_stream_list_add_string(js, pPkg->pszFileName));
         }
-        CHECK_JD_RC(jd_map_add_child(jd_info, "Packages", jd_pkgs));
-        JD_SAFE_DESTROY(jd_pkgs);
-        CHECK_JD_RC(jd_list_add_child(jd, jd_info));
-        JD_SAFE_DESTROY(jd_info);
+        CHECK_JD_RC(jd_stream_list_end(js));
+        CHECK_JD_RC(jd_stream_map_end(js));
     }
-    pr_json(jd->buf);
-    JD_SAFE_DESTROY(jd);
+    CHECK_JD_RC(jd_stream_list_end(js));
+    CHECK_JD_RC(jd_stream_flush(js));
 
 error:
-    JD_SAFE_DESTROY(jd);
-    JD_SAFE_DESTROY(jd_info);
-    JD_SAFE_DESTROY(jd_pkgs);
+    JD_STREAM_SAFE_DESTROY(js);
     return dwError;
 }